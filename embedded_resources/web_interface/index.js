@@ -44,6 +44,67 @@ function rebootButton() {
   }
 }
 
+var fileListing = null;
+const FILES_PER_PAGE = 200;
+
+function renderFileList(page) {
+  var fs = fileListing.fs;
+  var entries = fileListing.folders.length + fileListing.files.length;
+  var pages = Math.max(1, Math.ceil(entries / FILES_PER_PAGE));
+  page = Math.min(Math.max(page, 0), pages - 1);
+  var first = page * FILES_PER_PAGE;
+  var last = first + FILES_PER_PAGE;
+
+  var tableContent = "<table><tr><th align='left'>Name</th><th style=\"text-align=center;\">Size</th><th></th></tr>\n";
+  tableContent += "<tr><th align='left'><a onclick=\"listFilesButton('" + fileListing.preFolder + "', '" + fs + "')\" href='javascript:void(0);'>... </a></th><th align='left'></th><th></th></tr>\n";
+  fileListing.folders.slice(first, last).forEach(function (item) {
+    tableContent += "<tr align='left'><td><a onclick=\"listFilesButton('" + item.path + "', '" + fs + "')\" href='javascript:void(0);'>" + item.name + "</a></td>";
+    tableContent += "<td></td>\n";
+    tableContent += "<td><i style=\"color: #e0d204;\" class=\"gg-folder\" onclick=\"listFilesButton('" + item.path + "', '" + fs + "')\"></i>&nbsp&nbsp";
+    tableContent += "<i style=\"color: #e0d204;\" class=\"gg-rename\" onclick=\"renameFile('" + item.path + "', '" + item.name + "')\"></i>&nbsp&nbsp";
+    tableContent += "<i style=\"color: #e0d204;\" class=\"gg-trash\" onclick=\"downloadDeleteButton('" + item.path + "', 'delete')\"></i></td></tr>\n\n";
+  });
+  var firstFile = Math.max(0, first - fileListing.folders.length);
+  var lastFile = Math.max(0, last - fileListing.folders.length);
+  fileListing.files.slice(firstFile, lastFile).forEach(function (item) {
+    tableContent += "<tr align='left'><td>" + item.name + "</td>\n";
+    tableContent += "<td style=\"font-size: 10px; text-align=center;\">" + item.size + "</td>\n";
+    tableContent += "<td>";
+
+    if (item.name.substring(item.name.lastIndexOf('.') + 1).toLowerCase() === "sub") {
+        tableContent += "<i class=\"gg-data\" onclick=\"sendSubFile(\'" + item.path + "\')\"></i>&nbsp&nbsp\n"
+    }
+    if (item.name.substring(item.name.lastIndexOf('.') + 1).toLowerCase() === "ir") {
+        tableContent += "<i class=\"gg-data\" onclick=\"sendIrFile(\'" + item.path + "\')\"></i>&nbsp&nbsp\n"
+    }
+    if (item.name.substring(item.name.lastIndexOf('.') + 1).toLowerCase() === "js") {
+        tableContent += "<i class=\"gg-data\" onclick=\"runJsFile(\'" + item.path + "\')\"></i>&nbsp&nbsp\n"
+    }
+    if (item.name.substring(item.name.lastIndexOf('.') + 1).toLowerCase() === "bjs") {
+        tableContent += "<i class=\"gg-data\" onclick=\"runJsFile(\'" + item.path + "\')\"></i>&nbsp&nbsp\n"
+    }
+    if (item.name.substring(item.name.lastIndexOf('.') + 1).toLowerCase() === "txt") {
+        tableContent += "<i class=\"gg-data\" onclick=\"runBadusbFile(\'" + item.path + "\')\"></i>&nbsp&nbsp\n"
+    }
+    if (item.name.substring(item.name.lastIndexOf('.') + 1).toLowerCase() === "enc") {
+        tableContent += "<i class=\"gg-data\" onclick=\"decryptAndType(\'" + item.path + "\')\"></i>&nbsp&nbsp\n"
+    }
+    tableContent += "<i class=\"gg-arrow-down-r\" onclick=\"downloadDeleteButton('" + item.path + "', 'download')\"></i>&nbsp&nbsp\n";
+    tableContent += "<i class=\"gg-rename\" onclick=\"renameFile('" + item.path + "', '" + item.name + "')\"></i>&nbsp&nbsp\n";
+    tableContent += "<i class=\"gg-trash\" onclick=\"downloadDeleteButton('" + item.path + "', 'delete')\"></i>&nbsp&nbsp\n";
+    tableContent += "<i class=\"gg-pen\"  onclick=\"downloadDeleteButton('" + item.path + "', 'edit')\">\n";
+  });
+  tableContent += "</td>\n</tr></table>";
+  if (pages > 1) {
+    tableContent += "<div>";
+    if (page > 0) tableContent += "<button onclick=\"renderFileList(" + (page - 1) + ")\">&lt; Prev</button>";
+    tableContent += " Page " + (page + 1) + " of " + pages + " (" + entries + " entries) ";
+    if (page < pages - 1) tableContent += "<button onclick=\"renderFileList(" + (page + 1) + ")\">Next &gt;</button>";
+    tableContent += "</div>";
+  }
+  _("details").innerHTML = tableContent;
+}
+
 function listFilesButton(folders, fs = 'LittleFS', userRequest = false) {
   xmlhttp = new XMLHttpRequest();
   _("actualFolder").value = "";
@@ -55,10 +116,8 @@ function listFilesButton(folders, fs = 'LittleFS', userRequest = false) {
   xmlhttp.onload = function () {
     console.log(xmlhttp.status);
     if (xmlhttp.status === 200) {
-        var responseText = xmlhttp.responseText;
-        var lines = responseText.split('\n');
-        var tableContent = "<table><tr><th align='left'>Name</th><th style=\"text-align=center;\">Size</th><th></th></tr>\n";
-        tableContent += "<tr><th align='left'><a onclick=\"listFilesButton('" + PreFolder + "', '" + fs + "')\" href='javascript:void(0);'>... </a></th><th align='left'></th><th></th></tr>\n";
+        // the device streams the entries unsorted, sorting and paging are done here
+        var lines = xmlhttp.responseText.split('\n');
         var folder = "";
         var foldersArray = [];
         var filesArray = [];
@@ -79,43 +138,8 @@ function listFilesButton(folders, fs = 'LittleFS', userRequest = false) {
         });
         foldersArray.sort((a, b) => a.name.localeCompare(b.name));
         filesArray.sort((a, b) => a.name.localeCompare(b.name));
-        foldersArray.forEach(function (item) {
-            tableContent += "<tr align='left'><td><a onclick=\"listFilesButton('" + item.path + "', '" + fs + "')\" href='javascript:void(0);'>" + item.name + "</a></td>";
-            tableContent += "<td></td>\n";
-            tableContent += "<td><i style=\"color: #e0d204;\" class=\"gg-folder\" onclick=\"listFilesButton('" + item.path + "', '" + fs + "')\"></i>&nbsp&nbsp";
-            tableContent += "<i style=\"color: #e0d204;\" class=\"gg-rename\" onclick=\"renameFile('" + item.path + "', '" + item.name + "')\"></i>&nbsp&nbsp";
-            tableContent += "<i style=\"color: #e0d204;\" class=\"gg-trash\" onclick=\"downloadDeleteButton('" + item.path + "', 'delete')\"></i></td></tr>\n\n";
-        });
-        filesArray.forEach(function (item) {
-            tableContent += "<tr align='left'><td>" + item.name + "</td>\n";
-            tableContent += "<td style=\"font-size: 10px; text-align=center;\">" + item.size + "</td>\n";
-            tableContent += "<td>";
-
-            if (item.name.substring(item.name.lastIndexOf('.') + 1).toLowerCase() === "sub") {
-                tableContent += "<i class=\"gg-data\" onclick=\"sendSubFile(\'" + item.path + "\')\"></i>&nbsp&nbsp\n"
-            }
-            if (item.name.substring(item.name.lastIndexOf('.') + 1).toLowerCase() === "ir") {
-                tableContent += "<i class=\"gg-data\" onclick=\"sendIrFile(\'" + item.path + "\')\"></i>&nbsp&nbsp\n"
-            }
-            if (item.name.substring(item.name.lastIndexOf('.') + 1).toLowerCase() === "js") {
-                tableContent += "<i class=\"gg-data\" onclick=\"runJsFile(\'" + item.path + "\')\"></i>&nbsp&nbsp\n"
-            }
-            if (item.name.substring(item.name.lastIndexOf('.') + 1).toLowerCase() === "bjs") {
-                tableContent += "<i class=\"gg-data\" onclick=\"runJsFile(\'" + item.path + "\')\"></i>&nbsp&nbsp\n"
-            }
-            if (item.name.substring(item.name.lastIndexOf('.') + 1).toLowerCase() === "txt") {
-                tableContent += "<i class=\"gg-data\" onclick=\"runBadusbFile(\'" + item.path + "\')\"></i>&nbsp&nbsp\n"
-            }
-            if (item.name.substring(item.name.lastIndexOf('.') + 1).toLowerCase() === "enc") {
-                tableContent += "<i class=\"gg-data\" onclick=\"decryptAndType(\'" + item.path + "\')\"></i>&nbsp&nbsp\n"
-            }
-            tableContent += "<i class=\"gg-arrow-down-r\" onclick=\"downloadDeleteButton('" + item.path + "', 'download')\"></i>&nbsp&nbsp\n";
-            tableContent += "<i class=\"gg-rename\" onclick=\"renameFile('" + item.path + "', '" + item.name + "')\"></i>&nbsp&nbsp\n";
-            tableContent += "<i class=\"gg-trash\" onclick=\"downloadDeleteButton('" + item.path + "', 'delete')\"></i>&nbsp&nbsp\n";
-            tableContent += "<i class=\"gg-pen\"  onclick=\"downloadDeleteButton('" + item.path + "', 'edit')\">\n";
-        });
-        tableContent += "</td>\n</tr></table>";
-        _("details").innerHTML = tableContent;
+        fileListing = { fs: fs, preFolder: PreFolder, folders: foldersArray, files: filesArray };
+        renderFileList(0);
     } else if(xmlhttp.status>0) {
         console.error('Request Error: ' + xmlhttp.status);
     }
@@ -300,11 +324,43 @@ function downloadDeleteButton(filename, action) {
 
   if (action == "download") {
     _("status").innerHTML = "";
+    if (filename.toLowerCase().endsWith(".enc") && confirm("Decrypt the file while downloading?")) {
+      if (!cachedPassword) cachedPassword = prompt("Enter decryption password: ", "");
+      if (!cachedPassword) return;  // cancelled
+      downloadDecrypted(filename, fs);
+      return;
+    }
     window.open(urltocall, "_blank");
   }
 }
 
 
+// The password goes in the body of a POST, so it isn't kept in the history or the logs like a URL
+function downloadDecrypted(filename, fs) {
+  const formdata = new FormData();
+  formdata.append("name", filename);
+  formdata.append("fs", fs);
+  formdata.append("password", cachedPassword);
+  _("status").innerHTML = "Decrypting " + filename + "...";
+  fetch("/decrypt", { method: "POST", body: formdata })
+    .then(response => {
+      if (!response.ok) return response.text().then(text => { throw new Error(text); });
+      return response.blob();  // rejected when the device ends it early: wrong password or altered file
+    })
+    .then(blob => {
+      const link = document.createElement("a");
+      link.href = URL.createObjectURL(blob);
+      link.download = filename.substring(filename.lastIndexOf("/") + 1).replace(/\.enc$/i, "");
+      link.click();
+      URL.revokeObjectURL(link.href);
+      _("status").innerHTML = "";
+    })
+    .catch(error => {
+      cachedPassword = "";
+      _("status").innerHTML = error.message || "ERROR: wrong password or altered file";
+    });
+}
+
 function cancelEdit() {
   document.querySelector('.editor-container').style.display = 'none';
   _("editor").value = "";
@@ -475,8 +531,22 @@ function processNextUpload(fs, folder) {
 }
 var cachedPassword = "";
 
+// The device derives the key of each encrypted file before its upload, that takes a while
+function uploadKey() {
+  const formdata = new FormData();
+  formdata.append("password", cachedPassword);
+  return fetch("/uploadkey", { method: "POST", body: formdata }).then(response => {
+    if (!response.ok) throw new Error();
+    return response.text();
+  });
+}
+
 function uploadFile(folder, file, fs) {
-  return new Promise((resolve, reject) => {
+  const encrypt = _("encryptCheckbox") && _("encryptCheckbox").checked;
+  if (encrypt && !cachedPassword) cachedPassword = prompt("Enter encryption password: ", "");
+  if (encrypt && !cachedPassword) return Promise.reject();  // cancelled
+  const key = encrypt ? uploadKey() : Promise.resolve("");
+  return key.then(key => new Promise((resolve, reject) => {
       const progressBarId = `${file.name}-progressBar`;
       if (!_(progressBarId)) {
           var fileProgressDiv = document.createElement("div");
@@ -484,6 +554,8 @@ function uploadFile(folder, file, fs) {
           _("file-progress-container").appendChild(fileProgressDiv);
       }
       var formdata = new FormData();
+      // the key must come before the file, the device encrypts each chunk as it arrives
+      if (key) formdata.append("key", key);
       formdata.append("file", file, file.webkitRelativePath || file.name);
       formdata.append("fs", fs);
       formdata.append("folder", folder);
@@ -494,12 +566,12 @@ function uploadFile(folder, file, fs) {
               _(progressBarId).value = Math.round(percent);
           }
       }, false);
-      ajax.addEventListener("load", () => resolve(), false);
+      ajax.addEventListener("load", () => ajax.status < 400 ? resolve() : reject(), false);
       ajax.addEventListener("error", () => reject(), false);
       ajax.addEventListener("abort", () => reject(), false);
       ajax.open("POST", "/");
       ajax.send(formdata);
-  });
+  }));
 }
 
 function systemInfo() {
@@ -19,5 +19,12 @@ public:
     virtual void releaseAll(void) {};
     virtual bool isConnected() { return false; };
     virtual void setLayout(const uint8_t *layout) {};
+    // ASCII to key table of the layout in use, see KeyboardLayout.h. nullptr when unknown
+    virtual const uint8_t *getLayout() { return nullptr; };
+    // Sends modifiers and up to 6 raw keys (0 for none) as one report, replacing the keys held.
+    // False when the host didn't take it, so it can be sent again
+    virtual bool sendKeys(uint8_t modifiers, const uint8_t *keys) { return false; };
+    // Time the host takes to accept a report, 0 when sendKeys() already waits for it
+    virtual uint32_t reportIntervalUs() { return 0; };
 };
 #endif
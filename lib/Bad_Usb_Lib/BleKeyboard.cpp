@@ -273,6 +273,30 @@ void BleKeyboard::sendReport(MediaKeyReport *keys) {
     }
 }
 
+bool BleKeyboard::sendKeys(uint8_t modifiers, const uint8_t *keys) {
+    if (!this->isConnected() || this->inputKeyboard->getSubscribedCount() == 0) return false;
+    _keyReport.modifiers = modifiers;
+    memcpy(_keyReport.keys, keys, 6);
+    // notify() returns nothing in NimBLE 1.4: it passes the return code of ble_gattc_notify_custom() to
+    // onStatus() before returning. If it didn't, nothing tells whether the host keeps up, so wait the
+    // delay between keystrokes of press() instead
+    _notifyStatus = BLE_KEYBOARD_NO_STATUS;
+    this->inputKeyboard->setValue((uint8_t *)&_keyReport, sizeof(KeyReport));
+    this->inputKeyboard->notify();
+    if (_notifyStatus == BLE_KEYBOARD_NO_STATUS) {
+        this->delay_ms(_delay_ms);
+        return true;
+    }
+    return _notifyStatus == 0;
+}
+
+uint32_t BleKeyboard::reportIntervalUs() {
+    if (this->isConnected() && pServer->getConnectedCount() > 0) {
+        return pServer->getPeerInfo(0).getConnInterval() * 1250; // 1.25ms units
+    }
+    return _delay_ms * 1000;
+}
+
 uint8_t USBPutChar(uint8_t c);
 
 // press() adds the specified key (printing, non-printing, or modifier)
@@ -469,6 +493,10 @@ void BleKeyboard::onWrite(BLECharacteristic *me) {
     ESP_LOGI(LOG_TAG, "special keys: %d", *value);
 }
 
+void BleKeyboard::onStatus(BLECharacteristic *pCharacteristic, Status s, int code) {
+    if (pCharacteristic == this->inputKeyboard) _notifyStatus = code;
+}
+
 void BleKeyboard::delay_ms(uint64_t ms) {
     uint64_t m = esp_timer_get_time();
     if (ms) {
@@ -34,6 +34,7 @@
 #define BLE_KEYBOARD_VERSION_MAJOR 0
 #define BLE_KEYBOARD_VERSION_MINOR 0
 #define BLE_KEYBOARD_VERSION_REVISION 4
+#define BLE_KEYBOARD_NO_STATUS -1 // onStatus() wasn't called for the last notification
 
 class BleKeyboard : public BLEServerCallbacks, public BLECharacteristicCallbacks, public HIDInterface {
 private:
@@ -50,6 +51,7 @@ private:
     String deviceManufacturer;
     uint8_t batteryLevel;
     bool connected = false;
+    int _notifyStatus = 0; // return code of the last notification, passed to onStatus()
     uint32_t _delay_ms = 7;
     void delay_ms(uint64_t ms);
 
@@ -70,6 +72,12 @@ public:
     void begin(const uint8_t *layout = KeyboardLayout_en_US) override { begin(layout, HID_KEYBOARD); };
     void begin(const uint8_t *layout, uint16_t showAs);
     void setLayout(const uint8_t *layout = KeyboardLayout_en_US) { _asciimap = layout; }
+    const uint8_t *getLayout() override { return _asciimap; }
+    // Doesn't wait: false when the stack is out of room for the notification, the host is behind.
+    // Paces itself like press() when the stack doesn't tell
+    bool sendKeys(uint8_t modifiers, const uint8_t *keys) override;
+    // Connection interval, or the delay between keystrokes when there is no connection yet
+    uint32_t reportIntervalUs() override;
     void end(void) override;
     void sendReport(KeyReport *keys);
     void sendReport(MediaKeyReport *keys);
@@ -101,6 +109,7 @@ protected:
     virtual void onDisconnect(BLEServer *pServer) override;
     virtual void onAuthenticationComplete(ble_gap_conn_desc *desc);
     virtual void onWrite(BLECharacteristic *me) override;
+    virtual void onStatus(BLECharacteristic *pCharacteristic, Status s, int code) override;
     virtual void
     onSubscribe(NimBLECharacteristic *pCharacteristic, ble_gap_conn_desc *desc, uint16_t subValue) override;
 };
@@ -35,6 +35,7 @@ void CH9329_Keyboard_::begin(Stream& stream, const uint8_t *layout)
 {
 	_asciimap = layout;
 	_stream = &stream;
+	_noAck = false;
 }
 
 void CH9329_Keyboard_::begin(const uint8_t *layout)
@@ -93,6 +94,39 @@ void CH9329_Keyboard_::sendReport(CH9329_KeyReport* keys)
 	_stream->write(_reportData, length);
 }
 
+bool CH9329_Keyboard_::sendKeys(uint8_t modifiers, const uint8_t *keys)
+{
+	if (_stream == nullptr) {
+		return false;
+	}
+	while (_stream->available()) {
+		_stream->read();	// answers to press() and release(), that don't read them
+	}
+	_keyReport.modifiers = modifiers;
+	memcpy(_keyReport.keys, keys, 6);
+	sendReport(&_keyReport);
+	_stream->flush();
+	if (_noAck) {
+		return true;
+	}
+
+	// 57 AB 00 82 01 <status> <sum>, status 0 when the report went to the host
+	uint8_t reply[CH9329_ACK_LENGTH];
+	size_t got = 0;
+	unsigned long start = millis();
+	while (got < CH9329_ACK_LENGTH && millis() - start < CH9329_ACK_TIMEOUT) {
+		if (_stream->available()) {
+			reply[got++] = _stream->read();
+		}
+	}
+	if (got < CH9329_ACK_LENGTH) {
+		// the chip doesn't answer (its RX isn't wired): refusals can't be told from here on
+		_noAck = true;
+		return true;
+	}
+	return reply[0] == 0x57 && reply[1] == 0xAB && reply[3] == 0x82 && reply[5] == 0x00;
+}
+
 // press() adds the specified key (printing, non-printing, or modifier)
 // to the persistent key report and sends the report.  Because of the way
 // USB HID works, the host acts like the key remains pressed until we
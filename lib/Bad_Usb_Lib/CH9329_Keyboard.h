@@ -33,6 +33,8 @@
 #define CH9329_DEFAULT_BAUDRATE 9600
 
 #define KEY_REPORT_DATA_LENGTH 14
+#define CH9329_ACK_LENGTH 7 // answer to a report
+#define CH9329_ACK_TIMEOUT 20
 
 // Low level key report: up to 6 keys and shift, ctrl etc at once
 typedef struct CH9329_KeyReport {
@@ -51,6 +53,7 @@ private:
     CH9329_KeyReport _keyReport;
     const uint8_t *_asciimap;
     Stream *_stream;
+    bool _noAck = false; // no answer came to a report
     uint8_t _reportData[KEY_REPORT_DATA_LENGTH];
     void sendReport(CH9329_KeyReport *keys);
     int getReportData(CH9329_KeyReport *keys, uint8_t *buffer, size_t size);
@@ -67,6 +70,10 @@ public:
     size_t release(uint8_t k) override;
     void releaseAll(void) override;
     void setLayout(const uint8_t *layout) override { _asciimap = layout; };
+    const uint8_t *getLayout() override { return _asciimap; };
+    // Waits for the answer of the chip, false when it reports an error. When it never answered, only
+    // waits for the frame to leave the UART and returns true: refusals can't be detected then
+    bool sendKeys(uint8_t modifiers, const uint8_t *keys) override;
 };
 extern CH9329_Keyboard_ CH9329_Keyboard;
 
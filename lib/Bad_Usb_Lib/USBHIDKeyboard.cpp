@@ -69,7 +69,7 @@ void USBHIDKeyboard::_onOutput(uint8_t report_id, const uint8_t* buffer, uint16_
     }
 }
 
-void USBHIDKeyboard::sendReport(KeyReport* keys)
+bool USBHIDKeyboard::sendReport(KeyReport* keys)
 {
     hid_keyboard_report_t report;
     report.reserved = 0;
@@ -79,7 +79,14 @@ void USBHIDKeyboard::sendReport(KeyReport* keys)
     } else {
         memset(report.keycode, 0, 6);
     }
-    hid.SendReport(HID_REPORT_ID_KEYBOARD, &report, sizeof(report));
+    return hid.SendReport(HID_REPORT_ID_KEYBOARD, &report, sizeof(report));
+}
+
+bool USBHIDKeyboard::sendKeys(uint8_t modifiers, const uint8_t *keys)
+{
+    _keyReport.modifiers = modifiers;
+    memcpy(_keyReport.keys, keys, 6);
+    return sendReport(&_keyReport);
 }
 
 #define SHIFT 0x80
@@ -63,7 +63,10 @@ public:
     size_t release(uint8_t k) override;
     void releaseAll(void) override;
     void setLayout(const uint8_t *layout) override { _asciimap = layout; };
-    void sendReport(KeyReport *keys);
+    const uint8_t *getLayout() override { return _asciimap; };
+    bool sendReport(KeyReport *keys);
+    // SendReport() waits for the host to poll the report
+    bool sendKeys(uint8_t modifiers, const uint8_t *keys) override;
 
     // raw functions work with TinyUSB's HID_KEY_* macros
     size_t pressRaw(uint8_t k) override;
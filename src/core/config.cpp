@@ -35,6 +35,7 @@ JsonDocument BruceConfig::toJson() const {
     for (auto key : evilWifiNames) _evilWifiNames.add(key);
 
     setting["bleName"] = bleName;
+    setting["badUsbFastType"] = badUsbFastType;
 
     JsonObject _wifi = setting["wifi"].to<JsonObject>();
     for (const auto &pair : wifi) { _wifi[pair.first] = pair.second; }
@@ -300,6 +301,13 @@ void BruceConfig::fromFile() {
         log_e("Fail");
     }
 
+    if (!setting["badUsbFastType"].isNull()) {
+        badUsbFastType = setting["badUsbFastType"].as<int>();
+    } else {
+        count++;
+        log_e("Fail");
+    }
+
     if (!setting["irTx"].isNull()) {
         irTx = setting["irTx"].as<int>();
     } else {
@@ -481,6 +489,7 @@ void BruceConfig::validateConfig() {
     validateLedBrightValue();
     validateLedColorValue();
     validateLedBlinkEnabledValue();
+    validateBadUsbFastTypeValue();
     validateRfScanRangeValue();
     validateRfModuleValue();
     validateRfidModuleValue();
@@ -622,6 +631,16 @@ void BruceConfig::setBleName(String value) {
     saveFile();
 }
 
+void BruceConfig::setBadUsbFastType(int value) {
+    badUsbFastType = value;
+    validateBadUsbFastTypeValue();
+    saveFile();
+}
+
+void BruceConfig::validateBadUsbFastTypeValue() {
+    if (badUsbFastType > 1) badUsbFastType = 1;
+}
+
 void BruceConfig::setIrTxPin(int value) {
     irTx = value;
     saveFile();
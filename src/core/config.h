@@ -79,6 +79,9 @@ public:
     // BLE
     String bleName = String("Keyboard_" + String((uint8_t)(ESP.getEfuseMac() >> 32), HEX));
 
+    // BadUSB
+    int badUsbFastType = 0; // several keys a report for STRING, hosts may reorder them
+
     // IR
     int irTx = LED;
     uint8_t irTxRepeats = 0;
@@ -170,6 +173,10 @@ public:
     // BLE
     void setBleName(const String name);
 
+    // BadUSB
+    void setBadUsbFastType(int value);
+    void validateBadUsbFastTypeValue();
+
     // IR
     void setIrTxPin(int value);
     void setIrTxRepeats(uint8_t value);
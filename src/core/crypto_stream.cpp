@@ -0,0 +1,115 @@
+#include "crypto_stream.h"
+#include <esp_system.h>
+#include <mbedtls/pkcs5.h>
+
+CryptoStream::CryptoStream() {
+    mbedtls_aes_init(&_aes);
+    mbedtls_md_init(&_hmac);
+}
+
+CryptoStream::~CryptoStream() {
+    mbedtls_aes_free(&_aes);
+    mbedtls_md_free(&_hmac);
+}
+
+// Derives the AES and HMAC keys from the password and authenticates the header
+bool CryptoStream::setup(
+    const String &password, const uint8_t *header, const uint8_t *salt, uint32_t iterations
+) {
+    uint8_t keys[64];
+    const mbedtls_md_info_t *sha256 = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    mbedtls_md_free(&_hmac);
+    mbedtls_md_init(&_hmac);
+    bool ok = mbedtls_md_setup(&_hmac, sha256, 1) == 0 &&
+              mbedtls_pkcs5_pbkdf2_hmac(
+                  &_hmac,
+                  (const unsigned char *)password.c_str(),
+                  password.length(),
+                  salt,
+                  ENC_SALT_SIZE,
+                  iterations,
+                  sizeof(keys),
+                  keys
+              ) == 0 &&
+              mbedtls_aes_setkey_enc(&_aes, keys, 256) == 0 &&
+              mbedtls_md_hmac_starts(&_hmac, keys + 32, 32) == 0 &&
+              mbedtls_md_hmac_update(&_hmac, header, ENC_HEADER_SIZE) == 0;
+    memset(keys, 0, sizeof(keys));
+
+    memcpy(_counter, _nonce, sizeof(_counter));
+    _blockOffset = 0;
+    _verified = false;
+    return ok;
+}
+
+bool CryptoStream::beginEncrypt(const String &password, uint8_t *header) {
+    uint32_t iterations = ENC_KDF_ITERATIONS;
+    uint8_t *p = header;
+    memcpy(p, ENC_MAGIC, 8);
+    p[8] = ENC_VERSION;
+    memcpy(p + 9, &iterations, 4);
+    esp_fill_random(p + 13, ENC_SALT_SIZE + ENC_NONCE_SIZE);
+    memcpy(_nonce, p + 13 + ENC_SALT_SIZE, ENC_NONCE_SIZE);
+    _encrypt = true;
+    return setup(password, header, p + 13, iterations);
+}
+
+bool CryptoStream::beginDecrypt(const String &password, const uint8_t *header) {
+    uint32_t iterations;
+    if (memcmp(header, ENC_MAGIC, 8) || header[8] != ENC_VERSION) return false;
+    memcpy(&iterations, header + 9, 4);
+    if (iterations == 0 || iterations > ENC_KDF_MAX_ITERATIONS) return false;
+    memcpy(_nonce, header + 13 + ENC_SALT_SIZE, ENC_NONCE_SIZE);
+    _encrypt = false;
+    return setup(password, header, header + 13, iterations);
+}
+
+void CryptoStream::update(const uint8_t *in, uint8_t *out, size_t len) {
+    if (!_encrypt && !_verified) mbedtls_md_hmac_update(&_hmac, in, len); // before `in` is overwritten
+    mbedtls_aes_crypt_ctr(&_aes, len, &_blockOffset, _counter, _block, in, out);
+    if (_encrypt) mbedtls_md_hmac_update(&_hmac, out, len);
+}
+
+void CryptoStream::authenticate(const uint8_t *in, size_t len) { mbedtls_md_hmac_update(&_hmac, in, len); }
+
+void CryptoStream::finish(uint8_t *tag) { mbedtls_md_hmac_finish(&_hmac, tag); }
+
+bool CryptoStream::verify(const uint8_t *tag) {
+    uint8_t expected[ENC_TAG_SIZE];
+    mbedtls_md_hmac_finish(&_hmac, expected);
+    uint8_t diff = 0; // constant time compare
+    for (int i = 0; i < ENC_TAG_SIZE; i++) diff |= expected[i] ^ tag[i];
+    memcpy(_counter, _nonce, sizeof(_counter));
+    _blockOffset = 0;
+    _verified = diff == 0;
+    return _verified;
+}
+
+bool isStreamEncrypted(File &file) {
+    uint8_t magic[9];
+    size_t pos = file.position();
+    bool found = file.read(magic, sizeof(magic)) == sizeof(magic) && memcmp(magic, ENC_MAGIC, 8) == 0 &&
+                 magic[8] == ENC_VERSION;
+    file.seek(pos);
+    return found;
+}
+
+bool openEncryptedFile(File &file, const String &password, CryptoStream &cs, size_t &dataLen) {
+    uint8_t header[ENC_HEADER_SIZE];
+    uint8_t buf[512];
+    size_t size = file.size();
+    if (size < ENC_HEADER_SIZE + ENC_TAG_SIZE || !file.seek(0)) return false;
+    if (file.read(header, sizeof(header)) != sizeof(header)) return false;
+    if (!cs.beginDecrypt(password, header)) return false;
+
+    dataLen = size - ENC_HEADER_SIZE - ENC_TAG_SIZE;
+    size_t left = dataLen;
+    while (left > 0) {
+        size_t n = file.read(buf, min(left, sizeof(buf)));
+        if (n == 0) return false;
+        cs.authenticate(buf, n);
+        left -= n;
+    }
+    if (file.read(buf, ENC_TAG_SIZE) != ENC_TAG_SIZE || !cs.verify(buf)) return false;
+    return file.seek(ENC_HEADER_SIZE);
+}
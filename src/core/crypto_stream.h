@@ -0,0 +1,63 @@
+#ifndef __CRYPTO_STREAM_H__
+#define __CRYPTO_STREAM_H__
+
+#include <Arduino.h>
+#include <FS.h>
+#include <mbedtls/aes.h>
+#include <mbedtls/md.h>
+
+#define ENC_MAGIC "BRUCEENC"
+#define ENC_VERSION 2
+#define ENC_KDF_ITERATIONS 2048
+#define ENC_KDF_MAX_ITERATIONS 100000 // refuse headers that would block the device for too long
+#define ENC_SALT_SIZE 16
+#define ENC_NONCE_SIZE 16
+#define ENC_HEADER_SIZE (8 + 1 + 4 + ENC_SALT_SIZE + ENC_NONCE_SIZE)
+#define ENC_TAG_SIZE 32
+
+/**
+ * @brief Streaming authenticated encryption of Bruce Encrypted Files (version 2)
+ *
+ * File layout: header | ciphertext | tag. The data is encrypted with AES-256-CTR and
+ * authenticated with HMAC-SHA256 over the header and the ciphertext, both keys derived
+ * from the password with PBKDF2. update() takes chunks of any size.
+ */
+class CryptoStream {
+public:
+    CryptoStream();
+    ~CryptoStream();
+
+    // Encryption: derives new keys and fills the header to be written before the data
+    bool beginEncrypt(const String &password, uint8_t *header);
+    // Decryption: parses the header and derives the keys. Returns false if it isn't a version 2 file
+    bool beginDecrypt(const String &password, const uint8_t *header);
+
+    // Encrypts or decrypts len bytes, `in` and `out` may be the same buffer
+    void update(const uint8_t *in, uint8_t *out, size_t len);
+    // Decryption: feeds the ciphertext to the tag only, to check a file before decrypting it
+    void authenticate(const uint8_t *in, size_t len);
+
+    // Encryption: computes the tag to be written after the data
+    void finish(uint8_t *tag);
+    // Decryption: checks the tag found after the data. Decryption restarts from the first byte
+    bool verify(const uint8_t *tag);
+
+private:
+    bool setup(const String &password, const uint8_t *header, const uint8_t *salt, uint32_t iterations);
+
+    mbedtls_aes_context _aes;
+    mbedtls_md_context_t _hmac;
+    uint8_t _nonce[ENC_NONCE_SIZE];
+    uint8_t _counter[16];
+    uint8_t _block[16];
+    size_t _blockOffset = 0;
+    bool _encrypt = true;
+    bool _verified = false;
+};
+
+// True if the file starts with a version 2 header
+bool isStreamEncrypted(File &file);
+// Checks the tag of an encrypted file, then leaves `cs` and the file ready to decrypt its data
+bool openEncryptedFile(File &file, const String &password, CryptoStream &cs, size_t &dataLen);
+
+#endif
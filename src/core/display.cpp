@@ -1,6 +1,7 @@
 #include "display.h"
 #include "core/wifi/webInterface.h" // for server
 #include "core/wifi/wg.h"           //for isConnectedWireguard to print wireguard lock
+#include "image_strip.h"
 #include "mykeyboard.h"
 #include "settings.h" //for timeStr
 #include "utils.h"
@@ -860,13 +861,11 @@ void drawWireguardStatus(int x, int y) {
 ** Description:   Função para desenhar e mostrar o menu principal
 ***************************************************************************************/
 #define MAX_ITEMS (int)(tftHeight - 20) / (LH * 2)
-Opt_Coord listFiles(int index, std::vector<FileList> fileList) {
+Opt_Coord listFiles(int index, int count, std::function<FileList(int)> item) {
     Opt_Coord coord;
     if (index == 0) { tft.fillScreen(bruceConfig.bgColor); }
     tft.setCursor(10, 10);
     tft.setTextSize(FM);
-    int i = 0;
-    int arraySize = fileList.size();
     int start = 0;
     if (index >= MAX_ITEMS) {
         start = index - MAX_ITEMS + 1;
@@ -874,28 +873,25 @@ Opt_Coord listFiles(int index, std::vector<FileList> fileList) {
     }
     int nchars = (tftWidth - 20) / (6 * tft.textsize);
     String txt = ">";
-    while (i < arraySize) {
-        if (i >= start) {
-            tft.setCursor(10, tft.getCursorY());
-            if (fileList[i].folder == true)
-                tft.setTextColor(getColorVariation(bruceConfig.priColor), bruceConfig.bgColor);
-            else if (fileList[i].operation == true) tft.setTextColor(ALCOLOR, bruceConfig.bgColor);
-            else { tft.setTextColor(bruceConfig.priColor, bruceConfig.bgColor); }
-
-            if (index == i) {
-                txt = ">";
-                coord.x = 10 + FM * LW;
-                coord.y = tft.getCursorY();
-                coord.size = nchars;
-                coord.fgcolor =
-                    fileList[i].folder ? getColorVariation(bruceConfig.priColor) : bruceConfig.priColor;
-                coord.bgcolor = bruceConfig.bgColor;
-            } else txt = " ";
-            txt += fileList[i].filename + "                 ";
-            tft.println(txt.substring(0, nchars));
-        }
-        i++;
-        if (i == (start + MAX_ITEMS) || i == arraySize) break;
+    // only the rows on screen are fetched
+    for (int i = start; i < count && i < start + MAX_ITEMS; i++) {
+        FileList file = item(i);
+        tft.setCursor(10, tft.getCursorY());
+        if (file.folder == true)
+            tft.setTextColor(getColorVariation(bruceConfig.priColor), bruceConfig.bgColor);
+        else if (file.operation == true) tft.setTextColor(ALCOLOR, bruceConfig.bgColor);
+        else { tft.setTextColor(bruceConfig.priColor, bruceConfig.bgColor); }
+
+        if (index == i) {
+            txt = ">";
+            coord.x = 10 + FM * LW;
+            coord.y = tft.getCursorY();
+            coord.size = nchars;
+            coord.fgcolor = file.folder ? getColorVariation(bruceConfig.priColor) : bruceConfig.priColor;
+            coord.bgcolor = bruceConfig.bgColor;
+        } else txt = " ";
+        txt += file.filename + "                 ";
+        tft.println(txt.substring(0, nchars));
     }
     tft.drawRoundRect(5, 5, tftWidth - 10, tftHeight - 10, 5, bruceConfig.priColor);
     tft.drawRoundRect(5, 5, tftWidth - 10, tftHeight - 10, 5, bruceConfig.priColor);
@@ -1008,78 +1004,30 @@ void drawMfkey64Icon(int x, int y) {
 // ####################################################################################################
 //  from:
 //  https://github.com/Bodmer/TFT_eSPI/blob/master/examples/Generic/ESP32_SDcard_jpeg/ESP32_SDcard_jpeg.ino
-//  This function assumes xpos,ypos is a valid screen coordinate. For convenience images that do not
-//  fit totally on the screen are cropped to the nearest MCU size and may leave right/bottom borders.
+//  MCUs (Minimum Coding Units, typically 8x8 or 16x16 pixel blocks) are gathered into strips of whole MCU
+//  rows instead of being pushed one by one. Decoding stops once the image runs off the bottom of the screen.
 void jpegRender(int xpos, int ypos) {
-
-    // jpegInfo(); // Print information from the JPEG file (could comment this line out)
-
-    uint16_t *pImg;
     uint16_t mcu_w = JpegDec.MCUWidth;
     uint16_t mcu_h = JpegDec.MCUHeight;
     uint32_t max_x = JpegDec.width;
     uint32_t max_y = JpegDec.height;
 
-    bool swapBytes = tft.getSwapBytes();
-    tft.setSwapBytes(true);
-
-    // Jpeg images are draw as a set of image block (tiles) called Minimum Coding Units (MCUs)
-    // Typically these MCUs are 16x16 pixel blocks
-    // Determine the width and height of the right and bottom edge image blocks
-    uint32_t min_w = jpg_min(mcu_w, max_x % mcu_w);
-    uint32_t min_h = jpg_min(mcu_h, max_y % mcu_h);
-
-    // save the current image block size
-    uint32_t win_w = mcu_w;
-    uint32_t win_h = mcu_h;
-
-    // save the coordinate of the right and bottom edges to assist image cropping
-    // to the screen size
-    max_x += xpos;
-    max_y += ypos;
-
-    // Fetch data from the file, decode and display
-    tft.fillRect(xpos, ypos, JpegDec.width, JpegDec.height, TFT_BLACK);
-    while (JpegDec.read()) {   // While there is more data in the file
-        pImg = JpegDec.pImage; // Decode a MCU (Minimum Coding Unit, typically a 8x8 or 16x16 pixel block)
-
-        // Calculate coordinates of top left corner of current MCU
-        int mcu_x = JpegDec.MCUx * mcu_w + xpos;
-        int mcu_y = JpegDec.MCUy * mcu_h + ypos;
-
-        // check if the image block size needs to be changed for the right edge
-        if (mcu_x + mcu_w <= max_x) win_w = mcu_w;
-        else win_w = min_w;
-
-        // check if the image block size needs to be changed for the bottom edge
-        if (mcu_y + mcu_h <= max_y) win_h = mcu_h;
-        else win_h = min_h;
-
-        // copy pixels into a contiguous block
-        if (win_w != mcu_w) {
-            uint16_t *cImg;
-            int p = 0;
-            cImg = pImg + win_w;
-            for (int h = 1; h < win_h; h++) {
-                p += mcu_w;
-                for (int w = 0; w < win_w; w++) {
-                    *cImg = *(pImg + w + p);
-                    cImg++;
-                }
-            }
+    tft.fillRect(xpos, ypos, max_x, max_y, TFT_BLACK);
+    ImageStrip strip;
+    strip.begin(xpos, ypos, max_x, max_y, mcu_h);
+    while (JpegDec.read()) {
+        uint32_t mcu_x = JpegDec.MCUx * mcu_w;
+        uint32_t mcu_y = JpegDec.MCUy * mcu_h;
+        if (ypos + (int)mcu_y >= tft.height()) {
+            JpegDec.abort();
+            break;
         }
-
-        // calculate how many pixels must be drawn
-        uint32_t mcu_pixels = win_w * win_h;
-
-        // draw image MCU block only if it will fit on the screen
-        if ((mcu_x + win_w) <= tft.width() && (mcu_y + win_h) <= tft.height())
-            tft.pushImage(mcu_x, mcu_y, win_w, win_h, pImg);
-        else if ((mcu_y + win_h) > tft.height())
-            JpegDec.abort(); // Image has run off bottom of screen so abort decoding
+        // blocks of the right and bottom edges are cropped to the image
+        uint32_t win_w = jpg_min(mcu_w, max_x - mcu_x);
+        uint32_t win_h = jpg_min(mcu_h, max_y - mcu_y);
+        strip.block(mcu_x, mcu_y, win_w, win_h, JpegDec.pImage, mcu_w);
     }
-
-    tft.setSwapBytes(swapBytes);
+    strip.end();
 }
 
 bool showJpeg(FS fs, String filename, int x, int y, bool center) {
@@ -1089,62 +1037,20 @@ bool showJpeg(FS fs, String filename, int x, int y, bool center) {
     if (fs.exists(filename)) picture = fs.open(filename, FILE_READ);
     else return false;
 
-    const size_t data_size = picture.size();
-
-    // Alloc memory into heap
-    uint8_t *data_array = new uint8_t[data_size];
-    if (data_array == nullptr) {
-        // Fail allocating memory
+    // decoded straight from the file, only the decoder's input buffer is held in memory
+    if (JpegDec.decodeFsFile(picture) != 1) {
         picture.close();
-        delete[] data_array;
-        return false;
-    }
-
-    uint8_t data;
-    int i = 0;
-    byte line_len = 0;
-
-    while (picture.available()) {
-        data = picture.read();
-        data_array[i] = data;
-        i++;
-
-        // print array on Serial
-        /*
-        Serial.print("0x");
-        if (abs(data) < 16) {
-          Serial.print("0");
-        }
-
-        Serial.print(data, HEX);
-        Serial.print(","); // Add value and comma
-        line_len++;
-        if (line_len >= 32) {
-          line_len = 0;
-          Serial.println();
-        }
-        */
-    }
-
-    picture.close();
-
-    bool decoded = false;
-    if (data_array) {
-        decoded = JpegDec.decodeArray(data_array, data_size);
-    } else {
         displayError(filename + " Fail");
         delay(2500);
-        delete[] data_array; // free heap before leaving
         return false;
     }
-
-    if (decoded) {
-        if (center) {
-            x = x + (tftWidth - JpegDec.width) / 2;
-            y = y + (tftHeight - JpegDec.height) / 2;
-        }
-        jpegRender(x, y);
+    if (center) {
+        x = x + (tftWidth - JpegDec.width) / 2;
+        y = y + (tftHeight - JpegDec.height) / 2;
     }
+    jpegRender(x, y);
+    picture.close();
+
     // calculate how long it took to draw the image
     drawTime = millis() - drawTime; // Calculate the time it took
 
@@ -1153,8 +1059,6 @@ bool showJpeg(FS fs, String filename, int x, int y, bool center) {
     Serial.print(drawTime);
     Serial.println(" ms");
     Serial.println("=====================================");
-
-    delete[] data_array; // free heap before leaving
     return true;
 }
 
@@ -1162,7 +1066,8 @@ bool showJpeg(FS fs, String filename, int x, int y, bool center) {
 //  Draw a GIF on the TFT
 //  derived from
 //  https://github.com/bitbank2/AnimatedGIF/blob/master/examples/TFT_eSPI_memory/TFT_eSPI_memory.ino and
-//  https://github.com/bitbank2/AnimatedGIF/blob/master/examples/best_practices_example/best_practices_example.ino
+//  https://github.com/bitbank2/AnimatedGIF/blob/master/examples/
+//  best_practices_example/best_practices_example.ino
 // ####################################################################################################
 
 Gif::Gif() : gifPosition(0, 0) {}
@@ -1450,100 +1355,102 @@ uint16_t getColorVariation(uint16_t color, int delta, int direction) {
     return compl_color;
 }
 
-// Draw BITMAP files
-// These read 16- and 32-bit types from the SD card file.
-// BMP data is stored little-endian, Arduino is little-endian too.
-// May need to reverse subscript order if porting elsewhere.
-
-uint16_t read16(fs::File &f) {
-    uint16_t result;
-    ((uint8_t *)&result)[0] = f.read(); // LSB
-    ((uint8_t *)&result)[1] = f.read(); // MSB
-    return result;
+// Converts n 24 bit BMP pixels to 16-bit colours, big endian as the display takes them
+static void bmpToLine(const uint8_t *bptr, uint16_t *line, int n) {
+    for (int col = 0; col < n; col++, bptr += 3) {
+        uint16_t c = ((bptr[2] & 0xF8) << 8) | ((bptr[1] & 0xFC) << 3) | (bptr[0] >> 3);
+        line[col] = __builtin_bswap16(c);
+    }
 }
 
-uint32_t read32(fs::File &f) {
-    uint32_t result;
-    ((uint8_t *)&result)[0] = f.read(); // LSB
-    ((uint8_t *)&result)[1] = f.read();
-    ((uint8_t *)&result)[2] = f.read();
-    ((uint8_t *)&result)[3] = f.read(); // MSB
-    return result;
-}
+// Draw BITMAP files
+// 24 bit uncompressed BMPs, bottom up or top down (negative height). Rows are read several at a time
+// and converted straight into the strip. Only the columns on the screen are converted: rows wider than
+// a read are read from the first visible column, in pieces.
 bool drawBmp(FS fs, String filename, int x, int y, bool center) {
     if ((x >= tft.width()) || (y >= tft.height())) return false;
     uint32_t startTime = millis();
 
-    File bmpFS;
-
-    // Open requested file on SD card
-    bmpFS = fs.open(filename, "r");
-
+    File bmpFS = fs.open(filename, "r");
     if (!bmpFS) {
-        Serial.print("File not found");
-        goto ERROR;
+        Serial.println("File not found");
+        return false;
     }
 
-    uint32_t seekOffset;
-    uint16_t w, h, row, col;
-    uint8_t r, g, b;
-
-    if (read16(bmpFS) == 0x4D42) {
-        read32(bmpFS);
-        read32(bmpFS);
-        seekOffset = read32(bmpFS);
-        read32(bmpFS);
-        w = read32(bmpFS);
-        h = read32(bmpFS);
-        if (center) {
-            x = x + (tftWidth - w) / 2;
-            y = y + (tftHeight - h) / 2;
-        }
-
-        if ((read16(bmpFS) == 1) && (read16(bmpFS) == 24) && (read32(bmpFS) == 0)) {
-            y += h - 1;
-
-            bool oldSwapBytes = tft.getSwapBytes();
-            tft.setSwapBytes(true);
-            bmpFS.seek(seekOffset);
-
-            uint16_t padding = (4 - ((w * 3) & 3)) & 3;
-            uint8_t lineBuffer[w * 3 + padding];
-
-            for (row = 0; row < h; row++) {
-
-                bmpFS.read(lineBuffer, sizeof(lineBuffer));
-                uint8_t *bptr = lineBuffer;
-                uint16_t *tptr = (uint16_t *)lineBuffer;
-                // Convert 24 to 16-bit colours
-                for (uint16_t col = 0; col < w; col++) {
-                    b = *bptr++;
-                    g = *bptr++;
-                    r = *bptr++;
-                    *tptr++ = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
-                }
-
-                // Push the pixel row to screen, pushImage will crop the line if needed
-                // y is decremented as the BMP image is drawn bottom up
-                tft.drawPixel(
-                    0, 0, 0
-                ); // shared TFT_Spi devices struggle to work, need call a line first sometimes
-                tft.pushImage(x, y--, w, 1, (uint16_t *)lineBuffer);
-            }
-            tft.setSwapBytes(oldSwapBytes);
-            Serial.print("BMP Loaded in ");
-            Serial.print(millis() - startTime);
-            Serial.println(" ms");
-        } else {
-            goto ERROR;
-        }
-    } else {
-    ERROR:
+    // BMP data is stored little-endian, like the ESP32
+    uint8_t header[34];
+    uint32_t seekOffset = 0, compression = 0;
+    int w = 0, h = 0;
+    uint16_t planes = 0, bpp = 0;
+    if (bmpFS.read(header, sizeof(header)) == sizeof(header) && header[0] == 'B' && header[1] == 'M') {
+        memcpy(&seekOffset, header + 10, 4);
+        memcpy(&w, header + 18, 4);
+        memcpy(&h, header + 22, 4);
+        memcpy(&planes, header + 26, 2);
+        memcpy(&bpp, header + 28, 2);
+        memcpy(&compression, header + 30, 4);
+    }
+    if (planes != 1 || bpp != 24 || compression != 0 || w <= 0 || h == 0) {
         Serial.println("BMP format not recognized.");
         bmpFS.close();
         return false;
     }
+    size_t rowBytes = (w * 3 + 3) & ~3;
+    bool bottomUp = h > 0;
+    h = abs(h);
+    if (center) {
+        x = x + (tftWidth - w) / 2;
+        y = y + (tftHeight - h) / 2;
+    }
+    int c0 = max(0, -x); // visible columns [c0, c1)
+    int c1 = min(w, tft.width() - x);
+    if (c1 <= c0) {
+        bmpFS.close();
+        return true;
+    }
+    int vw = c1 - c0;
+
+    bool wide = rowBytes > IMG_READ_BYTES;
+    int rowsPerRead = wide ? 1 : IMG_READ_BYTES / rowBytes;
+    uint8_t *readBuffer = (uint8_t *)malloc(wide ? IMG_READ_BYTES : rowsPerRead * rowBytes);
+    if (!readBuffer) {
+        bmpFS.close();
+        return false;
+    }
+    ImageStrip strip;
+    strip.begin(x + c0, y, vw, h, 1, bottomUp);
+    bool ok = bmpFS.seek(seekOffset);
+    for (int done = 0; ok && done < h;) {
+        int rows = min(rowsPerRead, h - done);
+        if (!wide && bmpFS.read(readBuffer, rows * rowBytes) != rows * rowBytes) ok = false;
+        for (int r = 0; ok && r < rows; r++, done++) {
+            uint16_t *line = strip.line(bottomUp ? h - 1 - done : done);
+            if (!line) {
+                ok = false;
+                break;
+            }
+            if (!wide) {
+                bmpToLine(readBuffer + r * rowBytes + c0 * 3, line, vw);
+                continue;
+            }
+            ok = bmpFS.seek(seekOffset + done * rowBytes + c0 * 3);
+            for (int col = 0; ok && col < vw; col += IMG_READ_BYTES / 3) {
+                int n = min(vw - col, IMG_READ_BYTES / 3);
+                ok = bmpFS.read(readBuffer, n * 3) == n * 3;
+                if (ok) bmpToLine(readBuffer, line + col, n);
+            }
+        }
+    }
+    strip.end();
+    free(readBuffer);
     bmpFS.close();
+    if (!ok) {
+        Serial.println("BMP read failed");
+        return false;
+    }
+    Serial.print("BMP Loaded in ");
+    Serial.print(millis() - startTime);
+    Serial.println(" ms");
     return true;
 }
 
@@ -1559,11 +1466,91 @@ bool drawImg(FS fs, String filename, int x, int y, bool center, int playDuration
     return false;
 }
 
+// Time spent decoding and drawing all the frames of a GIF, the delays between frames left out
+static int32_t gifDrawMs(FS &fs, const String &filename) {
+    Gif gif;
+    if (!gif.openGIF(&fs, filename.c_str())) return -1;
+    int x = (tftWidth - gif.getCanvasWidth()) / 2;
+    int y = (tftHeight - gif.getCanvasHeight()) / 2;
+    int32_t busy = 0;
+    int result;
+    do {
+        uint32_t start = millis();
+        result = gif.playFrame(x, y);
+        if (result != 2) busy += millis() - start; // 2: waiting for the next frame
+    } while (result > 0);
+    return result < 0 ? -1 : busy;
+}
+
+/***************************************************************************************
+** Function name: imageBenchmark
+** Description:   Draws the images of a folder and shows the average time per image by format
+***************************************************************************************/
+void imageBenchmark(FS fs, String folder) {
+    const char *formats[] = {"bmp", "jpg", "png", "gif"};
+    unsigned long count[4] = {0, 0, 0, 0};
+    unsigned long total[4] = {0, 0, 0, 0};
+    unsigned long worst[4] = {0, 0, 0, 0};
+
+    File dir = fs.open(folder);
+    if (!dir || !dir.isDirectory()) {
+        displayError("Folder not found", true);
+        return;
+    }
+    while (!check(EscPress)) {
+        File file = dir.openNextFile();
+        if (!file) break;
+        String path = file.path();
+        bool isDir = file.isDirectory();
+        file.close();
+        if (isDir) continue;
+        String ext = path.substring(path.lastIndexOf('.') + 1);
+        ext.toLowerCase();
+        for (int f = 0; f < 4; f++) {
+            if (ext != formats[f]) continue;
+            tft.fillScreen(bruceConfig.bgColor);
+            int32_t ms;
+            if (f == 3) {
+                ms = gifDrawMs(fs, path);
+            } else {
+                uint32_t start = millis();
+                ms = drawImg(fs, path, 0, 0, true) ? millis() - start : -1;
+            }
+            if (ms < 0) break;
+            count[f]++;
+            total[f] += ms;
+            worst[f] = max(worst[f], (unsigned long)ms);
+            Serial.printf("Image benchmark: %s %ldms\n", path.c_str(), (long)ms);
+        }
+    }
+    dir.close();
+
+    drawMainBorderWithTitle("IMAGE BENCHMARK");
+    padprintln("");
+    for (int f = 0; f < 4; f++) {
+        String fmt = formats[f];
+        fmt.toUpperCase();
+        if (count[f] == 0) {
+            padprintln(fmt + ": no images");
+            continue;
+        }
+        padprintf("%s: %lu, avg %lums, max %lums\n", fmt.c_str(), count[f], total[f] / count[f], worst[f]);
+        Serial.printf(
+            "Image benchmark %s: %lu images, avg %lums, max %lums\n",
+            fmt.c_str(),
+            count[f],
+            total[f] / count[f],
+            worst[f]
+        );
+    }
+    delay(200);
+    while (!check(AnyKeyPress)) delay(10);
+}
+
 #if !defined(LITE_MODE)
 /// Draw PNG files
 
 #include <PNGdec.h>
-#define MAX_IMAGE_WIDTH 320
 PNG *png;
 // Functions to access a file on the SD card
 File myfile;
@@ -1589,16 +1576,10 @@ int32_t mySeek(PNGFILE *handle, int32_t position) {
 // Function to draw pixels to the display
 int16_t xpos = 0;
 int16_t ypos = 0;
+uint32_t pngBackground = 0; // transparent pixels get the background color
 void PNGDraw(PNGDRAW *pDraw) {
-    uint16_t usPixels[320];
-    // static uint16_t dmaBuffer[MAX_IMAGE_WIDTH]; // static so buffer persists after fn exit
-    uint8_t r = ((uint16_t)bruceConfig.bgColor & 0xF800) >> 8;
-    uint8_t g = ((uint16_t)bruceConfig.bgColor & 0x07E0) >> 3;
-    uint8_t b = ((uint16_t)bruceConfig.bgColor & 0x001F) << 3;
-    png->getLineAsRGB565(pDraw, usPixels, PNG_RGB565_BIG_ENDIAN, b << 16 | g << 8 | r);
-    tft.drawPixel(0, 0, 0);
-    tft.drawPixel(0, 0, 0);
-    tft.pushImage(xpos, ypos + pDraw->y, pDraw->iWidth, 1, usPixels);
+    uint16_t *line = ((ImageStrip *)pDraw->pUser)->line(pDraw->y);
+    if (line) png->getLineAsRGB565(pDraw, line, PNG_RGB565_BIG_ENDIAN, pngBackground);
 }
 
 bool drawPNG(FS fs, String filename, int x, int y, bool center) {
@@ -1611,23 +1592,27 @@ bool drawPNG(FS fs, String filename, int x, int y, bool center) {
         // Serial.printf("image specs: (%d x %d), %d bpp, pixel type: %d\n", png->getWidth(),
         // png->getHeight(), png->getBpp(), png->getPixelType());
 
+        xpos = x;
+        ypos = y;
         if (center) {
             xpos = x + (tftWidth - png->getWidth()) / 2;
             ypos = y + (tftHeight - png->getHeight()) / 2;
         }
-
-        if (png->getWidth() > MAX_IMAGE_WIDTH) {
-            Serial.println("Image too wide for allocated line buffer size!");
-        } else {
-            rc = png->decode(NULL, 0);
-            png->close();
-        }
+        uint8_t r = ((uint16_t)bruceConfig.bgColor & 0xF800) >> 8;
+        uint8_t g = ((uint16_t)bruceConfig.bgColor & 0x07E0) >> 3;
+        uint8_t b = ((uint16_t)bruceConfig.bgColor & 0x001F) << 3;
+        pngBackground = b << 16 | g << 8 | r;
+
+        ImageStrip strip;
+        strip.begin(xpos, ypos, png->getWidth(), png->getHeight());
+        rc = png->decode(&strip, 0);
+        strip.end();
+        png->close();
         // How long did rendering take...
         Serial.print("PNG Loaded in ");
         Serial.print(millis() - dt);
         Serial.println("ms");
     } else {
-    ERROR:
         delete png;
         return false;
     }
@@ -1637,5 +1622,6 @@ bool drawPNG(FS fs, String filename, int x, int y, bool center) {
 #else
 bool drawPNG(FS fs, String filename, int x, int y, bool center) {
     log_w("PNG: Not supported in this version");
+    return false;
 }
 #endif
@@ -6,6 +6,7 @@
 #include <FS.h>
 #include <LittleFS.h>
 #include <SD.h>
+#include <functional>
 #include <globals.h>
 #define BORDER_PAD_X 10
 #define BORDER_PAD_Y 28
@@ -89,6 +90,8 @@ bool drawPNG(FS fs, String filename, int x, int y, bool center);
 bool drawBmp(FS fs, String filename, int x = 0, int y = 0, bool center = false);
 bool showGif(FS *fs, const char *filename, int x = 0, int y = 0, bool center = false, int playDurationMs = 0);
 bool showJpeg(FS fs, String filename, int x = 0, int y = 0, bool center = false);
+// Draws the BMP, JPEG, PNG and GIF files of `folder` and reports the time per image of each format
+void imageBenchmark(FS fs, String folder);
 
 uint16_t getComplementaryColor(uint16_t color);
 uint16_t getComplementaryColor2(uint16_t color);
@@ -168,7 +171,7 @@ void printSubtitle(String subtitle, bool withLine = true);
 void printFootnote(String text);
 void printCenterFootnote(String text);
 
-Opt_Coord listFiles(int index, std::vector<FileList> fileList);
+Opt_Coord listFiles(int index, int count, std::function<FileList(int)> item);
 
 void drawWireguardStatus(int x, int y);
 
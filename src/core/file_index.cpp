@@ -0,0 +1,333 @@
+#include "file_index.h"
+#include <algorithm>
+
+#define FILE_INDEX_VERSION 1
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+
+struct __attribute__((packed)) FileIndexHeader {
+    char magic[3]; // "BFI"
+    uint8_t version;
+    uint32_t count;
+    uint32_t hash;
+    uint32_t namesLen;
+    uint16_t pathLen; // the folder path follows, two paths may have the same file name
+};
+
+static uint32_t fnv(uint32_t hash, const char *data, size_t len) {
+    for (size_t i = 0; i < len; i++) hash = (hash ^ (uint8_t)data[i]) * FNV_PRIME;
+    return hash;
+}
+
+static uint32_t entryHash(uint32_t hash, const char *name, size_t len, bool folder) {
+    char type = folder ? '/' : '.';
+    return fnv(fnv(hash, name, len), &type, 1);
+}
+
+static uint64_t sortKey(const char *name, size_t len) {
+    uint64_t key = 0;
+    for (size_t i = 0; i < 8; i++) key = key << 8 | (i < len ? toupper((uint8_t)name[i]) : 0);
+    return key;
+}
+
+// Same order as comparing the upper cased names
+static int compareUpper(const char *a, size_t aLen, const char *b, size_t bLen) {
+    for (size_t i = 0; i < aLen && i < bLen; i++) {
+        int diff = toupper((uint8_t)a[i]) - toupper((uint8_t)b[i]);
+        if (diff) return diff;
+    }
+    return (int)aLen - (int)bLen;
+}
+
+static String normalized(const String &folder) {
+    if (folder.length() > 1 && folder.endsWith("/")) return folder.substring(0, folder.length() - 1);
+    return folder.length() ? folder : String("/");
+}
+
+static String indexPath(const String &folder) {
+    char name[16];
+    uint32_t hash = fnv(FNV_OFFSET, folder.c_str(), folder.length());
+    snprintf(name, sizeof(name), "/%08lx.idx", (unsigned long)hash);
+    return String(FILE_INDEX_DIR) + name;
+}
+
+// Name of a folder entry without its path, nullptr for entries that are not listed
+static const char *entryName(const String &folder, File &f) {
+    const char *name = f.name();
+    const char *slash = strrchr(name, '/');
+    if (slash) name = slash + 1;
+    if (folder == "/" && strcmp(name, FILE_INDEX_DIR + 1) == 0) return nullptr;
+    return name;
+}
+
+static void *growBuffer(void *buf, size_t bytes) {
+    return psramFound() ? ps_realloc(buf, bytes) : realloc(buf, bytes);
+}
+
+bool FileIndex::open(FS &fs, const String &folder, const String &allowedExt) {
+    close();
+    _fs = &fs;
+    _folder = normalized(folder);
+    _ext = allowedExt;
+    unsigned long start = millis();
+    bool cached = load();
+    if (!cached && !build()) return false;
+    _verifying = cached;
+    applyFilter();
+    Serial.printf(
+        "File index: %lu entries of %s %s in %lums\n",
+        (unsigned long)_count,
+        _folder.c_str(),
+        cached ? "loaded" : "listed",
+        millis() - start
+    );
+    return true;
+}
+
+void FileIndex::freeMemory() {
+    free(_records);
+    free(_names);
+    _records = nullptr;
+    _names = nullptr;
+}
+
+void FileIndex::close() {
+    freeMemory();
+    if (_file) _file.close();
+    if (_scan) _scan.close();
+    free(_pageNames);
+    _pageNames = nullptr;
+    _pageNamesCap = 0;
+    _pageCount = 0;
+    _count = 0;
+    _map.clear();
+    _filtered = false;
+    _verifying = false;
+}
+
+bool FileIndex::build() {
+    File root = _fs->open(_folder);
+    if (!root || !root.isDirectory()) return false;
+
+    Record *records = nullptr;
+    char *names = nullptr;
+    uint32_t count = 0, recordsCap = 0;
+    uint32_t namesLen = 0, namesCap = 0;
+    uint32_t hash = FNV_OFFSET;
+    bool complete = true;
+    for (File f = root.openNextFile(); f; f = root.openNextFile()) {
+        const char *name = entryName(_folder, f);
+        if (!name) continue;
+        size_t len = strlen(name);
+        bool folder = f.isDirectory();
+        if (count == recordsCap) {
+            recordsCap = max(recordsCap * 2, (uint32_t)FILE_INDEX_MIN_ENTRIES);
+            Record *grown = (Record *)growBuffer(records, recordsCap * sizeof(Record));
+            if (!grown) complete = false;
+            else records = grown;
+        }
+        if (complete && namesLen + len > namesCap) {
+            namesCap = max(namesCap * 2, namesLen + (uint32_t)len + 1024);
+            char *grown = (char *)growBuffer(names, namesCap);
+            if (!grown) complete = false;
+            else names = grown;
+        }
+        if (!complete) break;
+        hash = entryHash(hash, name, len, folder);
+        memcpy(names + namesLen, name, len);
+        records[count++] = {sortKey(name, len), namesLen, (uint16_t)len, folder, 0};
+        namesLen += len;
+    }
+    root.close();
+    if (!complete) {
+        Serial.printf(
+            "File index: out of memory, %s listed up to %lu entries\n", _folder.c_str(), (unsigned long)count
+        );
+    }
+
+    // folders first, then by name
+    std::sort(records, records + count, [names](const Record &a, const Record &b) {
+        if (a.folder != b.folder) return a.folder > b.folder;
+        if (a.key != b.key) return a.key < b.key;
+        return compareUpper(names + a.name, a.len, names + b.name, b.len) < 0;
+    });
+
+    _records = records;
+    _names = names;
+    _count = count;
+    _hash = hash;
+    if (complete && count >= FILE_INDEX_MIN_ENTRIES && save(records, names, namesLen) && load()) freeMemory();
+    return true;
+}
+
+bool FileIndex::save(const Record *records, const char *names, uint32_t namesLen) {
+    if (!_fs->exists(FILE_INDEX_DIR) && !_fs->mkdir(FILE_INDEX_DIR)) return false;
+    String path = indexPath(_folder);
+    File f = _fs->open(path, FILE_WRITE);
+    if (!f) return false;
+
+    FileIndexHeader header = {
+        {'B', 'F', 'I'},
+        FILE_INDEX_VERSION, _count, _hash, namesLen, (uint16_t)_folder.length()
+    };
+    bool ok = f.write((uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+              f.write((const uint8_t *)_folder.c_str(), _folder.length()) == _folder.length();
+    // names go in listing order, so the names of a page are read at once
+    uint32_t offset = 0;
+    for (uint32_t i = 0; ok && i < _count; i++) {
+        Record rec = records[i];
+        rec.name = offset;
+        offset += rec.len;
+        ok = f.write((uint8_t *)&rec, sizeof(rec)) == sizeof(rec);
+    }
+    for (uint32_t i = 0; ok && i < _count; i++) {
+        ok = f.write((const uint8_t *)names + records[i].name, records[i].len) == records[i].len;
+    }
+    f.close();
+    if (!ok) _fs->remove(path);
+    return ok;
+}
+
+bool FileIndex::load() {
+    String path = indexPath(_folder);
+    if (!_fs->exists(path)) return false;
+    File f = _fs->open(path, FILE_READ);
+    if (!f) return false;
+
+    FileIndexHeader header;
+    if (f.read((uint8_t *)&header, sizeof(header)) != sizeof(header) || memcmp(header.magic, "BFI", 3) != 0 ||
+        header.version != FILE_INDEX_VERSION || header.pathLen != _folder.length()) {
+        return false;
+    }
+    char stored[64];
+    for (uint16_t done = 0; done < header.pathLen;) {
+        uint16_t n = min<uint16_t>(sizeof(stored), header.pathLen - done);
+        if (f.read((uint8_t *)stored, n) != n || memcmp(stored, _folder.c_str() + done, n) != 0) return false;
+        done += n;
+    }
+    uint32_t tableOffset = sizeof(header) + header.pathLen;
+    uint32_t namesOffset = tableOffset + header.count * sizeof(Record);
+    if (f.size() != namesOffset + header.namesLen) return false;
+
+    _file = f;
+    _tableOffset = tableOffset;
+    _namesOffset = namesOffset;
+    _count = header.count;
+    _hash = header.hash;
+    _pageCount = 0;
+    return true;
+}
+
+const FileIndex::Record &FileIndex::record(uint32_t r) {
+    static const Record none = {0, 0, 0, 0, 0};
+    if (_records) return _records[r];
+    if (r < _pageFirst || r >= _pageFirst + _pageCount) {
+        uint32_t first = r - r % FILE_INDEX_PAGE;
+        uint32_t count = min<uint32_t>(FILE_INDEX_PAGE, _count - first);
+        _pageCount = 0;
+        _file.seek(_tableOffset + first * sizeof(Record));
+        if (_file.read((uint8_t *)_page, count * sizeof(Record)) != count * sizeof(Record)) return none;
+
+        uint32_t start = _page[0].name;
+        uint32_t len = _page[count - 1].name + _page[count - 1].len - start;
+        if (len > _pageNamesCap) {
+            char *grown = (char *)realloc(_pageNames, len);
+            if (!grown) return none;
+            _pageNames = grown;
+            _pageNamesCap = len;
+        }
+        _file.seek(_namesOffset + start);
+        if (_file.read((uint8_t *)_pageNames, len) != len) return none;
+        _pageFirst = first;
+        _pageCount = count;
+        _pageNamesStart = start;
+    }
+    return _page[r - _pageFirst];
+}
+
+// Name of a record just returned by record(), not null terminated
+const char *FileIndex::name(const Record &rec) {
+    if (rec.len == 0) return "";
+    return _records ? _names + rec.name : _pageNames + (rec.name - _pageNamesStart);
+}
+
+void FileIndex::applyFilter() {
+    _map.clear();
+    _filtered = _ext != "*";
+    if (!_filtered) return;
+    for (uint32_t r = 0; r < _count; r++) {
+        const Record &rec = record(r);
+        if (!rec.folder) {
+            const char *n = name(rec);
+            int dot = rec.len - 1;
+            while (dot >= 0 && n[dot] != '.') dot--;
+            String ext;
+            ext.concat(n + dot + 1, rec.len - dot - 1);
+            if (!checkExt(ext, _ext)) continue;
+        }
+        _map.push_back(r);
+    }
+}
+
+FileList FileIndex::get(uint32_t i) {
+    FileList item;
+    item.folder = false;
+    item.operation = false;
+    if (i >= size()) return item;
+    const Record &rec = record(recordOf(i));
+    item.filename.concat(name(rec), rec.len);
+    item.folder = rec.folder;
+    return item;
+}
+
+int FileIndex::find(char letter, uint32_t from) {
+    uint32_t n = size();
+    uint8_t upper = toupper((uint8_t)letter);
+    for (uint32_t k = 0; k < n; k++) {
+        uint32_t i = (from + k) % n;
+        if ((record(recordOf(i)).key >> 56) == upper) return i;
+    }
+    return -1;
+}
+
+bool FileIndex::verify() {
+    if (!_verifying) return false;
+    if (!_scan) {
+        _scan = _fs->open(_folder);
+        _scanCount = 0;
+        _scanHash = FNV_OFFSET;
+        if (!_scan) {
+            _verifying = false;
+            return false;
+        }
+    }
+    for (int n = 0; n < FILE_INDEX_VERIFY_STEP; n++) {
+        File f = _scan.openNextFile();
+        if (f) {
+            const char *name = entryName(_folder, f);
+            if (name) {
+                _scanHash = entryHash(_scanHash, name, strlen(name), f.isDirectory());
+                _scanCount++;
+            }
+            continue;
+        }
+        _scan.close();
+        _verifying = false;
+        if (_scanCount == _count && _scanHash == _hash) return false;
+
+        Serial.println("File index: " + _folder + " changed, listing it again");
+        FS &fs = *_fs;
+        String folder = _folder;
+        String ext = _ext;
+        close();
+        invalidate(fs, folder);
+        open(fs, folder, ext);
+        return true;
+    }
+    return false;
+}
+
+void FileIndex::invalidate(FS &fs, const String &folder) {
+    String path = indexPath(normalized(folder));
+    if (fs.exists(path)) fs.remove(path);
+}
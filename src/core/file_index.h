@@ -0,0 +1,92 @@
+#ifndef __FILE_INDEX_H__
+#define __FILE_INDEX_H__
+
+#include "sd_functions.h"
+#include <FS.h>
+#include <vector>
+
+#define FILE_INDEX_DIR "/.bruceidx"  // index files, named after a hash of the folder path
+#define FILE_INDEX_MIN_ENTRIES 64    // smaller folders are scanned on every open and kept in RAM
+#define FILE_INDEX_PAGE 16           // records read at once, about a screen of rows
+#define FILE_INDEX_VERIFY_STEP 4     // folder entries checked by each verify() call
+
+/**
+ * @brief Sorted listing of a folder, read a page at a time
+ *
+ * The folder is scanned once: names are packed into a single buffer and each entry gets a sort key made of
+ * its first 8 upper cased characters, so the sort mostly compares integers. Listings of big folders are
+ * written to FILE_INDEX_DIR and later opens only read the header, rows are then read FILE_INDEX_PAGE at a
+ * time as they are shown, whatever the folder size.
+ * invalidate() drops an index when Bruce changes the folder. Changes made by anything else are caught by
+ * verify(), that walks the folder a few entries at a time while the listing is in use.
+ */
+class FileIndex {
+public:
+    ~FileIndex() { close(); }
+
+    // Lists `folder`, from its index when there is one. allowedExt filters the files ("*", "sub" or
+    // "sub|ir"), folders are always listed
+    bool open(FS &fs, const String &folder, const String &allowedExt = "*");
+    void close();
+
+    // Entries listed, folders first
+    uint32_t size() const { return _filtered ? _map.size() : _count; }
+    FileList get(uint32_t i);
+    // First entry from `from` on, wrapping around, whose name starts with `letter`. -1 if there is none
+    int find(char letter, uint32_t from);
+    // Checks a few more entries of the folder against the index. Returns true when the folder had changed
+    // and was listed again
+    bool verify();
+
+    // Drops the index of `folder`, to be called after changing its content
+    static void invalidate(FS &fs, const String &folder);
+
+private:
+    struct Record {
+        uint64_t key;  // first 8 characters, upper case, big endian
+        uint32_t name; // offset in the names
+        uint16_t len;
+        uint8_t folder;
+        uint8_t reserved;
+    };
+
+    bool build();
+    bool load();
+    bool save(const Record *records, const char *names, uint32_t namesLen);
+    void applyFilter();
+    const Record &record(uint32_t r);
+    const char *name(const Record &rec);
+    uint32_t recordOf(uint32_t i) const { return _filtered ? _map[i] : i; }
+    void freeMemory();
+
+    FS *_fs = nullptr;
+    String _folder;
+    String _ext;
+    uint32_t _count = 0;
+    uint32_t _hash = 0; // of the names in directory order, to tell when the folder changed
+
+    // small folders, or when the index can't be written: everything in RAM
+    Record *_records = nullptr;
+    char *_names = nullptr;
+
+    // big folders: the index file and the page last read from it
+    File _file;
+    uint32_t _tableOffset = 0;
+    uint32_t _namesOffset = 0;
+    Record _page[FILE_INDEX_PAGE];
+    uint32_t _pageFirst = 0;
+    uint32_t _pageCount = 0;
+    char *_pageNames = nullptr;
+    uint32_t _pageNamesStart = 0;
+    uint32_t _pageNamesCap = 0;
+
+    bool _filtered = false;
+    std::vector<uint32_t> _map; // filtered entry -> record
+
+    File _scan; // verify() walk
+    bool _verifying = false;
+    uint32_t _scanCount = 0;
+    uint32_t _scanHash = 0;
+};
+
+#endif
@@ -0,0 +1,167 @@
+#include "image_strip.h"
+#include <climits>
+#include <esp_heap_caps.h>
+#include <globals.h>
+
+#if defined(HAS_SCREEN) && defined(ESP32_DMA) && !defined(TFT_PARALLEL_8_BIT)
+#define IMG_STRIP_DMA
+#endif
+
+static bool displayBusShared() {
+#if TFT_MOSI > 0
+    return bruceConfig.SDCARD_bus.mosi == (gpio_num_t)TFT_MOSI ||
+           bruceConfig.CC1101_bus.mosi == (gpio_num_t)TFT_MOSI ||
+           bruceConfig.NRF24_bus.mosi == (gpio_num_t)TFT_MOSI;
+#else
+    return false;
+#endif
+}
+
+void ImageStrip::begin(int x, int y, int w, int h, int rowAlign, bool bottomUp) {
+    end();
+    _x = x;
+    _y = y;
+    _w = w;
+    _h = h;
+    _align = max(rowAlign, 1);
+    _bottomUp = bottomUp;
+    _cx0 = max(0, -x);
+    _cx1 = min(w, tft.width() - x);
+    _cy0 = max(0, -y);
+    _cy1 = min(h, tft.height() - y);
+    _rows = 0;
+    _first = 0;
+    _lo = INT_MAX;
+    _hi = -1;
+    _pending = -1;
+    _cur = 0;
+    _dma = false;
+    _shared = displayBusShared();
+    _swap = tft.getSwapBytes();
+    tft.setSwapBytes(false); // strips are filled big endian, as the display wants them
+    _active = true;
+
+    int vw = _cx1 - _cx0;
+    if (vw <= 0 || _cy1 <= _cy0) return; // off screen, rows are just dropped
+    int rows = IMG_STRIP_BYTES / (vw * (int)sizeof(uint16_t)) / _align * _align;
+    rows = min(rows, (h + _align - 1) / _align * _align);
+    if (rows == 0) return;
+    size_t bytes = rows * vw * sizeof(uint16_t);
+#ifdef IMG_STRIP_DMA
+    if (!_shared) {
+        if (!tft.DMA_Enabled) tft.initDMA();
+        _buf[0] = (uint16_t *)heap_caps_malloc(bytes, MALLOC_CAP_DMA);
+        _buf[1] = (uint16_t *)heap_caps_malloc(bytes, MALLOC_CAP_DMA);
+        _dma = tft.DMA_Enabled && _buf[0] && _buf[1];
+        if (!_dma) {
+            free(_buf[1]);
+            _buf[1] = nullptr;
+        }
+    }
+#endif
+    if (!_buf[0]) _buf[0] = (uint16_t *)malloc(bytes);
+    if (!_buf[0]) return; // row by row then
+    _rows = rows;
+#ifdef IMG_STRIP_DMA
+    if (_dma) tft.startWrite();
+#endif
+}
+
+// Where `row` goes in the strip, moving the strip to it if needed. nullptr for rows off screen or when
+// there is no strip
+uint16_t *ImageStrip::stripRow(int row) {
+    if (_rows == 0 || row < _cy0 || row >= _cy1) return nullptr;
+    if (row < _first || row >= _first + _rows) {
+        flush();
+        _first = _bottomUp ? max(row - _rows + 1, _cy0) : row - row % _align;
+    }
+    _lo = min(_lo, row);
+    _hi = max(_hi, row);
+    return _buf[_cur] + (row - _first) * (_cx1 - _cx0);
+}
+
+uint16_t *ImageStrip::line(int row) {
+    if (!_active) return nullptr;
+    commitLine();
+    if (_cx0 == 0 && _cx1 == _w) { // the whole row is on screen, decoded in place
+        uint16_t *dst = stripRow(row);
+        if (dst) return dst;
+    }
+    if (!_scratch) _scratch = (uint16_t *)malloc(_w * sizeof(uint16_t));
+    if (!_scratch) return nullptr;
+    _pending = row;
+    return _scratch;
+}
+
+void ImageStrip::commitLine() {
+    int row = _pending;
+    _pending = -1;
+    if (row < _cy0 || row >= _cy1 || _cx1 <= _cx0) return;
+    uint16_t *src = _scratch + _cx0;
+    int vw = _cx1 - _cx0;
+    uint16_t *dst = stripRow(row);
+    if (dst) memcpy(dst, src, vw * sizeof(uint16_t));
+    else push(_x + _cx0, _y + row, vw, 1, src);
+}
+
+void ImageStrip::block(int bx, int by, int bw, int bh, const uint16_t *pixels, int stride) {
+    if (!_active) return;
+    int c0 = max(bx, _cx0);
+    int c1 = min(bx + bw, _cx1);
+    if (c0 >= c1) return;
+    for (int r = 0; r < bh; r++) {
+        int row = by + r;
+        if (row < _cy0 || row >= _cy1) continue;
+        const uint16_t *src = pixels + r * stride + (c0 - bx);
+        uint16_t *dst = stripRow(row);
+        if (!dst) {
+            tft.setSwapBytes(true);
+            tft.pushImage(_x + c0, _y + row, c1 - c0, 1, (uint16_t *)src);
+            tft.setSwapBytes(false);
+            continue;
+        }
+        dst += c0 - _cx0;
+        for (int c = c0; c < c1; c++) *dst++ = __builtin_bswap16(*src++);
+    }
+}
+
+void ImageStrip::flush() {
+    if (_hi < _lo) return;
+    int vw = _cx1 - _cx0;
+    push(_x + _cx0, _y + _lo, vw, _hi - _lo + 1, _buf[_cur] + (_lo - _first) * vw);
+    if (_dma) _cur ^= 1; // the other one is free once pushImageDMA() returns
+    _lo = INT_MAX;
+    _hi = -1;
+}
+
+void ImageStrip::push(int x, int y, int w, int h, uint16_t *pixels) {
+#ifdef IMG_STRIP_DMA
+    if (_dma) {
+        tft.pushImageDMA(x, y, w, h, pixels);
+        return;
+    }
+#endif
+    // shared TFT_Spi devices struggle to work, need call a pixel first sometimes
+    if (_shared) tft.drawPixel(0, 0, 0);
+    tft.pushImage(x, y, w, h, pixels);
+}
+
+void ImageStrip::end() {
+    if (_active) {
+        commitLine();
+        flush();
+#ifdef IMG_STRIP_DMA
+        if (_dma) {
+            tft.dmaWait();
+            tft.endWrite();
+        }
+#endif
+        tft.setSwapBytes(_swap);
+        _active = false;
+    }
+    free(_buf[0]);
+    free(_buf[1]);
+    free(_scratch);
+    _buf[0] = _buf[1] = _scratch = nullptr;
+    _dma = false;
+}
@@ -0,0 +1,57 @@
+#ifndef __IMAGE_STRIP_H__
+#define __IMAGE_STRIP_H__
+
+#include <Arduino.h>
+
+#define IMG_STRIP_BYTES 16384 // each strip buffer (two with DMA): 16 rows of a 512 pixel wide screen
+#define IMG_READ_BYTES 4096   // file reads of the decoders that don't buffer their input
+
+/**
+ * @brief Gathers decoded image rows into strips pushed to the display as one window
+ *
+ * Decoders write rows, or JPEG MCUs, into the current strip and the strip is pushed when the next row falls
+ * outside of it. Only the part of the image that is on the screen is kept, so the memory used is the same
+ * whatever the image size. With DMA a strip is sent while the decoder fills the other buffer.
+ * DMA is left out when another device shares the display bus, their transfers don't mix.
+ */
+class ImageStrip {
+public:
+    ~ImageStrip() { end(); }
+
+    // w x h image drawn at (x, y). Strips hold a multiple of rowAlign rows, rows come top down unless
+    // bottomUp
+    void begin(int x, int y, int w, int h, int rowAlign = 1, bool bottomUp = false);
+    // Buffer for the w big endian pixels of `row`, valid until the next call
+    uint16_t *line(int row);
+    // bw x bh block of native endian pixels at (bx, by) in the image, rows `stride` pixels apart
+    void block(int bx, int by, int bw, int bh, const uint16_t *pixels, int stride);
+    // Pushes what is left and waits for the display
+    void end();
+
+    bool usesDma() const { return _dma; }
+
+private:
+    uint16_t *stripRow(int row);
+    void commitLine();
+    void flush();
+    void push(int x, int y, int w, int h, uint16_t *pixels);
+
+    uint16_t *_buf[2] = {nullptr, nullptr};
+    uint16_t *_scratch = nullptr; // one image row, for rows the strip can't take whole
+    int _x = 0, _y = 0, _w = 0, _h = 0;
+    int _cx0 = 0, _cx1 = 0;       // visible columns [cx0, cx1) and rows [cy0, cy1) of the image
+    int _cy0 = 0, _cy1 = 0;
+    int _rows = 0;                // rows in a strip, 0 when pushing row by row
+    int _align = 1;
+    int _first = 0;               // image row at the top of the strip
+    int _lo = 0, _hi = -1;        // rows written in the strip
+    int _pending = -1;            // row waiting in _scratch
+    uint8_t _cur = 0;             // buffer being filled
+    bool _bottomUp = false;
+    bool _dma = false;
+    bool _shared = false;         // the display bus has other devices on it
+    bool _swap = false;
+    bool _active = false;
+};
+
+#endif
@@ -29,6 +29,7 @@ void ConfigMenu::optionsMenu() {
         {"Led Blink On/Off", setLedBlinkConfig},
 #endif
         {"Sound On/Off", setSoundConfig},
+        {"BadUSB Fast Type", setBadUsbFastTypeConfig},
         {"Startup WiFi", setWifiStartupConfig},
         {"Startup App", setStartupApp},
         {"Network Creds", setNetworkCredsMenu},
@@ -14,6 +14,7 @@ void RFMenu::optionsMenu() {
         {"Record RAW",      rf_raw_record             }, // Pablo-Ortiz-Lopez
         {"Custom SubGhz",   sendCustomRF              },
         {"Spectrum",        rf_spectrum               },
+        {"RSSI Spectrum",   rf_rssi_spectrum          },
         {"SquareWave Spec", rf_SquareWave             }, // @Pirata
         {"Jammer Itmt",     [=]() { RFJammer(false); }},
         {"Jammer Full",     [=]() { RFJammer(true); } },
@@ -2,6 +2,7 @@
 #include <Arduino.h>
 #include <MD5Builder.h>
 
+#include "crypto_stream.h"
 #include "mykeyboard.h"
 #include "passwords.h"
 #include "sd_functions.h"
@@ -81,6 +82,34 @@ String readDecryptedFile(FS &fs, String filepath) {
     File cyphertextFile = fs.open(filepath, FILE_READ);
     if (!cyphertextFile) return "";
 
+    if (isStreamEncrypted(cyphertextFile)) {
+        // version 2 (binary, authenticated), e.g. uploaded with a password from the WebUI
+        CryptoStream cipher;
+        size_t dataLen = 0;
+        String plaintext;
+        bool ok = openEncryptedFile(cyphertextFile, cachedPassword, cipher, dataLen) &&
+                  plaintext.reserve(dataLen);
+        uint8_t buf[256];
+        while (ok && dataLen > 0) {
+            size_t n = cyphertextFile.read(buf, min(dataLen, sizeof(buf)));
+            if (n == 0) { // short read: only the whole, authenticated data is returned
+                ok = false;
+                break;
+            }
+            cipher.update(buf, buf, n);
+            plaintext.concat((const char *)buf, n);
+            dataLen -= n;
+        }
+        cyphertextFile.close();
+        if (!ok) {
+            // invalidate cached password -> will ask again on the next try
+            cachedPassword = "";
+            displayError("decryption failed (invalid password?)");
+            return "";
+        }
+        return plaintext;
+    }
+
     String line;
     String cypertextData = "";
     String plaintext = "";
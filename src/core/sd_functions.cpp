@@ -1,5 +1,6 @@
 #include "sd_functions.h"
 #include "display.h" // using displayRedStripe as error msg
+#include "file_index.h"
 #include "modules/badusb_ble/ducky_typer.h"
 #include "modules/bjs_interpreter/interpreter.h"
 #include "modules/gps/wigle.h"
@@ -14,12 +15,10 @@
 #include <globals.h>
 
 #include <MD5Builder.h>
-#include <algorithm>       // for std::sort
 #include <esp32/rom/crc.h> // for CRC32
 
 // SPIClass sdcardSPI;
 String fileToCopy;
-std::vector<FileList> fileList;
 
 /***************************************************************************************
 ** Function name: setupSdCard
@@ -114,11 +113,18 @@ bool ToggleSDCard() {
         return sdcardMounted;
     }
 }
+// Folder holding `path`
+static String parentFolder(const String &path) {
+    String parent = path.substring(0, path.lastIndexOf('/'));
+    return parent == "" ? "/" : parent;
+}
+
 /***************************************************************************************
 ** Function name: deleteFromSd
 ** Description:   delete file or folder
 ***************************************************************************************/
 bool deleteFromSd(FS fs, String path) {
+    FileIndex::invalidate(fs, parentFolder(path));
     File dir = fs.open(path);
     if (!dir.isDirectory()) {
         dir.close();
@@ -155,6 +161,7 @@ bool renameFile(FS fs, String path, String filename) {
     String newName = keyboard(filename, 76, "Type the new Name:");
     // Rename the file of folder
     if (fs.rename(path, path.substring(0, path.lastIndexOf('/')) + "/" + newName)) {
+        FileIndex::invalidate(fs, parentFolder(path));
         // Serial.println("Renamed from " + filename + " to " + newName);
         return true;
     } else {
@@ -194,6 +201,7 @@ bool copyToFs(FS from, FS to, String path, bool draw) {
         Serial.println("Fail creating destination file");
         return false;
     }
+    FileIndex::invalidate(to, "/");
     size_t bytesRead;
     int tot = source.size();
     int prog = 0;
@@ -276,6 +284,7 @@ bool pasteFile(FS fs, String path) {
         sourceFile.close();
         return false;
     }
+    FileIndex::invalidate(fs, path);
 
     // Ler dados do arquivo original e escrever no arquivo de destino
     size_t bytesRead;
@@ -324,6 +333,7 @@ bool createFolder(FS fs, String path) {
         displayRedStripe("Couldn't create folder");
         return false;
     }
+    FileIndex::invalidate(fs, path);
     return true;
 }
 
@@ -438,22 +448,6 @@ String crc32File(FS &fs, String filepath) {
     return (String(s));
 }
 
-/***************************************************************************************
-** Function name: sortList
-** Description:   sort files for name
-***************************************************************************************/
-bool sortList(const FileList &a, const FileList &b) {
-    if (a.folder != b.folder) {
-        return a.folder > b.folder; // true if a is a folder and b is not
-    }
-    // Order items alfabetically
-    String fa = a.filename.c_str();
-    fa.toUpperCase();
-    String fb = b.filename.c_str();
-    fb.toUpperCase();
-    return fa < fb;
-}
-
 /***************************************************************************************
 ** Function name: checkExt
 ** Description:   check file extension
@@ -478,52 +472,6 @@ bool checkExt(String ext, String pattern) {
     return ext == lastExt;
 }
 
-/***************************************************************************************
-** Function name: sortList
-** Description:   sort files for name
-***************************************************************************************/
-void readFs(FS fs, String folder, String allowed_ext) {
-    int allFilesCount = 0;
-    fileList.clear();
-    FileList object;
-
-    File root = fs.open(folder);
-    if (!root || !root.isDirectory()) { return; }
-    File file = root.openNextFile();
-    while (file && fileList.size() < 250) {
-        String fileName = file.name();
-        if (file.isDirectory()) {
-            object.filename = fileName.substring(fileName.lastIndexOf("/") + 1);
-            object.folder = true;
-            object.operation = false;
-            fileList.push_back(object);
-        } else {
-            String ext = fileName.substring(fileName.lastIndexOf(".") + 1);
-            if (allowed_ext == "*" || checkExt(ext, allowed_ext)) {
-                object.filename = fileName.substring(fileName.lastIndexOf("/") + 1);
-                object.folder = false;
-                object.operation = false;
-                fileList.push_back(object);
-            }
-        }
-        file = root.openNextFile();
-    }
-    file.close();
-    root.close();
-
-    // Sort folders/files
-    std::sort(fileList.begin(), fileList.end(), sortList);
-
-    Serial.println("Files listed with: " + String(fileList.size()) + " files/folders found");
-
-    // Adds Operational btn at the botton
-    object.filename = "> Back";
-    object.folder = false;
-    object.operation = true;
-
-    fileList.push_back(object);
-}
-
 /*********************************************************************
 **  Function: loopSD
 **  Where you choose what to do with your SD Files
@@ -541,6 +489,17 @@ String loopSD(FS &fs, bool filePicker, String allowed_ext, String rootPath) {
     }
 
     Opt_Coord coord;
+    FileIndex dirIndex;
+    FileList selected;
+    // the listing is read from the index as it is shown, "> Back" comes after its last entry
+    auto entry = [&](int i) {
+        if (i < (int)dirIndex.size()) return dirIndex.get(i);
+        FileList back;
+        back.filename = "> Back";
+        back.folder = false;
+        back.operation = true;
+        return back;
+    };
     String result = "";
     bool reload = false;
     bool redraw = true;
@@ -560,9 +519,9 @@ String loopSD(FS &fs, bool filePicker, String allowed_ext, String rootPath) {
     bool exit = false;
     // returnToMenu=true;  // make sure menu is redrawn when quitting in any point
 
-    readFs(fs, Folder, allowed_ext);
+    dirIndex.open(fs, Folder, allowed_ext);
 
-    maxFiles = fileList.size() - 1; // discount the >back operator
+    maxFiles = dirIndex.size(); // index of the >back operator
     LongPress = false;
     unsigned long LongPressTmp = millis();
     while (1) {
@@ -576,21 +535,27 @@ String loopSD(FS &fs, bool filePicker, String allowed_ext, String rootPath) {
                 tft.fillScreen(bruceConfig.bgColor);
                 tft.drawRoundRect(5, 5, tftWidth - 10, tftHeight - 10, 5, bruceConfig.priColor);
                 Serial.println("reload to read: " + Folder);
-                readFs(fs, Folder, allowed_ext);
+                dirIndex.open(fs, Folder, allowed_ext);
                 PreFolder = Folder;
-                maxFiles = fileList.size() - 1;
+                maxFiles = dirIndex.size();
                 if (strcmp(PreFolder.c_str(), Folder.c_str()) != 0 || index > maxFiles) index = 0;
                 reload = false;
             }
-            if (fileList.size() < 2) readFs(fs, Folder, allowed_ext);
 
-            coord = listFiles(index, fileList);
+            coord = listFiles(index, maxFiles + 1, entry);
+            selected = entry(index);
 #if defined(HAS_TOUCH)
             TouchFooter();
 #endif
             redraw = false;
         }
-        displayScrollingText(fileList[index].filename, coord);
+        displayScrollingText(selected.filename, coord);
+        // changes made to the folder by something else show up once the index is checked
+        if (dirIndex.verify()) {
+            maxFiles = dirIndex.size();
+            if (index > maxFiles) index = maxFiles;
+            redraw = true;
+        }
 
 #ifdef HAS_KEYBOARD
         const short PAGE_JUMP_SIZE = 5;
@@ -613,22 +578,12 @@ String loopSD(FS &fs, bool filePicker, String allowed_ext, String rootPath) {
         // check letter shortcuts
         if (pressed_letter > 0) {
             // Serial.println(pressed_letter);
-            if (tolower(fileList[index].filename.c_str()[0]) == pressed_letter) {
-                // already selected, go to the next
-                index += 1;
-                // check if index is still valid
-                if (index <= maxFiles && tolower(fileList[index].filename.c_str()[0]) == pressed_letter) {
-                    redraw = true;
-                    continue;
-                }
-            }
-            // else look again from the start
-            for (int i = 0; i < maxFiles; i++) {
-                if (tolower(fileList[i].filename.c_str()[0]) == pressed_letter) { // check if 1st char matches
-                    index = i;
-                    redraw = true;
-                    break; // quit on 1st match
-                }
+            // already selected: go to the next one, else look again from the start
+            bool onLetter = tolower(selected.filename.c_str()[0]) == pressed_letter;
+            int found = dirIndex.find(pressed_letter, onLetter ? index + 1 : 0);
+            if (found >= 0) {
+                index = found;
+                redraw = true;
             }
         }
 #elif defined(T_EMBED) || defined(HAS_TOUCH)
@@ -655,24 +610,24 @@ String loopSD(FS &fs, bool filePicker, String allowed_ext, String rootPath) {
             }
             if (LongPress && millis() - LongPressTmp < 500) goto WAITING;
             LongPress = false;
+            selected = entry(index);
 
             if (check(SelPress)) {
-                if (fileList[index].folder == true && fileList[index].operation == false) {
+                if (selected.folder == true && selected.operation == false) {
+                    String name = selected.filename;
                     options = {
-                        {"New Folder", [=]() { createFolder(fs, Folder); }                           },
-                        {"Rename",
-                         [=]() {
-                             renameFile(fs, Folder + fileList[index].filename, fileList[index].filename);
-                         }                                                                           },
-                        {"Delete",     [=]() { deleteFromSd(fs, Folder + fileList[index].filename); }},
-                        {"Close Menu", [&]() { yield(); }                                            },
-                        {"Main Menu",  [&]() { exit = true; }                                        },
+                        {"New Folder", [=]() { createFolder(fs, Folder); }          },
+                        {"Rename",     [=]() { renameFile(fs, Folder + name, name); }},
+                        {"Delete",     [=]() { deleteFromSd(fs, Folder + name); }   },
+                        {"Close Menu", [&]() { yield(); }                           },
+                        {"Main Menu",  [&]() { exit = true; }                       },
                     };
+                    dirIndex.close();
                     loopOptions(options);
                     tft.drawRoundRect(5, 5, tftWidth - 10, tftHeight - 10, 5, bruceConfig.priColor);
                     reload = true;
                     redraw = true;
-                } else if (fileList[index].folder == false && fileList[index].operation == false) {
+                } else if (selected.folder == false && selected.operation == false) {
                     goto Files;
                 } else {
                     options = {
@@ -681,6 +636,7 @@ String loopSD(FS &fs, bool filePicker, String allowed_ext, String rootPath) {
                     if (fileToCopy != "") options.push_back({"Paste", [=]() { pasteFile(fs, Folder); }});
                     options.push_back({"Close Menu", [&]() { yield(); }});
                     options.push_back({"Main Menu", [&]() { exit = true; }});
+                    dirIndex.close();
                     loopOptions(options);
                     tft.drawRoundRect(5, 5, tftWidth - 10, tftHeight - 10, 5, bruceConfig.priColor);
                     reload = true;
@@ -688,19 +644,18 @@ String loopSD(FS &fs, bool filePicker, String allowed_ext, String rootPath) {
                 }
             } else {
             Files:
-                if (fileList[index].folder == true && fileList[index].operation == false) {
-                    Folder = Folder + (Folder == "/" ? "" : "/") +
-                             fileList[index].filename; // Folder=="/"? "":"/" +
+                if (selected.folder == true && selected.operation == false) {
+                    Folder = Folder + (Folder == "/" ? "" : "/") + selected.filename; // Folder=="/"? "":"/" +
                     // Debug viewer
                     Serial.println(Folder);
                     redraw = true;
-                } else if (fileList[index].folder == false && fileList[index].operation == false) {
+                } else if (selected.folder == false && selected.operation == false) {
                     // Save the file/folder info to Clear memory to allow other functions to work better
-                    String filepath = Folder + (Folder == "/" ? "" : "/") + fileList[index].filename; //
-                    String filename = fileList[index].filename;
+                    String filepath = Folder + (Folder == "/" ? "" : "/") + selected.filename; //
+                    String filename = selected.filename;
                     // Debug viewer
                     Serial.println(filepath + " --> " + filename);
-                    fileList.clear(); // Clear memory to allow other functions to work better
+                    dirIndex.close(); // Clear memory to allow other functions to work better
 
                     options = {
                         {"View File",  [=]() { viewFile(fs, filepath); }            },
@@ -718,12 +673,17 @@ String loopSD(FS &fs, bool filePicker, String allowed_ext, String rootPath) {
 
                     // custom file formats commands added in front
                     if (filepath.endsWith(".jpg") || filepath.endsWith(".gif") || filepath.endsWith(".bmp") ||
-                        filepath.endsWith(".png"))
+                        filepath.endsWith(".png")) {
+                        options.insert(options.begin(), {"Image Benchmark", [&]() {
+                                                             delay(200);
+                                                             imageBenchmark(fs, Folder);
+                                                         }});
                         options.insert(options.begin(), {"View Image", [&]() {
                                                              drawImg(fs, filepath, 0, 0, true, -1);
                                                              delay(750);
                                                              while (!check(AnyKeyPress)) delay(10);
                                                          }});
+                    }
                     if (filepath.endsWith(".ir"))
                         options.insert(options.begin(), {"IR Tx SpamAll", [&]() {
                                                              delay(200);
@@ -852,7 +812,7 @@ String loopSD(FS &fs, bool filePicker, String allowed_ext, String rootPath) {
             delay(10);
         }
     }
-    fileList.clear();
+    dirIndex.close();
     return result;
 }
 
@@ -966,5 +926,6 @@ File createNewFile(FS *&fs, String filepath, String filename) {
 
     Serial.println("Creating file: " + name + ext);
     File file = (*fs).open(name + ext, FILE_WRITE);
+    if (file) FileIndex::invalidate(*fs, filepath);
     return file;
 }
@@ -138,7 +138,7 @@ uint32_t irTxBufferCallback(cmd *c) {
     f.close();
     free(txt);
 
-    bool r = txIrFile(&PSRamFS, tmpfilepath);
+    bool r = txIrFile(&PSRamFS, tmpfilepath, false); // no sidecar for a temporary file
     PSRamFS.remove(tmpfilepath);
 
     return r;
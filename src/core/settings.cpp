@@ -255,6 +255,18 @@ void setLedBlinkConfig() {
     loopOptions(options, bruceConfig.ledBlinkEnabled);
 }
 
+/*********************************************************************
+**  Function: setBadUsbFastTypeConfig
+**  Type BadUSB STRING text one key a report, or several keys a report
+**********************************************************************/
+void setBadUsbFastTypeConfig() {
+    options = {
+        {"One key a report", [=]() { bruceConfig.setBadUsbFastType(0); }, bruceConfig.badUsbFastType == 0},
+        {"6 keys a report",  [=]() { bruceConfig.setBadUsbFastType(1); }, bruceConfig.badUsbFastType == 1},
+    };
+    loopOptions(options, bruceConfig.badUsbFastType);
+}
+
 /*********************************************************************
 **  Function: setWifiStartupConfig
 **  Enable or disable wifi connection at startup
@@ -52,6 +52,8 @@ void setSoundConfig();
 
 void setLedBlinkConfig();
 
+void setBadUsbFastTypeConfig();
+
 void setWifiStartupConfig();
 
 void setStartupApp();
@@ -0,0 +1,118 @@
+#include "spectrum_view.h"
+#include "display.h"
+
+#define RGB565(r, g, b) ((((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3)))
+#define SPECTRUM_GRID_COLOR RGB565(25, 25, 25)
+
+static uint8_t peak[SPECTRUM_MAX_COLS];       // peak hold, decays a bit on each waterfall row
+static uint8_t rowLevel[SPECTRUM_MAX_COLS];   // max level since the last waterfall row
+static uint8_t drawnHeight[SPECTRUM_MAX_COLS]; // bar drawn in the sprite, 0xFF forces a redraw
+static uint8_t drawnPeak[SPECTRUM_MAX_COLS];
+
+static uint16_t heatColor(uint8_t level) {
+    if (level < 8) return bruceConfig.bgColor;
+    int v = min((int)level, SPECTRUM_LEVEL_MAX) * 255 / SPECTRUM_LEVEL_MAX;
+    int r = 0, g = 0, b = 0;
+    if (v < 85) b = v * 3;
+    else if (v < 170) {
+        g = (v - 85) * 3;
+        b = 255 - g;
+    } else {
+        r = (v - 170) * 3;
+        g = 255 - r;
+    }
+    return RGB565(r, g, b);
+}
+
+void spectrumViewBegin(SpectrumView &v, int cols, bool grid) {
+    memset(peak, 0, sizeof(peak));
+    memset(rowLevel, 0, sizeof(rowLevel));
+    memset(drawnHeight, 0xFF, sizeof(drawnHeight));
+    memset(drawnPeak, 0xFF, sizeof(drawnPeak));
+
+    v.cols = constrain(cols, 1, min((int)tftWidth, SPECTRUM_MAX_COLS));
+    v.bw = max(tftWidth / v.cols, 1);
+    v.x = (tftWidth - v.bw * v.cols) / 2;
+    v.specY = LH + 2;
+    int area = tftHeight - 2 * LH - 6;
+    v.specH = min(area * 3 / 5, SPECTRUM_LEVEL_MAX);
+    v.wfY = v.specY + v.specH + 2;
+    v.wfH = area - v.specH - 2;
+    v.grid = grid;
+    v.lastRow = millis();
+
+    v.useSprite = false;
+#if defined(HAS_SCREEN)
+    sprite.setColorDepth(8);
+    v.useSprite = sprite.createSprite(v.bw * v.cols, v.specH) != nullptr;
+    draw.setColorDepth(8);
+    if (draw.createSprite(v.bw * v.cols, v.wfH)) {
+        draw.fillSprite(bruceConfig.bgColor);
+        draw.setScrollRect(0, 0, v.bw * v.cols, v.wfH, bruceConfig.bgColor);
+    }
+#endif
+}
+
+void spectrumViewEnd() {
+#if defined(HAS_SCREEN)
+    sprite.deleteSprite();
+    draw.deleteSprite();
+#endif
+}
+
+// Draws column `c` at (x, y) of `d`, the screen or the sprite
+template <typename D>
+static void drawColumn(D &d, int x, int y, const SpectrumView &v, int c, int h, int p) {
+    uint16_t bg = bruceConfig.bgColor;
+    uint16_t bar = bruceConfig.priColor;
+    if (v.grid) {
+        if (c % 8 == 0) bg = SPECTRUM_GRID_COLOR;
+        if (c % 2) bar = TFT_DARKGREY;
+    }
+    d.fillRect(x, y, v.bw, v.specH - h, bg);
+    d.fillRect(x, y + v.specH - h, v.bw, h, bar);
+    if (p > h) d.drawFastHLine(x, y + v.specH - p, v.bw, TFT_WHITE);
+}
+
+void spectrumViewUpdate(SpectrumView &v, const uint8_t *levels) {
+    int run = -1; // first column of a run of changed columns, pushed together
+    for (int c = 0; c <= v.cols; c++) {
+        bool changed = false;
+        if (c < v.cols) {
+            uint8_t level = min((int)levels[c], SPECTRUM_LEVEL_MAX);
+            peak[c] = max(peak[c], level);
+            rowLevel[c] = max(rowLevel[c], level);
+            int h = level * v.specH / SPECTRUM_LEVEL_MAX;
+            int p = peak[c] * v.specH / SPECTRUM_LEVEL_MAX;
+            changed = h != drawnHeight[c] || p != drawnPeak[c];
+            if (changed) {
+                if (v.useSprite) drawColumn(sprite, c * v.bw, 0, v, c, h, p);
+                else drawColumn(tft, v.x + c * v.bw, v.specY, v, c, h, p);
+                drawnHeight[c] = h;
+                drawnPeak[c] = p;
+            }
+        }
+        if (changed && run < 0) run = c;
+        if (!changed && run >= 0) {
+#if defined(HAS_SCREEN)
+            if (v.useSprite)
+                sprite.pushSprite(v.x + run * v.bw, v.specY, run * v.bw, 0, (c - run) * v.bw, v.specH);
+#endif
+            run = -1;
+        }
+    }
+
+    if (millis() - v.lastRow < SPECTRUM_WATERFALL_MS) return;
+    v.lastRow = millis();
+#if defined(HAS_SCREEN)
+    if (draw.created()) {
+        draw.scroll(0, 1);
+        for (int c = 0; c < v.cols; c++) draw.drawFastHLine(c * v.bw, 0, v.bw, heatColor(rowLevel[c]));
+        draw.pushSprite(v.x, v.wfY);
+    }
+#endif
+    for (int c = 0; c < v.cols; c++) {
+        rowLevel[c] = 0;
+        peak[c] = peak[c] > 4 ? peak[c] - 4 : 0;
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef __SPECTRUM_VIEW_H__
+#define __SPECTRUM_VIEW_H__
+
+#include <Arduino.h>
+
+#define SPECTRUM_MAX_COLS 320    // columns of the widest screen
+#define SPECTRUM_LEVEL_MAX 200   // levels go from 0 to this, higher ones are clipped
+#define SPECTRUM_WATERFALL_MS 100 // one waterfall row per period
+
+/**
+ * @brief Bars with peak hold and a waterfall under them, shared by the spectrum analyzers
+ *
+ * The bars go to an 8 bits sprite and only the columns that changed are pushed, so the SPI bus is mostly
+ * left to the radio. Without memory for the sprites the bars are drawn on the screen and there is no
+ * waterfall. Only one view at a time: it uses the `sprite` and `draw` sprites.
+ */
+struct SpectrumView {
+    int cols;
+    int bw; // column width
+    int x;  // left of the first column
+    int specY;
+    int specH;
+    int wfY;
+    int wfH;
+    bool grid; // a grid column every 8 and bars of alternating colors, to tell channels apart
+    bool useSprite;
+    unsigned long lastRow;
+};
+
+// Lays out `cols` columns between the header line and the labels line, which are left to the caller
+void spectrumViewBegin(SpectrumView &v, int cols, bool grid = false);
+void spectrumViewEnd();
+// Draws the levels of a sweep, one per column, and adds a waterfall row once per SPECTRUM_WATERFALL_MS
+void spectrumViewUpdate(SpectrumView &v, const uint8_t *levels);
+
+#endif
@@ -1,4 +1,5 @@
 #include "webInterface.h"
+#include "core/crypto_stream.h"
 #include "core/display.h"    // using displayRedStripe as error msg
 #include "core/mykeyboard.h" // using keyboard when calling rename
 #include "core/passwords.h"
@@ -71,53 +72,113 @@ String humanReadableSize(uint64_t bytes) {
     else return String(bytes / 1024.0 / 1024.0 / 1024.0) + " GB";
 }
 
+/**********************************************************************
+**  Function: jsonEscape
+**  Escape a file name to be placed inside a JSON string
+**********************************************************************/
+static String jsonEscape(const String &txt) {
+    String out;
+    out.reserve(txt.length() + 2);
+    for (size_t i = 0; i < txt.length(); i++) {
+        char c = txt[i];
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((uint8_t)c < 0x20) {
+            char esc[7];
+            snprintf(esc, sizeof(esc), "\\u%04x", c);
+            out += esc;
+        } else out += c;
+    }
+    return out;
+}
+
+// State of a directory listing being streamed, lives as long as the response
+struct FileListState {
+    File root;
+    String pending;      // entry not sent yet
+    size_t sent = 0;     // bytes of pending already sent
+    uint32_t index = 0;  // entries read from the folder
+    uint32_t offset = 0; // first entry to be listed
+    uint32_t limit = 0;  // max entries listed, 0 for all of them
+    uint32_t listed = 0;
+    bool json = false;
+    bool done = false;
+};
+
+// Reads the next entry of the folder into st.pending (left empty for the skipped ones)
+static void nextFileListEntry(FileListState &st) {
+    File entry;
+    if (!st.done && (st.limit == 0 || st.listed < st.limit)) entry = st.root.openNextFile();
+    if (!entry) {
+        st.done = true;
+        st.root.close();
+        bool more = st.limit && st.listed == st.limit;
+        if (st.json) st.pending = String("],\"more\":") + (more ? "true" : "false") + "}\n";
+        else if (more) st.pending = "mo:" + String(st.index) + ":0\n"; // offset of the next page
+        return;
+    }
+    if (st.index++ < st.offset) return;
+
+    String name = entry.name();
+    bool isDir = entry.isDirectory();
+    if (st.json) {
+        st.pending = st.listed ? ",{\"name\":\"" : "{\"name\":\"";
+        st.pending += jsonEscape(name) + "\",\"dir\":" + (isDir ? "true" : "false");
+        if (!isDir) st.pending += ",\"size\":" + String((uint32_t)entry.size());
+        st.pending += "}";
+    } else if (isDir) st.pending = "Fo:" + name + ":0\n";
+    else st.pending = "Fi:" + name + ":" + humanReadableSize(entry.size()) + "\n";
+    entry.close();
+    st.listed++;
+}
+
 /**********************************************************************
 **  Function: listFiles
-**  list all of the files, if ishtml=true, return html rather than simple text
+**  Streams the entries of a folder as they are read, in a single pass.
+**  Text lines are "Fo:name:0" and "Fi:name:size", or JSON with json=true.
+**  Sorting is left to the client
 **********************************************************************/
-String listFiles(FS fs, String folder) {
-    // log_i("Listfiles Start");
-    String returnText = "pa:" + folder + ":0\n";
-    Serial.println("Listing files stored on SD");
+AsyncWebServerResponse *
+listFiles(AsyncWebServerRequest *request, FS fs, String folder, bool json, uint32_t offset, uint32_t limit) {
+    Serial.println("Listing files of " + folder);
 
     _webFS = fs;
+    auto st = std::make_shared<FileListState>();
+    st->json = json;
+    st->offset = offset;
+    st->limit = limit;
+    if (json) st->pending = "{\"folder\":\"" + jsonEscape(folder) + "\",\"entries\":[";
+    else st->pending = "pa:" + folder + ":0\n";
 
-    File root = fs.open(folder);
-    File foundfile = root.openNextFile();
     if (folder == "//") folder = "/";
     uploadFolder = folder;
-    String PreFolder = folder;
-    PreFolder = PreFolder.substring(0, PreFolder.lastIndexOf("/"));
-    if (PreFolder == "") PreFolder = "/";
-
-    if (folder == "/") folder = "";
-    while (foundfile) {
-        if (esp_get_free_heap_size() > (String("Fo:" + String(foundfile.name()) + ":0\n").length()) + 1024) {
-            if (foundfile.isDirectory()) returnText += "Fo:" + String(foundfile.name()) + ":0\n";
-        } else break;
-        foundfile = root.openNextFile();
-        esp_task_wdt_reset();
+    st->root = fs.open(folder);
+    if (!st->root || !st->root.isDirectory()) {
+        st->done = true;
+        if (json) st->pending += "],\"more\":false}\n";
     }
-    root.close();
-    foundfile.close();
-
-    if (folder == "") folder = "/";
-    root = fs.open(folder);
-    foundfile = root.openNextFile();
-    while (foundfile) {
-        if (esp_get_free_heap_size() > (String("Fo:" + String(foundfile.name()) + ":0\n").length()) + 1024) {
-            if (!(foundfile.isDirectory()))
-                returnText +=
-                    "Fi:" + String(foundfile.name()) + ":" + humanReadableSize(foundfile.size()) + "\n";
-        } else break;
-        foundfile = root.openNextFile();
-        esp_task_wdt_reset();
-    }
-    root.close();
-    foundfile.close();
 
-    // log_i("ListFiles End");
-    return returnText;
+    return request->beginChunkedResponse(
+        json ? "application/json" : "text/plain",
+        [st](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+            size_t len = 0;
+            while (len < maxLen) {
+                if (st->sent >= st->pending.length()) {
+                    if (st->done) break;
+                    st->pending = "";
+                    st->sent = 0;
+                    nextFileListEntry(*st);
+                    continue;
+                }
+                size_t n = min(maxLen - len, st->pending.length() - st->sent);
+                memcpy(buffer + len, st->pending.c_str() + st->sent, n);
+                st->sent += n;
+                len += n;
+            }
+            return len;
+        }
+    );
 }
 
 /**********************************************************************
@@ -160,9 +221,56 @@ void createDirRecursive(String path, FS fs) {
         startIndex = endIndex + 1;
     }
 }
+#define UPLOAD_KEYS_MAX 4 // keys derived for uploads that haven't started yet
+
+// Encryption keys derived ahead of the uploads by uploadKeyTask, each one encrypts a single file
+struct UploadKey {
+    uint32_t token;
+    CryptoStream *cipher;
+    uint8_t header[ENC_HEADER_SIZE];
+};
+static UploadKey uploadKeys[UPLOAD_KEYS_MAX]; // only used by async_tcp
+static uint8_t nextUploadKey = 0;
+
+// Upload in progress, in request->_tempObject that the server frees with the request
+struct UploadState {
+    bool failed;          // an error was sent, the rest of the upload is dropped
+    CryptoStream *cipher; // with an encryption key
+};
+
+static void dropUploadCipher(AsyncWebServerRequest *request) {
+    UploadState *st = (UploadState *)request->_tempObject;
+    if (!st) return;
+    delete st->cipher;
+    st->cipher = nullptr;
+}
+
+static UploadState *uploadState(AsyncWebServerRequest *request) {
+    if (!request->_tempObject) {
+        request->_tempObject = calloc(1, sizeof(UploadState));
+        if (request->_tempObject) request->onDisconnect([request]() { dropUploadCipher(request); });
+    }
+    return (UploadState *)request->_tempObject;
+}
+
+// Ends an upload with an error: the partial file is removed and the next chunks are ignored
+static void failUpload(AsyncWebServerRequest *request, const String &error) {
+    dropUploadCipher(request);
+    if (request->_tempFile) {
+        String path = request->_tempFile.path();
+        request->_tempFile.close();
+        _webFS.remove(path);
+    }
+    UploadState *st = (UploadState *)request->_tempObject;
+    if (st) st->failed = true;
+    request->send(500, "text/plain", error);
+}
+
 /**********************************************************************
 **  Function: handleUpload
 ** handles uploads to the filserver
+** with a key from /uploadkey, each chunk is encrypted as it arrives
+** (see crypto_stream.h)
 **********************************************************************/
 void handleUpload(
     AsyncWebServerRequest *request, String filename, size_t index, uint8_t *data, size_t len, bool final
@@ -172,42 +280,59 @@ void handleUpload(
     if (uploadFolder == "/") uploadFolder = "";
 
     if (checkUserWebAuth(request)) {
+        UploadState *st = uploadState(request);
+        if (!st) {
+            if (!index) request->send(500, "text/plain", "Not enough memory");
+            return;
+        }
+        if (st->failed) return;
+
         if (!index) {
-            if (request->hasArg("password")) filename = filename + ".enc";
+            bool encrypt = request->hasArg("key");
+            if (encrypt) filename = filename + ".enc";
             Serial.println("File: " + uploadFolder + "/" + filename);
             String relativePath = filename;
             String fullPath = uploadFolder + "/" + relativePath;
             String dirPath = fullPath.substring(0, fullPath.lastIndexOf("/"));
             if (dirPath.length() > 0) { createDirRecursive(dirPath, _webFS); }
-        RETRY:
-            request->_tempFile = _webFS.open(uploadFolder + "/" + filename, "w");
+            for (int retry = 0; retry < 3 && !request->_tempFile; retry++) {
+                if (retry) vTaskDelay(pdMS_TO_TICKS(5));
+                request->_tempFile = _webFS.open(uploadFolder + "/" + filename, "w");
+            }
             if (!request->_tempFile) {
                 Serial.println("Failed to open file for writing: " + uploadFolder + "/" + filename);
-                vTaskDelay(pdMS_TO_TICKS(5));
-                goto RETRY;
+                return failUpload(request, "Failed to open file for writing: " + filename);
             }
-        }
 
-        if (len) {
-            if (request->hasArg("password")) {
-                // encryption requested
-                static int chunck_no = 0;
-                if (chunck_no != 0) {
-                    // TODO: handle multiple chunks
-                    request->send(404, "text/html", "file is too big");
-                    return;
-                } else chunck_no += 1;
-                String enc_password = request->arg("password");
-                String plaintext = String((char *)data).substring(0, len);
-                String cyphertxt = encryptString(plaintext, enc_password);
-                if (cyphertxt == "") { return; }
-                if (request->_tempFile)
-                    request->_tempFile.write((const uint8_t *)cyphertxt.c_str(), cyphertxt.length());
-            } else {
-                if (request->_tempFile) request->_tempFile.write(data, len);
+            dropUploadCipher(request); // previous file of the same request
+            if (encrypt) {
+                uint32_t token = strtoul(request->arg("key").c_str(), NULL, 16);
+                UploadKey *key = NULL;
+                for (UploadKey &k : uploadKeys) {
+                    if (k.cipher && k.token == token) key = &k;
+                }
+                if (!key) return failUpload(request, "Encryption key expired, upload again");
+                st->cipher = key->cipher;
+                key->cipher = nullptr;
+                if (request->_tempFile.write(key->header, ENC_HEADER_SIZE) != ENC_HEADER_SIZE)
+                    return failUpload(request, "Failed to write " + filename);
             }
         }
+
+        if (len && request->_tempFile) {
+            // encrypted in place, the chunk isn't used after this callback
+            if (st->cipher) st->cipher->update(data, data, len);
+            if (request->_tempFile.write(data, len) != len)
+                return failUpload(request, "Failed to write " + filename);
+        }
         if (final) {
+            if (st->cipher) {
+                uint8_t tag[ENC_TAG_SIZE];
+                st->cipher->finish(tag);
+                dropUploadCipher(request);
+                if (request->_tempFile && request->_tempFile.write(tag, sizeof(tag)) != sizeof(tag))
+                    return failUpload(request, "Failed to write " + filename);
+            }
             // close the file handle as the upload is now done
             if (request->_tempFile) request->_tempFile.close();
             request->redirect("/");
@@ -217,6 +342,125 @@ void handleUpload(
     }
 }
 
+// Key derivation for an upload with a password
+struct UploadKeyState {
+    String password;
+    CryptoStream *cipher = new CryptoStream();
+    uint8_t header[ENC_HEADER_SIZE];
+    volatile int8_t ready = 0; // 1 once derived, -1 on failure, 0 while deriving
+    char token[9] = "";
+    ~UploadKeyState() { delete cipher; }
+};
+
+// PBKDF2 takes too long for the async_tcp task, it runs here
+static void uploadKeyTask(void *param) {
+    auto st = (std::shared_ptr<UploadKeyState> *)param;
+    bool ok = (*st)->cipher && (*st)->cipher->beginEncrypt((*st)->password, (*st)->header);
+    (*st)->password = "";
+    (*st)->ready = ok ? 1 : -1;
+    delete st;
+    vTaskDelete(NULL);
+}
+
+/**********************************************************************
+**  Function: sendUploadKey
+** derives the key of an encrypted upload and answers with its token,
+** to be posted as "key" before the file. The status is sent before
+** the key is ready: a failure ends the response before its length
+**********************************************************************/
+void sendUploadKey(AsyncWebServerRequest *request, const String &password) {
+    auto st = std::make_shared<UploadKeyState>();
+    st->password = password;
+    auto param = new std::shared_ptr<UploadKeyState>(st);
+    if (xTaskCreate(uploadKeyTask, "uploadkey", 8192, param, 1, NULL) != pdPASS) {
+        delete param;
+        request->send(500, "text/plain", "ERROR: no memory to derive the key");
+        return;
+    }
+
+    AsyncWebServerResponse *response = request->beginResponse(
+        "text/plain",
+        8,
+        [st](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+            if (st->ready == 0) return RESPONSE_TRY_AGAIN;
+            if (st->ready < 0) return 0;
+            if (!st->token[0]) {
+                // the oldest key not used yet is dropped
+                UploadKey &key = uploadKeys[nextUploadKey];
+                nextUploadKey = (nextUploadKey + 1) % UPLOAD_KEYS_MAX;
+                delete key.cipher;
+                key.token = esp_random();
+                key.cipher = st->cipher;
+                st->cipher = nullptr;
+                memcpy(key.header, st->header, ENC_HEADER_SIZE);
+                snprintf(st->token, sizeof(st->token), "%08lx", (unsigned long)key.token);
+            }
+            size_t n = min(maxLen, (size_t)8 - index);
+            memcpy(buffer, st->token + index, n);
+            return n;
+        }
+    );
+    request->send(response);
+}
+
+// Download of an encrypted file: its tag is checked by decryptCheckTask before anything is sent
+struct DecryptState {
+    File file;
+    String password;
+    CryptoStream cipher;
+    volatile int8_t verified = 0; // 1 when the tag matches, -1 when it doesn't, 0 while checking
+};
+
+// PBKDF2 and the HMAC of the whole file take too long for the async_tcp task, they run here
+static void decryptCheckTask(void *param) {
+    auto st = (std::shared_ptr<DecryptState> *)param;
+    size_t dataLen;
+    bool ok = openEncryptedFile((*st)->file, (*st)->password, (*st)->cipher, dataLen);
+    (*st)->password = "";
+    (*st)->verified = ok ? 1 : -1;
+    delete st;
+    vTaskDelete(NULL);
+}
+
+/**********************************************************************
+**  Function: sendDecryptedFile
+** streams the plaintext of an encrypted file, once its tag was checked.
+** The status is sent before the check ends: a wrong password or an
+** altered file ends the response before its content length
+**********************************************************************/
+void sendDecryptedFile(AsyncWebServerRequest *request, FS &fs, String fileName, const String &password) {
+    auto st = std::make_shared<DecryptState>();
+    st->file = fs.open(fileName, FILE_READ);
+    if (!st->file || !isStreamEncrypted(st->file) || st->file.size() < ENC_HEADER_SIZE + ENC_TAG_SIZE) {
+        request->send(400, "text/plain", "ERROR: not a streaming encrypted file");
+        return;
+    }
+    size_t dataLen = st->file.size() - ENC_HEADER_SIZE - ENC_TAG_SIZE;
+    st->password = password;
+    auto param = new std::shared_ptr<DecryptState>(st);
+    if (xTaskCreate(decryptCheckTask, "decrypt", 8192, param, 1, NULL) != pdPASS) {
+        delete param;
+        request->send(500, "text/plain", "ERROR: no memory to decrypt the file");
+        return;
+    }
+
+    String plainName = fileName.substring(fileName.lastIndexOf("/") + 1);
+    if (plainName.endsWith(".enc")) plainName.remove(plainName.length() - 4);
+    AsyncWebServerResponse *response = request->beginResponse(
+        "application/octet-stream",
+        dataLen,
+        [st, dataLen](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+            if (st->verified == 0) return RESPONSE_TRY_AGAIN;
+            if (st->verified < 0) return 0;
+            size_t n = st->file.read(buffer, min(maxLen, dataLen - index));
+            st->cipher.update(buffer, buffer, n);
+            return n;
+        }
+    );
+    response->addHeader("Content-Disposition", "attachment; filename=\"" + plainName + "\"");
+    request->send(response);
+}
+
 void notFound(AsyncWebServerRequest *request) { request->send(404, "text/plain", "Nothing in here Sharky"); }
 
 /**********************************************************************
@@ -412,16 +656,19 @@ void configureWebServer() {
         }
     });
 
-    // List files of the LittleFS
+    // List files of the LittleFS or SD, streamed as the folder is read
+    // optional args: format=json, offset and limit (number of entries)
     server->on("/listfiles", HTTP_GET, [](AsyncWebServerRequest *request) {
         if (checkUserWebAuth(request)) {
             String folder = "/";
             if (request->hasArg("folder")) { folder = request->arg("folder"); }
-            bool useSD = false;
+            bool json = request->arg("format") == "json";
+            uint32_t offset = request->arg("offset").toInt();
+            uint32_t limit = request->arg("limit").toInt();
             if (strcmp(request->arg("fs").c_str(), "SD") == 0) {
-                request->send(200, "text/plain", listFiles(SD, folder));
+                request->send(listFiles(request, SD, folder, json, offset, limit));
             } else {
-                request->send(200, "text/plain", listFiles(LittleFS, folder));
+                request->send(listFiles(request, LittleFS, folder, json, offset, limit));
             }
 
         } else {
@@ -509,6 +756,31 @@ void configureWebServer() {
         }
     });
 
+    // define route to download the plaintext of an encrypted file, the password stays out of the URL
+    server->on("/uploadkey", HTTP_POST, [](AsyncWebServerRequest *request) {
+        if (checkUserWebAuth(request)) {
+            if (request->hasArg("password")) sendUploadKey(request, request->arg("password"));
+            else request->send(400, "text/plain", "ERROR: password required");
+        } else {
+            request->requestAuthentication();
+        }
+    });
+
+    server->on("/decrypt", HTTP_POST, [](AsyncWebServerRequest *request) {
+        if (checkUserWebAuth(request)) {
+            if (request->hasArg("name") && request->hasArg("password")) {
+                FS *fs = request->arg("fs") == "SD" ? (FS *)&SD : (FS *)&LittleFS;
+                String fileName = request->arg("name");
+                if (!(*fs).exists(fileName)) request->send(400, "text/plain", "ERROR: file does not exist");
+                else sendDecryptedFile(request, *fs, fileName, request->arg("password"));
+            } else {
+                request->send(400, "text/plain", "ERROR: name and password required");
+            }
+        } else {
+            request->requestAuthentication();
+        }
+    });
+
     server->on("/edit", HTTP_POST, [](AsyncWebServerRequest *request) {
         if (checkUserWebAuth(request)) {
             if (request->hasArg("name") && request->hasArg("content") && request->hasArg("fs")) {
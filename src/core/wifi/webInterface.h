@@ -11,7 +11,10 @@ extern AsyncWebServer *server; // used to check if the webserver is running
 
 // function defaults
 String humanReadableSize(uint64_t bytes);
-String listFiles(FS fs, String folder);
+AsyncWebServerResponse *listFiles(
+    AsyncWebServerRequest *request, FS fs, String folder, bool json = false, uint32_t offset = 0,
+    uint32_t limit = 0
+);
 String readLineFromFile(File myFile);
 
 void loopOptionsWebUi();
@@ -1,10 +1,10 @@
 #include "nrf_spectrum.h"
 #include "../../core/display.h"
 #include "../../core/mykeyboard.h"
+#include "../../core/spectrum_view.h"
 #include "nrf_common.h"
 
 #define CHANNELS 80
-#define RGB565(r, g, b) ((((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3)))
 uint8_t channel[CHANNELS];
 
 // Register Access Functions
@@ -26,9 +26,7 @@ inline void setRegister(SPIClass &SSPI, byte r, byte v) {
 inline void powerDown(SPIClass &SSPI) { setRegister(SSPI, 0x00, getRegister(SSPI, 0x00) & ~0x02); }
 
 // Scanning Channels
-#define _BW tftWidth / CHANNELS
-String scanChannels(SPIClass *SSPI, bool web) {
-    String result = "{";
+void scanChannels(SPIClass *SSPI) {
     digitalWrite(NRF24_CE_PIN, LOW);
     for (int i = 0; i < CHANNELS; i++) {
         NRFradio.setChannel(i);
@@ -38,23 +36,27 @@ String scanChannels(SPIClass *SSPI, bool web) {
         int rpd = 0;
         if (NRFradio.testCarrier()) rpd = 200;
         channel[i] = (channel[i] * 3 + rpd) / 4;
+    }
+}
 
-        int level = (channel[i] > 125) ? 125 : channel[i]; // Clamp values
+static uint8_t frameSeq = 0;
 
-        tft.drawFastVLine(i * _BW, 0, 125, (i % 8) ? TFT_BLACK : RGB565(25, 25, 25));
-        tft.drawFastVLine(
-            i * _BW, tftHeight - (10 + level), level, (i % 2 == 0) ? bruceConfig.priColor : TFT_DARKGREY
-        ); // Use green for even indices
-        tft.drawFastVLine(i * _BW, 0, tftHeight - (9 + level), (i % 8) ? TFT_BLACK : RGB565(25, 25, 25));
-        tft.drawFastVLine(i * _BW, 0, rpd ? 2 : 0, TFT_DARKGREY);
-        if (web) {
-            if (i > 0) result += ",";
-            result += String(level);
-        }
-    }
-    if (web) result += "}";
-    return result; // return a string in this format "{1,32,45,32,84,32 .... 12,54,65}" with 80 values to be
-                   // used in the WebUI (Future)
+size_t nrfSpectrumFrame(uint8_t *buf, size_t cap) {
+    if (cap < 4 + CHANNELS) return 0;
+    buf[0] = NRF_FRAME_MAGIC;
+    buf[1] = 'N';
+    buf[2] = frameSeq++;
+    buf[3] = CHANNELS;
+    memcpy(buf + 4, channel, CHANNELS);
+    return 4 + CHANNELS;
+}
+
+static void drawHeader(int sweepRate, bool streaming) {
+    char header[32];
+    snprintf(header, sizeof(header), "%d sweeps/s %s    ", sweepRate, streaming ? "[SERIAL]" : "");
+    tft.setTextSize(FP);
+    tft.setTextColor(bruceConfig.priColor, bruceConfig.bgColor);
+    tft.drawString(header, 0, 0, 1);
 }
 
 void nrf_spectrum(SPIClass *SSPI) {
@@ -64,6 +66,8 @@ void nrf_spectrum(SPIClass *SSPI) {
     tft.drawCentreString("2.44Ghz", tftWidth / 2, tftHeight - LH, 1);
     tft.drawRightString("2.48Ghz", tftWidth, tftHeight - LH, 1);
     memset(channel, 0, CHANNELS);
+    SpectrumView v;
+    spectrumViewBegin(v, CHANNELS, true);
 
     if (nrf_start()) {
         NRFradio.setAutoAck(false);
@@ -80,13 +84,41 @@ void nrf_spectrum(SPIClass *SSPI) {
         for (uint8_t i = 0; i < 6; ++i) { NRFradio.openReadingPipe(i, noiseAddress[i]); }
         NRFradio.setDataRate(RF24_1MBPS);
 
-        while (!check(EscPress)) { scanChannels(SSPI); }
+        bool streaming = false;
+        uint8_t frame[4 + CHANNELS];
+        uint32_t sweeps = 0;
+        unsigned long lastRate = millis();
+        drawHeader(0, streaming);
+        while (!check(EscPress)) {
+            if (check(SelPress)) {
+                streaming = !streaming;
+                drawHeader(0, streaming);
+            }
+
+            scanChannels(SSPI);
+            sweeps++;
+            spectrumViewUpdate(v, channel);
+
+            // frames are skipped rather than blocking the sweep when the serial buffer is full
+            if (streaming) {
+                size_t len = nrfSpectrumFrame(frame, sizeof(frame));
+                if (Serial.availableForWrite() >= (int)len) Serial.write(frame, len);
+            }
+
+            if (millis() - lastRate >= 1000) {
+                drawHeader(sweeps * 1000 / (millis() - lastRate), streaming);
+                sweeps = 0;
+                lastRate = millis();
+            }
+        }
         NRFradio.stopListening();
         powerDown(*SSPI); //
+        spectrumViewEnd();
         delay(250);
         return;
 
     } else {
+        spectrumViewEnd();
         Serial.println("Fail Starting radio");
         displayError("NRF24 not found");
         delay(500);
@@ -1,6 +1,11 @@
 #pragma once
 #include <RF24.h>
 
+#define NRF_FRAME_MAGIC 0xA5 // binary frames: magic, 'N', sequence, channel count, one level per channel
+
 void nrf_spectrum(SPIClass *SSPI);
 
-String scanChannels(SPIClass *SSPI, bool web = false);
+// One sweep of the 80 channels, the smoothed levels (0-200) are left in `channel`
+void scanChannels(SPIClass *SSPI);
+// Binary frame of the last sweep for the serial/WebUI clients. Returns its size, 0 if `cap` is too small
+size_t nrfSpectrumFrame(uint8_t *buf, size_t cap);
@@ -0,0 +1,214 @@
+#include "ducky_script.h"
+#include <keys.h>
+
+#define DUCKY_TEXT_MAX 0xFFFF // chars of a text op, longer strings are typed by several ops
+
+static const DuckyCombination duckyComb[]{
+    {"CTRL-ALT",       KEY_LEFT_CTRL, KEY_LEFT_ALT,   0             },
+    {"CTRL-SHIFT",     KEY_LEFT_CTRL, KEY_LEFT_SHIFT, 0             },
+    {"CTRL-GUI",       KEY_LEFT_CTRL, KEY_LEFT_GUI,   0             },
+    {"CTRL-ESCAPE",    KEY_LEFT_CTRL, KEY_ESC,        0             },
+    {"ALT-SHIFT",      KEY_LEFT_ALT,  KEY_LEFT_SHIFT, 0             },
+    {"ALT-GUI",        KEY_LEFT_ALT,  KEY_LEFT_GUI,   0             },
+    {"GUI-SHIFT",      KEY_LEFT_GUI,  KEY_LEFT_SHIFT, 0             },
+    {"GUI-SPACE",      KEY_LEFT_GUI,  KEY_SPACE,      0             },
+    {"CTRL-ALT-SHIFT", KEY_LEFT_CTRL, KEY_LEFT_ALT,   KEY_LEFT_SHIFT},
+    {"CTRL-ALT-GUI",   KEY_LEFT_CTRL, KEY_LEFT_ALT,   KEY_LEFT_GUI  },
+    {"ALT-SHIFT-GUI",  KEY_LEFT_ALT,  KEY_LEFT_SHIFT, KEY_LEFT_GUI  },
+    {"CTRL-SHIFT-GUI", KEY_LEFT_CTRL, KEY_LEFT_SHIFT, KEY_LEFT_GUI  }
+};
+
+const DuckyCommand duckyCmds[]{
+    {"STRING",         0,                   DuckyCommandType_Print      },
+    {"STRINGLN",       0,                   DuckyCommandType_Print      },
+    {"REM",            0,                   DuckyCommandType_Comment    },
+    {"DELAY",          0,                   DuckyCommandType_Delay      },
+    {"DEFAULTDELAY",   DUCKY_DEFAULT_DELAY, DuckyCommandType_Delay      },
+    {"REPEAT",         0,                   DuckyCommandType_Loop       },
+    {"CTRL-ALT",       0,                   DuckyCommandType_Combination},
+    {"CTRL-SHIFT",     0,                   DuckyCommandType_Combination},
+    {"CTRL-GUI",       0,                   DuckyCommandType_Combination},
+    {"CTRL-ESCAPE",    0,                   DuckyCommandType_Combination},
+    {"ALT-SHIFT",      0,                   DuckyCommandType_Combination},
+    {"ALT-GUI",        0,                   DuckyCommandType_Combination},
+    {"GUI-SHIFT",      0,                   DuckyCommandType_Combination},
+    {"GUI-SPACE",      0,                   DuckyCommandType_Combination},
+    {"CTRL-ALT-SHIFT", 0,                   DuckyCommandType_Combination},
+    {"CTRL-ALT-GUI",   0,                   DuckyCommandType_Combination},
+    {"ALT-SHIFT-GUI",  0,                   DuckyCommandType_Combination},
+    {"CTRL-SHIFT-GUI", 0,                   DuckyCommandType_Combination},
+    {"BACKSPACE",      KEYBACKSPACE,        DuckyCommandType_Cmd        },
+    {"DELETE",         KEY_DELETE,          DuckyCommandType_Cmd        },
+    {"ALT",            KEY_LEFT_ALT,        DuckyCommandType_Cmd        },
+    {"CTRL",           KEY_LEFT_CTRL,       DuckyCommandType_Cmd        },
+    {"GUI",            KEY_LEFT_GUI,        DuckyCommandType_Cmd        },
+    {"SHIFT",          KEY_LEFT_SHIFT,      DuckyCommandType_Cmd        },
+    {"ESCAPE",         KEY_ESC,             DuckyCommandType_Cmd        },
+    {"TAB",            KEYTAB,              DuckyCommandType_Cmd        },
+    {"ENTER",          KEY_RETURN,          DuckyCommandType_Cmd        },
+    {"DOWNARROW",      KEY_DOWN_ARROW,      DuckyCommandType_Cmd        },
+    {"DOWN",           KEY_DOWN_ARROW,      DuckyCommandType_Cmd        },
+    {"LEFTARROW",      KEY_LEFT_ARROW,      DuckyCommandType_Cmd        },
+    {"LEFT",           KEY_LEFT_ARROW,      DuckyCommandType_Cmd        },
+    {"RIGHTARROW",     KEY_RIGHT_ARROW,     DuckyCommandType_Cmd        },
+    {"RIGHT",          KEY_RIGHT_ARROW,     DuckyCommandType_Cmd        },
+    {"UPARROW",        KEY_UP_ARROW,        DuckyCommandType_Cmd        },
+    {"UP",             KEY_UP_ARROW,        DuckyCommandType_Cmd        },
+    {"BREAK",          KEY_PAUSE,           DuckyCommandType_Cmd        },
+    {"CAPSLOCK",       KEY_CAPS_LOCK,       DuckyCommandType_Cmd        },
+    {"PAUSE",          KEY_PAUSE,           DuckyCommandType_Cmd        },
+    {"END",            KEY_END,             DuckyCommandType_Cmd        },
+    {"HOME",           KEY_HOME,            DuckyCommandType_Cmd        },
+    {"INSERT",         KEY_INSERT,          DuckyCommandType_Cmd        },
+    {"NUMLOCK",        LED_NUMLOCK,         DuckyCommandType_Cmd        },
+    {"PAGEUP",         KEY_PAGE_UP,         DuckyCommandType_Cmd        },
+    {"PAGEDOWN",       KEY_PAGE_DOWN,       DuckyCommandType_Cmd        },
+    {"PRINTSCREEN",    KEY_PRINT_SCREEN,    DuckyCommandType_Cmd        },
+    {"SCROLLOCK",      KEY_SCROLL_LOCK,     DuckyCommandType_Cmd        },
+    {"MENU",           KEY_MENU,            DuckyCommandType_Cmd        },
+    {"F1",             KEY_F1,              DuckyCommandType_Cmd        },
+    {"F2",             KEY_F2,              DuckyCommandType_Cmd        },
+    {"F3",             KEY_F3,              DuckyCommandType_Cmd        },
+    {"F4",             KEY_F4,              DuckyCommandType_Cmd        },
+    {"F5",             KEY_F5,              DuckyCommandType_Cmd        },
+    {"F6",             KEY_F6,              DuckyCommandType_Cmd        },
+    {"F7",             KEY_F7,              DuckyCommandType_Cmd        },
+    {"F8",             KEY_F8,              DuckyCommandType_Cmd        },
+    {"F9",             KEY_F9,              DuckyCommandType_Cmd        },
+    {"F10",            KEY_F10,             DuckyCommandType_Cmd        },
+    {"F11",            KEY_F11,             DuckyCommandType_Cmd        },
+    {"F12",            KEY_F12,             DuckyCommandType_Cmd        },
+    {"SPACE",          KEY_SPACE,           DuckyCommandType_Cmd        }
+};
+const size_t duckyCmdsCount = sizeof(duckyCmds) / sizeof(duckyCmds[0]);
+
+const DuckyCommand *duckyCommand(const char *name) {
+    for (size_t i = 0; i < duckyCmdsCount; i++) {
+        if (strcmp(name, duckyCmds[i].command) == 0) return &duckyCmds[i];
+    }
+    return nullptr;
+}
+
+const DuckyCombination *duckyCombination(const char *name) {
+    for (const DuckyCombination &comb : duckyComb) {
+        if (strcmp(name, comb.command) == 0) return &comb;
+    }
+    return nullptr;
+}
+
+void DuckyScript::clear() {
+    _ops.clear();
+    _text = "";
+    _lastLine = "";
+}
+
+bool DuckyScript::compileChunk(File &file) {
+    _ops.clear();
+    _text = "";
+    int lines = 0;
+    for (; lines < DUCKY_CHUNK_LINES && file.available(); lines++) {
+        // CRLF is a combination of two control characters: the "Carriage Return" represented by
+        // the character "\r" and the "Line Feed" represented by the character "\n".
+        String line = file.readStringUntil('\n');
+        if (line.endsWith("\r")) line.remove(line.length() - 1);
+        compileLine(line);
+    }
+    return lines > 0;
+}
+
+void DuckyScript::emitText(DuckyOpCode code, const String &text, uint8_t key) {
+    size_t done = 0;
+    do {
+        size_t len = min<size_t>(text.length() - done, DUCKY_TEXT_MAX);
+        _ops.push_back({code, key, (uint16_t)len, _text.length()});
+        _text.concat(text.c_str() + done, len);
+        done += len;
+    } while (code == DuckyOp_Print && done < text.length()); // only typed text is worth keeping whole
+}
+
+void DuckyScript::compileLine(const String &line) {
+    if (line.length() == 0) return;
+    int space = line.indexOf(' ');
+    if (line.substring(0, space < 0 ? line.length() : space) != "REPEAT") {
+        _lastLine = line;
+        compileCommand(line);
+        return;
+    }
+
+    if (_lastLine.length() == 0) {
+        emitText(DuckyOp_Warn, "REPEAT without a line to repeat, skipped");
+        return;
+    }
+    long times = 1;
+    if (space < 0) {
+        emitText(DuckyOp_Warn, "REPEAT without argument, repeating once");
+    } else {
+        // how many times it will repeat, using .toInt() conversion;
+        times = line.substring(space + 1).toInt();
+        if (times == 0) {
+            times = 1;
+            emitText(DuckyOp_Warn, "REPEAT argument NaN, repeating once");
+        }
+    }
+    size_t repeat = _ops.size();
+    emit(DuckyOp_Repeat, 0, times < 0 ? 0 : times);
+    compileCommand(_lastLine);
+    _ops[repeat].len = _ops.size() - repeat - 1;
+}
+
+void DuckyScript::compileCommand(const String &line) {
+    int space = line.indexOf(' ');
+    String command = line.substring(0, space < 0 ? line.length() : space);
+    String argument = space > 0 ? line.substring(space + 1) : "";
+    const DuckyCommand *cmd = duckyCommand(command.c_str());
+
+    // a line is shown once its command ran
+    if (cmd == nullptr) {
+        emit(DuckyOp_ReleaseAll);
+        emitText(DuckyOp_Warn, command + " -> Not Supported, running as STRINGLN");
+        emitText(DuckyOp_Print, argument.length() > 0 ? command + " " + argument : command);
+        emit(DuckyOp_PrintLn);
+        emitText(DuckyOp_Line, argument);
+        return;
+    }
+
+    switch (cmd->type) {
+        case DuckyCommandType_Print:
+            if (argument.length() > 0) emitText(DuckyOp_Print, argument);
+            if (strcmp(cmd->command, "STRINGLN") == 0) emit(DuckyOp_PrintLn);
+            break;
+        case DuckyCommandType_Delay: {
+            long ms = argument.toInt();
+            if ((int)cmd->key > 0 || ms <= 0) ms = DUCKY_DEFAULT_DELAY; // DEFAULTDELAY, or no valid argument
+            emit(DuckyOp_Delay, 0, ms);
+            break;
+        }
+        case DuckyCommandType_Cmd:
+            emit(DuckyOp_Press, cmd->key);
+            pressArgument(argument);
+            break;
+        case DuckyCommandType_Combination: {
+            const DuckyCombination *comb = duckyCombination(cmd->command);
+            if (comb) {
+                emit(DuckyOp_Press, comb->key1);
+                emit(DuckyOp_Press, comb->key2);
+                if (comb->key3 != 0) emit(DuckyOp_Press, comb->key3);
+            }
+            pressArgument(argument);
+            break;
+        }
+        default: break; // REM
+    }
+    emitText(DuckyOp_Line, command + argument, min<size_t>(command.length(), 255));
+}
+
+// The key of a command (CTRL ESCAPE), nothing for the other commands, else the first char (GUI r)
+void DuckyScript::pressArgument(const String &argument) {
+    const DuckyCommand *argCmd = duckyCommand(argument.c_str());
+    if (argCmd != nullptr) {
+        if (argCmd->type == DuckyCommandType_Cmd) emit(DuckyOp_Press, argCmd->key);
+    } else if (argument.length() > 0) {
+        emit(DuckyOp_Press, argument.charAt(0));
+    }
+    emit(DuckyOp_ReleaseAll);
+}
@@ -0,0 +1,88 @@
+#ifndef __DUCKY_SCRIPT_H__
+#define __DUCKY_SCRIPT_H__
+
+#include <Arduino.h>
+#include <FS.h>
+#include <vector>
+
+#define DUCKY_DEFAULT_DELAY 100 // DEFAULTDELAY, and DELAY without a valid argument
+#define DUCKY_CHUNK_LINES 256   // lines compiled at once, so long scripts don't have to fit in memory
+
+enum DuckyCommandType {
+    DuckyCommandType_Unknown,
+    DuckyCommandType_Cmd,
+    DuckyCommandType_Print,
+    DuckyCommandType_Delay,
+    DuckyCommandType_Comment,
+    DuckyCommandType_Loop,
+    DuckyCommandType_Combination
+};
+
+struct DuckyCommand {
+    const char *command;
+    char key;
+    DuckyCommandType type;
+};
+
+struct DuckyCombination {
+    const char *command;
+    char key1;
+    char key2;
+    char key3;
+};
+
+extern const DuckyCommand duckyCmds[];
+extern const size_t duckyCmdsCount;
+
+// nullptr when the name is not a command
+const DuckyCommand *duckyCommand(const char *name);
+const DuckyCombination *duckyCombination(const char *name);
+
+enum DuckyOpCode : uint8_t {
+    DuckyOp_Line,       // ends a line: shows the first `key` chars of the text as the command, the rest white
+    DuckyOp_Warn,       // shows the text as a warning
+    DuckyOp_Press,      // presses `key`
+    DuckyOp_ReleaseAll, // releases every key
+    DuckyOp_Print,      // types the text
+    DuckyOp_PrintLn,    // types a new line
+    DuckyOp_Delay,      // waits `arg` ms
+    DuckyOp_Repeat      // runs the `len` ops that follow it `arg` times, then goes on after them
+};
+
+struct DuckyOp {
+    DuckyOpCode code;
+    uint8_t key;
+    uint16_t len; // text ops: length of the text, at `arg` in the text of the script
+    uint32_t arg;
+};
+
+/**
+ * @brief DuckyScript lowered to the ops that run it
+ *
+ * Each line is parsed and its command and keys looked up once, before anything is typed, so running the
+ * script is only walking ops. The file is compiled DUCKY_CHUNK_LINES lines at a time: each compileChunk()
+ * replaces the ops of the previous chunk, remembering the last line for a REPEAT at the start of the next.
+ */
+class DuckyScript {
+public:
+    // Compiles the next lines of the file. False when there is nothing left to compile
+    bool compileChunk(File &file);
+    void compileLine(const String &line);
+    void clear();
+
+    const std::vector<DuckyOp> &ops() const { return _ops; }
+    // Text of a Line, Warn or Print op, `op.len` chars, not null terminated
+    const char *text(const DuckyOp &op) const { return _text.c_str() + op.arg; }
+
+private:
+    void emit(DuckyOpCode code, uint8_t key = 0, uint32_t arg = 0) { _ops.push_back({code, key, 0, arg}); }
+    void emitText(DuckyOpCode code, const String &text, uint8_t key = 0);
+    void compileCommand(const String &line);
+    void pressArgument(const String &argument);
+
+    std::vector<DuckyOp> _ops;
+    String _text;
+    String _lastLine; // last line that wasn't a REPEAT, what the next REPEAT runs again
+};
+
+#endif
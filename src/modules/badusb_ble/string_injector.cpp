@@ -0,0 +1,110 @@
+#include "string_injector.h"
+#include <KeyboardLayout.h>
+
+#define MOD_LEFT_SHIFT 0x02
+#define MOD_RIGHT_ALT 0x40 // AltGr
+
+static const uint8_t noKeys[6] = {0};
+
+static bool hasKey(const uint8_t *keys, uint8_t count, uint8_t key) {
+    for (uint8_t i = 0; i < count; i++) {
+        if (keys[i] == key) return true;
+    }
+    return false;
+}
+
+bool StringInjector::send(uint8_t modifiers, const uint8_t *keys) {
+    for (int attempt = 0; attempt <= INJECT_RETRIES; attempt++) {
+        while (micros() - _lastSend < _gapUs) {
+            if (_gapUs - (micros() - _lastSend) > 2000) delay(1);
+        }
+        bool ok = _hid->sendKeys(modifiers, keys);
+        _lastSend = micros();
+        _stats.reports++;
+        if (ok) {
+            if (++_accepted >= INJECT_SPEEDUP_AFTER && _gapUs > _floorUs) {
+                _gapUs = max<uint32_t>(_floorUs, _gapUs - _gapUs / 8 - 1);
+                _accepted = 0;
+            }
+            return true;
+        }
+        _stats.retries++;
+        _accepted = 0;
+        _gapUs = min<uint32_t>(max<uint32_t>(_gapUs * 2, INJECT_MIN_BACKOFF_US), INJECT_MAX_GAP_US);
+    }
+    return false;
+}
+
+size_t StringInjector::type(HIDInterface *hid, const char *text, size_t len) {
+    unsigned long start = millis();
+    const uint8_t *layout = hid->getLayout();
+    if (layout == nullptr) {
+        size_t n = hid->write((const uint8_t *)text, len);
+        _stats.chars += n;
+        _stats.ms += millis() - start;
+        return n;
+    }
+
+    uint32_t interval = hid->reportIntervalUs();
+    if (hid != _hid) {
+        _hid = hid;
+        _gapUs = interval;
+        _accepted = 0;
+    }
+    _floorUs = interval / INJECT_REPORTS_PER_INTERVAL;
+    if (_gapUs < _floorUs) _gapUs = _floorUs;
+
+    uint8_t maxKeys = _packKeys ? 6 : 1;
+    uint8_t group[6] = {0}; // keys to press next
+    uint8_t groupMods = 0;
+    uint8_t count = 0;
+    uint8_t held[6] = {0}; // keys of the last report sent
+    uint8_t heldMods = 0;
+    bool holding = false;
+    size_t typed = 0;
+    bool ok = true;
+
+    for (size_t i = 0; i < len && ok; i++) {
+        uint8_t c = text[i];
+        if (c == '\r' || c >= 0x80) continue; // '\r' is skipped by write() too, layouts end at DEL
+        uint8_t key = layout[c];
+        if (!key) continue;
+        uint8_t mods = 0;
+        if ((key & ALT_GR) == ALT_GR) {
+            mods = MOD_RIGHT_ALT;
+            key &= 0x3F;
+        } else if ((key & SHIFT) == SHIFT) {
+            mods = MOD_LEFT_SHIFT;
+            key &= 0x7F;
+        }
+        if (key == ISO_REPLACEMENT) key = ISO_KEY;
+
+        if (count && (count == maxKeys || mods != groupMods || hasKey(group, count, key))) {
+            ok = send(groupMods, group);
+            if (!ok) break;
+            typed += count;
+            memcpy(held, group, sizeof(held));
+            heldMods = groupMods;
+            holding = true;
+            count = 0;
+            memset(group, 0, sizeof(group));
+        }
+        // a key held must go up before it is pressed again, modifiers change with no key down
+        if (holding && (!_packKeys || mods != heldMods || hasKey(held, 6, key))) {
+            ok = send(0, noKeys);
+            holding = false;
+        }
+        if (!count) groupMods = mods;
+        group[count++] = key;
+    }
+    if (ok && count) {
+        ok = send(groupMods, group);
+        if (ok) typed += count;
+    }
+    if (ok) send(0, noKeys);
+    else _hid->sendKeys(0, noKeys); // a single try to release the keys, the host stopped taking reports
+
+    _stats.chars += typed;
+    _stats.ms += millis() - start;
+    return typed;
+}
@@ -0,0 +1,55 @@
+#ifndef __STRING_INJECTOR_H__
+#define __STRING_INJECTOR_H__
+
+#include <Bad_Usb_Lib.h>
+
+#define INJECT_RETRIES 20               // sends of a refused report before giving up on the host
+#define INJECT_REPORTS_PER_INTERVAL 4   // fastest pace: reports per interval of the host (BLE connection)
+#define INJECT_SPEEDUP_AFTER 32         // reports taken in a row before trying a shorter gap
+#define INJECT_MIN_BACKOFF_US 1000      // gap after the first refused report when there was none
+#define INJECT_MAX_GAP_US 50000         // slowest pace
+
+struct InjectStats {
+    uint32_t chars = 0;   // typed
+    uint32_t reports = 0; // sent, refused ones included
+    uint32_t retries = 0; // reports refused by the host
+    unsigned long ms = 0;
+};
+
+/**
+ * @brief Types text through a keyboard with several keys a report
+ *
+ * Chars are turned into keys with the layout of the keyboard. By default each key is pressed and released in
+ * its own reports, like write(). With setPacking(true) keys are pressed together, up to 6 a report, as long
+ * as they need the same modifiers and no key is twice in the group, and are released only when the next group
+ * needs one of them or other modifiers: "abc" takes 2 reports instead of 6. HID doesn't say in which order
+ * a host reads the keys of a report: Linux reads them in order, other hosts may not, so packing must be
+ * confirmed on the target first. Reports are paced by the gap between them: it starts
+ * at the interval the keyboard tells, shrinks while the host takes every report and doubles when one is
+ * refused, which is then sent again. Keyboards that can't send raw reports fall back to write().
+ */
+class StringInjector {
+public:
+    // Returns the chars typed, less than len only when the host stopped taking reports
+    size_t type(HIDInterface *hid, const char *text, size_t len);
+    // Several keys a report, see above
+    void setPacking(bool pack) { _packKeys = pack; }
+
+    // Of all the text typed since the last reset
+    const InjectStats &stats() const { return _stats; }
+    uint32_t charsPerSecond() const { return _stats.ms ? _stats.chars * 1000ULL / _stats.ms : 0; }
+    void resetStats() { _stats = InjectStats(); }
+
+private:
+    bool send(uint8_t modifiers, const uint8_t *keys);
+
+    HIDInterface *_hid = nullptr;
+    bool _packKeys = false;
+    uint32_t _gapUs = 0;   // between two reports, learned from the host
+    uint32_t _floorUs = 0; // shortest gap tried
+    uint32_t _accepted = 0;
+    unsigned long _lastSend = 0;
+    InjectStats _stats;
+};
+
+#endif
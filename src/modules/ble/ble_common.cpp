@@ -1,16 +1,22 @@
 #include "ble_common.h"
 #include "core/mykeyboard.h"
+#include "core/sd_functions.h"
 #include "core/utils.h"
+#include "modules/wifi/mac_set.h"
 
 #define SERVICE_UUID "1bc68b2a-f3e3-11e9-81b4-2a2ae2dbcce4"
 #define CHARACTERISTIC_RX_UUID "1bc68da0-f3e3-11e9-81b4-2a2ae2dbcce4"
 #define CHARACTERISTIC_TX_UUID "1bc68efe-f3e3-11e9-81b4-2a2ae2dbcce4"
 
-#define SCANTIME 5
 #define SCANTYPE ACTIVE
 #define SCAN_INT 100
 #define SCAN_WINDOW 99
 
+#define BLE_SCAN_MAX_DEVICES 256 // device table slots, power of 2. Kept at most 3/4 full
+#define BLE_SCAN_STALE_MS 10000  // rows of devices not heard for this long are greyed out
+#define BLE_SCAN_REDRAW_MS 250
+#define BLE_MFG_MAX 24 // manufacturer data kept per device, company id included
+
 #define ENDIAN_CHANGE_U16(x) ((((x) & 0xFF00) >> 8) + (((x) & 0xFF) << 8))
 
 BLEServer *pServer = NULL;
@@ -33,7 +39,6 @@ class MyCallbacks : public BLECharacteristicCallbacks {
     void onWrite(NimBLECharacteristic *pCharacteristic) { data = pCharacteristic->getValue(); }
 };
 
-int scanTime = SCANTIME; // In seconds
 BLEScan *pBLEScan;
 
 uint8_t sta_mac[6];
@@ -57,34 +62,124 @@ void ble_info(String name, String address, String signal) {
     }
 }
 
+// Device heard by the continuous scan. Updated by the NimBLE host task, drawn by the UI loop
+struct BleScanDevice {
+    bool used;
+    uint8_t address[6]; // display order
+    uint8_t addrType;
+    uint8_t advType;
+    char name[24];
+    int16_t rssi; // smoothed, in 1/16 dBm
+    int8_t lastRssi;
+    uint32_t firstSeen;
+    uint32_t lastSeen;
+    uint32_t count; // advertisements received
+    uint8_t mfgLen;
+    uint8_t mfg[BLE_MFG_MAX];
+    bool dirty;      // changed since it was last drawn
+    bool drawnStale; // stale when it was last drawn
+};
+
+static BleScanDevice *bleDevices = NULL;        // open addressing on the address
+static uint16_t bleOrder[BLE_SCAN_MAX_DEVICES]; // slots in discovery order, the rows of the list
+static uint16_t bleDeviceCount = 0;
+static uint32_t bleAdvCount = 0;
+static uint32_t bleDropped = 0; // new devices refused because the table is full
+static portMUX_TYPE bleScanMux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *advTypeName(uint8_t type) {
+    switch (type) {
+        case 0: return "CON"; // ADV_IND
+        case 1: return "DIR"; // ADV_DIRECT_IND
+        case 2: return "SCN"; // ADV_SCAN_IND
+        case 3: return "NON"; // ADV_NONCONN_IND
+        case 4: return "RSP"; // SCAN_RSP
+        default: return "???";
+    }
+}
+
+static int smoothedRssi(const BleScanDevice &d) { return (d.rssi - 8) / 16; }
+
 class AdvertisedDeviceCallbacks : public NimBLEAdvertisedDeviceCallbacks {
+    // Runs for every advertisement (duplicates included): no heap allocation, a short critical section
     void onResult(NimBLEAdvertisedDevice *advertisedDevice) {
-        String bt_title;
-        String bt_name;
-        String bt_address;
-        String bt_signal;
-
-        bt_name = advertisedDevice->getName().c_str();
-        bt_title = advertisedDevice->getName().c_str();
-        bt_address = advertisedDevice->getAddress().toString().c_str();
-        bt_signal = String(advertisedDevice->getRSSI());
-        // Serial.println("\n\nAddress - " + bt_address + "Name-"+ bt_name +"\n\n");
-        if (bt_title.isEmpty()) bt_title = bt_address;
-        if (bt_name.isEmpty()) bt_name = "<no name>";
-        // If BT name is empty, set NONAME
-        if (options.size() < 250)
-            options.emplace_back(bt_title.c_str(), [=]() { ble_info(bt_name, bt_address, bt_signal); });
-        else {
-            Serial.println("Memory low, stopping BLE scan...");
-            pBLEScan->stop();
+        uint8_t address[6];
+        const uint8_t *native = advertisedDevice->getAddress().getNative(); // little endian
+        for (int i = 0; i < 6; i++) address[i] = native[5 - i];
+        int8_t rssi = advertisedDevice->getRSSI();
+
+        // AD structures: length, type, data. Only the name and the manufacturer data are kept
+        char name[24] = "";
+        uint8_t mfg[BLE_MFG_MAX];
+        uint8_t mfgLen = 0;
+        const uint8_t *payload = advertisedDevice->getPayload();
+        size_t len = advertisedDevice->getPayloadLength();
+        for (size_t pos = 0; pos + 1 < len;) {
+            uint8_t adLen = payload[pos];
+            if (adLen == 0 || pos + 1 + adLen > len) break;
+            uint8_t adType = payload[pos + 1];
+            const uint8_t *data = payload + pos + 2;
+            size_t dataLen = adLen - 1;
+            if ((adType == 0x09 || (adType == 0x08 && name[0] == '\0')) && dataLen > 0) {
+                size_t n = min(dataLen, sizeof(name) - 1);
+                memcpy(name, data, n);
+                name[n] = '\0';
+            } else if (adType == 0xFF && dataLen > 0) {
+                mfgLen = min(dataLen, sizeof(mfg));
+                memcpy(mfg, data, mfgLen);
+            }
+            pos += 1 + adLen;
+        }
+
+        uint64_t key = macToKey(address);
+        uint32_t now = millis();
+        portENTER_CRITICAL(&bleScanMux);
+        bleAdvCount++;
+        size_t i = (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & (BLE_SCAN_MAX_DEVICES - 1);
+        while (bleDevices[i].used && memcmp(bleDevices[i].address, address, 6) != 0)
+            i = (i + 1) & (BLE_SCAN_MAX_DEVICES - 1);
+        BleScanDevice &d = bleDevices[i];
+        if (!d.used) {
+            if (bleDeviceCount >= BLE_SCAN_MAX_DEVICES * 3 / 4) {
+                bleDropped++;
+                portEXIT_CRITICAL(&bleScanMux);
+                return;
+            }
+            memset(&d, 0, sizeof(d));
+            d.used = true;
+            memcpy(d.address, address, 6);
+            d.addrType = advertisedDevice->getAddressType();
+            d.rssi = rssi * 16;
+            d.firstSeen = now;
+            d.dirty = true;
+            bleOrder[bleDeviceCount++] = i;
         }
+        int shown = smoothedRssi(d);
+        d.rssi += (rssi * 16 - d.rssi) / 4; // exponential moving average, 1/4 weight to the new value
+        if (smoothedRssi(d) != shown) d.dirty = true;
+        d.lastRssi = rssi;
+        d.lastSeen = now;
+        d.count++;
+        d.advType = advertisedDevice->getAdvType();
+        if (name[0] && strcmp(name, d.name) != 0) {
+            strcpy(d.name, name);
+            d.dirty = true;
+        }
+        if (mfgLen) {
+            memcpy(d.mfg, mfg, mfgLen);
+            d.mfgLen = mfgLen;
+        }
+        portEXIT_CRITICAL(&bleScanMux);
     }
 };
 
 void ble_scan_setup() {
     BLEDevice::init("");
     pBLEScan = BLEDevice::getScan();
-    pBLEScan->setAdvertisedDeviceCallbacks(new AdvertisedDeviceCallbacks());
+    // Duplicates are needed to follow the RSSI. Results are not stored by NimBLE, the table keeps them
+    pBLEScan->setAdvertisedDeviceCallbacks(new AdvertisedDeviceCallbacks(), true);
+    pBLEScan->setMaxResults(0);
+    pBLEScan->setDuplicateFilter(false);
     // Active scan uses more power, but get results faster
     pBLEScan->setActiveScan(true);
     pBLEScan->setInterval(SCAN_INT);
@@ -106,18 +201,208 @@ void ble_scan_setup() {
     delay(500);
 }
 
+static String bleAddressString(const BleScanDevice &d) {
+    char addr[18];
+    const uint8_t *a = d.address;
+    sprintf(addr, "%02x:%02x:%02x:%02x:%02x:%02x", a[0], a[1], a[2], a[3], a[4], a[5]);
+    return addr;
+}
+
+// Copy of a device, taken under the lock. markDrawn starts tracking its changes from this copy
+static BleScanDevice bleSnapshot(uint16_t row, bool markDrawn = false) {
+    portENTER_CRITICAL(&bleScanMux);
+    BleScanDevice &live = bleDevices[bleOrder[row]];
+    if (markDrawn) {
+        live.dirty = false;
+        live.drawnStale = millis() - live.lastSeen > BLE_SCAN_STALE_MS;
+    }
+    BleScanDevice d = live;
+    portEXIT_CRITICAL(&bleScanMux);
+    return d;
+}
+
+// True when the row changed, or went stale, since it was drawn
+static bool bleRowChanged(uint16_t row) {
+    portENTER_CRITICAL(&bleScanMux);
+    const BleScanDevice &d = bleDevices[bleOrder[row]];
+    bool changed = d.dirty || (millis() - d.lastSeen > BLE_SCAN_STALE_MS) != d.drawnStale;
+    portEXIT_CRITICAL(&bleScanMux);
+    return changed;
+}
+
+static void ble_scan_export(bool json) {
+    FS *fs;
+    if (!getFsStorage(fs)) return;
+    if (!fs->exists("/BruceBLE")) fs->mkdir("/BruceBLE");
+    String path;
+    for (int i = 1;; i++) {
+        path = "/BruceBLE/ble_scan_" + String(i) + (json ? ".json" : ".csv");
+        if (!fs->exists(path)) break;
+    }
+    File file = fs->open(path, FILE_WRITE);
+    if (!file) {
+        displayError("Failed to open file");
+        return;
+    }
+
+    uint16_t count = bleDeviceCount;
+    if (json) file.print("[");
+    else file.print("address,address_type,name,adv_type,rssi,last_rssi,count,first_seen,last_seen,mfg\n");
+    for (uint16_t row = 0; row < count; row++) {
+        BleScanDevice d = bleSnapshot(row);
+        char mfg[BLE_MFG_MAX * 2 + 1] = "";
+        for (int i = 0; i < d.mfgLen; i++) sprintf(mfg + i * 2, "%02x", d.mfg[i]);
+        String name = d.name;
+        if (json) name.replace("\\", "\\\\");
+        name.replace("\"", json ? "\\\"" : "\"\"");
+        file.printf(
+            json ? "%s\n{\"address\":\"%s\",\"address_type\":%d,\"name\":\"%s\",\"adv_type\":\"%s\","
+                   "\"rssi\":%d,\"last_rssi\":%d,\"count\":%u,\"first_seen\":%u,\"last_seen\":%u,"
+                   "\"mfg\":\"%s\"}"
+                 : "%s%s,%d,\"%s\",%s,%d,%d,%u,%u,%u,%s\n",
+            json && row > 0 ? "," : "",
+            bleAddressString(d).c_str(),
+            d.addrType,
+            name.c_str(),
+            advTypeName(d.advType),
+            smoothedRssi(d),
+            d.lastRssi,
+            d.count,
+            d.firstSeen,
+            d.lastSeen,
+            mfg
+        );
+    }
+    if (json) file.println("\n]");
+    file.close();
+    displaySuccess("Saved " + path);
+    delay(1000);
+}
+
+// Draws one row of the list, padded to the full width so it overwrites the previous text
+static void ble_scan_draw_row(uint16_t row, int y, int cols) {
+    BleScanDevice d = bleSnapshot(row, true);
+    bool stale = d.drawnStale;
+
+    char line[64];
+    String label = d.name[0] ? String(d.name) : bleAddressString(d);
+    int nameCols = max(cols - 9, 4);
+    snprintf(
+        line,
+        sizeof(line),
+        "%-*.*s %4d %s",
+        nameCols,
+        nameCols,
+        label.c_str(),
+        smoothedRssi(d),
+        advTypeName(d.advType)
+    );
+    tft.setTextColor(stale ? TFT_DARKGREY : bruceConfig.priColor, bruceConfig.bgColor);
+    tft.drawString(line, 10, y, 1);
+}
+
 void ble_scan() {
-    displayTextLine("Scanning..");
+    if (!bleDevices) {
+        size_t bytes = sizeof(BleScanDevice) * BLE_SCAN_MAX_DEVICES;
+        bleDevices = (BleScanDevice *)(psramFound() ? ps_malloc(bytes) : malloc(bytes));
+        if (!bleDevices) {
+            displayError("Not enough memory");
+            return;
+        }
+    }
+    memset(bleDevices, 0, sizeof(BleScanDevice) * BLE_SCAN_MAX_DEVICES);
+    bleDeviceCount = 0;
+    bleAdvCount = 0;
+    bleDropped = 0;
 
-    options = {};
+    displayTextLine("Scanning..");
     ble_scan_setup();
-    BLEScanResults foundDevices = pBLEScan->start(scanTime, false);
-
-    addOptionToMainMenu();
+    pBLEScan->start(0, nullptr, false); // runs until stopped, results come through the callback
+
+    const int top = 42;
+    const int rowH = LH * FP + 2;
+    const int rows = max((tftHeight - top - 8) / rowH, 1);
+    const int cols = min((tftWidth - 20) / (LW * FP), 63);
+    int page = 0;
+    bool full = true;
+    uint16_t drawnRows = 0;
+    unsigned long lastRedraw = 0;
+    uint32_t lastAdvCount = 0;
+    int advRate = 0;
+
+    while (true) {
+        if (check(EscPress) || returnToMenu) break;
+        int pages = max((bleDeviceCount + rows - 1) / rows, 1);
+        if (check(NextPress)) {
+            page = (page + 1) % pages;
+            full = true;
+        }
+        if (check(PrevPress)) {
+            page = (page + pages - 1) % pages;
+            full = true;
+        }
+        if (check(SelPress)) {
+            bool exit = false;
+            options = {
+                {"Devices",     [&]() {
+                     std::vector<Option> devices;
+                     for (uint16_t row = 0; row < bleDeviceCount; row++) {
+                         BleScanDevice d = bleSnapshot(row);
+                         String addr = bleAddressString(d);
+                         String name = d.name[0] ? String(d.name) : "<no name>";
+                         String signal = String(smoothedRssi(d));
+                         devices.emplace_back(d.name[0] ? d.name : addr.c_str(), [=]() {
+                             ble_info(name, addr, signal);
+                         });
+                     }
+                     loopOptions(devices);
+                 }},
+                {"Export CSV",  [&]() { ble_scan_export(false); }},
+                {"Export JSON", [&]() { ble_scan_export(true); }},
+                {"Resume",      [&]() {}},
+                {"Exit",        [&]() { exit = true; }},
+            };
+            loopOptions(options);
+            options.clear();
+            returnToMenu = false;
+            if (exit) break;
+            full = true;
+        }
 
-    loopOptions(options);
-    options.clear();
+        if (millis() - lastRedraw < BLE_SCAN_REDRAW_MS) {
+            delay(5);
+            continue;
+        }
+        unsigned long elapsed = millis() - lastRedraw;
+        lastRedraw = millis();
+        advRate = (bleAdvCount - lastAdvCount) * 1000 / elapsed;
+        lastAdvCount = bleAdvCount;
+
+        if (full) {
+            drawMainBorderWithTitle("BLE Scan");
+            drawnRows = 0;
+        }
+        tft.setTextSize(FP);
+        tft.setTextColor(bruceConfig.priColor, bruceConfig.bgColor);
+        char header[48];
+        snprintf(
+            header, sizeof(header), "Dev:%u Adv/s:%d Pg:%d/%d%s   ", bleDeviceCount, advRate, page + 1, pages,
+            bleDropped ? " FULL" : ""
+        );
+        tft.drawString(header, 10, top - rowH - 2, 1);
+
+        // only the rows that changed, appeared, or went stale since the last redraw
+        uint16_t first = page * rows;
+        uint16_t last = min((int)bleDeviceCount, (int)first + rows);
+        for (uint16_t row = first; row < last; row++) {
+            if (full || row - first >= drawnRows || bleRowChanged(row))
+                ble_scan_draw_row(row, top + (row - first) * rowH, cols);
+        }
+        drawnRows = last - first;
+        full = false;
+    }
 
+    pBLEScan->stop();
     // Delete results fromBLEScan buffer to release memory
     pBLEScan->clearResults();
 }
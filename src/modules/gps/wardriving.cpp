@@ -11,19 +11,206 @@
 #include "core/mykeyboard.h"
 #include "core/sd_functions.h"
 #include "core/wifi/wifi_common.h"
+#include <TimeLib.h>
+#include <esp_timer.h>
+#include <esp_wifi.h>
+#include <new>
 
 #define MAX_WAIT 5000
 #define CURRENT_YEAR 2024
 
+// Passive capture: the promiscuous callback only parses the frame and queues it, the table lives in the loop
+static QueueHandle_t beaconQueue = NULL;
+static esp_timer_handle_t hopTimer = NULL;
+static uint8_t hopChannel = 1;
+static uint8_t hopMaxChannel = 13;
+static volatile uint32_t droppedBeacons = 0;
+
+static void hopTimerCallback(void *arg) {
+    hopChannel = hopChannel >= hopMaxChannel ? 1 : hopChannel + 1;
+    esp_wifi_set_channel(hopChannel, WIFI_SECOND_CHAN_NONE);
+}
+
+// Security of a beacon from its RSN / WPA information elements and the privacy capability bit
+static wifi_auth_mode_t beaconAuthMode(bool privacy, bool wpa, bool rsn, bool psk, bool sae, bool eap) {
+    if (rsn) {
+        if (eap) return WIFI_AUTH_WPA2_ENTERPRISE;
+        if (sae && psk) return WIFI_AUTH_WPA2_WPA3_PSK;
+        if (sae) return WIFI_AUTH_WPA3_PSK;
+        return wpa ? WIFI_AUTH_WPA_WPA2_PSK : WIFI_AUTH_WPA2_PSK;
+    }
+    if (wpa) return WIFI_AUTH_WPA_PSK;
+    return privacy ? WIFI_AUTH_WEP : WIFI_AUTH_OPEN;
+}
+
+static void beaconCallback(void *buf, wifi_promiscuous_pkt_type_t type) {
+    if (type != WIFI_PKT_MGMT) return;
+    const wifi_promiscuous_pkt_t *pkt = (const wifi_promiscuous_pkt_t *)buf;
+    const uint8_t *frame = pkt->payload;
+    int len = pkt->rx_ctrl.sig_len - 4; // without FCS
+    // beacons and probe responses: 24 bytes header, 12 bytes fixed fields, then the tags
+    if ((frame[0] != 0x80 && frame[0] != 0x50) || len < 36) return;
+
+    WardrivingBeacon b = {};
+    memcpy(b.bssid, frame + 16, 6);
+    b.rssi = pkt->rx_ctrl.rssi;
+    b.channel = pkt->rx_ctrl.channel;
+    bool privacy = frame[34] & 0x10;
+    bool wpa = false, rsn = false, psk = false, sae = false, eap = false;
+
+    int pos = 36;
+    while (pos + 2 <= len) {
+        uint8_t id = frame[pos], tagLen = frame[pos + 1];
+        const uint8_t *tag = frame + pos + 2;
+        if (pos + 2 + tagLen > len) break;
+        if (id == 0 && tagLen <= 32) {
+            memcpy(b.ssid, tag, tagLen);
+        } else if (id == 3 && tagLen == 1) {
+            b.channel = tag[0];
+        } else if (id == 48 && tagLen >= 8) {
+            // version, group cipher, pairwise ciphers, then the AKM suites
+            rsn = true;
+            int n = tag[6] | (tag[7] << 8);
+            int akm = 8 + n * 4;
+            if (akm + 2 <= tagLen) {
+                int count = tag[akm] | (tag[akm + 1] << 8);
+                for (int i = 0; i < count && akm + 2 + i * 4 + 4 <= tagLen; i++) {
+                    uint8_t suite = tag[akm + 2 + i * 4 + 3];
+                    if (suite == 1 || suite == 5) eap = true;
+                    else if (suite == 2 || suite == 6) psk = true;
+                    else if (suite == 8) sae = true;
+                }
+            }
+        } else if (id == 221 && tagLen >= 4 && tag[0] == 0x00 && tag[1] == 0x50 && tag[2] == 0xF2 &&
+                   tag[3] == 0x01) {
+            wpa = true;
+        }
+        pos += 2 + tagLen;
+    }
+    b.authMode = beaconAuthMode(privacy, wpa, rsn, psk, sae, eap);
+
+    if (xQueueSend(beaconQueue, &b, 0) != pdTRUE) droppedBeacons++;
+}
+
+// The dedup tables are too big for the stack the app runs on
+template <typename T> static T *allocTable() {
+    void *mem = psramFound() ? ps_malloc(sizeof(T)) : malloc(sizeof(T));
+    return mem ? new (mem) T() : nullptr;
+}
+
+bool WigleCsvWriter::open(FS &fs, const String &path, const String &header) {
+    close();
+    if (!_buf) _buf = (char *)malloc(WIGLE_BUFFER_SIZE);
+    if (!_buf) return false;
+
+    bool is_new_file = !fs.exists(path);
+    _file = fs.open(path, is_new_file ? FILE_WRITE : FILE_APPEND);
+    if (!_file) return false;
+    if (is_new_file) _file.print(header);
+    _lastSync = millis();
+    return true;
+}
+
+void WigleCsvWriter::write(
+    const uint8_t *bssid, const char *ssid, const char *authMode, time_t firstSeen, int channel, int rssi,
+    double lat, double lng, double alt, double accuracy
+) {
+    if (!_file) return;
+    char escaped[65]; // quotes are doubled inside the quoted SSID
+    size_t n = 0;
+    for (const char *c = ssid; *c && n < sizeof(escaped) - 2; c++) {
+        if (*c == '"') escaped[n++] = '"';
+        escaped[n++] = *c;
+    }
+    escaped[n] = '\0';
+
+    // longest line is about 200 bytes
+    if (WIGLE_BUFFER_SIZE - _len < 256) writeBuffer();
+    int len = snprintf(
+        _buf + _len,
+        WIGLE_BUFFER_SIZE - _len,
+        "%02X:%02X:%02X:%02X:%02X:%02X,\"%s\",[%s],%04d-%02d-%02d %02d:%02d:%02d,"
+        "%d,%d,%d,%f,%f,%f,%f,,,WIFI\n",
+        bssid[0],
+        bssid[1],
+        bssid[2],
+        bssid[3],
+        bssid[4],
+        bssid[5],
+        escaped,
+        authMode,
+        year(firstSeen),
+        month(firstSeen),
+        day(firstSeen),
+        hour(firstSeen),
+        minute(firstSeen),
+        second(firstSeen),
+        channel,
+        channel != 14 ? 2407 + (channel * 5) : 2484,
+        rssi,
+        lat,
+        lng,
+        alt,
+        accuracy
+    );
+    if (len > 0) _len = min(_len + len, (size_t)WIGLE_BUFFER_SIZE - 1);
+}
+
+void WigleCsvWriter::writeBuffer() {
+    if (_len == 0 || !_file) return;
+    if (_file.write((const uint8_t *)_buf, _len) != _len) Serial.println("Wardriving: CSV write failed");
+    _len = 0;
+}
+
+void WigleCsvWriter::sync(bool force) {
+    if (!_file || (!force && millis() - _lastSync < WIGLE_SYNC_MS)) return;
+    writeBuffer();
+    _file.flush(); // fsync, so a power loss costs at most WIGLE_SYNC_MS of data
+    _lastSync = millis();
+}
+
+void WigleCsvWriter::close() {
+    if (_file) {
+        writeBuffer();
+        _file.close();
+    }
+    free(_buf);
+    _buf = nullptr;
+    _len = 0;
+}
+
 Wardriving::Wardriving() { setup(); }
 
 Wardriving::~Wardriving() {
     if (gpsConnected) end();
+    free(registeredMACs);
+    free(spilledMACs);
+    free(activeNetworks);
     ioExpander.turnPinOnOff(IO_EXP_GPS, LOW);
 }
 
 void Wardriving::setup() {
     ioExpander.turnPinOnOff(IO_EXP_GPS, HIGH);
+
+    bool chosen = false;
+    std::vector<Option> options = {
+        {"Passive scan", [&]() { chosen = passive = true; }  },
+        {"Active scan",  [&]() {
+             chosen = true;
+             passive = false;
+         }},
+    };
+    loopOptions(options);
+    if (!chosen) return;
+
+    registeredMACs = allocTable<MacSet<WARDRIVING_MAC_CAP>>();
+    spilledMACs = allocTable<MacBloom<WARDRIVING_BLOOM_BITS>>();
+    if (passive) activeNetworks = allocTable<MacMap<WARDRIVING_ACTIVE_CAP, WardrivingNetwork>>();
+    if (!registeredMACs || !spilledMACs || (passive && !activeNetworks)) {
+        displayError("Not enough memory");
+        return;
+    }
+
     display_banner();
     padprintln("Initializing...");
 
@@ -39,6 +226,43 @@ void Wardriving::begin_wifi() {
     WiFi.disconnect();
 }
 
+void Wardriving::begin_passive() {
+    beaconQueue = xQueueCreate(WARDRIVING_QUEUE_LEN, sizeof(WardrivingBeacon));
+    droppedBeacons = 0;
+
+    wifi_country_t country;
+    if (esp_wifi_get_country(&country) == ESP_OK && country.nchan > 0)
+        hopMaxChannel = min(country.schan + country.nchan - 1, 13);
+    hopChannel = 1;
+
+    wifi_promiscuous_filter_t filter = {.filter_mask = WIFI_PROMIS_FILTER_MASK_MGMT};
+    esp_wifi_set_promiscuous_filter(&filter);
+    esp_wifi_set_promiscuous_rx_cb(beaconCallback);
+    esp_wifi_set_promiscuous(true);
+    esp_wifi_set_channel(hopChannel, WIFI_SECOND_CHAN_NONE);
+
+    esp_timer_create_args_t args = {};
+    args.callback = &hopTimerCallback;
+    args.name = "wardrive_hop";
+    if (esp_timer_create(&args, &hopTimer) == ESP_OK)
+        esp_timer_start_periodic(hopTimer, (uint64_t)WARDRIVING_HOP_MS * 1000);
+    else Serial.println("Fail creating the channel hopping timer");
+}
+
+void Wardriving::end_passive() {
+    if (hopTimer) {
+        esp_timer_stop(hopTimer);
+        esp_timer_delete(hopTimer);
+        hopTimer = NULL;
+    }
+    esp_wifi_set_promiscuous(false);
+    esp_wifi_set_promiscuous_rx_cb(NULL);
+    if (beaconQueue) {
+        vQueueDelete(beaconQueue);
+        beaconQueue = NULL;
+    }
+}
+
 bool Wardriving::begin_gps() {
     GPSserial.begin(bruceConfig.gpsBaudrate, SERIAL_8N1, SERIAL_RX, SERIAL_TX);
 
@@ -59,6 +283,11 @@ bool Wardriving::begin_gps() {
 }
 
 void Wardriving::end() {
+    if (passive && beaconQueue) {
+        flush_networks(true);
+        end_passive();
+    }
+    csv.close();
     wifiDisconnect();
 
     GPSserial.end();
@@ -70,6 +299,8 @@ void Wardriving::end() {
 }
 
 void Wardriving::loop() {
+    if (passive) return passive_loop();
+
     int count = 0;
     returnToMenu = false;
     while (1) {
@@ -108,6 +339,136 @@ void Wardriving::loop() {
     }
 }
 
+void Wardriving::read_gps() {
+    while (GPSserial.available() > 0) gps.encode(GPSserial.read());
+    if (gps.location.isUpdated()) set_position();
+    if (filename == "" && gps.date.isValid() && gps.date.year() >= CURRENT_YEAR &&
+        gps.date.year() < CURRENT_YEAR + 5)
+        create_filename();
+}
+
+// Never blocks on the radio: beacons arrive through the queue while the GPS keeps being decoded
+void Wardriving::passive_loop() {
+    returnToMenu = false;
+    begin_passive();
+
+    unsigned long lastGps = millis();
+    unsigned long lastRedraw = 0;
+    WardrivingBeacon beacon;
+    while (1) {
+        if (check(EscPress) || returnToMenu) return end();
+
+        if (GPSserial.available() > 0) {
+            lastGps = millis();
+            read_gps();
+        } else if (millis() - lastGps > MAX_WAIT) {
+            displayError("GPS not Found!");
+            return end();
+        }
+
+        int merged = 0;
+        while (merged++ < WARDRIVING_QUEUE_LEN && xQueueReceive(beaconQueue, &beacon, 0) == pdTRUE)
+            update_network(beacon);
+
+        if (millis() - lastRedraw >= 1000) {
+            lastRedraw = millis();
+            flush_networks(false);
+            csv.sync();
+
+            display_banner();
+            if (gps.location.isValid()) padprintf(2, "Coord: %.6f, %.6f\n", cur_lat, cur_lng);
+            else dump_gps_data();
+            padprintf(2, "In range: %d  Ch: %d\n", (int)activeNetworks->size(), hopChannel);
+            if (distance > 0) padprintf(2, "Networks/km: %.1f\n", wifiNetworkCount / (distance / 1000));
+            if (droppedBeacons) padprintf(2, "Dropped beacons: %u\n", droppedBeacons);
+        }
+        delay(5);
+    }
+}
+
+// Merges a beacon into the table, keeping the position of the strongest reception
+void Wardriving::update_network(const WardrivingBeacon &beacon) {
+    bool fresh;
+    WardrivingNetwork *found = activeNetworks->insert(macToKey(beacon.bssid), fresh);
+    if (!found) { // too many networks in range, this one waits for some to be flushed
+        droppedBeacons++;
+        return;
+    }
+    WardrivingNetwork &net = *found;
+    net.lastSeen = millis();
+
+    if (net.firstSeen == 0) net.firstSeen = gps_time();
+
+    if (fresh) {
+        net.beacon = beacon;
+    } else if (beacon.rssi > net.beacon.rssi || !net.hasPosition) {
+        net.beacon.rssi = beacon.rssi;
+        net.beacon.channel = beacon.channel;
+        if (beacon.ssid[0]) memcpy(net.beacon.ssid, beacon.ssid, sizeof(beacon.ssid)); // hidden SSIDs
+    } else {
+        return;
+    }
+
+    if (gps.location.isValid()) {
+        net.hasPosition = true;
+        net.lat = gps.location.lat();
+        net.lng = gps.location.lng();
+        net.alt = gps.altitude.meters();
+        net.hdop = gps.hdop.hdop();
+    }
+}
+
+// Writes the networks that went out of range (or all of them) and drops them from the table
+void Wardriving::flush_networks(bool all) {
+    unsigned long now = millis();
+    for (size_t slot = 0; slot < activeNetworks->capacity();) {
+        WardrivingNetwork &net = activeNetworks->value(slot);
+        if (!activeNetworks->used(slot) || (!all && now - net.lastSeen < WARDRIVING_FLUSH_MS)) {
+            slot++;
+            continue;
+        }
+        // networks never heard with a fix are useless for WiGLE
+        if (net.hasPosition && net.firstSeen != 0 && open_file() && register_mac(net.beacon.bssid)) {
+            csv.write(
+                net.beacon.bssid,
+                net.beacon.ssid,
+                auth_mode_to_string(net.beacon.authMode).c_str(),
+                net.firstSeen,
+                net.beacon.channel,
+                net.beacon.rssi,
+                net.lat,
+                net.lng,
+                net.alt,
+                net.hdop
+            );
+            wifiNetworkCount++;
+        }
+        activeNetworks->eraseSlot(slot); // the slot may now hold a network that was after it
+    }
+}
+
+// True the first time a BSSID is seen. Past WARDRIVING_MAC_CAP networks the bloom filter takes over,
+// its rare false positives only drop a new network from the file
+bool Wardriving::register_mac(const uint8_t *bssid) {
+    uint64_t key = macToKey(bssid);
+    if (registeredMACs->contains(key)) return false;
+    if (registeredMACs->insert(key)) return true;
+    return spilledMACs->insert(key);
+}
+
+// 0 until the receiver has a real date, modules without a fix report 2000-00-00
+time_t Wardriving::gps_time() {
+    if (!gps.date.isValid() || !gps.time.isValid() || gps.date.year() < CURRENT_YEAR) return 0;
+    tmElements_t tm;
+    tm.Year = gps.date.year() - 1970;
+    tm.Month = gps.date.month();
+    tm.Day = gps.date.day();
+    tm.Hour = gps.time.hour();
+    tm.Minute = gps.time.minute();
+    tm.Second = gps.time.second();
+    return makeTime(tm);
+}
+
 void Wardriving::set_position() {
     double lat = gps.location.lat();
     double lng = gps.location.lng();
@@ -189,75 +550,62 @@ void Wardriving::create_filename() {
     filename = String(timestamp) + "_wardriving.csv";
 }
 
-void Wardriving::append_to_file(int network_amount) {
+// Opens the session file once, it then stays open until the end
+bool Wardriving::open_file() {
+    if (csv.isOpen()) return true;
+
     FS *fs;
     if (!getFsStorage(fs)) {
         padprintln("Storage setup error");
         returnToMenu = true;
-        return;
+        return false;
     }
 
     if (filename == "") create_filename();
 
     if (!(*fs).exists("/BruceWardriving")) (*fs).mkdir("/BruceWardriving");
 
-    bool is_new_file = false;
-    if (!(*fs).exists("/BruceWardriving/" + filename)) is_new_file = true;
-    File file = (*fs).open("/BruceWardriving/" + filename, is_new_file ? FILE_WRITE : FILE_APPEND);
-
-    if (!file) {
+    String header =
+        "WigleWifi-1.6,appRelease=v" + String(BRUCE_VERSION) + ",model=M5Stack GPS Unit,release=v" +
+        String(BRUCE_VERSION) +
+        ",device=ESP32 M5Stack,display=SPI TFT,board=ESP32 M5Stack,brand=Bruce,star=Sol,body=4,subBody=1\n"
+        "MAC,SSID,AuthMode,FirstSeen,Channel,Frequency,RSSI,CurrentLatitude,CurrentLongitude,"
+        "AltitudeMeters,AccuracyMeters,RCOIs,MfgrId,Type\n";
+    if (!csv.open(*fs, "/BruceWardriving/" + filename, header)) {
         padprintln("Failed to open file for writing");
         returnToMenu = true;
-        return;
+        return false;
     }
+    return true;
+}
 
-    if (is_new_file) {
-        file.println(
-            "WigleWifi-1.6,appRelease=v" + String(BRUCE_VERSION) + ",model=M5Stack GPS Unit,release=v" +
-            String(BRUCE_VERSION) +
-            ",device=ESP32 M5Stack,display=SPI TFT,board=ESP32 M5Stack,brand=Bruce,star=Sol,body=4,subBody=1"
-        );
-        file.println(
-            "MAC,SSID,AuthMode,FirstSeen,Channel,Frequency,RSSI,CurrentLatitude,CurrentLongitude,"
-            "AltitudeMeters,AccuracyMeters,RCOIs,MfgrId,Type"
-        );
-    }
+void Wardriving::append_to_file(int network_amount) {
+    if (!open_file()) return;
 
+    // like passive mode, nothing is written without a fix: the networks are kept for the next scan
+    time_t now = gps_time();
+    if (now == 0 || !gps.location.isValid()) {
+        WiFi.scanDelete();
+        return;
+    }
     for (int i = 0; i < network_amount; i++) {
-        String macAddress = WiFi.BSSIDstr(i);
-
         // Check if MAC was already found in this session
-        if (registeredMACs.find(macAddress) == registeredMACs.end()) {
-            registeredMACs.insert(macAddress); // Adds MAC to file
-            int32_t channel = WiFi.channel(i);
-
-            char buffer[512];
-            snprintf(
-                buffer,
-                sizeof(buffer),
-                "%s,\"%s\",[%s],%04d-%02d-%02d %02d:%02d:%02d,%d,%d,%d,%f,%f,%f,%f,,,WIFI\n",
-                macAddress.c_str(),
-                WiFi.SSID(i).c_str(),
-                auth_mode_to_string(WiFi.encryptionType(i)).c_str(),
-                gps.date.year(),
-                gps.date.month(),
-                gps.date.day(),
-                gps.time.hour(),
-                gps.time.minute(),
-                gps.time.second(),
-                channel,
-                channel != 14 ? 2407 + (channel * 5) : 2484,
-                WiFi.RSSI(i),
-                gps.location.lat(),
-                gps.location.lng(),
-                gps.altitude.meters(),
-                gps.hdop.hdop() * 1.0
-            );
-            file.print(buffer);
-
-            wifiNetworkCount++;
-        }
+        if (!register_mac(WiFi.BSSID(i))) continue;
+
+        csv.write(
+            WiFi.BSSID(i),
+            WiFi.SSID(i).c_str(),
+            auth_mode_to_string(WiFi.encryptionType(i)).c_str(),
+            now,
+            WiFi.channel(i),
+            WiFi.RSSI(i),
+            gps.location.lat(),
+            gps.location.lng(),
+            gps.altitude.meters(),
+            gps.hdop.hdop()
+        );
+        wifiNetworkCount++;
     }
-
-    file.close();
+    WiFi.scanDelete();
+    csv.sync();
 }
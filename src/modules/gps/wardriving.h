@@ -9,10 +9,72 @@
 #ifndef __WAR_DRIVING_H__
 #define __WAR_DRIVING_H__
 
+#include "modules/wifi/mac_set.h"
+#include <FS.h>
 #include <TinyGPS++.h>
 #include <esp_wifi_types.h>
 #include <globals.h>
-#include <set>
+
+#define WARDRIVING_HOP_MS 150        // passive mode: time on each channel, a bit more than a beacon interval
+#define WARDRIVING_FLUSH_MS 30000    // passive mode: networks not heard for this long are written to the file
+#define WARDRIVING_QUEUE_LEN 64      // beacons waiting to be merged into the table
+#define WARDRIVING_MAC_CAP 4096      // exact dedup slots (3/4 usable), 32kB
+#define WARDRIVING_BLOOM_BITS 131072 // dedup of the networks past the exact table, 16kB
+#define WARDRIVING_ACTIVE_CAP 256    // passive mode: slots of the networks in range (3/4 usable), 26kB
+#define WIGLE_BUFFER_SIZE 4096       // CSV lines kept in RAM before being written
+#define WIGLE_SYNC_MS 10000          // the CSV is synced to the flash at most this often
+
+// Beacon or probe response parsed by the promiscuous callback
+struct WardrivingBeacon {
+    uint8_t bssid[6];
+    char ssid[33];
+    uint8_t channel;
+    int8_t rssi;
+    wifi_auth_mode_t authMode;
+};
+
+// Network heard by the passive capture, with the position where it was heard best
+struct WardrivingNetwork {
+    WardrivingBeacon beacon; // rssi is the best one
+    time_t firstSeen = 0;    // GPS time, 0 if there was no valid date yet
+    unsigned long lastSeen = 0;
+    bool hasPosition = false;
+    double lat = 0;
+    double lng = 0;
+    double alt = 0;
+    double hdop = 0;
+};
+
+/**
+ * @brief WiGLE CSV file kept open for the whole session
+ *
+ * Lines are formatted straight into a write-behind buffer that only goes to the file when it fills up
+ * or on sync(), and the file is synced at most every WIGLE_SYNC_MS: the flash sees a few big writes
+ * instead of an open/append/close per scan.
+ */
+class WigleCsvWriter {
+public:
+    ~WigleCsvWriter() { close(); }
+
+    // Opens `path` for appending, writing `header` first if the file is new
+    bool open(FS &fs, const String &path, const String &header);
+    bool isOpen() { return (bool)_file; }
+    void write(
+        const uint8_t *bssid, const char *ssid, const char *authMode, time_t firstSeen, int channel, int rssi,
+        double lat, double lng, double alt, double accuracy
+    );
+    // Writes the buffer to the file, and syncs it if WIGLE_SYNC_MS passed (or `force`)
+    void sync(bool force = false);
+    void close();
+
+private:
+    void writeBuffer();
+
+    File _file;
+    char *_buf = nullptr;
+    size_t _len = 0;
+    unsigned long _lastSync = 0;
+};
 
 class Wardriving {
 public:
@@ -36,9 +98,13 @@ private:
     double distance = 0;
     String filename = "";
     TinyGPSPlus gps;
-    HardwareSerial GPSserial = HardwareSerial(2); // Uses UART2 for GPS
-    std::set<String> registeredMACs;              // Store and track registered MAC
-    int wifiNetworkCount = 0;                     // Counter fo wifi networks
+    HardwareSerial GPSserial = HardwareSerial(2);           // Uses UART2 for GPS
+    MacSet<WARDRIVING_MAC_CAP> *registeredMACs = nullptr;   // BSSIDs already in the file
+    MacBloom<WARDRIVING_BLOOM_BITS> *spilledMACs = nullptr; // same, once registeredMACs is full
+    WigleCsvWriter csv;
+    int wifiNetworkCount = 0; // Counter fo wifi networks
+    bool passive = true;      // promiscuous capture, not WiFi.scanNetworks()
+    MacMap<WARDRIVING_ACTIVE_CAP, WardrivingNetwork> *activeNetworks = nullptr; // passive: networks in range
 
     /////////////////////////////////////////////////////////////////////////////////////
     // Setup
@@ -46,6 +112,8 @@ private:
     void begin_wifi(void);
     bool begin_gps(void);
     void end(void);
+    void begin_passive(void);
+    void end_passive(void);
 
     /////////////////////////////////////////////////////////////////////////////////////
     // Display functions
@@ -61,6 +129,17 @@ private:
     String auth_mode_to_string(wifi_auth_mode_t authMode);
     void append_to_file(int network_amount);
     void create_filename(void);
+    bool open_file(void);
+    bool register_mac(const uint8_t *bssid);
+    time_t gps_time(void);
+
+    /////////////////////////////////////////////////////////////////////////////////////
+    // Passive capture
+    /////////////////////////////////////////////////////////////////////////////////////
+    void passive_loop(void);
+    void read_gps(void);
+    void update_network(const WardrivingBeacon &beacon);
+    void flush_networks(bool all);
 };
 
 #endif // WAR_DRIVING_H
@@ -10,8 +10,70 @@
 #include "core/mykeyboard.h"
 #include "core/sd_functions.h"
 #include "core/wifi/wifi_common.h"
+#include "rom/miniz.h"
+#include <esp_rom_crc.h>
+
+// Raw deflate settings: few probes, the CSVs compress well enough and the upload stays CPU light
+#define WIGLE_DEFLATE_FLAGS (32 | TDEFL_GREEDY_PARSING_FLAG)
+
+// Batches the upload body into WIGLE_TLS_BATCH writes. Without a client it only counts the bytes
+struct UploadSink {
+    WiFiClientSecure *client = nullptr;
+    uint8_t *buf = nullptr;
+    size_t len = 0;
+    size_t total = 0;
+    bool failed = false;
+
+    void write(const uint8_t *data, size_t n) {
+        total += n;
+        if (!client) return;
+        while (n > 0) {
+            size_t chunk = min(n, (size_t)WIGLE_TLS_BATCH - len);
+            memcpy(buf + len, data, chunk);
+            len += chunk;
+            data += chunk;
+            n -= chunk;
+            if (len == WIGLE_TLS_BATCH) flush();
+        }
+    }
+    void flush() {
+        if (client && len > 0 && client->write(buf, len) != len) failed = true;
+        len = 0;
+    }
+};
+
+static String manifestPath(const String &folder) {
+    return folder.endsWith("/") ? folder + WIGLE_MANIFEST : folder + "/" + WIGLE_MANIFEST;
+}
+
+static mz_bool putDeflated(const void *data, int len, void *user) {
+    UploadSink *sink = (UploadSink *)user;
+    sink->write((const uint8_t *)data, len);
+    return !sink->failed;
+}
+
+// Writes the gzip form of the whole file to the sink
+static bool gzipFile(File &file, tdefl_compressor *d, uint8_t *in, UploadSink &sink, const String &message) {
+    static const uint8_t header[10] = {0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 3}; // deflate, no name, unix
+    size_t size = file.size();
+    uint32_t crc = 0;
+    if (!file.seek(0) || tdefl_init(d, putDeflated, &sink, WIGLE_DEFLATE_FLAGS) != TDEFL_STATUS_OKAY)
+        return false;
 
-#define CBUFLEN 1024
+    sink.write(header, sizeof(header));
+    while (true) {
+        size_t n = file.read(in, WIGLE_TLS_BATCH);
+        bool last = n < WIGLE_TLS_BATCH || file.available() == 0;
+        crc = esp_rom_crc32_le(crc, in, n);
+        if (tdefl_compress_buffer(d, in, n, last ? TDEFL_FINISH : TDEFL_NO_FLUSH) < 0 || sink.failed)
+            return false;
+        if (size > 0) progressHandler(file.position() * 100 / size, 100, message);
+        if (last) break;
+    }
+    uint32_t trailer[2] = {crc, (uint32_t)size};
+    sink.write((const uint8_t *)trailer, sizeof(trailer));
+    return file.position() == size;
+}
 
 Wigle::Wigle() {}
 
@@ -39,7 +101,7 @@ bool Wigle::get_user() {
 
     WiFiClientSecure client;
     client.setInsecure();
-    if (!client.connect(host, 443)) return false;
+    if (!client.connect(host, WIGLE_PORT)) return false;
 
     client.println("GET /api/v2/profile/user HTTP/1.0");
     client.print("Host: ");
@@ -84,9 +146,14 @@ void Wigle::dump_wigle_info() {
     padprintln("");
 }
 
-void Wigle::send_upload_headers(WiFiClientSecure &client, String filename, int filesize, String boundary) {
-    // Content-Disposition header size.
-    int cd_header_len = 147 - 45 - 8 + filename.length() + 2 * (boundary.length() + 2);
+// Sends the request headers and the part header of the file, returns what goes after the file data
+String Wigle::send_upload_headers(
+    WiFiClientSecure &client, String filename, int filesize, String boundary, const char *content_type
+) {
+    String part = "--" + boundary + "\r\n";
+    part += "Content-Disposition: form-data; name=\"file\"; filename=\"" + filename + "\"\r\n";
+    part += "Content-Type: " + String(content_type) + "\r\n\r\n";
+    String tail = "\r\n--" + boundary + "--\r\n\r\n";
 
     client.println("POST /api/v2/file/upload HTTP/1.0");
     client.print("Host: ");
@@ -98,16 +165,10 @@ void Wigle::send_upload_headers(WiFiClientSecure &client, String filename, int f
     client.print("Content-Type: multipart/form-data; boundary=");
     client.println(boundary);
     client.print("Content-Length: ");
-    client.println(filesize + cd_header_len);
-    client.println();
-
-    // Start content-disposition file header:
-    client.println("--" + boundary);
-    client.print("Content-Disposition: form-data; name=\"file\"; filename=\"");
-    client.print(filename);
-    client.println("\"");
-    client.println("Content-Type: text/csv");
+    client.println(part.length() + filesize + tail.length());
     client.println();
+    client.print(part);
+    return tail;
 }
 
 bool Wigle::upload(FS *fs, String filepath, bool auto_delete) {
@@ -151,8 +212,19 @@ bool Wigle::upload_all(FS *fs, String folder, bool auto_delete) {
 
     dump_wigle_info();
     int i = 1;
+    int skipped = 0;
     bool success;
 
+    // files uploaded by an interrupted run are not sent again
+    manifest.clear();
+    File list = fs->open(manifestPath(folder));
+    while (list && list.available()) {
+        String line = list.readStringUntil('\n');
+        line.trim();
+        if (line != "") manifest.push_back(line);
+    }
+    if (list) list.close();
+
     while (true) {
         success = false;
 
@@ -161,7 +233,10 @@ bool Wigle::upload_all(FS *fs, String folder, bool auto_delete) {
         String filename = file.name();
         String filepath = file.path();
 
-        if (!file.isDirectory() && filename.endsWith(".csv")) {
+        if (!file.isDirectory() && filename.endsWith(".csv") && _is_uploaded(file)) {
+            skipped++;
+            success = true;
+        } else if (!file.isDirectory() && filename.endsWith(".csv")) {
             Serial.println("Uploading file to Wigle: " + filename);
 
             if (!_upload_file(file, "Uploading " + String(i) + "...")) {
@@ -170,6 +245,7 @@ bool Wigle::upload_all(FS *fs, String folder, bool auto_delete) {
                 delay(1000);
                 return false;
             }
+            _mark_uploaded(fs, folder, file);
             i++;
             success = true;
         }
@@ -178,44 +254,91 @@ bool Wigle::upload_all(FS *fs, String folder, bool auto_delete) {
     }
 
     String plural = i > 2 ? "s" : "";
+    if (skipped > 0) Serial.printf("Wigle: %d file(s) already uploaded were skipped\n", skipped);
     displaySuccess(String(i - 1) + " file" + plural + " uploaded");
     delay(1000);
     return true;
 }
 
+// Manifest lines are "name,size": a file that grew since its upload is sent again
+bool Wigle::_is_uploaded(File &file) {
+    String entry = String(file.name()) + "," + String(file.size());
+    for (const String &line : manifest) {
+        if (line == entry) return true;
+    }
+    return false;
+}
+
+// Appended right after each upload, so it survives a reset in the middle of the run
+void Wigle::_mark_uploaded(FS *fs, String folder, File &file) {
+    String entry = String(file.name()) + "," + String(file.size());
+    manifest.push_back(entry);
+    File list = fs->open(manifestPath(folder), FILE_APPEND);
+    if (!list) return;
+    list.println(entry);
+    list.close();
+}
+
+// Two deflate passes: the first one only measures the gzip size, that HTTP/1.0 needs up front.
+// Compressing twice costs less than sending the raw CSV over the air
+bool Wigle::_upload_gzip(
+    WiFiClientSecure &client, File &file, String boundary, String upload_message, uint8_t *mem
+) {
+    tdefl_compressor *d = (tdefl_compressor *)mem;
+    uint8_t *in = mem + sizeof(tdefl_compressor);
+
+    UploadSink sizing;
+    if (!gzipFile(file, d, in, sizing, "Compressing...")) return false;
+    Serial.printf("Wigle: %s %u -> %u bytes\n", file.name(), (unsigned)file.size(), (unsigned)sizing.total);
+
+    String tail =
+        send_upload_headers(client, String(file.name()) + ".gz", sizing.total, boundary, "application/gzip");
+    UploadSink sink;
+    sink.client = &client;
+    sink.buf = in + WIGLE_TLS_BATCH;
+    bool ok = gzipFile(file, d, in, sink, upload_message) && sink.total == sizing.total;
+    sink.flush();
+    client.print(tail);
+    return ok && !sink.failed;
+}
+
 bool Wigle::_upload_file(File file, String upload_message) {
     WiFiClientSecure client;
     client.setInsecure();
-    if (!client.connect(host, 443)) {
+    if (!client.connect(host, WIGLE_PORT)) {
         displayError("Wigle API connection failed");
         delay(1000);
         return false;
     }
 
-    String filename = file.name();
-    int filesize = file.size();
     String boundary = "BRUCE";
     boundary.concat(esp_random());
 
-    send_upload_headers(client, filename, filesize, boundary);
-
-    byte cbuf[CBUFLEN];
-    float percent = 0;
-    while (file.available()) {
-        long bytes_available = file.available();
-        int toread = CBUFLEN;
-        if (bytes_available < CBUFLEN) toread = bytes_available;
-        file.read(cbuf, toread);
-        client.write(cbuf, toread);
-        percent = ((float)file.position() / (float)file.size()) * 100;
-        progressHandler(percent, 100, upload_message);
+    size_t bytes = sizeof(tdefl_compressor) + 2 * WIGLE_TLS_BATCH;
+    uint8_t *mem = (uint8_t *)(psramFound() ? ps_malloc(bytes) : malloc(bytes));
+    bool ok = true;
+    if (mem) {
+        ok = _upload_gzip(client, file, boundary, upload_message, mem);
+    } else {
+        // not enough memory for the compressor: raw CSV
+        mem = (uint8_t *)malloc(WIGLE_TLS_BATCH);
+        if (!mem) {
+            client.stop();
+            return false;
+        }
+        String tail = send_upload_headers(client, file.name(), file.size(), boundary);
+        while (ok && file.available()) {
+            size_t n = file.read(mem, WIGLE_TLS_BATCH);
+            ok = n > 0 && client.write(mem, n) == n;
+            progressHandler(file.position() * 100 / file.size(), 100, upload_message);
+        }
+        client.print(tail);
+    }
+    free(mem);
+    if (!ok) {
+        client.stop();
+        return false;
     }
-
-    client.println();
-    client.print("--");
-    client.print(boundary);
-    client.println("--");
-    client.println();
     client.flush();
 
     Serial.println("File transfer complete");
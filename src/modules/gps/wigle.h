@@ -11,6 +11,20 @@
 #include <WiFiClientSecure.h>
 #include <globals.h>
 
+#define WIGLE_TLS_BATCH 4096             // bytes read from the file and written to TLS at once
+#define WIGLE_MANIFEST ".wigle_uploads"  // files already uploaded by upload_all, inside the folder
+
+// WiGLE API server, override with build flags to upload to a mirror or a test server.
+// The client always speaks TLS (setInsecure, any certificate is taken), so a stand-in on the LAN has to
+// terminate TLS too, e.g. -DWIGLE_HOST='"192.168.4.2"' -DWIGLE_PORT=8443 and a self-signed HTTPS server
+// that answers POST /api/v2/file/upload with {"success":true}
+#ifndef WIGLE_HOST
+#define WIGLE_HOST "api.wigle.net"
+#endif
+#ifndef WIGLE_PORT
+#define WIGLE_PORT 443
+#endif
+
 class Wigle {
 public:
     /////////////////////////////////////////////////////////////////////////////////////
@@ -25,17 +39,27 @@ public:
     bool get_user(void);
     bool upload(FS *fs, String filepath, bool auto_delete = true);
     bool upload_all(FS *fs, String filepath, bool auto_delete = true);
-    void send_upload_headers(WiFiClientSecure &client, String filename, int filesize, String boundary);
+    String send_upload_headers(
+        WiFiClientSecure &client, String filename, int filesize, String boundary,
+        const char *content_type = "text/csv"
+    );
     void display_banner(void);
     void dump_wigle_info(void);
 
 private:
     String wigle_user;
     String auth_header;
-    const char *host = "api.wigle.net";
+    const char *host = WIGLE_HOST;
 
     bool _check_token(void);
     bool _upload_file(File file, String upload_message);
+    bool _upload_gzip(
+        WiFiClientSecure &client, File &file, String boundary, String upload_message, uint8_t *mem
+    );
+    bool _is_uploaded(File &file);
+    void _mark_uploaded(FS *fs, String folder, File &file);
+
+    std::vector<String> manifest;
 };
 
 #endif
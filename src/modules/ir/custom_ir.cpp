@@ -5,6 +5,7 @@
 #include "core/sd_functions.h"
 #include "core/settings.h"
 #include "core/type_convertion.h"
+#include "ir_file.h"
 #include <IRutils.h>
 
 uint32_t swap32(uint32_t value) {
@@ -15,13 +16,6 @@ uint32_t swap32(uint32_t value) {
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Custom IR
 
-static std::vector<IRCode *> codes;
-
-void resetCodesArray() {
-    for (auto code : codes) { delete code; }
-    codes.clear();
-}
-
 static std::vector<IRCode *> recent_ircodes;
 
 void addToRecentCodes(IRCode *ircode) {
@@ -69,18 +63,21 @@ void selectRecentIrMenu() {
     return;
 }
 
-bool txIrFile(FS *fs, String filepath) {
-    // SPAM all codes of the file
+// Sends the signal last read from `db`, raw timings are used straight from its buffer
+static void sendFileCode(IRCode *code, IrFileReader &db) {
+    if (code->type.equalsIgnoreCase("raw")) sendRawTimings(code->frequency, db.rawTimings(), db.rawCount());
+    else sendIRCommand(code);
+}
 
-    int total_codes = 0;
-    String line;
+bool txIrFile(FS *fs, String filepath, bool useCache) {
+    // SPAM all codes of the file
 
-    File databaseFile = fs->open(filepath, FILE_READ);
+    IrFileReader db;
 
     pinMode(bruceConfig.irTx, OUTPUT);
     // digitalWrite(bruceConfig.irTx, LED_ON);
 
-    if (!databaseFile) {
+    if (!db.open(*fs, filepath, useCache)) {
         Serial.println("Failed to open database file.");
         displayError("Fail to open file");
         delay(2000);
@@ -90,105 +87,16 @@ bool txIrFile(FS *fs, String filepath) {
 
     bool endingEarly = false;
     int codes_sent = 0;
-    uint16_t frequency = 0;
-    String rawData = "";
-    String protocol = "";
-    String address = "";
-    String command = "";
-    String value = "";
-    uint8_t bits = 32;
-
-    databaseFile.seek(0); // comes back to first position
-
-    // count the number of codes to replay
-    while (databaseFile.available()) {
-        line = databaseFile.readStringUntil('\n');
-        if (line.startsWith("type:")) total_codes++;
-    }
+    int total_codes = db.count();
+    IRCode code;
 
     Serial.printf("\nStarted SPAM all codes with: %d codes", total_codes);
-    // comes back to first position, beggining of the file
-    databaseFile.seek(0);
-    while (databaseFile.available()) {
+    while (db.next(code)) {
         progressHandler(codes_sent, total_codes);
-        line = databaseFile.readStringUntil('\n');
-        if (line.endsWith("\r")) line.remove(line.length() - 1);
-
-        if (line.startsWith("type:")) {
-            codes_sent++;
-            String type = line.substring(5);
-            type.trim();
-            Serial.println("Type: " + type);
-            if (type == "raw") {
-                Serial.println("RAW code");
-                while (databaseFile.available()) {
-                    line = databaseFile.readStringUntil('\n');
-                    if (line.endsWith("\r")) line.remove(line.length() - 1);
-
-                    if (line.startsWith("frequency:")) {
-                        line = line.substring(10);
-                        line.trim();
-                        frequency = line.toInt();
-                        Serial.printf("Frequency: %d\n", frequency);
-                    } else if (line.startsWith("data:")) {
-                        rawData = line.substring(5);
-                        rawData.trim();
-                        Serial.println("RawData: " + rawData);
-                    } else if ((frequency != 0 && rawData != "") || line.startsWith("#")) {
-                        IRCode code;
-                        code.type = "raw";
-                        code.data = rawData;
-                        code.frequency = frequency;
-                        sendIRCommand(&code);
-
-                        rawData = "";
-                        frequency = 0;
-                        type = "";
-                        line = "";
-                        break;
-                    }
-                }
-            } else if (type == "parsed") {
-                Serial.println("PARSED");
-                while (databaseFile.available()) {
-                    line = databaseFile.readStringUntil('\n');
-                    if (line.endsWith("\r")) line.remove(line.length() - 1);
-
-                    if (line.startsWith("protocol:")) {
-                        protocol = line.substring(9);
-                        protocol.trim();
-                        Serial.println("Protocol: " + protocol);
-                    } else if (line.startsWith("address:")) {
-                        address = line.substring(8);
-                        address.trim();
-                        Serial.println("Address: " + address);
-                    } else if (line.startsWith("command:")) {
-                        command = line.substring(8);
-                        command.trim();
-                        Serial.println("Command: " + command);
-                    } else if (line.startsWith("value:") || line.startsWith("state:")) {
-                        value = line.substring(6);
-                        value.trim();
-                        Serial.println("Value: " + value);
-                    } else if (line.startsWith("bits:")) {
-                        bits = line.substring(strlen("bits:")).toInt();
-                        Serial.println("bits: " + bits);
-                    } else if (line.indexOf("#") != -1) { // TODO: also detect EOF
-                        IRCode code(protocol, address, command, value, bits);
-                        sendIRCommand(&code);
-
-                        protocol = "";
-                        address = "";
-                        command = "";
-                        value = "";
-                        bits = 32;
-                        type = "";
-                        line = "";
-                        break;
-                    }
-                }
-            }
-        }
+        codes_sent++;
+        Serial.println("Name: " + code.name + " Type: " + code.type);
+        sendFileCode(&code, db);
+
         // if user is pushing (holding down) TRIGGER button, stop transmission early
         if (check(SelPress)) // Pause TV-B-Gone
         {
@@ -205,22 +113,18 @@ bool txIrFile(FS *fs, String filepath) {
             if (endingEarly) break; // Cancels  custom IR Spam
             displayTextLine("Running, Wait");
         }
-    } // end while file has lines to process
-    databaseFile.close();
+    } // end while file has codes to process
+    db.close();
     Serial.println("closed");
     Serial.println("EXTRA finished");
 
-    resetCodesArray();
     digitalWrite(bruceConfig.irTx, LED_OFF);
     return true;
 }
 
 void otherIRcodes() {
     checkIrTxPin();
-    resetCodesArray();
-    int total_codes = 0;
     String filepath;
-    File databaseFile;
     FS *fs = NULL;
 
     returnToMenu = true; // make sure menu is redrawn when quitting in any point
@@ -265,10 +169,10 @@ void otherIRcodes() {
 
     // else continue and try to parse the file
 
-    databaseFile = fs->open(filepath, FILE_READ);
+    IrFileReader db;
     drawMainBorder();
 
-    if (!databaseFile) {
+    if (!db.open(*fs, filepath)) {
         Serial.println("Failed to open database file.");
         // displayError("Fail to open file");
         // delay(2000);
@@ -276,71 +180,66 @@ void otherIRcodes() {
     }
     Serial.println("Opened database file.");
 
-    pinMode(bruceConfig.irTx, OUTPUT);
-    // digitalWrite(bruceConfig.irTx, LED_ON);
-
-    // Mode to choose and send command by command limitted to 100 commands
-    String line;
-    String txt;
-    codes.push_back(new IRCode());
-    while (databaseFile.available() && total_codes < 100) {
-        line = databaseFile.readStringUntil('\n');
-        txt = line.substring(line.indexOf(":") + 1);
-        txt.trim();
-        if (line.startsWith("name:")) {
-            // in case that the separation between codes are not made by "#" line
-            if (codes[total_codes]->name != "") {
-                total_codes++;
-                codes.push_back(new IRCode());
-            }
-            // save signal name
-            codes[total_codes]->name = txt;
-            codes[total_codes]->filepath = txt + " " + filepath.substring(1 + filepath.lastIndexOf("/"));
-        }
-        if (line.startsWith("type:")) codes[total_codes]->type = txt;
-        if (line.startsWith("protocol:")) codes[total_codes]->protocol = txt;
-        if (line.startsWith("address:")) codes[total_codes]->address = txt;
-        if (line.startsWith("frequency:")) codes[total_codes]->frequency = txt.toInt();
-        if (line.startsWith("bits:")) codes[total_codes]->bits = txt.toInt();
-        if (line.startsWith("command:")) codes[total_codes]->command = txt;
-        if (line.startsWith("data:") || line.startsWith("value:") || line.startsWith("state:")) {
-            codes[total_codes]->data = txt;
-        }
-        // if there are a line with "#", and the code name isnt't "" (there are a signal saved), go to next
-        // signal
-        if (line.startsWith("#") && total_codes < codes.size() && codes[total_codes]->name != "") {
-            total_codes++;
-            codes.push_back(new IRCode());
-        }
-        // if(line.startsWith("duty_cycle:")) codes[total_codes]->duty_cycle = txt.toFloat();
-    }
-    options = {};
-    for (auto code : codes) {
-        if (code->name != "") {
-            options.push_back({code->name.c_str(), [code]() {
-                                   sendIRCommand(code);
-                                   addToRecentCodes(code);
-                               }});
-        }
+    // Index only pass: keeps the offset of each named signal, that is decoded when selected
+    std::vector<uint32_t> signals;
+    signals.reserve(db.count());
+    IRCode ircode;
+    while (true) {
+        uint32_t pos = db.position();
+        if (!db.next(ircode, false)) break;
+        if (ircode.name != "") signals.push_back(pos);
     }
-    options.push_back({"Main Menu", [&]() { exit = true; }});
-    databaseFile.close();
-
-
-    
-  
-  #ifdef USE_BQ25896  ///DISABLE 5V OUTPUT
-  PPM.disableOTG();
-  #endif
+    Serial.printf("Indexed %u signals\n", (unsigned)signals.size());
 
+    pinMode(bruceConfig.irTx, OUTPUT);
+    // digitalWrite(bruceConfig.irTx, LED_ON);
 
+#ifdef USE_BQ25896 /// DISABLE 5V OUTPUT
+    PPM.disableOTG();
+#endif
     digitalWrite(bruceConfig.irTx, LED_OFF);
+
+    // The menu shows a page of signals at a time, so its size doesn't depend on the file
+    size_t page = 0;
+    int selected = -1;
     int idx = 0;
+    bool changePage = true;
     while (1) {
+        if (changePage) {
+            options = {};
+            if (page > 0) options.push_back({"<< Prev page", [&]() { page--; }});
+            size_t last = min(signals.size(), (page + 1) * IR_MENU_PAGE);
+            for (size_t i = page * IR_MENU_PAGE; i < last; i++) {
+                db.seek(signals[i]);
+                db.next(ircode, false);
+                options.push_back({ircode.name, [&selected, i]() { selected = i; }});
+            }
+            if (last < signals.size()) options.push_back({"Next page >>", [&]() { page++; }});
+            options.push_back({"Main Menu", [&]() { exit = true; }});
+            changePage = false;
+        }
+
+        size_t shownPage = page;
         idx = loopOptions(options, idx);
         if (check(EscPress) || exit) break;
+        if (page != shownPage) {
+            changePage = true;
+            idx = 0;
+        } else if (selected >= 0 && db.seek(signals[selected]) && db.next(ircode)) {
+            if (ircode.type.equalsIgnoreCase("raw")) {
+                sendRawTimings(ircode.frequency, db.rawTimings(), db.rawCount());
+                // recent codes outlive the file, keep a text copy of the timings
+                ircode.data = irRawTimingsToString(db.rawTimings(), db.rawCount());
+            } else {
+                sendIRCommand(&ircode);
+            }
+            ircode.filepath = ircode.name + " " + filepath.substring(1 + filepath.lastIndexOf("/"));
+            addToRecentCodes(&ircode);
+        }
+        selected = -1;
     }
     options.clear();
+    db.close();
 } // end of otherIRcodes
 
 // IR commands
@@ -637,7 +536,20 @@ bool sendDecodedCommand(String protocol, String value, uint8_t bits) {
     return success;
 }
 
-void sendRawCommand(uint16_t frequency, String rawData) {
+void sendRawCommand(uint16_t frequency, const String &rawData) {
+    // each value takes at least one digit and one separator
+    size_t cap = rawData.length() / 2 + 1;
+    uint16_t *dataBuffer = irRawBuffer(cap);
+    if (!dataBuffer) {
+        Serial.println("Not enough memory to send the raw command");
+        return;
+    }
+    uint16_t count = parseIrRawTimings(rawData.c_str(), dataBuffer, min(cap, (size_t)UINT16_MAX));
+    Serial.println("Parsing raw data complete.");
+    sendRawTimings(frequency, dataBuffer, count);
+}
+
+void sendRawTimings(uint16_t frequency, const uint16_t *timings, uint16_t count) {
  #ifdef USE_BQ25896  ///ENABLE 5V OUTPUT
   PPM.enableOTG();
   #endif
@@ -646,38 +558,13 @@ void sendRawCommand(uint16_t frequency, String rawData) {
     irsend.begin();
     displayTextLine("Sending..");
 
-    uint16_t dataBufferSize = 1;
-    for (int i = 0; i < rawData.length(); i++) {
-        if (rawData[i] == ' ') dataBufferSize += 1;
-    }
-    uint16_t *dataBuffer = (uint16_t *)malloc((dataBufferSize) * sizeof(uint16_t));
-
-    uint16_t count = 0;
-    // Parse raw data string
-    while (rawData.length() > 0 && count < dataBufferSize) {
-        int delimiterIndex = rawData.indexOf(' ');
-        if (delimiterIndex == -1) { delimiterIndex = rawData.length(); }
-        String dataChunk = rawData.substring(0, delimiterIndex);
-        rawData.remove(0, delimiterIndex + 1);
-        dataBuffer[count++] = (dataChunk.toInt());
-    }
-
-    Serial.println("Parsing raw data complete.");
-    // Serial.println(count);
-    // Serial.println(dataBuffer[count-1]);
-    // Serial.println(dataBuffer[0]);
-
     // Send raw command
-    irsend.sendRaw(dataBuffer, count, frequency);
+    irsend.sendRaw(timings, count, frequency);
 
     if (bruceConfig.irTxRepeats > 0) {
-        for (uint8_t i = 1; i <= bruceConfig.irTxRepeats; i++) {
-            irsend.sendRaw(dataBuffer, count, frequency);
-        }
+        for (uint8_t i = 1; i <= bruceConfig.irTxRepeats; i++) { irsend.sendRaw(timings, count, frequency); }
     }
 
-    free(dataBuffer);
-
     Serial.println(
         "Sent Raw Command" +
         (bruceConfig.irTxRepeats > 0 ? " (1 initial + " + String(bruceConfig.irTxRepeats) + " repeats)" : "")
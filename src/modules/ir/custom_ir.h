@@ -6,6 +6,8 @@
 #include <SD.h>
 #include <globals.h>
 
+#define IR_MENU_PAGE 50 // signals listed at once by the "Choose cmd" menu
+
 struct IRCode {
     IRCode(
         String protocol = "", String address = "", String command = "", String data = "", uint8_t bits = 32
@@ -39,7 +41,8 @@ struct IRCode {
 
 // Custom IR
 void sendIRCommand(IRCode *code);
-void sendRawCommand(uint16_t frequency, String rawData);
+void sendRawCommand(uint16_t frequency, const String &rawData);
+void sendRawTimings(uint16_t frequency, const uint16_t *timings, uint16_t count);
 void sendNECCommand(String address, String command);
 void sendNECextCommand(String address, String command);
 void sendRC5Command(String address, String command);
@@ -49,4 +52,4 @@ void sendSonyCommand(String address, String command, uint8_t nbits);
 void sendKaseikyoCommand(String address, String command);
 bool sendDecodedCommand(String protocol, String value, uint8_t bits = 32);
 void otherIRcodes();
-bool txIrFile(FS *fs, String filepath);
+bool txIrFile(FS *fs, String filepath, bool useCache = true);
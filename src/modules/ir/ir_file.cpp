@@ -0,0 +1,289 @@
+#include "ir_file.h"
+
+// .irc layout (little endian):
+//   header: "IRC", version, source size, source mtime, count of signals
+//   raw signal:    IRC_RAW, name, frequency (u16), count (u16), timings (u16 * count)
+//   parsed signal: IRC_PARSED, name, type, protocol, address, command, data, bits (u8)
+// Strings are stored as a length byte followed by the chars.
+struct __attribute__((packed)) IrcHeader {
+    char magic[3];
+    uint8_t version;
+    uint32_t srcSize;
+    uint32_t srcTime;
+    uint32_t count;
+};
+
+enum : uint8_t { IRC_PARSED = 0, IRC_RAW = 1 };
+
+static uint16_t *rawBuffer = nullptr;
+static size_t rawBufferCap = 0;
+
+uint16_t *irRawBuffer(size_t count) {
+    if (count <= rawBufferCap) return rawBuffer;
+    size_t cap = rawBufferCap ? rawBufferCap : 256;
+    while (cap < count) cap *= 2;
+    size_t bytes = cap * sizeof(uint16_t);
+    uint16_t *buf = (uint16_t *)(psramFound() ? ps_realloc(rawBuffer, bytes) : realloc(rawBuffer, bytes));
+    if (!buf) return nullptr;
+    rawBuffer = buf;
+    rawBufferCap = cap;
+    return buf;
+}
+
+size_t parseIrRawTimings(const char *text, uint16_t *out, size_t cap) {
+    size_t n = 0;
+    char *end;
+    while (n < cap) {
+        long value = strtol(text, &end, 10);
+        if (end == text) { // not a number, skip the char
+            if (*text == '\0') break;
+            text++;
+            continue;
+        }
+        text = end;
+        if (value < 0) value = -value;
+        out[n++] = value > UINT16_MAX ? UINT16_MAX : value;
+    }
+    return n;
+}
+
+String irRawTimingsToString(const uint16_t *timings, size_t count) {
+    String txt;
+    txt.reserve(count * 5);
+    char num[8];
+    for (size_t i = 0; i < count; i++) {
+        snprintf(num, sizeof(num), i ? " %u" : "%u", timings[i]);
+        txt += num;
+    }
+    return txt;
+}
+
+static bool writeString(File &f, const String &s) {
+    if (s.length() > 255) return false;
+    uint8_t len = s.length();
+    return f.write(&len, 1) == 1 && f.write((const uint8_t *)s.c_str(), len) == len;
+}
+
+static bool readString(File &f, String &s) {
+    uint8_t len;
+    char buf[256];
+    if (f.read(&len, 1) != 1 || f.read((uint8_t *)buf, len) != len) return false;
+    buf[len] = '\0';
+    s = buf;
+    return true;
+}
+
+// Parses the text file once and writes the binary form of all its signals to `dst`
+static bool compileIrFile(FS &fs, const String &src, const String &dst, size_t srcSize, uint32_t srcTime) {
+    IrFileReader reader;
+    if (!reader.open(fs, src, false)) return false;
+    File out = fs.open(dst, FILE_WRITE);
+    if (!out) return false;
+
+    unsigned long start = millis();
+    // the header is only marked as valid after everything was written
+    IrcHeader header = {{'I', 'R', 'C'}, 0, (uint32_t)srcSize, srcTime, 0};
+    bool ok = out.write((const uint8_t *)&header, sizeof(header)) == sizeof(header);
+    IRCode code;
+    while (ok && reader.next(code)) {
+        if (code.type.equalsIgnoreCase("raw")) {
+            uint8_t kind = IRC_RAW;
+            uint16_t info[2] = {code.frequency, (uint16_t)min(reader.rawCount(), (size_t)UINT16_MAX)};
+            size_t bytes = info[1] * sizeof(uint16_t);
+            ok = out.write(&kind, 1) == 1 && writeString(out, code.name) &&
+                 out.write((const uint8_t *)info, sizeof(info)) == sizeof(info) &&
+                 out.write((const uint8_t *)reader.rawTimings(), bytes) == bytes;
+        } else {
+            uint8_t kind = IRC_PARSED;
+            ok = out.write(&kind, 1) == 1 && writeString(out, code.name) && writeString(out, code.type) &&
+                 writeString(out, code.protocol) && writeString(out, code.address) &&
+                 writeString(out, code.command) && writeString(out, code.data) &&
+                 out.write(&code.bits, 1) == 1;
+        }
+        header.count++;
+    }
+    if (ok) {
+        header.version = IRC_VERSION;
+        ok = out.seek(0) && out.write((const uint8_t *)&header, sizeof(header)) == sizeof(header);
+    }
+    out.close();
+    if (!ok) {
+        Serial.println("IR: could not compile " + src);
+        fs.remove(dst);
+        return false;
+    }
+    Serial.printf("IR: compiled %u signals of %s in %lums\n", header.count, src.c_str(), millis() - start);
+    return true;
+}
+
+bool IrFileReader::open(FS &fs, const String &path, bool useCache) {
+    close();
+    _file = fs.open(path, FILE_READ);
+    if (!_file) return false;
+
+    size_t size = _file.size();
+    if (!useCache || size < IRC_MIN_SOURCE_SIZE) return true;
+
+    uint32_t mtime = _file.getLastWrite();
+    String irc = path.endsWith(".ir") ? path + "c" : path + ".irc";
+    if (openCompiled(fs, irc, size, mtime)) return true;
+    // missing or stale, build it from the text
+    if (compileIrFile(fs, path, irc, size, mtime) && openCompiled(fs, irc, size, mtime)) return true;
+    return true; // keep reading the text
+}
+
+bool IrFileReader::openCompiled(FS &fs, const String &path, size_t srcSize, uint32_t srcTime) {
+    if (!fs.exists(path)) return false;
+    File f = fs.open(path, FILE_READ);
+    if (!f) return false;
+    IrcHeader header;
+    if (f.read((uint8_t *)&header, sizeof(header)) != sizeof(header) || memcmp(header.magic, "IRC", 3) ||
+        header.version != IRC_VERSION || header.srcSize != srcSize || header.srcTime != srcTime) {
+        f.close();
+        return false;
+    }
+    _file = f;
+    _compiled = true;
+    _count = header.count;
+    return true;
+}
+
+void IrFileReader::close() {
+    if (_file) _file.close();
+    _text.seek(0);
+    _compiled = false;
+    _count = UINT32_MAX;
+    _pending = false;
+    _pendingName = "";
+    _rawCount = 0;
+}
+
+uint32_t IrFileReader::count() {
+    if (_count != UINT32_MAX) return _count;
+    if (!_file) return 0;
+    // text files: a quick scan of the "name:" keys
+    size_t pos = _text.position();
+    char key[16];
+    _count = 0;
+    _text.seek(0);
+    while (_text.nextKey(key, sizeof(key))) {
+        if (strcmp(key, "name") == 0) _count++;
+        _text.skipLine();
+    }
+    _text.seek(pos);
+    return _count;
+}
+
+uint32_t IrFileReader::position() {
+    if (_compiled) return _file.position();
+    return _pending ? _pendingPos : _text.position();
+}
+
+bool IrFileReader::seek(uint32_t pos) {
+    _pending = false;
+    if (_compiled) return _file.seek(pos);
+    return _text.seek(pos);
+}
+
+bool IrFileReader::next(IRCode &code, bool withData) {
+    code = IRCode();
+    _rawCount = 0;
+    if (!_file) return false;
+    return _compiled ? nextCompiled(code, withData) : nextText(code, withData);
+}
+
+bool IrFileReader::nextCompiled(IRCode &code, bool withData) {
+    uint8_t kind;
+    if (_file.read(&kind, 1) != 1 || !readString(_file, code.name)) return false;
+    if (kind == IRC_RAW) {
+        uint16_t info[2];
+        if (_file.read((uint8_t *)info, sizeof(info)) != sizeof(info)) return false;
+        code.type = "raw";
+        code.frequency = info[0];
+        size_t bytes = info[1] * sizeof(uint16_t);
+        if (!withData) return _file.seek(_file.position() + bytes);
+        _raw = irRawBuffer(info[1]);
+        if (bytes && (!_raw || _file.read((uint8_t *)_raw, bytes) != bytes)) return false;
+        _rawCount = info[1];
+    } else if (!readString(_file, code.type) || !readString(_file, code.protocol) ||
+               !readString(_file, code.address) || !readString(_file, code.command) ||
+               !readString(_file, code.data) || _file.read(&code.bits, 1) != 1) {
+        return false;
+    }
+    return true;
+}
+
+// False when the timings don't fit in memory, the signal is then left without any
+bool IrFileReader::readRawTimings() {
+    int chunk[IR_TIMINGS_CHUNK];
+    bool lineDone = false;
+    while (!lineDone) {
+        size_t n = _text.readTimings(chunk, IR_TIMINGS_CHUNK, lineDone);
+        uint16_t *buf = irRawBuffer(_rawCount + n);
+        if (!buf) {
+            if (!lineDone) _text.skipLine();
+            _raw = nullptr;
+            _rawCount = 0;
+            return false;
+        }
+        for (size_t i = 0; i < n; i++) buf[_rawCount++] = abs(chunk[i]);
+        _raw = buf;
+    }
+    return true;
+}
+
+bool IrFileReader::nextText(IRCode &code, bool withData) {
+    // a new signal starts at each "name:", or at the first key of a signal without name
+    bool found = _pending, named = _pending;
+    if (_pending) code.name = _pendingName;
+    _pending = false;
+
+    char key[16];
+    char value[16];
+    size_t keyPos = _text.position();
+    while (_text.nextKey(key, sizeof(key))) {
+        if (strcmp(key, "name") == 0) {
+            String name;
+            _text.readValue(name);
+            if (named) {
+                _pending = true;
+                _pendingName = name;
+                _pendingPos = keyPos;
+                break;
+            }
+            code.name = name;
+            named = found = true;
+            continue;
+        }
+        bool known = true;
+        if (strcmp(key, "type") == 0) _text.readValue(code.type);
+        else if (!withData) _text.skipLine();
+        else if (strcmp(key, "protocol") == 0) _text.readValue(code.protocol);
+        else if (strcmp(key, "address") == 0) _text.readValue(code.address);
+        else if (strcmp(key, "command") == 0) _text.readValue(code.command);
+        else if (strcmp(key, "value") == 0 || strcmp(key, "state") == 0) _text.readValue(code.data);
+        else if (strcmp(key, "data") == 0 && code.type.equalsIgnoreCase("raw")) {
+            if (!readRawTimings()) Serial.println("IR: not enough memory for the timings of " + code.name);
+        } else if (strcmp(key, "data") == 0) _text.readValue(code.data);
+        else if (strcmp(key, "frequency") == 0) {
+            _text.readValue(value, sizeof(value));
+            code.frequency = atoi(value);
+        } else if (strcmp(key, "bits") == 0) {
+            _text.readValue(value, sizeof(value));
+            code.bits = atoi(value);
+        } else {
+            known = false; // e.g. file header or duty_cycle, doesn't start a signal
+            _text.skipLine();
+        }
+        if (known) found = true;
+        keyPos = _text.position();
+    }
+    // raw data that came before its type
+    if (code.type.equalsIgnoreCase("raw") && _rawCount == 0 && code.data != "") {
+        size_t cap = code.data.length() / 2 + 1;
+        _raw = irRawBuffer(cap);
+        if (_raw) _rawCount = parseIrRawTimings(code.data.c_str(), _raw, cap);
+        code.data = "";
+    }
+    return found;
+}
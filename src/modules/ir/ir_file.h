@@ -0,0 +1,65 @@
+#ifndef __IR_FILE_H__
+#define __IR_FILE_H__
+
+#include "custom_ir.h"
+#include "modules/rf/sub_reader.h"
+#include <FS.h>
+
+#define IRC_VERSION 1
+#define IRC_MIN_SOURCE_SIZE 4096 // smaller files are parsed straight from the text
+#define IR_TIMINGS_CHUNK 64      // raw timings parsed from the text at once
+
+// Grows (never shrinks) the buffer shared by all raw IR transmissions, keeping its contents
+uint16_t *irRawBuffer(size_t count);
+// One pass parser of a space separated list of timings. Returns the number of values stored in `out`
+size_t parseIrRawTimings(const char *text, uint16_t *out, size_t cap);
+// Text form of raw timings, as saved in the "data:" field
+String irRawTimingsToString(const uint16_t *timings, size_t count);
+
+/**
+ * @brief Sequential reader of the signals of a Flipper .ir file
+ *
+ * Files bigger than IRC_MIN_SOURCE_SIZE are compiled once into a binary sidecar (tv.ir -> tv.irc),
+ * that is rebuilt whenever the size or the modification time of the source change.
+ * Raw timings are never kept as text, next() leaves them in the shared irRawBuffer().
+ */
+class IrFileReader {
+public:
+    IrFileReader() : _text(_file) {}
+    ~IrFileReader() { close(); }
+
+    // Opens `path`. With useCache, the compiled sidecar is used (and built if needed) when possible
+    bool open(FS &fs, const String &path, bool useCache = true);
+    void close();
+    bool compiled() const { return _compiled; }
+
+    // Number of signals of the file
+    uint32_t count();
+    // Reads the next signal. Returns false at the end of the file.
+    // Without data, only the name and the type are decoded (for indexing)
+    bool next(IRCode &code, bool withData = true);
+    // Offset of the next signal, that can be read again later with seek()
+    uint32_t position();
+    bool seek(uint32_t pos);
+    // Timings of the last raw signal read
+    const uint16_t *rawTimings() const { return _raw; }
+    size_t rawCount() const { return _rawCount; }
+
+private:
+    bool openCompiled(FS &fs, const String &path, size_t srcSize, uint32_t srcTime);
+    bool nextText(IRCode &code, bool withData);
+    bool nextCompiled(IRCode &code, bool withData);
+    bool readRawTimings();
+
+    File _file;
+    SubReader _text;
+    bool _compiled = false;
+    uint32_t _count = UINT32_MAX; // not counted yet
+    bool _pending = false;        // text files: a "name:" that starts the next signal was already read
+    String _pendingName;
+    uint32_t _pendingPos = 0;
+    uint16_t *_raw = nullptr;
+    size_t _rawCount = 0;
+};
+
+#endif
@@ -97,8 +97,10 @@ void brucegotchi_start() {
 
     tft.fillScreen(bruceConfig.bgColor);
     num_HS = 0; // restart pwnagotchi counting
+    stopHandshakeWriter();
     SavedHS.clear();
     registeredBeacons.clear(); // Clear the registeredBeacon array in case it has something
+    startHandshakeWriter();
     delay(300);                // Due to select button pressed to enter / quit this feature*
 
     brucegotchi_setup(); // Starts the thing
@@ -135,7 +137,8 @@ void brucegotchi_start() {
             if (registeredBeacons.size() > 40)
                 registeredBeacons.clear(); // Clear registered beacons to restart search and avoir restarts
             Serial.println("<<---- Starting Deauthentication Process ---->>");
-            for (auto registeredBeacon : registeredBeacons) {
+            for (uint64_t beaconKey : registeredBeacons) {
+                BeaconList registeredBeacon = BeaconList::fromKey(beaconKey);
                 char _MAC[20];
                 sprintf(
                     _MAC,
@@ -201,5 +204,6 @@ void brucegotchi_start() {
     // Turn off WiFi
     esp_wifi_set_promiscuous(false);
     esp_wifi_set_promiscuous_rx_cb(nullptr);
+    stopHandshakeWriter();
     wifiDisconnect();
 }
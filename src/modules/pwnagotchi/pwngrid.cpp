@@ -13,69 +13,118 @@ Thanks to @bmorcelli (Pirata) for his help doing a better code.
 #include "../wifi/sniffer.h"
 
 uint8_t pwngrid_friends_tot = 0;
-std::vector<pwngrid_peer> pwngrid_peers;
 String pwngrid_last_friend_name = "";
 
+// Peers live in an open addressing table indexed by the hash of their identity (linear probing).
+// The worker task writes it and the UI reads it, both under pwngrid_lock
+pwngrid_peer *pwngrid_table = NULL;
+SemaphoreHandle_t pwngrid_lock = NULL;
+
+// Advertisement copied out of the promiscuous callback, parsed later by the worker task
+typedef struct {
+    signed int rssi;
+    uint16_t len;
+    char json[PWNGRID_MAX_JSON];
+} pwngrid_advert;
+
+QueueHandle_t pwngrid_queue = NULL;
+TaskHandle_t pwngrid_task = NULL;
+
 uint8_t getPwngridTotalPeers() { return pwngrid_friends_tot; }
 uint8_t getPwngridRunTotalPeers() { return pwngrid_friends_tot; }
-String getPwngridLastFriendName() { return pwngrid_last_friend_name; }
-std::vector<pwngrid_peer> getPwngridPeers() { return pwngrid_peers; }
+String getPwngridLastFriendName() {
+    if (!pwngrid_lock) return pwngrid_last_friend_name;
+    xSemaphoreTake(pwngrid_lock, portMAX_DELAY);
+    String name = pwngrid_last_friend_name;
+    xSemaphoreGive(pwngrid_lock);
+    return name;
+}
+std::vector<pwngrid_peer> getPwngridPeers() {
+    std::vector<pwngrid_peer> peers;
+    if (!pwngrid_table) return peers;
+    xSemaphoreTake(pwngrid_lock, portMAX_DELAY);
+    for (int i = 0; i < PWNGRID_MAX_PEERS; i++) {
+        if (pwngrid_table[i].hash) peers.push_back(pwngrid_table[i]);
+    }
+    xSemaphoreGive(pwngrid_lock);
+    return peers;
+}
+
+// FNV-1a, never 0 since 0 marks the empty slots
+uint32_t peer_hash(const char *identity) {
+    uint32_t h = 2166136261u;
+    while (*identity) h = (h ^ (uint8_t)*identity++) * 16777619u;
+    return h ? h : 1;
+}
+
+// Slot of the peer, or of the empty slot where it would go
+int find_peer_slot(const char *identity, uint32_t hash) {
+    int i = hash & (PWNGRID_MAX_PEERS - 1);
+    while (pwngrid_table[i].hash &&
+           (pwngrid_table[i].hash != hash || strcmp(pwngrid_table[i].identity, identity) != 0))
+        i = (i + 1) & (PWNGRID_MAX_PEERS - 1);
+    return i;
+}
+
+void copy_field(char *dst, size_t size, JsonVariant value) {
+    const char *src = value.as<const char *>();
+    strncpy(dst, src ? src : "", size - 1);
+    dst[size - 1] = '\0';
+}
 
 // Add pwngrid peers
 void add_new_peer(JsonDocument &json, signed int rssi) {
-    // Check if it exists in the list
-    bool exists = false;
-    for (auto peer_list : pwngrid_peers) {
-        if (peer_list.identity == json["identity"].as<String>()) {
-            exists = true;
-            peer_list.last_ping = millis();
-            peer_list.gone = false;
-            peer_list.rssi = rssi;
-            return;
-        }
-    }
-    // Check if doesn't exists AND there are room in RAM memory to save
-    if (!exists && pwngrid_peers.size() < 50) {
-        pwngrid_peers.push_back((pwngrid_peer){
-            json["epoch"].as<int>(),
-            json["face"].as<String>(),
-            json["grid_version"].as<String>(),
-            json["identity"].as<String>(),
-            json["name"].as<String>(),
-            json["pwnd_run"].as<int>(),
-            json["pwnd_tot"].as<int>(),
-            json["session_id"].as<String>(),
-            json["timestamp"].as<int>(),
-            json["uptime"].as<int>(),
-            json["version"].as<String>(),
-            rssi,
-            millis(),
-            false,
-        }); // Add the local object into the vector
+    const char *identity = json["identity"].as<const char *>();
+    if (!identity || !pwngrid_table) return;
+    uint32_t hash = peer_hash(identity);
+
+    xSemaphoreTake(pwngrid_lock, portMAX_DELAY);
+    pwngrid_peer &peer = pwngrid_table[find_peer_slot(identity, hash)];
+    if (peer.hash) { // Already known, just refresh it
+        peer.last_ping = millis();
+        peer.gone = false;
+        peer.rssi = rssi;
+    } else if (pwngrid_friends_tot < PWNGRID_MAX_PEERS * 3 / 4) { // keep the probe sequences short
+        peer.hash = hash;
+        peer.epoch = json["epoch"].as<int>();
+        copy_field(peer.face, sizeof(peer.face), json["face"]);
+        copy_field(peer.grid_version, sizeof(peer.grid_version), json["grid_version"]);
+        copy_field(peer.identity, sizeof(peer.identity), json["identity"]);
+        copy_field(peer.name, sizeof(peer.name), json["name"]);
+        peer.pwnd_run = json["pwnd_run"].as<int>();
+        peer.pwnd_tot = json["pwnd_tot"].as<int>();
+        copy_field(peer.session_id, sizeof(peer.session_id), json["session_id"]);
+        peer.timestamp = json["timestamp"].as<int>();
+        peer.uptime = json["uptime"].as<int>();
+        copy_field(peer.version, sizeof(peer.version), json["version"]);
+        peer.rssi = rssi;
+        peer.last_ping = millis();
+        peer.gone = false;
         // Update last friend and increment counter
-        pwngrid_last_friend_name = json["name"].as<String>();
-        pwngrid_friends_tot = pwngrid_peers.size();
+        pwngrid_last_friend_name = peer.name;
+        pwngrid_friends_tot++;
     }
+    xSemaphoreGive(pwngrid_lock);
 }
 
-// Delete pwngrid peers
-void delete_peer_gone() { // Delete peers wigh pwngrid_peers.gone = true
-    std::vector<int>
-        peer_gone; // Create a vector of integers to save the index value of the element to be deleted
-    int index = 0;
-    for (const auto &peer_list : pwngrid_peers) {
-        if (peer_list.gone) peer_gone.push_back(index); // Saves the index value into the vector
-        index++;
-    }
-    std::reverse(
-        peer_gone.begin(), peer_gone.end()
-    ); // Reverse the vector to iterate from the end to the beginning
-    for (auto ind : peer_gone) {
-        pwngrid_peers.erase(pwngrid_peers.begin() + ind); // Delete the peer from the list
-        // Update counter;
-        pwngrid_friends_tot = pwngrid_peers.size();
+// Delete a peer, moving back the peers of its probe sequence so that they can still be found
+void delete_peer(int i) {
+    const int mask = PWNGRID_MAX_PEERS - 1;
+    int j = i;
+    while (true) {
+        pwngrid_table[i].hash = 0;
+        int home;
+        do {
+            j = (j + 1) & mask;
+            if (!pwngrid_table[j].hash) {
+                pwngrid_friends_tot--;
+                return;
+            }
+            home = pwngrid_table[j].hash & mask;
+        } while (i <= j ? (i < home && home <= j) : (i < home || home <= j));
+        pwngrid_table[i] = pwngrid_table[j];
+        i = j;
     }
-    peer_gone.clear();
 }
 
 // Had to remove Radiotap headers, since its automatically added
@@ -157,27 +206,30 @@ esp_err_t pwngridAdvertise(uint8_t channel, String face) {
     return result;
 }
 
-const int away_threshold = 120000;
+const unsigned long away_threshold = 120000;
 
 void checkPwngridGoneFriends() {
-    for (auto peer_list : pwngrid_peers) {
-        // Check if peer is away
-        int away_secs = peer_list.last_ping - millis();
-        if (away_secs > away_threshold) {
-            peer_list.gone = true;
-            delete_peer_gone();
-            return;
-        }
+    if (!pwngrid_table) return;
+    xSemaphoreTake(pwngrid_lock, portMAX_DELAY);
+    for (int i = 0; i < PWNGRID_MAX_PEERS;) {
+        pwngrid_peer &peer = pwngrid_table[i];
+        // Check if peer is away. A deleted slot may receive another peer, so it is checked again
+        if (peer.hash && millis() - peer.last_ping > away_threshold) delete_peer(i);
+        else i++;
     }
+    xSemaphoreGive(pwngrid_lock);
 }
 
 signed int getPwngridClosestRssi() {
     signed int closest = -1000;
+    if (!pwngrid_table) return closest;
 
-    for (auto peer_list : pwngrid_peers) {
-        // Check if peer is away
-        if (peer_list.gone == false && peer_list.rssi > closest) { closest = peer_list.rssi; }
+    xSemaphoreTake(pwngrid_lock, portMAX_DELAY);
+    for (int i = 0; i < PWNGRID_MAX_PEERS; i++) {
+        const pwngrid_peer &peer = pwngrid_table[i];
+        if (peer.hash && !peer.gone && peer.rssi > closest) closest = peer.rssi;
     }
+    xSemaphoreGive(pwngrid_lock);
 
     return closest;
 }
@@ -185,38 +237,9 @@ signed int getPwngridClosestRssi() {
 // Detect pwnagotchi adapted from Marauder
 // https://github.com/justcallmekoko/ESP32Marauder/wiki/detect-pwnagotchi
 // https://github.com/justcallmekoko/ESP32Marauder/blob/master/esp32_marauder/WiFiScan.cpp#L2255
-typedef struct {
-    int16_t fctl;
-    int16_t duration;
-    uint8_t da;
-    uint8_t sa;
-    uint8_t bssid;
-    int16_t seqctl;
-    unsigned char payload[];
-} __attribute__((packed)) WifiMgmtHdr;
-
-typedef struct {
-    uint8_t payload[0];
-    WifiMgmtHdr hdr;
-} wifi_ieee80211_packet_t;
-
-void getMAC(char *addr, uint8_t *data, uint16_t offset) {
-    sprintf(
-        addr,
-        "%02x:%02x:%02x:%02x:%02x:%02x",
-        data[offset + 0],
-        data[offset + 1],
-        data[offset + 2],
-        data[offset + 3],
-        data[offset + 4],
-        data[offset + 5]
-    );
-}
-
 void pwnSnifferCallback(void *buf, wifi_promiscuous_pkt_type_t type) {
     sniffer(buf, type);
     wifi_promiscuous_pkt_t *snifferPacket = (wifi_promiscuous_pkt_t *)buf;
-    WifiMgmtHdr *frameControl = (WifiMgmtHdr *)snifferPacket->payload;
 
     const uint8_t *frame = snifferPacket->payload;
     const uint16_t frameCtrl = (uint16_t)frame[0] | ((uint16_t)frame[1] << 8);
@@ -237,54 +260,43 @@ void pwnSnifferCallback(void *buf, wifi_promiscuous_pkt_type_t type) {
         BeaconList Beacon;
         memcpy(Beacon.MAC, apAddr, 6);
         Beacon.channel = ch;
-        if (registeredBeacons.find(Beacon) == registeredBeacons.end()) {
-            registeredBeacons.insert(Beacon); // Save a new MAC to Deauth
-        }
+        registeredBeacons.insert(Beacon.key()); // Save a new MAC to Deauth
     }
 
-    String src = "";
-    String essid = "";
-
-    if (type == WIFI_PKT_MGMT) {
-        // Remove frame check sequence bytes
-        int len = snifferPacket->rx_ctrl.sig_len - 4;
-        int fctl = ntohs(frameControl->fctl);
-        const wifi_ieee80211_packet_t *ipkt = (wifi_ieee80211_packet_t *)snifferPacket->payload;
-        const WifiMgmtHdr *hdr = &ipkt->hdr;
-
-        // if ((snifferPacket->payload[0] == 0x80) && (buf == 0)) {
-        if ((snifferPacket->payload[0] == 0x80)) {
-            char addr[] = "00:00:00:00:00:00";
-            getMAC(addr, snifferPacket->payload, 10);
-            src.concat(addr);
-            if (src == "de:ad:be:ef:de:ad") {
-                // Just grab the first 255 bytes of the pwnagotchi beacon
-                // because that is where the name is
-                for (int i = 38; i < len; i++) {
-                    if (isAscii(snifferPacket->payload[i])) { essid.concat((char)snifferPacket->payload[i]); }
-                }
-
-                JsonDocument sniffed_json; // ArduinoJson v6s
-                DeserializationError result = deserializeJson(sniffed_json, essid);
-
-                if (result == DeserializationError::Ok) {
-                    // Serial.println("\nSuccessfully parsed json");
-                    // serializeJson(json, Serial);  // ArduinoJson v6
-                    add_new_peer(sniffed_json, snifferPacket->rx_ctrl.rssi);
-                } else if (result == DeserializationError::IncompleteInput) {
-                    Serial.println("Deserialization error: incomplete input");
-                } else if (result == DeserializationError::NoMemory) {
-                    Serial.println("Deserialization error: no memory");
-                } else if (result == DeserializationError::InvalidInput) {
-                    Serial.println("Deserialization error: invalid input");
-                } else if (result == DeserializationError::TooDeep) {
-                    Serial.println("Deserialization error: too deep");
-                } else {
-                    Serial.println(essid);
-                    Serial.println("Deserialization error");
-                }
-            }
+    // Pwnagotchi advertisements: beacons from de:ad:be:ef:de:ad carrying their JSON in 0xDE vendor IEs.
+    // Only copied here, the JSON is parsed by the worker task
+    if (type != WIFI_PKT_MGMT || frame[0] != 0x80 || !pwngrid_queue) return;
+    static const uint8_t pwn_mac[6] = {0xde, 0xad, 0xbe, 0xef, 0xde, 0xad};
+    if (memcmp(frame + 10, pwn_mac, 6) != 0) return;
+
+    static pwngrid_advert advert; // only touched by the Wi-Fi task
+    int len = snifferPacket->rx_ctrl.sig_len - 4; // Remove frame check sequence bytes
+    advert.len = 0;
+    advert.rssi = snifferPacket->rx_ctrl.rssi;
+    for (int pos = 36; pos + 2 <= len;) {
+        uint8_t tag = frame[pos], tag_len = frame[pos + 1];
+        if (pos + 2 + tag_len > len) break;
+        if (tag == 0xde) {
+            uint16_t n = min((int)tag_len, PWNGRID_MAX_JSON - 1 - advert.len);
+            memcpy(advert.json + advert.len, frame + pos + 2, n);
+            advert.len += n;
         }
+        pos += 2 + tag_len;
+    }
+    if (advert.len == 0) return;
+    advert.json[advert.len] = '\0';
+    xQueueSend(pwngrid_queue, &advert, 0); // dropped if the worker is behind, it will be sent again
+}
+
+void pwngridWorker(void *arg) {
+    static pwngrid_advert advert;
+    while (true) {
+        if (xQueueReceive(pwngrid_queue, &advert, portMAX_DELAY) != pdTRUE) continue;
+
+        JsonDocument sniffed_json;
+        DeserializationError result = deserializeJson(sniffed_json, advert.json, advert.len);
+        if (result == DeserializationError::Ok) add_new_peer(sniffed_json, advert.rssi);
+        else Serial.printf("Deserialization error: %s\n", result.c_str());
     }
 }
 
@@ -293,6 +305,17 @@ const wifi_promiscuous_filter_t filter = {
 };
 
 void initPwngrid() {
+    if (!pwngrid_table) {
+        size_t bytes = sizeof(pwngrid_peer) * PWNGRID_MAX_PEERS;
+        pwngrid_table = (pwngrid_peer *)(psramFound() ? ps_malloc(bytes) : malloc(bytes));
+        pwngrid_lock = xSemaphoreCreateMutex();
+        pwngrid_queue = xQueueCreate(PWNGRID_QUEUE_LEN, sizeof(pwngrid_advert));
+        xTaskCreate(pwngridWorker, "pwngrid", 6144, NULL, 1, &pwngrid_task);
+    }
+    if (pwngrid_table) memset(pwngrid_table, 0, sizeof(pwngrid_peer) * PWNGRID_MAX_PEERS);
+    pwngrid_friends_tot = 0;
+    pwngrid_last_friend_name = "";
+
     wifi_init_config_t WIFI_INIT_CONFIG = WIFI_INIT_CONFIG_DEFAULT();
     esp_wifi_init(&WIFI_INIT_CONFIG);
     esp_wifi_set_storage(WIFI_STORAGE_RAM);
@@ -13,21 +13,26 @@ Thanks to @bmorcelli for his help doing a better code.
 #include <Arduino.h>
 #include <vector>
 
+#define PWNGRID_MAX_PEERS 64  // peer table slots, power of 2. Kept at most 3/4 full
+#define PWNGRID_MAX_JSON 1024 // JSON of an advertisement, reassembled from the 0xDE vendor IEs
+#define PWNGRID_QUEUE_LEN 4   // advertisements waiting for the worker task
+
 typedef struct {
     int epoch;
-    String face;
-    String grid_version;
-    String identity;
-    String name;
+    char face[48];
+    char grid_version[16];
+    char identity[65];
+    char name[33];
     int pwnd_run;
     int pwnd_tot;
-    String session_id;
+    char session_id[18];
     int timestamp;
     int uptime;
-    String version;
+    char version[16];
     signed int rssi;
     unsigned long last_ping;
     bool gone;
+    uint32_t hash; // of the identity, home slot in the peer table
 } pwngrid_peer;
 
 void initPwngrid();
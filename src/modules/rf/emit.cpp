@@ -1,5 +1,6 @@
 #include "emit.h"
 #include "modules/rf/rf_utils.h" // for initRfModule
+#include "modules/rf/rmt_tx.h"
 #include <ELECHOUSE_CC1101_SRC_DRV.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
@@ -77,9 +78,20 @@ void rf_raw_emit(RawRecording &recorded, bool &returnToMenu) {
     xTaskCreate(rf_raw_emit_draw, "RawEmitDraw", 2048, NULL, 1, &rf_raw_emit_draw_handle);
 
     for (size_t i = 0; i < recorded.codes.size(); ++i) {
-        // Send the RMT code
-        for (int j = 0; j < recorded.codeLengths[i]; j++) {
-            outputState = true;
+        // Send the RMT code, the recorded items already are in 1us ticks
+        outputState = true;
+        const rmt_item32_t *code = recorded.codes[i];
+        size_t half = 0, halves = 2 * (size_t)recorded.codeLengths[i];
+        bool sent = rmtTxPulses(txPin, [&](bool &level, uint32_t &duration) {
+            if (half >= halves) return false;
+            const rmt_item32_t &item = code[half / 2];
+            level = half % 2 ? item.level1 : item.level0;
+            duration = half % 2 ? item.duration1 : item.duration0;
+            half++;
+            return duration != 0; // zero duration is the end marker
+        });
+        // RMT not available, bit-bang it
+        for (int j = 0; !sent && j < recorded.codeLengths[i]; j++) {
             if (recorded.codes[i][j].level0 == 1) digitalWrite(txPin, HIGH);
             else digitalWrite(txPin, LOW);
             delayMicroseconds(recorded.codes[i][j].duration0);
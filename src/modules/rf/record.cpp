@@ -1,4 +1,5 @@
 #include "record.h"
+#include "rf_hunter.h"
 #include "rf_utils.h"
 #include <ELECHOUSE_CC1101_SRC_DRV.h>
 
@@ -73,55 +74,25 @@ void rf_raw_record_draw(RawRecordingStatus status) {
     }
 }
 
-// TODO: replace frequency scans throughout rf.cpp with this unified function
-#define FREQUENCY_SCAN_MAX_TRIES 5
 float rf_freq_scan() {
     float frequency = 0;
-    int idx = range_limits[bruceConfig.rfScanRange][0];
-    uint8_t attempt = 0;
-    int rssi = -80, rssiThreshold = -65;
-
-    FreqFound best_frequencies[FREQUENCY_SCAN_MAX_TRIES];
-    for (int i = 0; i < FREQUENCY_SCAN_MAX_TRIES; i++) {
-        best_frequencies[i].freq = 433.92;
-        best_frequencies[i].rssi = -75;
-    }
-
-    while (frequency <= 0 && !check(EscPress)) { // FastScan
+#if defined(USE_CC1101_VIA_SPI)
+    RfHunter hunter;
+    if (!hunter.begin(bruceConfig.rfScanRange, -65)) return 0;
+    while (!check(EscPress)) {
         sinewave_animation();
         previousMillis = millis();
-#if defined(USE_CC1101_VIA_SPI)
-
-        if (idx < range_limits[bruceConfig.rfScanRange][0] ||
-            idx > range_limits[bruceConfig.rfScanRange][1]) {
-            idx = range_limits[bruceConfig.rfScanRange][0];
+        if (hunter.step()) {
+            frequency = hunter.frequency();
+            bruceConfig.setRfFreq(frequency, 0);
+            Serial.println("Frequency Found: " + hunter.summary());
+            break;
         }
-        float checkFrequency = subghz_frequency_list[idx];
-        ELECHOUSE_cc1101.setMHZ(checkFrequency);
-        tft.drawPixel(0, 0, 0); // To make sure CC1101 shared with TFT works properly
-        delay(5);
-        rssi = ELECHOUSE_cc1101.getRssi();
-        if (rssi > rssiThreshold) {
-            best_frequencies[attempt].freq = checkFrequency;
-            best_frequencies[attempt].rssi = rssi;
-            attempt++;
-            if (attempt >= FREQUENCY_SCAN_MAX_TRIES) {
-                int max_index = 0;
-                for (int i = 1; i < FREQUENCY_SCAN_MAX_TRIES; ++i) {
-                    if (best_frequencies[i].rssi > best_frequencies[max_index].rssi) { max_index = i; }
-                }
-
-                bruceConfig.setRfFreq(best_frequencies[max_index].freq, 0);
-                frequency = best_frequencies[max_index].freq;
-                Serial.println("Frequency Found: " + String(frequency));
-            }
-        }
-        ++idx;
+    }
 #else
-        frequency = 433.92;
-        bruceConfig.setRfFreq(433.92, 2);
+    frequency = 433.92;
+    bruceConfig.setRfFreq(433.92, 2);
 #endif
-    }
     return frequency;
 }
 
@@ -0,0 +1,145 @@
+#include "rf_hunter.h"
+#include "rf_utils.h"
+
+bool RfHunter::begin(int range, int threshold) {
+    end();
+    if (range < 0 || range > 3) range = 3;
+    _first = range_limits[range][0];
+    _last = range_limits[range][1];
+    _threshold = threshold;
+    _stats = RfHuntStats();
+    _next = 0;
+    _frequency = 0;
+    _start = millis();
+    // the callers set the module up for RX before hunting
+    if (!_sweep.begin(subghz_frequency_list + _first, _last - _first + 1, false)) return false;
+
+    // a first sweep seeds the noise floor of each band
+    int8_t rssi[RF_SWEEP_MAX_BINS];
+    int32_t sum[3] = {0, 0, 0};
+    int count[3] = {0, 0, 0};
+    _sweep.sweep(rssi);
+    for (uint16_t i = 0; i < _sweep.bins(); i++) {
+        int8_t b = _sweep.band(i);
+        if (b < 0) continue;
+        sum[b] += rssi[i];
+        count[b]++;
+    }
+    for (int b = 0; b < 3; b++) {
+        _floor[b] = count[b] ? sum[b] * 16 / count[b] : -100 * 16;
+        _stats.noiseFloor[b] = _floor[b] / 16;
+    }
+    _stats.hops = _sweep.bins();
+    return true;
+}
+
+void RfHunter::end() { _sweep.end(); }
+
+bool RfHunter::isBusy(int8_t band, int8_t rssi) const {
+    return rssi * 16 > _floor[band] + RF_HUNT_MARGIN_DB * 8; // half way to a hit
+}
+
+// Keeps the strongest of `reads` reads of bin i, `first` being the one already done
+int8_t RfHunter::dwell(uint16_t i, int8_t first, int reads) {
+    int8_t rssi = first;
+    for (int n = 1; n < reads; n++) rssi = max(rssi, _sweep.measure(i));
+    _stats.hops += reads - 1;
+    return rssi;
+}
+
+// Sweeps `bins` bins over centerKhz +- spanKhz and returns the strongest one
+uint32_t RfHunter::peak(uint32_t centerKhz, uint32_t spanKhz, uint16_t bins, int8_t &rssi) {
+    rssi = RF_SWEEP_NO_RSSI;
+    float start = (centerKhz - spanKhz) / 1000.0f, stop = (centerKhz + spanKhz) / 1000.0f;
+    if (!_sweep.begin(start, stop, bins)) return centerKhz;
+    uint32_t best = centerKhz;
+    for (uint16_t i = 0; i < _sweep.bins(); i++) {
+        int8_t r = dwell(i, _sweep.measure(i), RF_HUNT_DWELL_READS);
+        _stats.hops++;
+        if (r > rssi) {
+            rssi = r;
+            best = _sweep.khz(i);
+        }
+    }
+    return best;
+}
+
+void RfHunter::lock(uint32_t khz, int8_t rssi) {
+    _frequency = khz / 1000.0f;
+    uint32_t closest = RF_HUNT_SNAP_KHZ + 1;
+    for (uint16_t i = _first; i <= _last; i++) {
+        uint32_t known = lroundf(subghz_frequency_list[i] * 1000);
+        uint32_t dist = known > khz ? known - khz : khz - known;
+        if (dist < closest) {
+            closest = dist;
+            _frequency = subghz_frequency_list[i];
+        }
+    }
+    _stats.lockRssi = rssi;
+    _stats.lockMs = millis() - _start;
+    for (int b = 0; b < 3; b++) _stats.noiseFloor[b] = _floor[b] / 16;
+
+    // back to the normal receiver settings, calibrated on the frequency found
+    _sweep.end(true);
+    setMHZ(_frequency);
+    ELECHOUSE_cc1101.SetRx();
+}
+
+bool RfHunter::step() {
+    if (!_sweep.active()) return false;
+    _sweep.shareBus();
+    unsigned long start = micros();
+    while (micros() - start < RF_HUNT_SLICE_US) {
+        uint16_t i = _next;
+        if (++_next >= _sweep.bins()) {
+            _next = 0;
+            _stats.sweeps++;
+        }
+        int8_t b = _sweep.band(i);
+        if (b < 0) continue;
+
+        int8_t rssi = _sweep.measure(i);
+        _stats.hops++;
+        if (!isBusy(b, rssi)) {
+            _floor[b] += (rssi * 16 - _floor[b]) / 16;
+            continue;
+        }
+        rssi = dwell(i, rssi, RF_HUNT_DWELL_READS);
+        int trigger = max(_threshold, _floor[b] / 16 + RF_HUNT_MARGIN_DB);
+        if (rssi <= trigger) continue;
+        _stats.hits++;
+
+        // the signal may sit between two known frequencies, or be closer to the next one
+        uint32_t hitKhz = _sweep.khz(i);
+        int8_t coarseRssi, fineRssi;
+        uint32_t coarseKhz = peak(hitKhz, RF_HUNT_COARSE_KHZ, RF_HUNT_COARSE_BINS, coarseRssi);
+        if (coarseRssi <= trigger) { // gone already
+            lock(hitKhz, rssi);
+            return true;
+        }
+        uint32_t fineKhz = peak(coarseKhz, RF_HUNT_FINE_KHZ, RF_HUNT_FINE_BINS, fineRssi);
+        if (fineRssi >= coarseRssi) lock(fineKhz, fineRssi);
+        else lock(coarseKhz, coarseRssi);
+        return true;
+    }
+    return false;
+}
+
+String RfHunter::summary() const {
+    char txt[160];
+    snprintf(
+        txt,
+        sizeof(txt),
+        "%.2fMHz at %ddBm in %lums: %lu sweeps, %lu hops, %lu hits, noise %d/%d/%ddBm",
+        _frequency,
+        _stats.lockRssi,
+        (unsigned long)_stats.lockMs,
+        (unsigned long)_stats.sweeps,
+        (unsigned long)_stats.hops,
+        (unsigned long)_stats.hits,
+        _stats.noiseFloor[0],
+        _stats.noiseFloor[1],
+        _stats.noiseFloor[2]
+    );
+    return txt;
+}
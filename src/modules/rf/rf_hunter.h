@@ -0,0 +1,68 @@
+#ifndef __RF_HUNTER_H__
+#define __RF_HUNTER_H__
+
+#include "rf_sweep.h"
+
+#define RF_HUNT_SLICE_US 5000  // time given to step() before the caller gets the loop back
+#define RF_HUNT_MARGIN_DB 10   // a hit must stand this far above the noise floor of its band
+#define RF_HUNT_DWELL_READS 4  // reads of a bin that looks busy, bursts have gaps between pulses
+#define RF_HUNT_COARSE_KHZ 600 // first refinement pass: +-600kHz around the hit...
+#define RF_HUNT_COARSE_BINS 25 // ...in 50kHz steps
+#define RF_HUNT_FINE_KHZ 50    // second pass: +-50kHz around the best bin...
+#define RF_HUNT_FINE_BINS 11   // ...in 10kHz steps
+#define RF_HUNT_SNAP_KHZ 50    // a peak this close to a known frequency locks on the known frequency
+
+struct RfHuntStats {
+    uint32_t hops = 0;                // bins measured, refinement included
+    uint32_t sweeps = 0;              // passes over the range
+    uint32_t hits = 0;                // bins above the trigger level
+    uint32_t lockMs = 0;              // from begin() to the lock
+    int8_t noiseFloor[3] = {0, 0, 0}; // dBm, by band
+    int8_t lockRssi = 0;
+};
+
+/**
+ * @brief Looks for an active frequency in one of the subghz_frequency_list ranges
+ *
+ * The range is swept with RfSweep. Each band keeps a noise floor estimate and a bin only triggers when
+ * it is above both the threshold and the floor of its band by RF_HUNT_MARGIN_DB. Quiet bins get a single
+ * read, busy ones RF_HUNT_DWELL_READS. A hit is refined by two finer sweeps around it, then snapped to
+ * the closest known frequency if there is one nearby.
+ */
+class RfHunter {
+public:
+    ~RfHunter() { end(); }
+
+    // range: index of range_limits. threshold: minimum RSSI of a hit, in dBm.
+    // The module must already be set up with initRfModule()
+    bool begin(int range, int threshold);
+    // Hunts for up to RF_HUNT_SLICE_US. Returns true once a frequency is locked: the module is then left in
+    // RX on frequency() and the hunt is over
+    bool step();
+    // Stops hunting and releases the module
+    void end();
+
+    bool active() const { return _sweep.active(); }
+    float frequency() const { return _frequency; }
+    const RfHuntStats &stats() const { return _stats; }
+    // One line summary of the last hunt, for the logs
+    String summary() const;
+
+private:
+    int8_t dwell(uint16_t i, int8_t first, int reads);
+    bool isBusy(int8_t band, int8_t rssi) const;
+    uint32_t peak(uint32_t centerKhz, uint32_t spanKhz, uint16_t bins, int8_t &rssi);
+    void lock(uint32_t khz, int8_t rssi);
+
+    RfSweep _sweep;
+    uint16_t _next = 0;
+    int _threshold = -65;
+    int16_t _floor[3];   // noise floor by band, in 1/16 dBm
+    uint16_t _first = 0; // first and last frequency of the range in subghz_frequency_list
+    uint16_t _last = 0;
+    float _frequency = 0;
+    unsigned long _start = 0;
+    RfHuntStats _stats;
+};
+
+#endif
@@ -11,6 +11,7 @@ RFScan::RFScan() { setup(); }
 RFScan::~RFScan() { deinitRfModule(); }
 
 void RFScan::setup() {
+    hunter.end(); // restarted while hunting
     if (!initRfModule("rx", bruceConfig.rfFreq)) { return; }
 
     RCSwitch_Enable_Receive(rcswitch);
@@ -37,7 +38,6 @@ void RFScan::loop() {
         if (restartScan) return setup();
 
         if (bruceConfig.rfFxdFreq) frequency = bruceConfig.rfFreq;
-        if (frequency <= 0) init_freqs();
 
         while (frequency <= 0) { // FastScan
             if (check(EscPress) || returnToMenu) return;
@@ -65,42 +65,17 @@ void RFScan::RCSwitch_Enable_Receive(RCSwitch rcswitch) {
     }
 }
 
-void RFScan::init_freqs() {
-    for (int i = 0; i < _MAX_TRIES; i++) {
-        _freqs[i].freq = 433.92;
-        _freqs[i].rssi = -75;
-    }
-    _try = 0;
-}
-
 void RFScan::fast_scan() {
-
-    if (idx < range_limits[bruceConfig.rfScanRange][0] || idx > range_limits[bruceConfig.rfScanRange][1]) {
-        idx = range_limits[bruceConfig.rfScanRange][0];
+    if (!hunter.active() && !hunter.begin(bruceConfig.rfScanRange, rssiThreshold)) {
+        frequency = bruceConfig.rfFreq; // no memory for the sweep, stay on the configured frequency
+        return;
     }
-    float checkFrequency = subghz_frequency_list[idx];
-    setMHZ(checkFrequency);
-    tft.drawPixel(0, 0, 0); // To make sure CC1101 shared with TFT works properly
-    delay(5);
-    rssi = ELECHOUSE_cc1101.getRssi();
-    if (rssi > rssiThreshold) {
-        _freqs[_try].freq = checkFrequency;
-        _freqs[_try].rssi = rssi;
-        _try++;
-        if (_try >= _MAX_TRIES) {
-            int max_index = 0;
-            for (int i = 1; i < _MAX_TRIES; ++i) {
-                if (_freqs[i].rssi > _freqs[max_index].rssi) { max_index = i; }
-            }
+    if (!hunter.step()) return;
 
-            bruceConfig.setRfFreq(_freqs[max_index].freq, 0);
-            frequency = _freqs[max_index].freq;
-            setMHZ(frequency);
-            Serial.println("Frequency Found: " + String(frequency));
-            rcswitch.resetAvailable();
-        }
-    }
-    ++idx;
+    frequency = hunter.frequency();
+    bruceConfig.setRfFreq(frequency, 0);
+    Serial.println("Frequency Found: " + hunter.summary());
+    rcswitch.resetAvailable();
 }
 
 void RFScan::read_rcswitch() {
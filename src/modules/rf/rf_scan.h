@@ -1,12 +1,11 @@
 #ifndef __RF_SCAN_H__
 #define __RF_SCAN_H__
 
+#include "rf_hunter.h"
 #include "rf_utils.h"
 #include "structs.h"
 #include <RCSwitch.h>
 
-#define _MAX_TRIES 5
-
 class RFScan {
 public:
     enum RFMenuOption {
@@ -44,11 +43,8 @@ private:
     char hexString[64];
     int signals = 0;
     float frequency = 0.f;
-    uint8_t _try = 0;
-    FreqFound _freqs[_MAX_TRIES]; // get the best RSSI out of 5 tries
-    int idx = range_limits[bruceConfig.rfScanRange][0];
+    RfHunter hunter;
     float found_freq = 0.f;
-    int rssi = -80;
     int rssiThreshold = -65;
     uint64_t lastSavedKey = 0;
 
@@ -73,7 +69,6 @@ private:
     // Utils
     /////////////////////////////////////////////////////////////////////////////////////
     void RCSwitch_Enable_Receive(RCSwitch rcswitch);
-    void init_freqs();
     void fast_scan();
 };
 
@@ -1,6 +1,8 @@
 #include "rf_send.h"
 #include "core/type_convertion.h"
 #include "rf_utils.h"
+#include "rmt_tx.h"
+#include "sub_reader.h"
 #include <RCSwitch.h>
 
 void sendCustomRF() {
@@ -35,12 +37,46 @@ void sendCustomRF() {
     }
 }
 
+// Parses a RAW_Data string into timings, in a single pass. Returns the number of timings read
+size_t parseRawTimings(const char *data, int *timings, size_t cap) {
+    size_t n = 0;
+    char *end;
+    while (*data && n < cap) {
+        long value = strtol(data, &end, 10);
+        if (end == data) { // not a number, skip it
+            data++;
+            continue;
+        }
+        if (value) timings[n++] = value; // 0 is the list terminator
+        data = end;
+    }
+    return n;
+}
+
+String rawTimingsToString(const int *timings, size_t count) {
+    String data = "";
+    data.reserve(count * 6);
+    for (size_t i = 0; i < count; i++) {
+        if (i) data += ' ';
+        data += String(timings[i]);
+    }
+    return data;
+}
+
+// The pin the signals are sent through, GDO0 of the CC1101 or the data pin of a simple transmitter
+static int rfTxPin() {
+    if (bruceConfig.rfModule == CC1101_SPI_MODULE) return bruceConfig.CC1101_bus.io0;
+    return bruceConfig.rfTx;
+}
+
 bool txSubFile(FS *fs, String filepath) {
     struct RfCodes selected_code;
     File databaseFile;
-    String line;
-    String txt;
+    char key[24];
+    char value[64];
     int sent = 0;
+    int total = 0;
+    size_t lastRawCount = 0; // timings of the last RAW line, if it fit in a single chunk
 
     if (!fs) return false;
 
@@ -55,94 +91,132 @@ bool txSubFile(FS *fs, String filepath) {
     Serial.println("Opened sub file.");
     selected_code.filepath = filepath.substring(1 + filepath.lastIndexOf("/"));
 
+    // RAW_Data lines are parsed into this buffer and transmitted chunk by chunk, as they are read
+    int *timings = (int *)malloc((SUB_RAW_CHUNK + 1) * sizeof(int));
+    if (!timings) {
+        databaseFile.close();
+        displayError("Not enough memory", true);
+        return false;
+    }
+
     std::vector<int> bitList;
     std::vector<int> bitRawList;
     std::vector<uint64_t> keyList;
-    std::vector<String> rawDataList;
-
-    if (!databaseFile) Serial.println("Fail opening file");
-    // Store the code(s) in the signal
-    while (databaseFile.available()) {
-        line = databaseFile.readStringUntil('\n');
-        txt = line.substring(line.indexOf(":") + 1);
-        if (txt.endsWith("\r")) txt.remove(txt.length() - 1);
-        txt.trim();
-        if (line.startsWith("Protocol:")) selected_code.protocol = txt;
-        if (line.startsWith("Preset:")) selected_code.preset = txt;
-        if (line.startsWith("Frequency:")) selected_code.frequency = txt.toInt();
-        if (line.startsWith("TE:")) selected_code.te = txt.toInt();
-        if (line.startsWith("Bit:")) bitList.push_back(txt.toInt()); // selected_code.Bit = txt.toInt();
-        if (line.startsWith("Bit_RAW:"))
-            bitRawList.push_back(txt.toInt()); // selected_code.BitRAW = txt.toInt();
-        if (line.startsWith("Key:"))
-            keyList.push_back(hexStringToDecimal(txt.c_str())
-            ); // selected_code.key = hexStringToDecimal(txt.c_str());
-        if (line.startsWith("RAW_Data:") || line.startsWith("Data_RAW:"))
-            rawDataList.push_back(txt); // selected_code.data = txt;
+
+    // The radio is configured once and all codes go out back to back
+    RfTxSession session;
+
+    SubReader reader(databaseFile);
+    // Store the code(s) in the signal, RAW data is sent right away
+    while (reader.nextKey(key, sizeof(key))) {
         if (check(EscPress)) break;
+        bool headerDone =
+            selected_code.protocol != "" && selected_code.preset != "" && selected_code.frequency > 0;
+
+        if (!strcmp(key, "RAW_Data") || !strcmp(key, "Data_RAW")) {
+            total++;
+            if (!headerDone) {
+                reader.skipLine();
+                continue;
+            }
+            if (selected_code.protocol != "RAW") { // BinRAW data is hex text, kept as it is
+                reader.readValue(selected_code.data);
+                if (session.send(selected_code)) sent++;
+                continue;
+            }
+
+            if (!session.beginCode(selected_code)) {
+                reader.skipLine();
+                continue;
+            }
+            if (sent == 0) displayTextLine("Sending..");
+            bool lineDone = false;
+            size_t chunks = 0;
+            // the chunks of a line go out as one signal, through a single RMT transmission
+            RmtTxStream stream;
+            bool streaming = stream.begin(gpio_num_t(rfTxPin()), SUB_RAW_CHUNK);
+            while (!lineDone) {
+                lastRawCount = reader.readTimings(timings, SUB_RAW_CHUNK, lineDone);
+                timings[lastRawCount] = 0; // termination
+                if (streaming) stream.write(timings, lastRawCount);
+                else RCSwitch_RAW_send(timings);
+                chunks++;
+            }
+            stream.end();
+            if (chunks > 1) lastRawCount = 0;
+            session.endCode();
+            sent++;
+            continue;
+        }
+
+        reader.readValue(value, sizeof(value));
+        if (!strcmp(key, "Protocol")) selected_code.protocol = value;
+        else if (!strcmp(key, "Preset")) selected_code.preset = value;
+        else if (!strcmp(key, "Frequency")) selected_code.frequency = strtoul(value, NULL, 10);
+        else if (!strcmp(key, "TE")) selected_code.te = atoi(value);
+        else if (!strcmp(key, "Bit")) bitList.push_back(atoi(value));
+        else if (!strcmp(key, "Bit_RAW")) bitRawList.push_back(atoi(value));
+        else if (!strcmp(key, "Key")) keyList.push_back(hexStringToDecimal(value));
+    }
+    // Bit and Bit_RAW of a BinRAW file describe its Data_RAW blocks, which were already sent
+    if (selected_code.protocol == "BinRAW") {
+        bitList.clear();
+        bitRawList.clear();
     }
-    int total = bitList.size() + bitRawList.size() + keyList.size() + rawDataList.size();
+    total += bitList.size() + bitRawList.size() + keyList.size();
     Serial.printf("Total signals found: %d\n", total);
     databaseFile.close();
 
     // If the signal is complete, send all of the code(s) that were found in it.
-    // TODO: try to minimize the overhead between codes.
     if (selected_code.protocol != "" && selected_code.preset != "" && selected_code.frequency > 0) {
+        if (bitList.size() + bitRawList.size() + keyList.size() > 0) displayTextLine("Sending..");
         for (int bit : bitList) {
             selected_code.Bit = bit;
-            sendRfCommand(selected_code);
-            sent++;
+            if (session.send(selected_code)) sent++;
             if (check(EscPress)) break;
-            // displayTextLine("Sent " + String(sent) + "/" + String(total));
         }
         for (int bitRaw : bitRawList) {
             selected_code.Bit = bitRaw;
-            sendRfCommand(selected_code);
-            sent++;
+            if (session.send(selected_code)) sent++;
             if (check(EscPress)) break;
-            // displayTextLine("Sent " + String(sent) + "/" + String(total));
         }
         for (uint64_t key : keyList) {
             selected_code.key = key;
-            sendRfCommand(selected_code);
-            sent++;
+            if (session.send(selected_code)) sent++;
             if (check(EscPress)) break;
-            // displayTextLine("Sent " + String(sent) + "/" + String(total));
-        }
-        for (String rawData : rawDataList) {
-            selected_code.data = rawData;
-            sendRfCommand(selected_code);
-            sent++;
-            if (check(EscPress)) break;
-            // displayTextLine("Sent " + String(sent) + "/" + String(total));
         }
+        // Recent codes keep the last RAW signal, if it is small enough
+        if (selected_code.protocol == "RAW") selected_code.data = rawTimingsToString(timings, lastRawCount);
         addToRecentCodes(selected_code);
     }
+    free(timings);
+    session.end();
 
     Serial.printf("\nSent %d of %d signals\n", sent, total);
-    displayTextLine("Sent " + String(sent) + "/" + String(total), true);
-
-    // Clear the vectors from memory
-    bitList.clear();
-    bitRawList.clear();
-    keyList.clear();
-    rawDataList.clear();
-    bitList.shrink_to_fit();
-    bitRawList.shrink_to_fit();
-    keyList.shrink_to_fit();
-    rawDataList.shrink_to_fit();
+    if (session.codes()) {
+        Serial.printf(
+            "TX time per code: avg %lu us, max %lu us\n",
+            session.totalUs() / session.codes(),
+            session.maxUs()
+        );
+        displayTextLine(
+            "Sent " + String(sent) + "/" + String(total) + " (" +
+                String(session.totalUs() / session.codes() / 1000) + "ms each)",
+            true
+        );
+    } else {
+        displayTextLine("Sent " + String(sent) + "/" + String(total), true);
+    }
 
     delay(1000);
     deinitRfModule();
     return true;
 }
 
-void sendRfCommand(struct RfCodes rfcode) {
+// Configures the radio to transmit with the code preset. Returns false if it isn't supported
+bool setupRfTx(const struct RfCodes &rfcode, int &rcswitch_protocol_no) {
     uint32_t frequency = rfcode.frequency;
-    String protocol = rfcode.protocol;
     String preset = rfcode.preset;
-    String data = rfcode.data;
-    uint64_t key = rfcode.key;
     byte modulation = 2; // possible values for CC1101: 0 = 2-FSK, 1 =GFSK, 2=ASK, 3 = 4-FSK, 4 = MSK
     float deviation = 1.58;
     float rxBW = 270.83; // Receive bandwidth
@@ -167,7 +241,7 @@ void sendRfCommand(struct RfCodes rfcode) {
         FuriHalSubGhzPresetCustom, //Custom Preset
     */
     // struct Protocol rcswitch_protocol;
-    int rcswitch_protocol_no = 1;
+    rcswitch_protocol_no = 1;
     if (preset == "FuriHalSubGhzPresetOok270Async") {
         rcswitch_protocol_no = 1;
         //  pulseLength , syncFactor , zero , one, invertedSignal
@@ -206,12 +280,12 @@ void sendRfCommand(struct RfCodes rfcode) {
         if (!found) {
             Serial.print("unsupported preset: ");
             Serial.println(preset);
-            return;
+            return false;
         }
     }
 
     // init transmitter
-    if (!initRfModule("", frequency / 1000000.0)) return;
+    if (!initRfModule("", frequency / 1000000.0)) return false;
     if (bruceConfig.rfModule == CC1101_SPI_MODULE) { // CC1101 in use
         // derived from
         // https://github.com/LSatan/SmartRC-CC1101-Driver-Lib/blob/master/examples/Rc-Switch%20examples%20cc1101/SendDemo_cc1101/SendDemo_cc1101.ino
@@ -235,52 +309,87 @@ void sendRfCommand(struct RfCodes rfcode) {
         if (modulation != 2) {
             Serial.print("unsupported modulation: ");
             Serial.println(modulation);
-            return;
+            return false;
         }
         initRfModule("tx", frequency / 1000000.0);
     }
+    return true;
+}
+
+bool RfTxSession::beginCode(const struct RfCodes &rfcode) {
+    // Only reconfigures the radio if the frequency or preset changed
+    if (!_active || rfcode.frequency != _frequency || rfcode.preset != _preset) {
+        if (!setupRfTx(rfcode, _rcswitch_protocol_no)) {
+            end();
+            return false;
+        }
+        _active = true;
+        _frequency = rfcode.frequency;
+        _preset = rfcode.preset;
+    } else if (_codes > 0) {
+        while (millis() - _lastCodeEnd < gapMs) yield(); // inter-frame gap
+    }
+    _codeStart = micros();
+    return true;
+}
+
+void RfTxSession::endCode() {
+    unsigned long elapsed = micros() - _codeStart;
+    _codes++;
+    _totalUs += elapsed;
+    if (elapsed > _maxUs) _maxUs = elapsed;
+    _lastCodeEnd = millis();
+    Serial.printf("Code %lu sent in %lu us\n", _codes, elapsed);
+}
+
+bool RfTxSession::send(const struct RfCodes &rfcode) {
+    if (!beginCode(rfcode)) return false;
+    sendRfCode(rfcode, _rcswitch_protocol_no);
+    endCode();
+    return true;
+}
+
+void RfTxSession::end() {
+    if (_active) deinitRfModule();
+    _active = false;
+}
+
+void sendRfCommand(struct RfCodes rfcode) {
+    displayTextLine("Sending..");
+    RfTxSession session;
+    session.send(rfcode);
+    session.end();
+}
+
+void sendRfCode(const struct RfCodes &rfcode, int rcswitch_protocol_no) {
+    const String &protocol = rfcode.protocol;
+    const String &data = rfcode.data;
 
     if (protocol == "RAW") {
         // count the number of elements of RAW_Data
-        int buff_size = 0;
-        int index = 0;
-        while (index >= 0) {
-            index = data.indexOf(' ', index + 1);
-            buff_size++;
-        }
+        size_t buff_size = 1;
+        for (const char *p = data.c_str(); *p; p++)
+            if (*p == ' ') buff_size++;
         // alloc buffer for transmittimings
-        int *transmittimings =
-            (int *)calloc(sizeof(int), buff_size + 1); // should be smaller the data.length()
-        size_t transmittimings_idx = 0;
-
-        // split data into words, convert to int, and store them in transmittimings
-        int startIndex = 0;
-        index = 0;
-        for (transmittimings_idx = 0; transmittimings_idx < buff_size; transmittimings_idx++) {
-            index = data.indexOf(' ', startIndex);
-            if (index == -1) {
-                transmittimings[transmittimings_idx] = data.substring(startIndex).toInt();
-            } else {
-                transmittimings[transmittimings_idx] = data.substring(startIndex, index).toInt();
-            }
-            startIndex = index + 1;
-        }
+        int *transmittimings = (int *)calloc(sizeof(int), buff_size + 1);
+        if (!transmittimings) return;
+        // parse data in a single pass, converting and storing the values in transmittimings
+        size_t transmittimings_idx = parseRawTimings(data.c_str(), transmittimings, buff_size);
         transmittimings[transmittimings_idx] = 0; // termination
 
         // send rf command
-        displayTextLine("Sending..");
         RCSwitch_RAW_send(transmittimings);
         free(transmittimings);
     } else if (protocol == "BinRAW") {
         // transform from "00 01 02 ... FF" into "00000000 00000001 00000010 .... 11111111"
-        rfcode.data = hexStrToBinStr(rfcode.data);
-        // Serial.println(rfcode.data);
-        rfcode.data.trim();
-        RCSwitch_RAW_Bit_send(rfcode);
+        struct RfCodes bincode = rfcode;
+        bincode.data = hexStrToBinStr(rfcode.data);
+        // Serial.println(bincode.data);
+        bincode.data.trim();
+        RCSwitch_RAW_Bit_send(bincode);
     }
 
     else if (protocol == "RcSwitch") {
-        data.replace(" ", ""); // remove spaces
         // uint64_t data_val = strtoul(data.c_str(), nullptr, 16);
         uint64_t data_val = rfcode.key;
         int bits = rfcode.Bit;
@@ -293,26 +402,26 @@ void sendRfCommand(struct RfCodes rfcode) {
         Serial.println(pulse);
         Serial.println(rcswitch_protocol_no);
         */
-        displayTextLine("Sending..");
-        RCSwitch_send(data_val, bits, pulse, rcswitch_protocol_no, repeat);
+        RCSwitch_tx(data_val, bits, pulse, rcswitch_protocol_no, repeat);
     } else if (protocol.startsWith("Princeton")) {
-        RCSwitch_send(rfcode.key, rfcode.Bit, 350, 1, 10);
+        RCSwitch_tx(rfcode.key, rfcode.Bit, 350, 1, 10);
     } else {
         Serial.print("unsupported protocol: ");
         Serial.println(protocol);
         Serial.println("Sending RcSwitch 11 protocol");
         // if(protocol.startsWith("CAME") || protocol.startsWith("HOLTEC" || NICE)) {
-        RCSwitch_send(rfcode.key, rfcode.Bit, 270, 11, 10);
+        RCSwitch_tx(rfcode.key, rfcode.Bit, 270, 11, 10);
         //}
-
-        return;
     }
+}
 
-    // digitalWrite(bruceConfig.rfTx, LED_OFF);
+void RCSwitch_send(uint64_t data, unsigned int bits, int pulse, int protocol, int repeat) {
+    RCSwitch_tx(data, bits, pulse, protocol, repeat);
     deinitRfModule();
 }
 
-void RCSwitch_send(uint64_t data, unsigned int bits, int pulse, int protocol, int repeat) {
+// Sends the code without turning the radio off, so it can be called many times in a session
+void RCSwitch_tx(uint64_t data, unsigned int bits, int pulse, int protocol, int repeat) {
     // derived from
     // https://github.com/LSatan/SmartRC-CC1101-Driver-Lib/blob/master/examples/Rc-Switch%20examples%20cc1101/SendDemo_cc1101/SendDemo_cc1101.ino
 
@@ -338,77 +447,86 @@ void RCSwitch_send(uint64_t data, unsigned int bits, int pulse, int protocol, in
     */
 
     mySwitch.disableTransmit();
-
-    deinitRfModule();
 }
 
 // ported from https://github.com/sui77/rc-switch/blob/3a536a172ab752f3c7a58d831c5075ca24fd920b/RCSwitch.cpp
-void RCSwitch_RAW_Bit_send(RfCodes data) {
-    int nTransmitterPin = bruceConfig.rfTx;
-    if (bruceConfig.rfModule == CC1101_SPI_MODULE) { nTransmitterPin = bruceConfig.CC1101_bus.io0; }
+void RCSwitch_RAW_Bit_send(RfCodes data, int repeat) {
+    int nTransmitterPin = rfTxPin();
+
+    if (data.data == "" || data.te <= 0) return;
+    const char *bits = data.data.c_str();
+    int len = data.data.length();
+
+    // Starts from the end of the string, consecutive equal bits are merged into a single pulse
+    int currentBit = len - 1;
+    int round = 0;
+    bool sent = rmtTxPulses(gpio_num_t(nTransmitterPin), [&](bool &level, uint32_t &duration) {
+        while (true) {
+            if (currentBit < 0) { // the repetitions follow right after, without any gap
+                if (++round >= repeat) return false;
+                currentBit = len - 1;
+            }
+            if (bits[currentBit] == '0' || bits[currentBit] == '1') break;
+            currentBit--; // invalid data
+        }
+        level = bits[currentBit] == '1';
+        duration = 0;
+        while (currentBit >= 0 && (bits[currentBit] == '1') == level &&
+               (bits[currentBit] == '0' || bits[currentBit] == '1')) {
+            duration += data.te;
+            currentBit--;
+        }
+        return true;
+    });
+    if (sent) return;
 
-    if (data.data == "") return;
+    // RMT not available, bit-bang it
     bool currentlogiclevel = false;
-    int nRepeatTransmit = 1;
-    for (int nRepeat = 0; nRepeat < nRepeatTransmit; nRepeat++) {
-        int currentBit = data.data.length();
-        while (currentBit >= 0) { // Starts from the end of the string until the max number of bits to send
-            char c = data.data[currentBit];
+    for (int nRepeat = 0; nRepeat < repeat; nRepeat++) {
+        currentBit = len - 1;
+        while (currentBit >= 0) {
+            char c = bits[currentBit];
             if (c == '1') {
                 currentlogiclevel = true;
             } else if (c == '0') {
                 currentlogiclevel = false;
             } else {
-                Serial.println("Invalid data");
                 currentBit--;
                 continue;
-                // return;
             }
 
             digitalWrite(nTransmitterPin, currentlogiclevel ? HIGH : LOW);
             delayMicroseconds(data.te);
-
-            // Serial.print(currentBit);
-            // Serial.print("=");
-            // Serial.println(currentlogiclevel);
-
             currentBit--;
         }
         digitalWrite(nTransmitterPin, LOW);
     }
 }
 
-void RCSwitch_RAW_send(int *ptrtransmittimings) {
-    int nTransmitterPin = bruceConfig.rfTx;
-    if (bruceConfig.rfModule == CC1101_SPI_MODULE) { nTransmitterPin = bruceConfig.CC1101_bus.io0; }
+void RCSwitch_RAW_send(const int *ptrtransmittimings, int repeat) {
+    int nTransmitterPin = rfTxPin();
 
     if (!ptrtransmittimings) return;
 
-    bool currentlogiclevel = true;
-    int nRepeatTransmit = 1; // repeats RAW signal twice!
-    // HighLow pulses ;
+    size_t count = 0;
+    while (ptrtransmittimings[count]) count++; // && currenttiming < RCSWITCH_MAX_CHANGES
+    if (rmtTxTimings(gpio_num_t(nTransmitterPin), ptrtransmittimings, count, repeat)) return;
 
-    for (int nRepeat = 0; nRepeat < nRepeatTransmit; nRepeat++) {
-        unsigned int currenttiming = 0;
-        while (ptrtransmittimings[currenttiming]) { // && currenttiming < RCSWITCH_MAX_CHANGES
-            if (ptrtransmittimings[currenttiming] >= 0) {
+    // RMT not available, bit-bang it
+    bool currentlogiclevel = true;
+    for (int nRepeat = 0; nRepeat < repeat; nRepeat++) {
+        for (size_t currenttiming = 0; currenttiming < count; currenttiming++) {
+            int timing = ptrtransmittimings[currenttiming];
+            if (timing >= 0) {
                 currentlogiclevel = true;
             } else {
-                // negative value
+                // negative value, keeps the caller's timings untouched so they can be sent again
                 currentlogiclevel = false;
-                ptrtransmittimings[currenttiming] = (-1) * ptrtransmittimings[currenttiming]; // invert sign
+                timing = -timing;
             }
 
             digitalWrite(nTransmitterPin, currentlogiclevel ? HIGH : LOW);
-            delayMicroseconds(ptrtransmittimings[currenttiming]);
-
-            /*
-            Serial.print(ptrtransmittimings[currenttiming]);
-            Serial.print("=");
-            Serial.println(currentlogiclevel);
-            */
-
-            currenttiming++;
+            delayMicroseconds(timing);
         }
         digitalWrite(nTransmitterPin, LOW);
     } // end for
@@ -3,13 +3,58 @@
 
 #include "structs.h"
 
+#define SUB_RAW_CHUNK 1024 // RAW_Data timings transmitted at once
+
 void sendCustomRF();
 bool txSubFile(FS *fs, String filepath);
 
+#define RF_TX_GAP_MS 10    // default gap between codes sent in the same session
+
+/**
+ * @brief Transmit session for several codes
+ *
+ * The radio is configured once per frequency/preset instead of once per code, and the
+ * codes go out back to back with `gapMs` between them. Time spent per code is measured.
+ */
+class RfTxSession {
+public:
+    uint32_t gapMs = RF_TX_GAP_MS;
+
+    ~RfTxSession() { end(); }
+
+    // Configures the radio (if needed) and waits the gap. Returns false if the preset isn't supported
+    bool beginCode(const struct RfCodes &rfcode);
+    void endCode();
+    // Sends a whole code: beginCode + protocol dispatch + endCode
+    bool send(const struct RfCodes &rfcode);
+    // Turns the radio off
+    void end();
+
+    unsigned long codes() const { return _codes; }
+    unsigned long totalUs() const { return _totalUs; }
+    unsigned long maxUs() const { return _maxUs; }
+
+private:
+    bool _active = false;
+    uint32_t _frequency = 0;
+    String _preset = "";
+    int _rcswitch_protocol_no = 1;
+    unsigned long _codeStart = 0;
+    unsigned long _lastCodeEnd = 0;
+    unsigned long _codes = 0;
+    unsigned long _totalUs = 0;
+    unsigned long _maxUs = 0;
+};
+
+bool setupRfTx(const struct RfCodes &rfcode, int &rcswitch_protocol_no);
 void sendRfCommand(struct RfCodes rfcode);
+void sendRfCode(const struct RfCodes &rfcode, int rcswitch_protocol_no);
+size_t parseRawTimings(const char *data, int *timings, size_t cap);
 void RCSwitch_send(uint64_t data, unsigned int bits, int pulse = 0, int protocol = 1, int repeat = 10);
+void RCSwitch_tx(uint64_t data, unsigned int bits, int pulse = 0, int protocol = 1, int repeat = 10);
 
-void RCSwitch_RAW_Bit_send(RfCodes data);
-void RCSwitch_RAW_send(int *ptrtransmittimings);
+// RAW senders go through the RMT peripheral when available, repeating the signal without gaps
+void RCSwitch_RAW_Bit_send(RfCodes data, int repeat = 1);
+void RCSwitch_RAW_send(const int *ptrtransmittimings, int repeat = 1);
 
 #endif
@@ -1,4 +1,9 @@
 #include "rf_spectrum.h"
+#include "core/display.h"
+#include "core/mykeyboard.h"
+#include "core/sd_functions.h"
+#include "core/spectrum_view.h"
+#include "rf_sweep.h"
 #include "rf_utils.h"
 #include "structs.h"
 #include <RCSwitch.h>
@@ -136,3 +141,247 @@ void rf_SquareWave() {
     rmt_rx_stop(RMT_RX_CHANNEL);
     delay(10);
 }
+
+// RSSI spectrum: the CC1101 is swept with RfSweep and shown by a SpectrumView
+#define RF_DBM_MIN -110 // bottom and top of the scale
+#define RF_DBM_MAX -30
+#define RFS_VERSION 1
+
+// .rfs capture layout (little endian):
+//   header: "RFS", version, count of bins (u16), settle time of a bin in us (u16), bins in kHz (u32 * count)
+//   sweep:  milliseconds since the start of the capture (u32), RSSI of each bin in dBm (i8 * count)
+struct __attribute__((packed)) RfsHeader {
+    char magic[3];
+    uint8_t version;
+    uint16_t bins;
+    uint16_t settleUs;
+};
+
+struct RssiView {
+    uint16_t bins; // a column shows the strongest of its bins
+    SpectrumView spectrum;
+};
+
+static uint8_t rssiLevel[SPECTRUM_MAX_COLS]; // by column
+
+static uint8_t dbmToLevel(int8_t dbm) {
+    if (dbm == RF_SWEEP_NO_RSSI || dbm <= RF_DBM_MIN) return 0;
+    return (min((int)dbm, RF_DBM_MAX) - RF_DBM_MIN) * SPECTRUM_LEVEL_MAX / (RF_DBM_MAX - RF_DBM_MIN);
+}
+
+static String khzToString(uint32_t khz) {
+    char txt[12];
+    snprintf(txt, sizeof(txt), "%lu.%03lu", (unsigned long)(khz / 1000), (unsigned long)(khz % 1000));
+    return txt;
+}
+
+static void rssiViewBegin(RssiView &v, uint16_t bins, uint32_t firstKhz, uint32_t lastKhz) {
+    tft.fillScreen(bruceConfig.bgColor);
+    tft.setTextSize(FP);
+    tft.setTextColor(bruceConfig.priColor, bruceConfig.bgColor);
+    tft.drawString(khzToString(firstKhz), 0, tftHeight - LH);
+    tft.drawRightString(khzToString(lastKhz), tftWidth, tftHeight - LH, 1);
+    v.bins = bins;
+    spectrumViewBegin(v.spectrum, min((int)bins, (int)tftWidth));
+}
+
+static void rssiViewUpdate(RssiView &v, const int8_t *rssi) {
+    const int cols = v.spectrum.cols;
+    for (int c = 0; c < cols; c++) {
+        uint8_t level = 0;
+        int last = (c + 1) * v.bins / cols;
+        for (int i = c * v.bins / cols; i < last; i++) level = max(level, dbmToLevel(rssi[i]));
+        rssiLevel[c] = level;
+    }
+    spectrumViewUpdate(v.spectrum, rssiLevel);
+}
+
+// Header line: strongest bin of the last sweep, sweep rate and capture state
+static void rssiViewHeader(uint32_t khz, int8_t dbm, int rate, const char *state) {
+    char header[48];
+    snprintf(header, sizeof(header), "%s %ddBm %d/s %s    ", khzToString(khz).c_str(), dbm, rate, state);
+    tft.setTextSize(FP);
+    tft.setTextColor(bruceConfig.priColor, bruceConfig.bgColor);
+    tft.drawString(header, 0, 0, 1);
+}
+
+static uint16_t strongestBin(const int8_t *rssi, uint16_t bins) {
+    uint16_t best = 0;
+    for (uint16_t i = 1; i < bins; i++) {
+        if (rssi[i] > rssi[best]) best = i;
+    }
+    return best;
+}
+
+static File openCapture(RfSweep &sw) {
+    FS *fs;
+    if (!getFsStorage(fs)) return File();
+    File file = createNewFile(fs, "/BruceRF", "spectrum.rfs");
+    if (!file) return file;
+    RfsHeader header = {{'R', 'F', 'S'}, RFS_VERSION, sw.bins(), sw.settleUs()};
+    file.write((const uint8_t *)&header, sizeof(header));
+    for (uint16_t i = 0; i < sw.bins(); i++) {
+        uint32_t khz = sw.khz(i);
+        file.write((const uint8_t *)&khz, sizeof(khz));
+    }
+    return file;
+}
+
+static void rssiSweepLoop(RfSweep &sw) {
+    RssiView v;
+    rssiViewBegin(v, sw.bins(), sw.khz(0), sw.khz(sw.bins() - 1));
+
+    uint8_t record[4 + RF_SWEEP_MAX_BINS]; // capture: time, then the sweep
+    int8_t *rssi = (int8_t *)record + 4;
+    File capture;
+    const char *state = "";
+    unsigned long captureStart = 0, lastRate = millis();
+    int sweeps = 0, rate = 0;
+    while (!check(EscPress)) {
+        if (check(SelPress)) {
+            if (capture) {
+                Serial.printf("RF sweep: saved %s\n", capture.path());
+                capture.close();
+                state = "";
+            } else {
+                capture = openCapture(sw);
+                captureStart = millis();
+                state = capture ? "[REC]" : "[NO FILE]";
+            }
+            lastRate = 0; // redraw the header now
+        }
+
+        sw.sweep(rssi);
+        sweeps++;
+        rssiViewUpdate(v, rssi);
+        if (capture) {
+            uint32_t t = millis() - captureStart;
+            memcpy(record, &t, sizeof(t));
+            capture.write(record, 4 + sw.bins());
+        }
+
+        if (millis() - lastRate >= 1000) {
+            if (lastRate) rate = sweeps * 1000 / (millis() - lastRate);
+            uint16_t best = strongestBin(rssi, sw.bins());
+            rssiViewHeader(sw.khz(best), rssi[best], rate, state);
+            sweeps = 0;
+            lastRate = millis();
+        }
+    }
+    if (capture) capture.close();
+    spectrumViewEnd();
+}
+
+static void rssiReplay() {
+    FS *fs;
+    if (!getFsStorage(fs)) {
+        displayError("No storage found", true);
+        return;
+    }
+    String path = loopSD(*fs, true, "rfs", "/BruceRF");
+    if (path == "") return;
+    File file = fs->open(path, FILE_READ);
+    RfsHeader header;
+    if (!file || file.read((uint8_t *)&header, sizeof(header)) != sizeof(header) ||
+        memcmp(header.magic, "RFS", 3) || header.version != RFS_VERSION || header.bins < 2 ||
+        header.bins > RF_SWEEP_MAX_BINS) {
+        displayError("Not a spectrum capture", true);
+        return;
+    }
+    uint32_t khz[RF_SWEEP_MAX_BINS];
+    size_t khzBytes = header.bins * sizeof(uint32_t);
+    if (file.read((uint8_t *)khz, khzBytes) != khzBytes) {
+        displayError("Not a spectrum capture", true);
+        return;
+    }
+    size_t dataStart = file.position();
+
+    RssiView v;
+    rssiViewBegin(v, header.bins, khz[0], khz[header.bins - 1]);
+    uint8_t record[4 + RF_SWEEP_MAX_BINS] = {};
+    int8_t *rssi = (int8_t *)record + 4;
+    size_t recordLen = 4 + header.bins;
+    unsigned long start = millis(), pausedAt = 0;
+    uint16_t best = 0;
+    bool stop = false;
+    while (!stop && !check(EscPress)) {
+        if (check(SelPress)) {
+            // pause: the clock of the replay stops too
+            if (pausedAt) start += millis() - pausedAt;
+            pausedAt = pausedAt ? 0 : millis();
+            rssiViewHeader(khz[best], rssi[best], 0, pausedAt ? "[PAUSE]" : "[PLAY]");
+        }
+        if (pausedAt) {
+            delay(10);
+            continue;
+        }
+        if (file.read(record, recordLen) != recordLen) { // end of the capture, from the start again
+            file.seek(dataStart);
+            start = millis();
+            continue;
+        }
+        uint32_t t;
+        memcpy(&t, record, sizeof(t));
+        // check() clears the press, so the wait has to end the replay itself
+        while (millis() - start < t && !stop) {
+            stop = check(EscPress);
+            delay(1);
+        }
+        if (stop) break;
+        rssiViewUpdate(v, rssi);
+        best = strongestBin(rssi, header.bins);
+        rssiViewHeader(khz[best], rssi[best], 0, "[PLAY]");
+    }
+    file.close();
+    spectrumViewEnd();
+}
+
+void rf_rssi_spectrum() {
+    int choice = -1;
+    std::vector<Option> options;
+    for (int i = 0; i < 3; i++) {
+        options.push_back({subghz_frequency_ranges[i], [&choice, i]() { choice = i; }});
+    }
+    options.push_back({"Known freqs", [&]() { choice = 3; }});
+    options.push_back({"Custom span", [&]() { choice = 4; }});
+    options.push_back({"Replay capture", [&]() { choice = 5; }});
+    loopOptions(options);
+    if (choice < 0) return;
+    if (choice == 5) {
+        rssiReplay();
+        returnToMenu = true;
+        return;
+    }
+    if (bruceConfig.rfModule != CC1101_SPI_MODULE) {
+        displayError("RSSI spectrum needs a CC1101", true);
+        return;
+    }
+
+    RfSweep sw;
+    uint16_t bins = min((int)tftWidth, RF_SWEEP_MAX_BINS);
+    bool ok = false;
+    if (choice < 3) {
+        // the band edges of subghz_frequency_list
+        float start = subghz_frequency_list[range_limits[choice][0]];
+        float stop = subghz_frequency_list[range_limits[choice][1]];
+        ok = sw.begin(start, stop, bins);
+    } else if (choice == 3) {
+        ok = sw.begin(subghz_frequency_list, sizeof(subghz_frequency_list) / sizeof(float));
+    } else {
+        String span = String(bruceConfig.rfFreq - 1, 2) + "-" + String(bruceConfig.rfFreq + 1, 2);
+        span = keyboard(span, 20, "Span start-stop MHz");
+        float start = 0, stop = 0;
+        if (sscanf(span.c_str(), "%f-%f", &start, &stop) != 2 || stop <= start) {
+            displayError("Invalid span", true);
+            return;
+        }
+        ok = sw.begin(start, stop, bins);
+    }
+    if (!ok) {
+        displayError("CC1101 not found", true);
+        return;
+    }
+    rssiSweepLoop(sw);
+    sw.end();
+    returnToMenu = true;
+}
@@ -2,6 +2,8 @@
 #define __RF_SPECTRUM_H__
 
 void rf_spectrum();
+// CC1101 RSSI sweep with waterfall, capture to a .rfs file and replay
+void rf_rssi_spectrum();
 void rf_SquareWave();
 
 #endif
@@ -0,0 +1,140 @@
+#include "rf_sweep.h"
+#include "rf_utils.h"
+
+#define MCSM0_FS_AUTOCAL 0x30
+#define MARCSTATE_IDLE 0x01
+
+// Tuning ranges of the CC1101, same as subghz_frequency_ranges
+static const float rfBands[3][2] = {
+    {300, 348},
+    {387, 464},
+    {779, 928}
+};
+
+static int8_t rfBand(float mhz) {
+    for (int8_t b = 0; b < 3; b++) {
+        if (mhz >= rfBands[b][0] && mhz <= rfBands[b][1]) return b;
+    }
+    return -1;
+}
+
+bool RfSweep::alloc(uint16_t count) {
+    free(_bins);
+    _bins = nullptr;
+    _count = 0;
+    if (count == 0 || count > RF_SWEEP_MAX_BINS) return false;
+    size_t bytes = count * sizeof(Bin);
+    _bins = (Bin *)(psramFound() ? ps_malloc(bytes) : malloc(bytes));
+    _count = _bins ? count : 0;
+    return _bins != nullptr;
+}
+
+void RfSweep::setBin(uint16_t i, float mhz) {
+    Bin &b = _bins[i];
+    uint32_t hz = lroundf(mhz * 1000) * 1000;
+    uint32_t word = ((uint64_t)hz << 16) / RF_SWEEP_XTAL_HZ;
+    b.khz = hz / 1000;
+    b.freq[0] = word >> 16;
+    b.freq[1] = word >> 8;
+    b.freq[2] = word;
+    b.band = rfBand(mhz);
+}
+
+bool RfSweep::begin(float startMHz, float stopMHz, uint16_t bins, bool initModule) {
+    if (bins < 2 || stopMHz <= startMHz || !alloc(bins)) return false;
+    float step = (stopMHz - startMHz) / (bins - 1);
+    for (uint16_t i = 0; i < bins; i++) setBin(i, startMHz + step * i);
+    return setup(constrain(step * 1000, 58, 812), initModule);
+}
+
+bool RfSweep::begin(const float *freqsMHz, uint16_t count, bool initModule) {
+    if (!alloc(count)) return false;
+    for (uint16_t i = 0; i < count; i++) setBin(i, freqsMHz[i]);
+    return setup(203, initModule);
+}
+
+void RfSweep::selectBand(const Bin &b) {
+    if (b.band == _band) return;
+    // antenna switch and the VCO settings of the band, see setMHZ()
+    setMHZ(b.khz / 1000.0f);
+    _band = b.band;
+}
+
+bool RfSweep::setup(float rxBwKHz, bool initModule) {
+    uint16_t first = 0;
+    while (first < _count && _bins[first].band < 0) first++;
+    if (first == _count) return false;
+    if (!_active) {
+        if (bruceConfig.rfModule != CC1101_SPI_MODULE ||
+            (initModule && !initRfModule("rx", _bins[first].khz / 1000.0f))) {
+            end();
+            return false;
+        }
+        _active = true;
+        _band = -1;
+        _mcsm0 = ELECHOUSE_cc1101.SpiReadReg(CC1101_MCSM0);
+        _mdmcfg4 = ELECHOUSE_cc1101.SpiReadReg(CC1101_MDMCFG4);
+    }
+    shareBus();
+    ELECHOUSE_cc1101.setRxBW(rxBwKHz);
+    // RSSI response time grows as the filter narrows: ~40us at 600kHz, ~400us at 58kHz
+    _settleUs = RF_SWEEP_PLL_US + 24000 / rxBwKHz;
+
+    unsigned long start = millis();
+    for (uint16_t i = 0; i < _count; i++) {
+        Bin &b = _bins[i];
+        if (b.band < 0) continue;
+        ELECHOUSE_cc1101.SpiStrobe(CC1101_SIDLE);
+        selectBand(b);
+        ELECHOUSE_cc1101.SpiWriteBurstReg(CC1101_FREQ2, b.freq, 3);
+        ELECHOUSE_cc1101.SpiStrobe(CC1101_SCAL);
+        unsigned long calStart = micros();
+        while ((ELECHOUSE_cc1101.SpiReadStatus(CC1101_MARCSTATE) & 0x1F) != MARCSTATE_IDLE &&
+               micros() - calStart < RF_SWEEP_CAL_TIMEOUT_US);
+        ELECHOUSE_cc1101.SpiReadBurstReg(CC1101_FSCAL3, b.fscal, 3);
+    }
+    // from now on IDLE->RX doesn't calibrate, the stored values are loaded instead
+    ELECHOUSE_cc1101.SpiWriteReg(CC1101_MCSM0, _mcsm0 & ~MCSM0_FS_AUTOCAL);
+    Serial.printf("RF sweep: %u bins calibrated in %lums, %uus a bin\n", _count, millis() - start, _settleUs);
+    return true;
+}
+
+void RfSweep::end(bool keepModule) {
+    if (_active) {
+        shareBus();
+        ELECHOUSE_cc1101.SpiStrobe(CC1101_SIDLE);
+        ELECHOUSE_cc1101.SpiWriteReg(CC1101_MCSM0, _mcsm0);
+        ELECHOUSE_cc1101.SpiWriteReg(CC1101_MDMCFG4, _mdmcfg4);
+        if (!keepModule) deinitRfModule();
+        _active = false;
+    }
+    free(_bins);
+    _bins = nullptr;
+    _count = 0;
+}
+
+int8_t RfSweep::measure(uint16_t i) {
+    Bin &b = _bins[i];
+    if (!_active || b.band < 0) return RF_SWEEP_NO_RSSI;
+    ELECHOUSE_cc1101.SpiStrobe(CC1101_SIDLE);
+    selectBand(b);
+    ELECHOUSE_cc1101.SpiWriteBurstReg(CC1101_FREQ2, b.freq, 3);
+    ELECHOUSE_cc1101.SpiWriteBurstReg(CC1101_FSCAL3, b.fscal, 3);
+    ELECHOUSE_cc1101.SpiStrobe(CC1101_SRX);
+    delayMicroseconds(_settleUs);
+    return constrain(ELECHOUSE_cc1101.getRssi(), -127, 0);
+}
+
+void RfSweep::shareBus() {
+    // a display transaction left open would keep the CC1101 off the bus: opening and closing one
+    // releases it without drawing anything
+    if (bruceConfig.CC1101_bus.mosi == (gpio_num_t)TFT_MOSI) {
+        tft.startWrite();
+        tft.endWrite();
+    }
+}
+
+void RfSweep::sweep(int8_t *out) {
+    shareBus();
+    for (uint16_t i = 0; i < _count; i++) out[i] = measure(i);
+}
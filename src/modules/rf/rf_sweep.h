@@ -0,0 +1,70 @@
+#ifndef __RF_SWEEP_H__
+#define __RF_SWEEP_H__
+
+#include <Arduino.h>
+
+#define RF_SWEEP_MAX_BINS 320
+#define RF_SWEEP_XTAL_HZ 26000000    // CC1101 modules use a 26MHz crystal
+#define RF_SWEEP_PLL_US 90           // synthesizer lock with a stored calibration (~800us with SCAL)
+#define RF_SWEEP_CAL_TIMEOUT_US 2000 // a calibration takes ~720us
+#define RF_SWEEP_NO_RSSI INT8_MIN    // bins outside of the CC1101 bands
+
+/**
+ * @brief RSSI sweep of the CC1101 over a list of bins
+ *
+ * The synthesizer is calibrated once for each bin in begin(), then the auto calibration is turned off and
+ * a hop only loads the frequency and its stored FSCAL registers before going to RX: the PLL locks in
+ * ~RF_SWEEP_PLL_US instead of calibrating again on every IDLE->RX. The settle time adds what the RSSI
+ * needs to follow the RX filter, that is slower the narrower it is.
+ */
+class RfSweep {
+public:
+    ~RfSweep() { end(); }
+
+    // Evenly spaced bins from startMHz to stopMHz, the RX filter follows the step.
+    // Called again while active, the module is kept and only the new bins are calibrated.
+    // initModule false when the caller already ran initRfModule(), so the CC1101 isn't reset again
+    bool begin(float startMHz, float stopMHz, uint16_t bins, bool initModule = true);
+    // One bin for each frequency of the list
+    bool begin(const float *freqsMHz, uint16_t count, bool initModule = true);
+    // Restores the auto calibration and the RX filter. With keepModule the module is left idle for the
+    // caller to tune, otherwise it is released
+    void end(bool keepModule = false);
+
+    bool active() const { return _active; }
+    uint16_t bins() const { return _count; }
+    uint32_t khz(uint16_t i) const { return _bins[i].khz; }
+    int8_t band(uint16_t i) const { return _bins[i].band; }
+    uint16_t settleUs() const { return _settleUs; }
+
+    // Tunes bin i and returns its RSSI in dBm, RF_SWEEP_NO_RSSI if the CC1101 can't tune it
+    int8_t measure(uint16_t i);
+    // Measures all the bins into out[bins()]
+    void sweep(int8_t *out);
+    // Hands the SPI bus back from the display when they share it. To be called before a batch of
+    // measure() that follows some drawing, sweep() already does it
+    void shareBus();
+
+private:
+    struct Bin {
+        uint32_t khz;
+        uint8_t freq[3];  // FREQ2..FREQ0
+        uint8_t fscal[3]; // FSCAL3..FSCAL1 found by the calibration
+        int8_t band;      // -1 outside of the bands
+    };
+
+    bool alloc(uint16_t count);
+    void setBin(uint16_t i, float mhz);
+    bool setup(float rxBwKHz, bool initModule);
+    void selectBand(const Bin &b);
+
+    Bin *_bins = nullptr;
+    uint16_t _count = 0;
+    uint16_t _settleUs = 0;
+    int8_t _band = -1; // band the antenna and the VCO settings are set for
+    uint8_t _mcsm0 = 0;
+    uint8_t _mdmcfg4 = 0; // RX filter set by initRfModule()
+    bool _active = false;
+};
+
+#endif
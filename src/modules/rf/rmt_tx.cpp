@@ -0,0 +1,199 @@
+#include "rmt_tx.h"
+#include "rf_utils.h"
+
+struct RmtTxState {
+    const RmtPulseSource *next;
+    bool level = false;
+    uint32_t remaining = 0; // us left of the current pulse
+    bool done = false;
+};
+
+// Only one transmission at a time, the translator has no argument for it
+static RmtTxState *txState = nullptr;
+
+// Called by rmt_write_sample() and then by the RMT interrupt, for `wanted` more items. The pulses don't come
+// from `src`: it is a single dummy byte, reported as translated once the source has no more pulses
+static void rmtTranslate(
+    const void *src, rmt_item32_t *dest, size_t src_size, size_t wanted, size_t *translated_size,
+    size_t *item_num
+) {
+    RmtTxState &st = *txState;
+    size_t n = 0;
+    bool half = false; // dest[n] has only its first half filled
+    while (n < wanted && !st.done) {
+        if (st.remaining == 0) {
+            if (!(*st.next)(st.level, st.remaining)) st.done = true;
+            continue;
+        }
+        // durations longer than an item can hold are split into several of them
+        uint32_t duration = st.remaining > RMT_TX_MAX_DURATION ? RMT_TX_MAX_DURATION : st.remaining;
+        st.remaining -= duration;
+        if (!half) {
+            dest[n].level0 = st.level;
+            dest[n].duration0 = duration;
+            half = true;
+        } else {
+            dest[n].level1 = st.level;
+            dest[n].duration1 = duration;
+            n++;
+            half = false;
+        }
+    }
+    if (half || (st.done && n == 0)) { // a zero duration is the end marker
+        if (!half) {
+            dest[n].level0 = 0;
+            dest[n].duration0 = 0;
+        }
+        dest[n].level1 = 0;
+        dest[n].duration1 = 0;
+        n++;
+    }
+    *item_num = n;
+    *translated_size = st.done ? src_size : 0;
+}
+
+static bool rmtTxInstall(gpio_num_t pin) {
+    rmt_config_t txconfig = RMT_DEFAULT_CONFIG_TX(pin, RMT_TX_CHANNEL);
+    txconfig.clk_div = RMT_CLK_DIV; // 1 tick = 1us
+    txconfig.mem_block_num = RMT_TX_MEM_BLOCKS;
+    txconfig.tx_config.idle_output_en = true;
+    txconfig.tx_config.idle_level = RMT_IDLE_LEVEL_LOW;
+    if (rmt_config(&txconfig) != ESP_OK) return false;
+    if (rmt_driver_install(RMT_TX_CHANNEL, 0, 0) != ESP_OK) return false;
+    if (rmt_translator_init(RMT_TX_CHANNEL, rmtTranslate) != ESP_OK) {
+        rmt_driver_uninstall(RMT_TX_CHANNEL);
+        return false;
+    }
+    return true;
+}
+
+static void rmtTxUninstall(gpio_num_t pin) {
+    rmt_driver_uninstall(RMT_TX_CHANNEL);
+    // gives the pin back to the GPIO matrix, for the bit-banged protocols
+    pinMode(pin, OUTPUT);
+    digitalWrite(pin, LOW);
+}
+
+// The dummy source of rmt_write_sample(), see rmtTranslate()
+static const uint8_t sample = 0;
+
+bool rmtTxPulses(gpio_num_t pin, const RmtPulseSource &next) {
+    if (!rmtTxInstall(pin)) return false;
+
+    RmtTxState state;
+    state.next = &next;
+    txState = &state;
+    // returns once the end marker was sent
+    rmt_write_sample(RMT_TX_CHANNEL, &sample, 1, true);
+    txState = nullptr;
+
+    rmtTxUninstall(pin);
+    return true;
+}
+
+bool rmtTxTimings(gpio_num_t pin, const int *timings, size_t count, int repeat) {
+    if (!timings || count == 0 || repeat < 1) return true;
+    size_t idx = 0;
+    int round = 0;
+    return rmtTxPulses(pin, [&](bool &level, uint32_t &duration) {
+        if (idx == count) { // the repetitions follow right after, without any gap
+            if (++round >= repeat) return false;
+            idx = 0;
+        }
+        int timing = timings[idx++];
+        level = timing >= 0;
+        duration = level ? timing : -timing;
+        return true;
+    });
+}
+
+bool RmtTxStream::begin(gpio_num_t pin, size_t chunk) {
+    end();
+    for (Buffer &buffer : _buffers) {
+        buffer.timings = (int *)(psramFound() ? ps_malloc(chunk * sizeof(int)) : malloc(chunk * sizeof(int)));
+        buffer.count = 0;
+        buffer.ready = false;
+    }
+    if (!_buffers[0].timings || !_buffers[1].timings || !rmtTxInstall(pin)) {
+        for (Buffer &buffer : _buffers) {
+            free(buffer.timings);
+            buffer.timings = nullptr;
+        }
+        return false;
+    }
+    _pin = pin;
+    _chunk = chunk;
+    _sending = 0;
+    _idx = 0;
+    _filling = 0;
+    _finished = false;
+    _started = false;
+    _underruns = 0;
+    _source = [this](bool &level, uint32_t &duration) { return nextPulse(level, duration); };
+    return true;
+}
+
+// Called from the RMT interrupt
+bool RmtTxStream::nextPulse(bool &level, uint32_t &duration) {
+    while (true) {
+        Buffer &buffer = _buffers[_sending];
+        if (!buffer.ready) {
+            if (_finished) return false;
+            level = false;
+            duration = RMT_TX_UNDERRUN_US;
+            _underruns++;
+            return true;
+        }
+        if (_idx == buffer.count) { // gives it back to write() and goes on with the other one
+            _idx = 0;
+            buffer.ready = false;
+            _sending ^= 1;
+            continue;
+        }
+        int timing = buffer.timings[_idx++];
+        level = timing >= 0;
+        duration = level ? timing : -timing;
+        return true;
+    }
+}
+
+void RmtTxStream::start() {
+    static RmtTxState state;
+    state = RmtTxState();
+    state.next = &_source;
+    txState = &state;
+    rmt_write_sample(RMT_TX_CHANNEL, &sample, 1, false);
+    _started = true;
+}
+
+void RmtTxStream::write(const int *timings, size_t count) {
+    if (!_buffers[0].timings || count == 0) return;
+    if (count > _chunk) count = _chunk;
+    Buffer &buffer = _buffers[_filling];
+    while (buffer.ready) vTaskDelay(1); // still being sent
+    memcpy(buffer.timings, timings, count * sizeof(int));
+    buffer.count = count;
+    buffer.ready = true;
+    _filling ^= 1;
+    // both buffers are queued before starting, so the first refill has a whole chunk of time
+    if (!_started && _filling == 0) start();
+}
+
+void RmtTxStream::end() {
+    if (!_buffers[0].timings) return;
+    _finished = true;
+    if (!_started && _buffers[0].ready) start();
+    if (_started) {
+        rmt_wait_tx_done(RMT_TX_CHANNEL, portMAX_DELAY);
+        txState = nullptr;
+    }
+    rmtTxUninstall(_pin);
+    if (_underruns) {
+        unsigned long lowUs = (unsigned long)_underruns * RMT_TX_UNDERRUN_US;
+        Serial.printf("RMT: %lu us of LOW waiting for timings\n", lowUs);
+    }
+    for (Buffer &buffer : _buffers) {
+        free(buffer.timings);
+        buffer.timings = nullptr;
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef __RMT_TX_H__
+#define __RMT_TX_H__
+
+#include "structs.h"
+#include <functional>
+
+#define RMT_TX_CHANNEL RMT_CHANNEL_2 // channel 0 (and 1) are used by FastLED on boards with RGB LEDs
+#define RMT_TX_MEM_BLOCKS 2          // 64 item blocks of RMT RAM, a half is refilled while the other is sent
+#define RMT_TX_MAX_DURATION 32767    // max ticks of a half item (15 bits)
+
+// Returns false when there are no more pulses. `level` true means HIGH, `duration` is in us
+typedef std::function<bool(bool &level, uint32_t &duration)> RmtPulseSource;
+
+/**
+ * @brief Transmits pulses through the RMT peripheral, without the jitter of bit-banging
+ *
+ * Pulses are converted to rmt_item32_t by the driver's translator, from its interrupt, each
+ * time half of the RMT RAM was sent, so signals of any length are streamed without the line
+ * going idle in between. `next` is called from that interrupt: it must be quick and must not
+ * block. Returns false if the RMT couldn't be set up, so the caller can fall back to bit-banging.
+ */
+bool rmtTxPulses(gpio_num_t pin, const RmtPulseSource &next);
+
+// Sends a list of timings (positive = HIGH, negative = LOW) `repeat` times back to back
+bool rmtTxTimings(gpio_num_t pin, const int *timings, size_t count, int repeat = 1);
+
+#define RMT_TX_UNDERRUN_US 100 // LOW sent while the next chunk of a stream isn't written yet
+
+/**
+ * @brief One RMT transmission fed with chunks of timings while it is sent
+ *
+ * The driver is installed once in begin() and the chunks are copied to two buffers: one is
+ * sent while the other is refilled by write(), so a signal read from a file in pieces goes out
+ * as a single one. If a chunk comes too late, the line stays LOW until it is written.
+ */
+class RmtTxStream {
+public:
+    ~RmtTxStream() { end(); }
+
+    // Returns false if the RMT or the buffers couldn't be set up, so the caller can bit-bang
+    bool begin(gpio_num_t pin, size_t chunk);
+    // Timings as in rmtTxTimings(), at most `chunk` of them. Waits for a free buffer
+    void write(const int *timings, size_t count);
+    // Waits for the end of the signal and releases the RMT
+    void end();
+
+private:
+    struct Buffer {
+        int *timings = nullptr;
+        volatile size_t count = 0;
+        volatile bool ready = false; // written and not fully sent yet
+    };
+
+    bool nextPulse(bool &level, uint32_t &duration);
+    void start();
+
+    gpio_num_t _pin = GPIO_NUM_NC;
+    size_t _chunk = 0;
+    Buffer _buffers[2];
+    uint8_t _sending = 0; // buffer read by the interrupt
+    size_t _idx = 0;
+    uint8_t _filling = 0; // next buffer written
+    volatile bool _finished = false;
+    bool _started = false;
+    uint32_t _underruns = 0;
+    RmtPulseSource _source;
+};
+
+#endif
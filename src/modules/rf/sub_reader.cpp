@@ -0,0 +1,115 @@
+#include "sub_reader.h"
+
+int SubReader::peek() {
+    if (_pos >= _len) {
+        _len = _file.read(_buf, sizeof(_buf));
+        _pos = 0;
+        if (_len == 0 || _len > sizeof(_buf)) {
+            _len = 0;
+            return -1;
+        }
+    }
+    return _buf[_pos];
+}
+
+int SubReader::next() {
+    int c = peek();
+    if (c >= 0) _pos++;
+    return c;
+}
+
+void SubReader::skipLine() {
+    int c;
+    do { c = next(); } while (c >= 0 && c != '\n');
+}
+
+bool SubReader::nextKey(char *key, size_t len) {
+    int c;
+    while (true) {
+        // skip blank lines and leading spaces
+        do { c = next(); } while (c == ' ' || c == '\t' || c == '\r' || c == '\n');
+        if (c < 0) return false;
+
+        size_t i = 0;
+        while (c >= 0 && c != ':' && c != '\n') {
+            if (i < len - 1) key[i++] = c;
+            c = next();
+        }
+        key[i] = '\0';
+        if (c == ':') return true;
+        if (c < 0) return false;
+        // line without a key, try the next one
+    }
+}
+
+void SubReader::readValue(char *value, size_t len) {
+    int c;
+    do { c = next(); } while (c == ' ' || c == '\t');
+
+    size_t i = 0;
+    while (c >= 0 && c != '\n') {
+        if (i < len - 1) value[i++] = c;
+        c = next();
+    }
+    while (i > 0 && (value[i - 1] == ' ' || value[i - 1] == '\t' || value[i - 1] == '\r')) i--;
+    value[i] = '\0';
+}
+
+void SubReader::readValue(String &value) {
+    value = "";
+    int c;
+    do { c = next(); } while (c == ' ' || c == '\t');
+    while (c >= 0 && c != '\n') {
+        if (c != '\r') value += (char)c;
+        c = next();
+    }
+    value.trim();
+}
+
+size_t SubReader::readTimings(int *timings, size_t cap, bool &lineDone) {
+    size_t n = 0;
+    lineDone = false;
+    while (n < cap) {
+        int c = peek();
+        while (c == ' ' || c == '\t' || c == '\r') {
+            _pos++;
+            c = peek();
+        }
+        if (c < 0 || c == '\n') {
+            if (c == '\n') _pos++;
+            lineDone = true;
+            break;
+        }
+
+        bool negative = false;
+        if (c == '-' || c == '+') {
+            negative = c == '-';
+            _pos++;
+            c = peek();
+        }
+        if (c < '0' || c > '9') { // not a number, ignore it
+            if (c >= 0 && c != '\n') _pos++;
+            continue;
+        }
+        int value = 0;
+        while (c >= '0' && c <= '9') {
+            value = value * 10 + (c - '0');
+            _pos++;
+            c = peek();
+        }
+        if (value) timings[n++] = negative ? -value : value; // 0 is the list terminator
+    }
+    // check if the line ends right after the last timing read
+    if (!lineDone) {
+        int c = peek();
+        while (c == ' ' || c == '\t' || c == '\r') {
+            _pos++;
+            c = peek();
+        }
+        if (c < 0 || c == '\n') {
+            if (c == '\n') _pos++;
+            lineDone = true;
+        }
+    }
+    return n;
+}
@@ -0,0 +1,47 @@
+#ifndef __SUB_READER_H__
+#define __SUB_READER_H__
+
+#include <FS.h>
+
+#define SUB_READER_BUFFER 512 // bytes read from the file at once
+
+/**
+ * @brief Streaming tokenizer for Flipper .sub files
+ *
+ * Reads the file through a small fixed buffer, so it never holds a full line in memory.
+ * RAW_Data values are parsed straight into the caller's timing buffer, that can be
+ * transmitted and reused chunk by chunk.
+ */
+class SubReader {
+public:
+    SubReader(File &file) : _file(file) {}
+
+    // Reads the next "Key:" of the file. Returns false at the end of the file
+    bool nextKey(char *key, size_t len);
+    // Reads the value of the current key, trimmed and truncated to len - 1 chars
+    void readValue(char *value, size_t len);
+    // Reads the value of the current key into a String (for values that need to be kept as text)
+    void readValue(String &value);
+    // Parses up to `cap` timings of the current line. `lineDone` is false if the line has more of them
+    size_t readTimings(int *timings, size_t cap, bool &lineDone);
+    void skipLine();
+
+    // Offset in the file of the next char to be read
+    size_t position() { return _file.position() - (_len - _pos); }
+    // Moves to `pos` dropping what is buffered
+    bool seek(size_t pos) {
+        _pos = _len = 0;
+        return _file.seek(pos);
+    }
+
+private:
+    int next();
+    int peek();
+
+    File &_file;
+    uint8_t _buf[SUB_READER_BUFFER];
+    size_t _pos = 0;
+    size_t _len = 0;
+};
+
+#endif
@@ -11,6 +11,7 @@
 #include "core/i2c_finder.h"
 #include "core/sd_functions.h"
 #include "core/type_convertion.h"
+#include "mifare_keys.h"
 
 PN532::PN532(bool use_i2c) {
     _use_i2c = use_i2c;
@@ -81,7 +82,10 @@ int PN532::erase() {
     if (!nfc.startPassiveTargetIDDetection()) return TAG_NOT_PRESENT;
     if (!nfc.readDetectedPassiveTargetID()) return FAILURE;
 
-    return erase_data_blocks();
+    mifareDictionary.beginCard(nfc.targetUid.uidByte, nfc.targetUid.size);
+    int result = erase_data_blocks();
+    mifareDictionary.endCard();
+    return result;
 }
 
 int PN532::write(int cardBaudRate) {
@@ -90,6 +94,7 @@ int PN532::write(int cardBaudRate) {
         if (!nfc.readDetectedPassiveTargetID()) return FAILURE;
 
         if (nfc.targetUid.sak != uid.sak) return TAG_NOT_MATCH;
+        mifareDictionary.beginCard(nfc.targetUid.uidByte, nfc.targetUid.size);
     } else {
         uint16_t sys_code = 0xFFFF; // Default sys code for FeliCa
         uint8_t req_code = 0x01;    // Default request code for FeliCa
@@ -99,7 +104,9 @@ int PN532::write(int cardBaudRate) {
         if (!nfc.felica_Polling(sys_code, req_code, idm, pmm, &sys_code_res)) { return TAG_NOT_PRESENT; }
     }
 
-    return write_data_blocks();
+    int result = write_data_blocks();
+    mifareDictionary.endCard();
+    return result;
 }
 
 int PN532::write_ndef() {
@@ -122,7 +129,7 @@ int PN532::load() {
 
     String line;
     String strData;
-    strAllPages = "";
+    image.clear();
     pageReadSuccess = true;
 
     while (file.available()) {
@@ -135,7 +142,7 @@ int PN532::load() {
         if (line.startsWith("ATQA:")) printableUID.atqa = strData;
         if (line.startsWith("Pages total:")) dataPages = strData.toInt();
         if (line.startsWith("Pages read:")) pageReadSuccess = false;
-        if (line.startsWith("Page ")) strAllPages += line + "\n";
+        image.parseLine(line.c_str()); // page and key lines, false for the others
     }
 
     file.close();
@@ -169,7 +176,7 @@ int PN532::save(String filename) {
         file.println("Blocks total: " + String(totalPages));
         file.println("Blocks read: " + String(dataPages));
     }
-    file.print(strAllPages);
+    image.toText([&](const char *line) { file.println(line); });
 
     file.close();
     delay(100);
@@ -247,10 +254,11 @@ void PN532::parse_data() {
 
 int PN532::read_data_blocks() {
     dataPages = 0;
+    dumpTime = 0;
     totalPages = 0;
     int readStatus = FAILURE;
 
-    strAllPages = "";
+    image.clear();
 
     if (printableUID.picc_type != "FeliCa") {
         switch (uid.sak) {
@@ -296,11 +304,23 @@ int PN532::read_mifare_classic_data_blocks() {
             break;
     }
 
-    if (no_of_sectors) {
-        for (int8_t i = 0; i < no_of_sectors; i++) {
+    if (no_of_sectors && image.begin(16, totalPages)) {
+        mifareDictionary.beginCard(uid.uidByte, uid.size);
+        int8_t i = 0;
+        for (; i < no_of_sectors; i++) {
             sectorReadStatus = read_mifare_classic_data_sector(i);
             if (sectorReadStatus != SUCCESS) break;
         }
+        MifareDumpStats stats = mifareDictionary.endCard();
+        dumpTime = max(stats.ms, 1UL);
+        Serial.printf(
+            "Mifare dump: %d/%d sectors in %lums, %lu auths (%lu with remembered keys)\n",
+            i,
+            no_of_sectors,
+            stats.ms,
+            (unsigned long)stats.auths,
+            (unsigned long)stats.cacheHits
+        );
     }
     return sectorReadStatus;
 }
@@ -321,90 +341,44 @@ int PN532::read_mifare_classic_data_sector(byte sector) {
 
     byte buffer[18];
     byte blockAddr;
-    String strPage;
 
-    int authStatus = authenticate_mifare_classic(firstBlock);
+    int authStatus = authenticate_mifare_classic(firstBlock, true);
     if (authStatus != SUCCESS) return authStatus;
 
     for (int8_t blockOffset = 0; blockOffset < no_of_blocks; blockOffset++) {
-        strPage = "";
         blockAddr = firstBlock + blockOffset;
 
         if (!nfc.mifareclassic_ReadDataBlock(blockAddr, buffer)) return FAILURE;
 
-        strPage = hexToStr(buffer, 16);
-
-        strAllPages += "Page " + String(dataPages) + ": " + strPage + "\n";
+        image.setPage(blockAddr, buffer);
         dataPages++;
     }
 
     return SUCCESS;
 }
 
-int PN532::authenticate_mifare_classic(byte block) {
-    uint8_t successA = 0;
-    uint8_t successB = 0;
-
-    for (auto key : keys) {
-        successA = nfc.mifareclassic_AuthenticateBlock(uid.uidByte, uid.size, block, 0, key);
-        if (successA) break;
-
-        if (!nfc.startPassiveTargetIDDetection() || !nfc.readDetectedPassiveTargetID()) {
-            return TAG_NOT_PRESENT;
+int PN532::authenticate_mifare_classic(byte block, bool keepKeys) {
+    byte sector = mifareSector(block);
+    auto tryKey = [&](uint8_t keyNumber, const uint8_t *k) {
+        if (nfc.mifareclassic_AuthenticateBlock(uid.uidByte, uid.size, block, keyNumber, (uint8_t *)k)) {
+            if (keepKeys) image.setKey(sector, keyNumber, k);
+            return 1;
         }
-    }
-
-    if (!successA) {
-        uint8_t keyA[6];
+        if (!nfc.startPassiveTargetIDDetection() || !nfc.readDetectedPassiveTargetID()) return -1;
+        return 0;
+    };
 
-        for (const auto &mifKey : bruceConfig.mifareKeys) {
-            for (size_t i = 0; i < mifKey.length(); i += 2) {
-                keyA[i / 2] = strtoul(mifKey.substring(i, i + 2).c_str(), NULL, 16);
-            }
-
-            successA = nfc.mifareclassic_AuthenticateBlock(uid.uidByte, uid.size, block, 0, keyA);
-            if (successA) break;
-
-            if (!nfc.startPassiveTargetIDDetection() || !nfc.readDetectedPassiveTargetID()) {
-                return TAG_NOT_PRESENT;
-            }
-        }
-    }
-
-    for (auto key : keys) {
-        successB = nfc.mifareclassic_AuthenticateBlock(uid.uidByte, uid.size, block, 1, key);
-        if (successB) break;
-
-        if (!nfc.startPassiveTargetIDDetection() || !nfc.readDetectedPassiveTargetID()) {
-            return TAG_NOT_PRESENT;
-        }
-    }
-
-    if (!successB) {
-        uint8_t keyB[6];
-
-        for (const auto &mifKey : bruceConfig.mifareKeys) {
-            for (size_t i = 0; i < mifKey.length(); i += 2) {
-                keyB[i / 2] = strtoul(mifKey.substring(i, i + 2).c_str(), NULL, 16);
-            }
-
-            successB = nfc.mifareclassic_AuthenticateBlock(uid.uidByte, uid.size, block, 1, keyB);
-            if (successB) break;
-
-            if (!nfc.startPassiveTargetIDDetection() || !nfc.readDetectedPassiveTargetID()) {
-                return TAG_NOT_PRESENT;
-            }
-        }
-    }
+    int foundA = mifareDictionary.findKey(sector, false, [&](const uint8_t *k) { return tryKey(0, k); });
+    if (foundA < 0) return TAG_NOT_PRESENT;
+    int foundB = mifareDictionary.findKey(sector, true, [&](const uint8_t *k) { return tryKey(1, k); });
+    if (foundB < 0) return TAG_NOT_PRESENT;
 
-    return (successA && successB) ? SUCCESS : TAG_AUTH_ERROR;
+    return (foundA && foundB) ? SUCCESS : TAG_AUTH_ERROR;
 }
 
 int PN532::read_mifare_ultralight_data_blocks() {
     uint8_t success;
     byte buffer[18];
-    byte i;
-    String strPage = "";
 
     uint8_t buf[4];
     nfc.mifareultralight_ReadPage(3, buf);
@@ -419,21 +393,13 @@ int PN532::read_mifare_ultralight_data_blocks() {
         default: totalPages = 64; break;
     }
 
+    if (!image.begin(4, totalPages)) return FAILURE;
     for (byte page = 0; page < totalPages; page += 4) {
         success = nfc.ntag2xx_ReadPage(page, buffer);
         if (!success) return FAILURE;
 
         for (byte offset = 0; offset < 4; offset++) {
-            strPage = "";
-            for (byte index = 0; index < 4; index++) {
-                i = 4 * offset + index;
-                strPage += buffer[i] < 0x10 ? F(" 0") : F(" ");
-                strPage += String(buffer[i], HEX);
-            }
-            strPage.trim();
-            strPage.toUpperCase();
-
-            strAllPages += "Page " + String(dataPages) + ": " + strPage + "\n";
+            image.setPage(page + offset, buffer + 4 * offset);
             dataPages++;
             if (dataPages >= totalPages) break;
         }
@@ -443,8 +409,8 @@ int PN532::read_mifare_ultralight_data_blocks() {
 }
 
 int PN532::read_felica_data() {
-    String strPage = "";
     totalPages = 14;
+    if (!image.begin(16, totalPages, "Block")) return FAILURE;
 
     for (uint16_t i = 0x8000; i < 0x8000 + totalPages; i++) {
         uint16_t block_list[1] = {i}; // Read the block i
@@ -454,109 +420,67 @@ int PN532::read_felica_data() {
         }; // Default service code for reading. Should works for every card
         int res = nfc.felica_ReadWithoutEncryption(1, default_service_code, 1, block_list, block_data);
 
-        for (size_t i = 0; i < 16; i++) {
-            if (res) { // If card block read successfully, copy data to string
-                strPage = hexToStr(block_data[0], 16);
-            }
-        }
-        if (res) { // If PN532 can't read the FeliCa tag, don't write the block to file
-            strAllPages += "Block " + String(dataPages++) + ": " + strPage + "\n";
+        // If PN532 can't read the FeliCa tag, the block is left out of the dump
+        if (res) {
+            image.setPage(i - 0x8000, block_data[0]);
+            dataPages++;
         }
-        strPage = ""; // Reset for the next block
     }
 
     return SUCCESS;
 }
 
 int PN532::write_data_blocks() {
-    String pageLine = "";
-    String strBytes = "";
-    int lineBreakIndex;
-    int pageIndex;
     bool blockWriteSuccess;
-    int totalSize = strAllPages.length();
-
-    Serial.println(strAllPages);
-    while (strAllPages.length() > 0) {
-        lineBreakIndex = strAllPages.indexOf("\n");
-        pageLine = strAllPages.substring(0, lineBreakIndex);
-        strAllPages = strAllPages.substring(lineBreakIndex + 1);
+    uint16_t pages = image.pages();
 
-        pageIndex = pageLine.substring(5, pageLine.indexOf(":")).toInt();
-        strBytes = pageLine.substring(pageLine.indexOf(":") + 1);
-        strBytes.trim();
-
-        if (pageIndex == 0) continue;
+    for (uint16_t pageIndex = 1; pageIndex < pages; pageIndex++) {
+        const uint8_t *data = image.page(pageIndex);
+        if (!data) continue;
 
         if (printableUID.picc_type != "FeliCa") {
             switch (uid.sak) {
                 case PICC_TYPE_MIFARE_MINI:
                 case PICC_TYPE_MIFARE_1K:
                 case PICC_TYPE_MIFARE_4K:
-                    if (pageIndex == 0 || (pageIndex + 1) % 4 == 0)
-                        continue; // Data blocks for MIFARE Classic
-                    blockWriteSuccess = write_mifare_classic_data_block(pageIndex, strBytes);
+                    if ((pageIndex + 1) % 4 == 0) continue; // Data blocks for MIFARE Classic
+                    blockWriteSuccess =
+                        image.pageSize() == 16 && write_mifare_classic_data_block(pageIndex, data);
                     break;
 
                 case PICC_TYPE_MIFARE_UL:
                     if (pageIndex < 4 || pageIndex >= dataPages - 5) continue; // Data blocks for NTAG21X
-                    blockWriteSuccess = write_mifare_ultralight_data_block(pageIndex, strBytes);
+                    blockWriteSuccess =
+                        image.pageSize() == 4 && write_mifare_ultralight_data_block(pageIndex, data);
                     break;
 
                 default: blockWriteSuccess = false; break;
             }
         } else {
-            blockWriteSuccess = write_felica_data_block(pageIndex, strBytes);
+            blockWriteSuccess = image.pageSize() == 16 && write_felica_data_block(pageIndex, data);
         }
 
         if (!blockWriteSuccess) return FAILURE;
 
-        progressHandler(totalSize - strAllPages.length(), totalSize, "Writing data blocks...");
+        progressHandler(pageIndex + 1, pages, "Writing data blocks...");
     }
 
     return SUCCESS;
 }
 
-bool PN532::write_mifare_classic_data_block(int block, String data) {
-    data.replace(" ", "");
-    byte size = data.length() / 2;
-    byte buffer[size];
-
-    if (size != 16) return false;
-
-    for (size_t i = 0; i < data.length(); i += 2) {
-        buffer[i / 2] = strtoul(data.substring(i, i + 2).c_str(), NULL, 16);
-    }
-
+bool PN532::write_mifare_classic_data_block(int block, const uint8_t *data) {
     if (authenticate_mifare_classic(block) != SUCCESS) return false;
 
-    return nfc.mifareclassic_WriteDataBlock(block, buffer);
+    return nfc.mifareclassic_WriteDataBlock(block, (uint8_t *)data);
 }
 
-bool PN532::write_mifare_ultralight_data_block(int block, String data) {
-    data.replace(" ", "");
-    byte size = data.length() / 2;
-    byte buffer[size];
-
-    if (size != 4) return false;
-
-    for (size_t i = 0; i < data.length(); i += 2) {
-        buffer[i / 2] = strtoul(data.substring(i, i + 2).c_str(), NULL, 16);
-    }
-
-    return nfc.ntag2xx_WritePage(block, buffer);
+bool PN532::write_mifare_ultralight_data_block(int block, const uint8_t *data) {
+    return nfc.ntag2xx_WritePage(block, (uint8_t *)data);
 }
 
-int PN532::write_felica_data_block(int block, String data) {
-    data.replace(" ", "");
-    byte size = data.length() / 2;
-    uint8_t block_data[1][16] = {0};
-
-    if (size != 16) { return false; }
-
-    for (size_t i = 0; i < data.length(); i += 2) {
-        block_data[0][i / 2] = strtoul(data.substring(i, i + 2).c_str(), NULL, 16);
-    }
+int PN532::write_felica_data_block(int block, const uint8_t *data) {
+    uint8_t block_data[1][16];
+    memcpy(block_data[0], data, 16);
 
     uint16_t block_list[1] = {(uint16_t)(block + 0x8000
     )}; // Write the block i. Block in FeliCa start from 0x8000
@@ -570,6 +494,8 @@ int PN532::write_felica_data_block(int block, String data) {
 
 int PN532::erase_data_blocks() {
     bool blockWriteSuccess;
+    const uint8_t zeros[16] = {0};
+    const uint8_t ndefEmpty[4] = {0x03, 0x00, 0xFE, 0x00};
 
     switch (uid.sak) {
         case PICC_TYPE_MIFARE_MINI:
@@ -577,19 +503,18 @@ int PN532::erase_data_blocks() {
         case PICC_TYPE_MIFARE_4K:
             for (byte i = 1; i < 64; i++) {
                 if ((i + 1) % 4 == 0) continue;
-                blockWriteSuccess =
-                    write_mifare_classic_data_block(i, "00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00");
+                blockWriteSuccess = write_mifare_classic_data_block(i, zeros);
                 if (!blockWriteSuccess) return FAILURE;
             }
             break;
 
         case PICC_TYPE_MIFARE_UL:
             // NDEF stardard
-            blockWriteSuccess = write_mifare_ultralight_data_block(4, "03 00 FE 00");
+            blockWriteSuccess = write_mifare_ultralight_data_block(4, ndefEmpty);
             if (!blockWriteSuccess) return FAILURE;
 
             for (byte i = 5; i < 130; i++) {
-                blockWriteSuccess = write_mifare_ultralight_data_block(i, "00 00 00 00");
+                blockWriteSuccess = write_mifare_ultralight_data_block(i, zeros);
                 if (!blockWriteSuccess) return FAILURE;
             }
             break;
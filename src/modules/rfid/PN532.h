@@ -66,17 +66,17 @@ private:
     int read_data_blocks();
     int read_mifare_classic_data_blocks();
     int read_mifare_classic_data_sector(byte sector);
-    int authenticate_mifare_classic(byte block);
+    int authenticate_mifare_classic(byte block, bool keepKeys = false);
     int read_mifare_ultralight_data_blocks();
 
     int write_data_blocks();
-    bool write_mifare_classic_data_block(int block, String data);
-    bool write_mifare_ultralight_data_block(int block, String data);
+    bool write_mifare_classic_data_block(int block, const uint8_t *data);
+    bool write_mifare_ultralight_data_block(int block, const uint8_t *data);
 
     int read_felica_data();
 
     int erase_data_blocks();
     int write_ndef_blocks();
 
-    int write_felica_data_block(int block, String data);
+    int write_felica_data_block(int block, const uint8_t *data);
 };
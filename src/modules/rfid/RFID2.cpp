@@ -10,6 +10,7 @@
 #include "core/display.h"
 #include "core/i2c_finder.h"
 #include "core/sd_functions.h"
+#include "mifare_keys.h"
 #include <MFRC522DriverI2C.h>
 #include <MFRC522DriverSPI.h>
 #include <MFRC522Hack.h>
@@ -81,7 +82,9 @@ int RFID2::clone() {
 int RFID2::erase() {
     if (!mfrc522.PICC_IsNewCardPresent() || !mfrc522.PICC_ReadCardSerial()) { return TAG_NOT_PRESENT; }
 
+    mifareDictionary.beginCard(mfrc522.uid.uidByte, mfrc522.uid.size);
     int result = erase_data_blocks();
+    mifareDictionary.endCard();
     mfrc522.PICC_HaltA();
     mfrc522.PCD_StopCrypto1();
     return result;
@@ -92,7 +95,9 @@ int RFID2::write(int cardBaudRate) {
 
     if (mfrc522.uid.sak != uid.sak) return TAG_NOT_MATCH;
 
+    mifareDictionary.beginCard(mfrc522.uid.uidByte, mfrc522.uid.size);
     int result = write_data_blocks();
+    mifareDictionary.endCard();
 
     mfrc522.PICC_HaltA();
     mfrc522.PCD_StopCrypto1();
@@ -122,7 +127,7 @@ int RFID2::load() {
 
     String line;
     String strData;
-    strAllPages = "";
+    image.clear();
     pageReadSuccess = true;
 
     while (file.available()) {
@@ -135,7 +140,7 @@ int RFID2::load() {
         if (line.startsWith("ATQA:")) printableUID.atqa = strData;
         if (line.startsWith("Pages total:")) dataPages = strData.toInt();
         if (line.startsWith("Pages read:")) pageReadSuccess = false;
-        if (line.startsWith("Page ")) strAllPages += line + "\n";
+        image.parseLine(line.c_str()); // page and key lines, false for the others
     }
 
     file.close();
@@ -170,7 +175,7 @@ int RFID2::save(String filename) {
     file.println("# Memory dump");
     file.println("Pages total: " + String(dataPages));
     if (!pageReadSuccess) file.println("Pages read: " + String(dataPages));
-    file.print(strAllPages);
+    image.toText([&](const char *line) { file.println(line); });
 
     file.close();
     delay(100);
@@ -245,10 +250,11 @@ void RFID2::parse_data() {
 
 int RFID2::read_data_blocks() {
     dataPages = 0;
+    dumpTime = 0;
     totalPages = 0;
     int readStatus = FAILURE;
     byte piccType = mfrc522.PICC_GetType(mfrc522.uid.sak);
-    strAllPages = "";
+    image.clear();
 
     switch (piccType) {
         case MFRC522::PICC_Type::PICC_TYPE_MIFARE_MINI:
@@ -294,11 +300,23 @@ int RFID2::read_mifare_classic_data_blocks(byte piccType) {
             break;
     }
 
-    if (no_of_sectors) {
-        for (int8_t i = 0; i < no_of_sectors; i++) {
+    if (no_of_sectors && image.begin(16, totalPages)) {
+        mifareDictionary.beginCard(mfrc522.uid.uidByte, mfrc522.uid.size);
+        int8_t i = 0;
+        for (; i < no_of_sectors; i++) {
             sectorReadStatus = read_mifare_classic_data_sector(i);
             if (sectorReadStatus != SUCCESS) break;
         }
+        MifareDumpStats stats = mifareDictionary.endCard();
+        dumpTime = max(stats.ms, 1UL);
+        Serial.printf(
+            "Mifare dump: %d/%d sectors in %lums, %lu auths (%lu with remembered keys)\n",
+            i,
+            no_of_sectors,
+            stats.ms,
+            (unsigned long)stats.auths,
+            (unsigned long)stats.cacheHits
+        );
     }
     mfrc522.PICC_HaltA();
     mfrc522.PCD_StopCrypto1();
@@ -323,106 +341,56 @@ int RFID2::read_mifare_classic_data_sector(byte sector) {
     byte byteCount;
     byte buffer[18];
     byte blockAddr;
-    String strPage;
 
-    int authStatus = authenticate_mifare_classic(firstBlock);
+    int authStatus = authenticate_mifare_classic(firstBlock, true);
     if (authStatus != SUCCESS) return authStatus;
 
     for (int8_t blockOffset = 0; blockOffset < no_of_blocks; blockOffset++) {
-        strPage = "";
         blockAddr = firstBlock + blockOffset;
         byteCount = sizeof(buffer);
 
         status = mfrc522.MIFARE_Read(blockAddr, buffer, &byteCount);
         if (status != MFRC522::StatusCode::STATUS_OK) { return FAILURE; }
 
-        for (byte index = 0; index < 16; index++) {
-            strPage += buffer[index] < 0x10 ? F(" 0") : F(" ");
-            strPage += String(buffer[index], HEX);
-        }
-
-        strPage.trim();
-        strPage.toUpperCase();
-
-        strAllPages += "Page " + String(dataPages) + ": " + strPage + "\n";
+        image.setPage(blockAddr, buffer);
         dataPages++;
     }
 
     return SUCCESS;
 }
 
-int RFID2::authenticate_mifare_classic(byte block) {
-    byte statusA = 0;
-    byte statusB = 0;
-
-    MFRC522::MIFARE_Key keyA;
-    MFRC522::MIFARE_Key keyB;
-
-    for (auto key : keys) {
-        memcpy(keyA.keyByte, key, 6);
-
-        statusA = mfrc522.PCD_Authenticate(
-            MFRC522::PICC_Command::PICC_CMD_MF_AUTH_KEY_A, block, &keyA, &mfrc522.uid
-        );
-        if (statusA == MFRC522::StatusCode::STATUS_OK) break;
-
-        if (!PICC_IsNewCardPresent() || !mfrc522.PICC_ReadCardSerial()) { return TAG_NOT_PRESENT; }
-    }
-
-    if (statusA != MFRC522::StatusCode::STATUS_OK) {
-        for (const auto &mifKey : bruceConfig.mifareKeys) {
-            for (size_t i = 0; i < mifKey.length(); i += 2) {
-                keyA.keyByte[i / 2] = strtoul(mifKey.substring(i, i + 2).c_str(), NULL, 16);
-            }
-
-            statusA = mfrc522.PCD_Authenticate(
-                MFRC522::PICC_Command::PICC_CMD_MF_AUTH_KEY_A, block, &keyA, &mfrc522.uid
-            );
-            if (statusA == MFRC522::StatusCode::STATUS_OK) break;
-
-            if (!PICC_IsNewCardPresent() || !mfrc522.PICC_ReadCardSerial()) { return TAG_NOT_PRESENT; }
+int RFID2::authenticate_mifare_classic(byte block, bool keepKeys) {
+    MFRC522::MIFARE_Key key;
+    byte sector = mifareSector(block);
+    auto tryKey = [&](MFRC522::PICC_Command command, const uint8_t *k) {
+        memcpy(key.keyByte, k, 6);
+        if (mfrc522.PCD_Authenticate(command, block, &key, &mfrc522.uid) == MFRC522::StatusCode::STATUS_OK) {
+            if (keepKeys) image.setKey(sector, command == MFRC522::PICC_Command::PICC_CMD_MF_AUTH_KEY_B, k);
+            return 1;
         }
-    }
-
-    for (auto key : keys) {
-        memcpy(keyB.keyByte, key, 6);
-
-        statusB = mfrc522.PCD_Authenticate(
-            MFRC522::PICC_Command::PICC_CMD_MF_AUTH_KEY_B, block, &keyB, &mfrc522.uid
-        );
-        if (statusB == MFRC522::StatusCode::STATUS_OK) break;
-
-        if (!PICC_IsNewCardPresent() || !mfrc522.PICC_ReadCardSerial()) { return TAG_NOT_PRESENT; }
-    }
-
-    if (statusB != MFRC522::StatusCode::STATUS_OK) {
-        for (const auto &mifKey : bruceConfig.mifareKeys) {
-            for (size_t i = 0; i < mifKey.length(); i += 2) {
-                keyB.keyByte[i / 2] = strtoul(mifKey.substring(i, i + 2).c_str(), NULL, 16);
-            }
-
-            statusB = mfrc522.PCD_Authenticate(
-                MFRC522::PICC_Command::PICC_CMD_MF_AUTH_KEY_A, block, &keyB, &mfrc522.uid
-            );
-            if (statusB == MFRC522::StatusCode::STATUS_OK) break;
-
-            if (!PICC_IsNewCardPresent() || !mfrc522.PICC_ReadCardSerial()) { return TAG_NOT_PRESENT; }
-        }
-    }
-
-    return (statusA == MFRC522::StatusCode::STATUS_OK && statusB == MFRC522::StatusCode::STATUS_OK)
-               ? SUCCESS
-               : TAG_AUTH_ERROR;
+        if (!PICC_IsNewCardPresent() || !mfrc522.PICC_ReadCardSerial()) return -1;
+        return 0;
+    };
+
+    int foundA = mifareDictionary.findKey(sector, false, [&](const uint8_t *k) {
+        return tryKey(MFRC522::PICC_Command::PICC_CMD_MF_AUTH_KEY_A, k);
+    });
+    if (foundA < 0) return TAG_NOT_PRESENT;
+    int foundB = mifareDictionary.findKey(sector, true, [&](const uint8_t *k) {
+        return tryKey(MFRC522::PICC_Command::PICC_CMD_MF_AUTH_KEY_B, k);
+    });
+    if (foundB < 0) return TAG_NOT_PRESENT;
+
+    return (foundA && foundB) ? SUCCESS : TAG_AUTH_ERROR;
 }
 
 int RFID2::read_mifare_ultralight_data_blocks() {
     byte status;
     byte byteCount;
     byte buffer[18];
-    byte i;
     byte cc;
-    String strPage = "";
 
+    if (!image.begin(4, 0)) return FAILURE;
     for (byte page = 0; page <= 252; page += 4) {
         byteCount = sizeof(buffer);
         status = mfrc522.MIFARE_Read(page, buffer, &byteCount);
@@ -430,7 +398,6 @@ int RFID2::read_mifare_ultralight_data_blocks() {
             return status == MFRC522::StatusCode::STATUS_MIFARE_NACK ? SUCCESS : FAILURE;
         }
         for (byte offset = 0; offset < 4; offset++) {
-            strPage = "";
             if (page + offset == 3) {
                 cc = buffer[4 * offset + 2];
                 switch (cc) {
@@ -443,15 +410,7 @@ int RFID2::read_mifare_ultralight_data_blocks() {
                     default: break;
                 }
             }
-            for (byte index = 0; index < 4; index++) {
-                i = 4 * offset + index;
-                strPage += buffer[i] < 0x10 ? F(" 0") : F(" ");
-                strPage += String(buffer[i], HEX);
-            }
-            strPage.trim();
-            strPage.toUpperCase();
-
-            strAllPages += "Page " + String(dataPages) + ": " + strPage + "\n";
+            image.setPage(page + offset, buffer + 4 * offset);
             dataPages++;
         }
     }
@@ -461,35 +420,26 @@ int RFID2::read_mifare_ultralight_data_blocks() {
 
 int RFID2::write_data_blocks() {
     byte piccType = mfrc522.PICC_GetType(mfrc522.uid.sak);
-    String pageLine = "";
-    String strBytes = "";
-    int lineBreakIndex;
-    int pageIndex;
     bool blockWriteSuccess;
-    int totalSize = strAllPages.length();
-
-    while (strAllPages.length() > 0) {
-        lineBreakIndex = strAllPages.indexOf("\n");
-        pageLine = strAllPages.substring(0, lineBreakIndex);
-        strAllPages = strAllPages.substring(lineBreakIndex + 1);
+    uint16_t pages = image.pages();
 
-        pageIndex = pageLine.substring(5, pageLine.indexOf(":")).toInt();
-        strBytes = pageLine.substring(pageLine.indexOf(":") + 1);
-        strBytes.trim();
-
-        if (pageIndex == 0) continue;
+    for (uint16_t pageIndex = 1; pageIndex < pages; pageIndex++) {
+        const uint8_t *data = image.page(pageIndex);
+        if (!data) continue;
 
         switch (piccType) {
             case MFRC522::PICC_Type::PICC_TYPE_MIFARE_MINI:
             case MFRC522::PICC_Type::PICC_TYPE_MIFARE_1K:
             case MFRC522::PICC_Type::PICC_TYPE_MIFARE_4K:
-                if (pageIndex == 0 || (pageIndex + 1) % 4 == 0) continue; // Data blocks for MIFARE Classic
-                blockWriteSuccess = write_mifare_classic_data_block(pageIndex, strBytes);
+                if ((pageIndex + 1) % 4 == 0) continue; // Data blocks for MIFARE Classic
+                blockWriteSuccess =
+                    image.pageSize() == 16 && write_mifare_classic_data_block(pageIndex, data);
                 break;
 
             case MFRC522::PICC_Type::PICC_TYPE_MIFARE_UL:
                 if (pageIndex < 4 || pageIndex >= dataPages - 5) continue; // Data blocks for NTAG21X
-                blockWriteSuccess = write_mifare_ultralight_data_block(pageIndex, strBytes);
+                blockWriteSuccess =
+                    image.pageSize() == 4 && write_mifare_ultralight_data_block(pageIndex, data);
                 break;
 
             default: blockWriteSuccess = false; break;
@@ -497,39 +447,23 @@ int RFID2::write_data_blocks() {
 
         if (!blockWriteSuccess) return FAILURE;
 
-        progressHandler(totalSize - strAllPages.length(), totalSize, "Writing data blocks...");
+        progressHandler(pageIndex + 1, pages, "Writing data blocks...");
     }
 
     return SUCCESS;
 }
 
-bool RFID2::write_mifare_classic_data_block(int block, String data) {
-    data.replace(" ", "");
-    byte size = data.length() / 2;
-    byte buffer[size];
-
-    for (size_t i = 0; i < data.length(); i += 2) {
-        buffer[i / 2] = strtoul(data.substring(i, i + 2).c_str(), NULL, 16);
-    }
-
+bool RFID2::write_mifare_classic_data_block(int block, const uint8_t *data) {
     if (authenticate_mifare_classic(block) != SUCCESS) return false;
 
-    byte status = mfrc522.MIFARE_Write((byte)block, buffer, size);
+    byte status = mfrc522.MIFARE_Write((byte)block, (byte *)data, 16);
     if (status != MFRC522::StatusCode::STATUS_OK) return false;
 
     return true;
 }
 
-bool RFID2::write_mifare_ultralight_data_block(int block, String data) {
-    data.replace(" ", "");
-    byte size = data.length() / 2;
-    byte buffer[size];
-
-    for (size_t i = 0; i < data.length(); i += 2) {
-        buffer[i / 2] = strtoul(data.substring(i, i + 2).c_str(), NULL, 16);
-    }
-
-    byte status = mfrc522.MIFARE_Ultralight_Write((byte)block, buffer, size);
+bool RFID2::write_mifare_ultralight_data_block(int block, const uint8_t *data) {
+    byte status = mfrc522.MIFARE_Ultralight_Write((byte)block, (byte *)data, 4);
     if (status != MFRC522::StatusCode::STATUS_OK) return false;
 
     return true;
@@ -538,6 +472,8 @@ bool RFID2::write_mifare_ultralight_data_block(int block, String data) {
 int RFID2::erase_data_blocks() {
     byte piccType = mfrc522.PICC_GetType(mfrc522.uid.sak);
     bool blockWriteSuccess;
+    const uint8_t zeros[16] = {0};
+    const uint8_t ndefEmpty[4] = {0x03, 0x00, 0xFE, 0x00};
 
     switch (piccType) {
         case MFRC522::PICC_Type::PICC_TYPE_MIFARE_MINI:
@@ -545,19 +481,18 @@ int RFID2::erase_data_blocks() {
         case MFRC522::PICC_Type::PICC_TYPE_MIFARE_4K:
             for (byte i = 1; i < 64; i++) {
                 if ((i + 1) % 4 == 0) continue;
-                blockWriteSuccess =
-                    write_mifare_classic_data_block(i, "00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00");
+                blockWriteSuccess = write_mifare_classic_data_block(i, zeros);
                 if (!blockWriteSuccess) return FAILURE;
             }
             break;
 
         case MFRC522::PICC_Type::PICC_TYPE_MIFARE_UL:
             // NDEF stardard
-            blockWriteSuccess = write_mifare_ultralight_data_block(4, "03 00 FE 00");
+            blockWriteSuccess = write_mifare_ultralight_data_block(4, ndefEmpty);
             if (!blockWriteSuccess) return FAILURE;
 
             for (byte i = 5; i < 130; i++) {
-                blockWriteSuccess = write_mifare_ultralight_data_block(i, "00 00 00 00");
+                blockWriteSuccess = write_mifare_ultralight_data_block(i, zeros);
                 if (!blockWriteSuccess) return FAILURE;
             }
             break;
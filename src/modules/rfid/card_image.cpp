@@ -0,0 +1,163 @@
+#include "card_image.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+// "AA BB CC", upper case. Returns the end of the text
+static char *formatHex(char *out, const uint8_t *bytes, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (i) *out++ = ' ';
+        *out++ = HEX_DIGITS[bytes[i] >> 4];
+        *out++ = HEX_DIGITS[bytes[i] & 0x0F];
+    }
+    *out = '\0';
+    return out;
+}
+
+// Bytes of "AA BB CC" or "AABBCC", up to `max`. -1 on anything else
+static int parseHex(const char *text, uint8_t *bytes, size_t max) {
+    size_t count = 0;
+    int digits = 0;
+    for (; *text && *text != '\r' && *text != '\n'; text++) {
+        if (*text == ' ' || *text == '\t') continue;
+        if (!isxdigit((uint8_t)*text)) return -1;
+        int v = isdigit((uint8_t)*text) ? *text - '0' : toupper((uint8_t)*text) - 'A' + 10;
+        if (digits % 2 == 0) {
+            if (count == max) return -1;
+            bytes[count++] = v << 4;
+        } else {
+            bytes[count - 1] |= v;
+        }
+        digits++;
+    }
+    return digits % 2 ? -1 : (int)count;
+}
+
+// Number after `prefix` and before ':', the rest of the line goes to `rest`
+static bool parseIndex(const char *line, const char *prefix, long &index, const char *&rest) {
+    size_t len = strlen(prefix);
+    if (strncmp(line, prefix, len) != 0 || !isdigit((uint8_t)line[len])) return false;
+    char *end;
+    index = strtol(line + len, &end, 10);
+    while (*end == ' ') end++;
+    if (*end != ':') return false;
+    rest = end + 1;
+    return true;
+}
+
+bool CardImage::allocate() {
+    if (!_store) _store = (Storage *)malloc(sizeof(Storage));
+    if (!_store) return false;
+    memset(_store, 0, sizeof(Storage));
+    return true;
+}
+
+bool CardImage::begin(uint8_t pageSize, uint16_t pages, const char *label) {
+    clear();
+    if (pageSize == 0 || CARD_IMAGE_BYTES % pageSize != 0 || !allocate()) return false;
+    _pageSize = pageSize;
+    _pages = pages < capacity() ? pages : capacity();
+    _label = label;
+    return true;
+}
+
+void CardImage::clear() {
+    free(_store);
+    _store = nullptr;
+    _label = "Page";
+    _pageSize = 0;
+    _pages = 0;
+    _pagesRead = 0;
+}
+
+bool CardImage::isRead(uint16_t page) const {
+    return _store && page < capacity() && (_store->read[page / 8] >> (page % 8) & 1);
+}
+
+const uint8_t *CardImage::page(uint16_t page) const {
+    return isRead(page) ? _store->data + page * _pageSize : nullptr;
+}
+
+bool CardImage::setPage(uint16_t page, const uint8_t *data) {
+    if (!_store || page >= capacity()) return false;
+    memcpy(_store->data + page * _pageSize, data, _pageSize);
+    if (!isRead(page)) {
+        _store->read[page / 8] |= 1 << (page % 8);
+        _pagesRead++;
+    }
+    if (page >= _pages) _pages = page + 1;
+    return true;
+}
+
+const uint8_t *CardImage::key(uint8_t sector, bool keyB) const {
+    if (!_store || sector >= CARD_IMAGE_SECTORS) return nullptr;
+    int bit = sector * 2 + keyB;
+    return (_store->keyKnown[bit / 8] >> (bit % 8) & 1) ? _store->keys[sector][keyB] : nullptr;
+}
+
+void CardImage::setKey(uint8_t sector, bool keyB, const uint8_t *key) {
+    if (!_store || sector >= CARD_IMAGE_SECTORS) return;
+    int bit = sector * 2 + keyB;
+    memcpy(_store->keys[sector][keyB], key, 6);
+    _store->keyKnown[bit / 8] |= 1 << (bit % 8);
+}
+
+uint32_t CardImage::checksum() const {
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (uint16_t p = 0; p < _pages; p++) {
+        const uint8_t *data = page(p);
+        if (!data) continue;
+        hash = (hash ^ (p & 0xFF)) * 16777619u;
+        hash = (hash ^ (p >> 8)) * 16777619u;
+        for (uint8_t i = 0; i < _pageSize; i++) hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+void CardImage::toText(std::function<void(const char *line)> emit) const {
+    char line[CARD_IMAGE_LINE];
+    for (uint16_t p = 0; p < _pages; p++) {
+        const uint8_t *data = page(p);
+        if (!data) continue;
+        int n = snprintf(line, sizeof(line), "%s %u: ", _label, p);
+        formatHex(line + n, data, _pageSize);
+        emit(line);
+    }
+    for (uint8_t sector = 0; sector < CARD_IMAGE_SECTORS; sector++) {
+        for (uint8_t b = 0; b < 2; b++) {
+            const uint8_t *k = key(sector, b);
+            if (!k) continue;
+            int n = snprintf(line, sizeof(line), "Key %c %u: ", b ? 'B' : 'A', sector);
+            formatHex(line + n, k, 6);
+            emit(line);
+        }
+    }
+}
+
+bool CardImage::parseLine(const char *line) {
+    long index;
+    const char *rest;
+    uint8_t bytes[16];
+
+    if (parseIndex(line, "Key A ", index, rest) || parseIndex(line, "Key B ", index, rest)) {
+        if (!_store || index < 0 || index >= CARD_IMAGE_SECTORS) return false;
+        if (parseHex(rest, bytes, 6) != 6) return false;
+        setKey(index, line[4] == 'B', bytes);
+        return true;
+    }
+
+    const char *label = "Page";
+    if (!parseIndex(line, "Page ", index, rest)) {
+        label = "Block";
+        if (!parseIndex(line, "Block ", index, rest)) return false;
+    }
+    int size = parseHex(rest, bytes, sizeof(bytes));
+    if (size != 4 && size != 16) return false;
+    // the first page tells the page size
+    if (!_store && !begin(size, 0, label)) return false;
+    if (size != _pageSize || index < 0 || index >= capacity()) return false;
+    return setPage(index, bytes);
+}
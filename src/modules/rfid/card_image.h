@@ -0,0 +1,71 @@
+#ifndef __CARD_IMAGE_H__
+#define __CARD_IMAGE_H__
+
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CARD_IMAGE_BYTES 4096 // Mifare Classic 4K, the biggest card read
+#define CARD_IMAGE_SECTORS 40
+#define CARD_IMAGE_LINE 64    // longest .rfid line: "Block 255: " and 16 bytes in hex
+
+/**
+ * @brief Binary image of the memory of a card: pages, which of them were read and the keys that opened
+ * each Mifare Classic sector
+ *
+ * This is what readers fill and writers take, hex only comes in when the image goes to or from the text of
+ * a .rfid file, through toText() and parseLine(). It only needs the C library so it can be built on a host.
+ * The storage is allocated by begin(), or by the first page parsed, and freed by clear().
+ */
+class CardImage {
+public:
+    CardImage() {}
+    ~CardImage() { clear(); }
+    CardImage(const CardImage &) = delete;
+    CardImage &operator=(const CardImage &) = delete;
+
+    // Empties the image for a card of `pages` pages of pageSize bytes (4 or 16). label names the pages in
+    // the text: "Page", or "Block" for FeliCa
+    bool begin(uint8_t pageSize, uint16_t pages, const char *label = "Page");
+    void clear();
+
+    uint8_t pageSize() const { return _pageSize; }
+    // Pages of the card, or up to the last one read when that is further
+    uint16_t pages() const { return _pages; }
+    uint16_t pagesRead() const { return _pagesRead; }
+    bool isRead(uint16_t page) const;
+    // pageSize() bytes, nullptr when the page wasn't read
+    const uint8_t *page(uint16_t page) const;
+    bool setPage(uint16_t page, const uint8_t *data);
+
+    // 6 bytes, nullptr when unknown
+    const uint8_t *key(uint8_t sector, bool keyB) const;
+    void setKey(uint8_t sector, bool keyB, const uint8_t *key);
+
+    // Of the pages read and their content, to tell two dumps apart
+    uint32_t checksum() const;
+
+    // .rfid lines: "Page 4: 01 02 03 04" for each page read, then "Key A 2: FF FF FF FF FF FF" for each key
+    void toText(std::function<void(const char *line)> emit) const;
+    // Reads a page or key line of a .rfid file. False for the other lines
+    bool parseLine(const char *line);
+
+private:
+    struct Storage {
+        uint8_t data[CARD_IMAGE_BYTES];
+        uint8_t read[CARD_IMAGE_BYTES / 4 / 8]; // a bit per page, 4 byte pages at most
+        uint8_t keys[CARD_IMAGE_SECTORS][2][6];
+        uint8_t keyKnown[(CARD_IMAGE_SECTORS * 2 + 7) / 8];
+    };
+
+    bool allocate();
+    uint16_t capacity() const { return _pageSize ? CARD_IMAGE_BYTES / _pageSize : 0; }
+
+    Storage *_store = nullptr;
+    const char *_label = "Page";
+    uint8_t _pageSize = 0;
+    uint16_t _pages = 0;
+    uint16_t _pagesRead = 0;
+};
+
+#endif
@@ -617,27 +617,17 @@ void Chameleon::emulateHF() {
         return setMode(BATTERY_INFO_MODE);
     }
 
+    static const char hexDigits[] = "0123456789ABCDEF";
     String strDump = "";
-    String strData = "";
-    String line = "";
-    int startIndex = 0;
-    int finalIndex;
-
-    while (true) {
-        finalIndex = strAllPages.indexOf("\n", startIndex);
-        if (finalIndex == -1) finalIndex = strAllPages.length();
-
-        line = strAllPages.substring(startIndex, finalIndex);
-        if (line.length() < 5) break;
-
-        strData = line.substring(line.indexOf(":") + 1);
-        strData.trim();
-        strDump += strData;
-
-        startIndex = finalIndex + 1;
+    strDump.reserve(image.pagesRead() * image.pageSize() * 2);
+    for (uint16_t page = 0; page < image.pages(); page++) {
+        const uint8_t *data = image.page(page);
+        if (!data) continue;
+        for (uint8_t i = 0; i < image.pageSize(); i++) {
+            strDump += hexDigits[data[i] >> 4];
+            strDump += hexDigits[data[i] & 0x0F];
+        }
     }
-    strDump.trim();
-    strDump.replace(" ", "");
 
     uint8_t slot = selectSlot();
 
@@ -710,7 +700,7 @@ bool Chameleon::readFileHF() {
 
     String line;
     String strData;
-    strAllPages = "";
+    image.clear();
     pageReadSuccess = true;
 
     while (file.available()) {
@@ -723,7 +713,7 @@ bool Chameleon::readFileHF() {
         if (line.startsWith("ATQA:")) printableHFUID.atqa = strData;
         if (line.startsWith("Pages total:")) dataPages = strData.toInt();
         if (line.startsWith("Pages read:")) pageReadSuccess = false;
-        if (line.startsWith("Page ")) strAllPages += line + "\n";
+        image.parseLine(line.c_str()); // page and key lines, false for the others
     }
 
     file.close();
@@ -758,7 +748,7 @@ bool Chameleon::writeFileHF(String filename) {
     file.println("# Memory dump");
     file.println("Pages total: " + String(dataPages));
     if (!pageReadSuccess) file.println("Pages read: " + String(dataPages));
-    file.print(strAllPages);
+    image.toText([&](const char *line) { file.println(line); });
 
     file.close();
     delay(100);
@@ -769,7 +759,7 @@ bool Chameleon::readHFDataBlocks() {
     dataPages = 0;
     totalPages = 0;
     bool readSuccess = false;
-    strAllPages = "";
+    image.clear();
 
     switch (chmUltra.hfTagData.sak) {
         case 0x08:
@@ -811,20 +801,13 @@ bool Chameleon::readMifareClassicDataBlocks(uint8_t *key) {
             break;
     }
 
-    String strPage;
+    if (!image.begin(16, totalPages)) return false;
 
-    for (byte i = 0; i < totalPages; i++) {
+    for (int i = 0; i < totalPages; i++) {
         if (!chmUltra.cmdMfReadBlock(i, key)) return false;
+        if (chmUltra.cmdResponse.dataSize < image.pageSize()) return false;
 
-        strPage = "";
-        for (byte index = 0; index < chmUltra.cmdResponse.dataSize; index++) {
-            strPage += chmUltra.cmdResponse.data[index] < 0x10 ? F(" 0") : F(" ");
-            strPage += String(chmUltra.cmdResponse.data[index], HEX);
-        }
-        strPage.trim();
-        strPage.toUpperCase();
-
-        strAllPages += "Page " + String(dataPages) + ": " + strPage + "\n";
+        image.setPage(i, chmUltra.cmdResponse.data);
         dataPages++;
     }
 
@@ -832,8 +815,6 @@ bool Chameleon::readMifareClassicDataBlocks(uint8_t *key) {
 }
 
 bool Chameleon::readMifareUltralightDataBlocks() {
-    String strPage;
-
     ChameleonUltra::TagType tagType = chmUltra.getTagType(chmUltra.hfTagData.sak);
 
     switch (tagType) {
@@ -847,19 +828,14 @@ bool Chameleon::readMifareUltralightDataBlocks() {
         default: totalPages = 256; break;
     }
 
-    for (byte i = 0; i < totalPages; i++) {
+    if (!image.begin(4, totalPages)) return false;
+
+    for (int i = 0; i < totalPages; i++) {
         if (!chmUltra.cmdMfuReadPage(i)) return false;
         if (chmUltra.cmdResponse.dataSize == 0) break;
+        if (chmUltra.cmdResponse.dataSize < image.pageSize()) return false;
 
-        strPage = "";
-        for (byte index = 0; index < chmUltra.cmdResponse.dataSize; index++) {
-            strPage += chmUltra.cmdResponse.data[index] < 0x10 ? F(" 0") : F(" ");
-            strPage += String(chmUltra.cmdResponse.data[index], HEX);
-        }
-        strPage.trim();
-        strPage.toUpperCase();
-
-        strAllPages += "Page " + String(dataPages) + ": " + strPage + "\n";
+        image.setPage(i, chmUltra.cmdResponse.data);
         dataPages++;
     }
 
@@ -867,43 +843,26 @@ bool Chameleon::readMifareUltralightDataBlocks() {
 }
 
 bool Chameleon::writeHFDataBlocks() {
-    String pageLine = "";
-    String strBytes = "";
-    int lineBreakIndex;
-    int pageIndex;
     bool blockWriteSuccess;
-    int totalSize = strAllPages.length();
+    uint16_t pages = image.pages();
+    uint8_t size = image.pageSize();
 
-    while (strAllPages.length() > 0) {
-        lineBreakIndex = strAllPages.indexOf("\n");
-        pageLine = strAllPages.substring(0, lineBreakIndex);
-        strAllPages = strAllPages.substring(lineBreakIndex + 1);
-
-        pageIndex = pageLine.substring(5, pageLine.indexOf(":")).toInt();
-        strBytes = pageLine.substring(pageLine.indexOf(":") + 1);
-        strBytes.trim();
-        strBytes.replace(" ", "");
-
-        if (pageIndex == 0) continue;
-
-        byte size = strBytes.length() / 2;
-        byte buffer[size];
-        for (size_t i = 0; i < strBytes.length(); i += 2) {
-            buffer[i / 2] = strtoul(strBytes.substring(i, i + 2).c_str(), NULL, 16);
-        }
+    for (uint16_t pageIndex = 1; pageIndex < pages; pageIndex++) {
+        const uint8_t *data = image.page(pageIndex);
+        if (!data) continue;
 
         blockWriteSuccess = false;
         if (isMifareClassic(chmUltra.hfTagData.sak)) {
-            if (pageIndex == 0 || (pageIndex + 1) % 4 == 0) continue; // Data blocks for MIFARE Classic
-            blockWriteSuccess = chmUltra.cmdMfWriteBlock(pageIndex, {}, buffer, size);
+            if ((pageIndex + 1) % 4 == 0) continue; // Data blocks for MIFARE Classic
+            blockWriteSuccess = chmUltra.cmdMfWriteBlock(pageIndex, {}, (uint8_t *)data, size);
         } else if (chmUltra.hfTagData.sak == 0x00) {
             if (pageIndex < 4 || pageIndex >= dataPages - 5) continue; // Data blocks for NTAG21X
-            blockWriteSuccess = chmUltra.cmdMfuWritePage(pageIndex, buffer, size);
+            blockWriteSuccess = chmUltra.cmdMfuWritePage(pageIndex, (uint8_t *)data, size);
         }
 
         if (!blockWriteSuccess) return false;
 
-        progressHandler(totalSize - strAllPages.length(), totalSize, "Writing data blocks...");
+        progressHandler(pageIndex + 1, pages, "Writing data blocks...");
     }
 
     return true;
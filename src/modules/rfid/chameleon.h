@@ -9,6 +9,7 @@
 #ifndef __CHAMELEON_H__
 #define __CHAMELEON_H__
 
+#include "card_image.h"
 #include <chameleonUltra.h>
 #include <set>
 
@@ -81,7 +82,7 @@ private:
     bool _battery_set = false;
     bool pageReadSuccess = false;
     uint32_t _lastReadTime = 0;
-    String strAllPages = "";
+    CardImage image;
     int totalPages = 0;
     int dataPages = 0;
     std::set<String> _scanned_set;
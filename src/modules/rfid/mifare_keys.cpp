@@ -0,0 +1,249 @@
+#include "mifare_keys.h"
+#include "core/sd_functions.h"
+#include <algorithm>
+#include <globals.h>
+#include <vector>
+
+#define MIFARE_KEY_READ 512 // bytes read from the key file at once
+
+MifareDictionary mifareDictionary;
+
+static const uint8_t defaultKeys[][6] = {
+    {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},
+    {0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5},
+    {0xB0, 0xB1, 0xB2, 0xB3, 0xB4, 0xB5},
+    {0x4D, 0x3A, 0x99, 0xC3, 0x51, 0xDD},
+    {0x1A, 0x98, 0x2C, 0x7E, 0x45, 0x9A},
+    {0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF},
+    {0x71, 0x4C, 0x5C, 0x88, 0x6E, 0x97},
+    {0x58, 0x7E, 0xE5, 0xF9, 0x35, 0x0F},
+    {0xA0, 0x47, 0x8C, 0xC3, 0x90, 0x91},
+    {0x53, 0x3C, 0xB6, 0xC7, 0x23, 0xF6},
+    {0x8F, 0xD0, 0xA4, 0xF2, 0x56, 0xE9},
+    {0xA6, 0x45, 0x98, 0xA7, 0x74, 0x78},
+    {0x26, 0x94, 0x0B, 0x21, 0xFF, 0x5D},
+    {0xFC, 0x00, 0x01, 0x87, 0x78, 0xF7},
+    {0x00, 0x00, 0x0F, 0xFE, 0x24, 0x88}
+};
+#define DEFAULT_KEYS (sizeof(defaultKeys) / sizeof(defaultKeys[0]))
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    c = toupper((uint8_t)c);
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// 12 hex digits, spaces and ':' between them are allowed
+static bool parseKey(const char *text, size_t len, uint8_t *key) {
+    int digits = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (text[i] == ' ' || text[i] == '\t' || text[i] == ':' || text[i] == '\r') continue;
+        int v = hexDigit(text[i]);
+        if (v < 0 || digits == 12) return false;
+        key[digits / 2] = digits % 2 ? key[digits / 2] | v : v << 4;
+        digits++;
+    }
+    return digits == 12;
+}
+
+static FS *keyFileFs() {
+    if (sdcardMounted && SD.exists(MIFARE_KEY_FILE)) return &SD;
+    if (LittleFS.exists(MIFARE_KEY_FILE)) return &LittleFS;
+    return nullptr;
+}
+
+bool MifareDictionary::add(const uint8_t *key) {
+    if (_count >= _capacity) return false;
+    memcpy(_keys + _count * 6, key, 6);
+    _count++;
+    return true;
+}
+
+void MifareDictionary::load() {
+    FS *fs = keyFileFs();
+    File file;
+    if (fs) file = fs->open(MIFARE_KEY_FILE, FILE_READ);
+    size_t fileSize = file ? file.size() : 0;
+    if (_loaded && _configKeys == bruceConfig.mifareKeys.size() && _fileSize == fileSize) {
+        if (file) file.close();
+        return;
+    }
+
+    unsigned long start = millis();
+    _configKeys = bruceConfig.mifareKeys.size();
+    _fileSize = fileSize;
+    _loaded = true;
+    // key indexes change, what was found is lost
+    for (Card &c : _cards) c.lastUse = 0;
+    _card = nullptr;
+
+    // each key of the file takes at least 13 bytes
+    _capacity = min<uint32_t>(DEFAULT_KEYS + _configKeys + fileSize / 13 + 1, MIFARE_KEY_MAX);
+    _count = 0;
+    free(_keys);
+    _keys = (uint8_t *)(psramFound() ? ps_malloc(_capacity * 6) : malloc(_capacity * 6));
+    if (!_keys) { // the keys of the file don't fit, keep the others
+        _capacity = DEFAULT_KEYS + _configKeys;
+        _keys = (uint8_t *)malloc(_capacity * 6);
+        if (!_keys) _capacity = 0;
+        if (file) file.close();
+    }
+
+    uint8_t key[6];
+    for (size_t i = 0; i < DEFAULT_KEYS; i++) add(defaultKeys[i]);
+    for (const auto &mifKey : bruceConfig.mifareKeys) {
+        if (parseKey(mifKey.c_str(), mifKey.length(), key)) add(key);
+    }
+
+    if (file) {
+        char buf[MIFARE_KEY_READ];
+        char line[32];
+        size_t lineLen = 0;
+        bool comment = false;
+        bool tooLong = false;
+        bool full = false;
+        while (!full) {
+            int n = file.read((uint8_t *)buf, sizeof(buf));
+            bool eof = n <= 0;
+            if (eof) {
+                n = 1;
+                buf[0] = '\n';
+            }
+            for (int i = 0; i < n && !full; i++) {
+                char c = buf[i];
+                if (c != '\n') {
+                    if (c == '#') comment = true;
+                    if (comment) continue;
+                    if (lineLen == sizeof(line)) tooLong = true;
+                    else line[lineLen++] = c;
+                    continue;
+                }
+                if (!tooLong && parseKey(line, lineLen, key)) full = !add(key);
+                lineLen = 0;
+                comment = tooLong = false;
+            }
+            if (eof) break;
+        }
+        file.close();
+    }
+
+    // drop duplicates, keeping the first one so the built in and config keys are still tried first.
+    // The index takes up to 128kB: in PSRAM when there is some, skipped if it doesn't fit, duplicates only
+    // cost a few more tries
+    uint16_t *order = (uint16_t *)(psramFound() ? ps_malloc(_count * 2) : malloc(_count * 2));
+    if (order) {
+        for (uint32_t i = 0; i < _count; i++) order[i] = i;
+        // ties by index, std::stable_sort would take another buffer as big as `order`
+        std::sort(order, order + _count, [this](uint16_t a, uint16_t b) {
+            int cmp = memcmp(_keys + a * 6, _keys + b * 6, 6);
+            return cmp < 0 || (cmp == 0 && a < b);
+        });
+        std::vector<bool> duplicate(_count, false);
+        for (uint32_t i = 1; i < _count; i++) {
+            if (memcmp(_keys + order[i] * 6, _keys + order[i - 1] * 6, 6) == 0) duplicate[order[i]] = true;
+        }
+        free(order);
+        uint32_t kept = 0;
+        for (uint32_t i = 0; i < _count; i++) {
+            if (duplicate[i]) continue;
+            if (kept != i) memcpy(_keys + kept * 6, _keys + i * 6, 6);
+            kept++;
+        }
+        _count = kept;
+    }
+
+    Serial.printf(
+        "Mifare keys: %lu loaded in %lums%s\n",
+        (unsigned long)_count,
+        millis() - start,
+        fs ? (fs == &SD ? " (SD file)" : " (LittleFS file)") : ""
+    );
+}
+
+void MifareDictionary::beginCard(const uint8_t *uid, uint8_t uidSize) {
+    load();
+    uint8_t prefix[MIFARE_KEY_UID_PREFIX] = {0};
+    memcpy(prefix, uid, min<uint8_t>(uidSize, MIFARE_KEY_UID_PREFIX));
+
+    // same system if the UID starts the same way, otherwise the card used the longest ago
+    Card *card = &_cards[0];
+    for (Card &c : _cards) {
+        if (c.lastUse && memcmp(c.prefix, prefix, MIFARE_KEY_UID_PREFIX) == 0) {
+            card = &c;
+            break;
+        }
+        if (c.lastUse < card->lastUse) card = &c;
+    }
+    if (!card->lastUse || memcmp(card->prefix, prefix, MIFARE_KEY_UID_PREFIX) != 0) {
+        memcpy(card->prefix, prefix, MIFARE_KEY_UID_PREFIX);
+        for (auto &sector : card->key) sector[0] = sector[1] = MIFARE_KEY_NONE;
+    }
+    card->lastUse = ++_uses;
+    _card = card;
+    _hotCount = 0;
+    _stats = MifareDumpStats();
+    _start = millis();
+}
+
+void MifareDictionary::found(uint8_t sector, bool keyB, uint16_t key) {
+    if (!_card) return;
+    if (sector < MIFARE_KEY_SECTORS) _card->key[sector][keyB] = key;
+
+    uint8_t pos = 0;
+    while (pos < _hotCount && _hot[pos] != key) pos++;
+    if (pos == _hotCount && _hotCount < MIFARE_KEY_HOT) _hotCount++;
+    if (pos == MIFARE_KEY_HOT) pos--;
+    for (; pos > 0; pos--) _hot[pos] = _hot[pos - 1];
+    _hot[0] = key;
+}
+
+int MifareDictionary::findKey(uint8_t sector, bool keyB, std::function<int(const uint8_t *key)> tryKey) {
+    uint16_t tried[MIFARE_KEY_HOT + 1];
+    uint8_t triedCount = 0;
+    auto wasTried = [&](uint16_t k) {
+        for (uint8_t i = 0; i < triedCount; i++) {
+            if (tried[i] == k) return true;
+        }
+        return false;
+    };
+
+    // remembered keys first: this sector on a card of the same system, then keys found on this card
+    uint16_t candidates[MIFARE_KEY_HOT + 1];
+    uint8_t candidateCount = 0;
+    if (_card && sector < MIFARE_KEY_SECTORS) candidates[candidateCount++] = _card->key[sector][keyB];
+    if (_card) {
+        for (uint8_t i = 0; i < _hotCount; i++) candidates[candidateCount++] = _hot[i];
+    }
+    for (uint8_t i = 0; i < candidateCount; i++) {
+        uint16_t k = candidates[i];
+        if (k >= _count || wasTried(k)) continue;
+        _stats.auths++;
+        int result = tryKey(_keys + k * 6);
+        if (result < 0) return result;
+        if (result > 0) {
+            _stats.cacheHits++;
+            found(sector, keyB, k);
+            return result;
+        }
+        tried[triedCount++] = k;
+    }
+
+    for (uint32_t k = 0; k < _count; k++) {
+        if (wasTried(k)) continue;
+        _stats.auths++;
+        int result = tryKey(_keys + k * 6);
+        if (result < 0) return result;
+        if (result > 0) {
+            found(sector, keyB, k);
+            return result;
+        }
+    }
+    return 0;
+}
+
+MifareDumpStats MifareDictionary::endCard() {
+    _stats.ms = millis() - _start;
+    _card = nullptr;
+    return _stats;
+}
@@ -0,0 +1,74 @@
+#ifndef __MIFARE_KEYS_H__
+#define __MIFARE_KEYS_H__
+
+#include <Arduino.h>
+#include <functional>
+
+#define MIFARE_KEY_FILE "/BruceRFID/mifare_keys.dic" // extra keys, 12 hex digits a line, # for comments
+#define MIFARE_KEY_MAX 0xFFFE                        // keys kept, found keys are stored as 16 bit indexes
+#define MIFARE_KEY_NONE 0xFFFF                       // no key found yet
+#define MIFARE_KEY_SECTORS 40                        // Mifare Classic 4K
+#define MIFARE_KEY_CARDS 8                           // cards whose keys are remembered
+#define MIFARE_KEY_UID_PREFIX 3                      // UID bytes shared by the cards of a same system
+#define MIFARE_KEY_HOT 8                             // keys found on the card, tried first on next sectors
+
+struct MifareDumpStats {
+    uint32_t auths = 0;     // authentications tried
+    uint32_t cacheHits = 0; // keys found among the remembered ones
+    unsigned long ms = 0;   // from beginCard() to endCard()
+};
+
+/**
+ * @brief Mifare Classic key dictionary and the keys found on recent cards
+ *
+ * The built in keys, the keys of the config and MIFARE_KEY_FILE (SD, else LittleFS) are parsed once into a
+ * buffer of 6 byte keys without duplicates. It is parsed again only when the config keys or the file change.
+ * findKey() tries first the key found for the same sector of an earlier card with the same UID prefix,
+ * then the keys already found on this card, then the rest of the dictionary.
+ */
+class MifareDictionary {
+public:
+    ~MifareDictionary() { free(_keys); }
+
+    // Starts reading or writing a card, (re)loading the dictionary if needed
+    void beginCard(const uint8_t *uid, uint8_t uidSize);
+    // tryKey(key) returns 1 when the key authenticates, 0 when it doesn't and -1 when the tag is gone.
+    // Returns the same for the whole search
+    int findKey(uint8_t sector, bool keyB, std::function<int(const uint8_t *key)> tryKey);
+    MifareDumpStats endCard();
+
+    uint32_t size() const { return _count; }
+
+private:
+    struct Card {
+        uint8_t prefix[MIFARE_KEY_UID_PREFIX];
+        uint16_t key[MIFARE_KEY_SECTORS][2]; // A and B, index of the key or MIFARE_KEY_NONE
+        uint32_t lastUse = 0;                // 0: free slot
+    };
+
+    void load();
+    bool add(const uint8_t *key);
+    void found(uint8_t sector, bool keyB, uint16_t key);
+
+    uint8_t *_keys = nullptr;
+    uint32_t _count = 0;
+    uint32_t _capacity = 0;
+    bool _loaded = false;
+    size_t _configKeys = 0; // sources of the loaded dictionary, to tell when it must be loaded again
+    size_t _fileSize = 0;
+
+    Card _cards[MIFARE_KEY_CARDS];
+    Card *_card = nullptr;
+    uint32_t _uses = 0;
+    uint16_t _hot[MIFARE_KEY_HOT]; // most recent first
+    uint8_t _hotCount = 0;
+    MifareDumpStats _stats;
+    unsigned long _start = 0;
+};
+
+extern MifareDictionary mifareDictionary;
+
+// Sector of a Mifare Classic block: 4 blocks a sector up to 128, then 16
+inline uint8_t mifareSector(int block) { return block < 128 ? block / 4 : 32 + (block - 128) / 16; }
+
+#endif
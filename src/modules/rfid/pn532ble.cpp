@@ -369,6 +369,36 @@ void updateArea(ScrollableTextArea &area) {
     area.draw();
 }
 
+// "12 00112233...", lower case as the dump screens always showed it
+static String dumpBlockLine(int block, const uint8_t *data) {
+    static const char hexDigits[] = "0123456789abcdef";
+    char line[40];
+    int n = snprintf(line, sizeof(line), "%d ", block);
+    for (int j = 0; j < 16; j++) {
+        line[n++] = hexDigits[data[j] >> 4];
+        line[n++] = hexDigits[data[j] & 0x0F];
+    }
+    line[n] = '\0';
+    return String(line);
+}
+
+// Blocks of a Mifare Classic card: 4 a sector up to 32 sectors, 16 after that
+static uint16_t mifareClassicBlocks(uint8_t sectorCount) {
+    return sectorCount <= 32 ? sectorCount * 4 : 128 + (sectorCount - 32) * 16;
+}
+
+void Pn532ble::dumpLine(ScrollableTextArea &area, const String &line) {
+    area.addLine(line);
+    area.scrollDown();
+    dumpFrame(area);
+}
+
+void Pn532ble::dumpFrame(ScrollableTextArea &area, bool force) {
+    if (!force && millis() - _lastFrame < PN532BLE_FRAME_MS) return;
+    area.draw();
+    _lastFrame = millis();
+}
+
 void Pn532ble::hf14aMfReadDumpMode() {
     displayBanner();
     padprintln("HF MFC Dump");
@@ -386,101 +416,58 @@ void Pn532ble::hf14aMfReadDumpMode() {
     ScrollableTextArea area(FP, 10, 28, tftWidth - 20, tftHeight - 38);
 
     if (tagInfo.sak == 0x08 || tagInfo.sak == 0x09 || tagInfo.sak == 0x18) {
+        unsigned long start = millis();
+        // blocks go to their place in the dump, so a failed sector doesn't shift the ones after it
         if (pn532_ble.isGen1A()) {
-            area.addLine("TYPE: " + tagInfo.type);
-            area.scrollDown();
-            area.draw();
-            area.addLine("UID:  " + tagInfo.uid_hex);
-            area.scrollDown();
-            area.draw();
-            area.addLine("MAGI: Gen1A");
-            area.scrollDown();
-            area.draw();
-            area.addLine("------------");
-            area.scrollDown();
-            area.draw();
+            dumpLine(area, "TYPE: " + tagInfo.type);
+            dumpLine(area, "UID:  " + tagInfo.uid_hex);
+            dumpLine(area, "MAGI: Gen1A");
+            dumpLine(area, "------------");
+            mfd.assign(64 * 16, 0);
             for (uint8_t i = 0; i < 64; i++) {
-                uint8_t blockData[16];
                 std::vector<uint8_t> res = pn532_ble.sendData({0x30, i}, true);
                 if (res.size() < 18) {
+                    mfd.clear();
                     displayError("Read failed");
                     return;
                 }
-                String blockStr = String(i) + " ";
-                for (uint8_t j = 0; j < 16; j++) {
-                    blockData[j] = res[j + 1];
-                    mfd.push_back(blockData[j]);
-                }
-
-                for (uint8_t j = 0; j < 16; j++) {
-                    blockStr += blockData[j] < 0x10 ? "0" : "";
-                    blockStr += String(blockData[j], HEX);
-                }
-                area.addLine(blockStr);
-                area.scrollDown();
-                area.draw();
+                memcpy(&mfd[i * 16], &res[1], 16);
+                dumpLine(area, dumpBlockLine(i, &mfd[i * 16]));
             }
-            area.addLine("------------");
-            area.scrollDown();
-            area.draw();
         } else if (pn532_ble.isGen4(gen4pwd)) {
             delay(200);
-            area.addLine("TYPE: " + tagInfo.type);
-            area.scrollDown();
-            area.draw();
-            area.addLine("UID:  " + tagInfo.uid_hex);
-            area.scrollDown();
-            area.draw();
-            area.addLine("MAGI: Gen4");
-            area.scrollDown();
-            area.draw();
-            area.addLine("------------");
-            area.scrollDown();
-            area.draw();
-            uint8_t sectorCount = getMifareClassicSectorCount(tagInfo.sak);
-            for (uint8_t s = 0; s < sectorCount; s++) {
-                uint8_t sectorBlockIdex = (s < 32) ? s * 4 : 32 * 4 + (s - 32) * 16;
-                uint8_t sectorBlockSize = (s < 32) ? 4 : 16;
-                for (uint8_t i = 0; i < sectorBlockSize; i++) {
-                    uint8_t blockIndex = sectorBlockIdex + i;
-                    uint8_t blockData[16];
-                    std::vector<uint8_t> res =
-                        pn532_ble.sendData({0xCF, 0x00, 0x00, 0x00, 0x00, 0xCE, blockIndex}, true);
-                    if (res.size() < 18) {
-                        displayError("Read failed");
-                        return;
-                    }
-                    String blockStr = String(blockIndex) + " ";
-                    for (uint8_t j = 0; j < 16; j++) {
-                        blockData[j] = res[j + 1];
-                        mfd.push_back(blockData[j]);
-                        blockStr += blockData[j] < 0x10 ? "0" : "";
-                        blockStr += String(blockData[j], HEX);
-                    }
-                    area.addLine(blockStr);
-                    area.scrollDown();
-                    area.draw();
+            dumpLine(area, "TYPE: " + tagInfo.type);
+            dumpLine(area, "UID:  " + tagInfo.uid_hex);
+            dumpLine(area, "MAGI: Gen4");
+            dumpLine(area, "------------");
+            uint16_t blockCount = mifareClassicBlocks(getMifareClassicSectorCount(tagInfo.sak));
+            mfd.assign(blockCount * 16, 0);
+            for (uint16_t blockIndex = 0; blockIndex < blockCount; blockIndex++) {
+                std::vector<uint8_t> res =
+                    pn532_ble.sendData({0xCF, 0x00, 0x00, 0x00, 0x00, 0xCE, (uint8_t)blockIndex}, true);
+                if (res.size() < 18) {
+                    mfd.clear();
+                    displayError("Read failed");
+                    return;
                 }
+                memcpy(&mfd[blockIndex * 16], &res[1], 16);
+                dumpLine(area, dumpBlockLine(blockIndex, &mfd[blockIndex * 16]));
             }
-            area.addLine("------------");
-            area.scrollDown();
-            area.draw();
         } else {
             tagInfo = pn532_ble.hf14aScan();
-            area.addLine("TYPE: " + tagInfo.type);
-            area.scrollDown();
-            area.draw();
-            area.addLine("UID:  " + tagInfo.uid_hex);
-            area.scrollDown();
-            area.draw();
-            area.addLine("------------");
-            area.scrollDown();
-            area.draw();
+            dumpLine(area, "TYPE: " + tagInfo.type);
+            dumpLine(area, "UID:  " + tagInfo.uid_hex);
+            dumpLine(area, "------------");
 
             uint8_t sectorCount = getMifareClassicSectorCount(tagInfo.sak);
+            mfd.assign(mifareClassicBlocks(sectorCount) * 16, 0);
+            // the tag stays selected after a sector is read, but a failed auth or read halts it: it needs a
+            // new scan before the next command
+            bool halted = false;
             for (uint8_t s = 0; s < sectorCount; s++) {
-                pn532_ble.hf14aScan();
                 uint8_t sectorBlockIdex = (s < 32) ? s * 4 : 32 * 4 + (s - 32) * 16;
+                if (halted) pn532_ble.hf14aScan();
+                halted = false;
                 bool useKeyA = true;
                 bool authResult =
                     pn532_ble.mfAuth(tagInfo.uid, sectorBlockIdex, pn532_ble.mifareDefaultKey, useKeyA);
@@ -491,47 +478,41 @@ void Pn532ble::hf14aMfReadDumpMode() {
                         pn532_ble.mfAuth(tagInfo.uid, sectorBlockIdex, pn532_ble.mifareDefaultKey, useKeyA);
                 }
                 if (!authResult) {
+                    halted = true;
                     displayError("Sector " + String(s) + " auth failed");
                     continue;
                 }
                 uint8_t sectorBlockSize = (s < 32) ? 4 : 16;
                 for (uint8_t i = 0; i < sectorBlockSize; i++) {
                     uint8_t blockIndex = sectorBlockIdex + i;
-                    uint8_t blockData[16];
+                    uint8_t *blockData = &mfd[blockIndex * 16];
                     std::vector<uint8_t> res = pn532_ble.mfRdbl(blockIndex);
-                    if (res.size() < 16) {
-                        area.addLine("Sector " + String(s) + " Block " + String(blockIndex) + " read failed");
-                        area.scrollDown();
-                        area.draw();
+                    if (res.size() < 17) {
+                        dumpLine(
+                            area, "Sector " + String(s) + " Block " + String(blockIndex) + " read failed"
+                        );
+                        // select the tag again for the rest of the sector
+                        pn532_ble.hf14aScan();
+                        if (!pn532_ble.mfAuth(
+                                tagInfo.uid, sectorBlockIdex, pn532_ble.mifareDefaultKey, useKeyA
+                            )) {
+                            halted = true;
+                            break;
+                        }
                         continue;
                     }
-                    String blockStr = String(blockIndex) + " ";
-                    for (uint8_t j = 0; j < 16; j++) { blockData[j] = res[j + 1]; }
+                    memcpy(blockData, &res[1], 16);
 
                     if (i == sectorBlockSize - 1) {
-                        if (useKeyA) {
-                            for (uint8_t j = 0; j < 6; j++) { blockData[j] = pn532_ble.mifareDefaultKey[j]; }
-                        } else {
-                            for (uint8_t j = 0; j < 6; j++) {
-                                blockData[j + 10] = pn532_ble.mifareDefaultKey[j];
-                            }
-                        }
-                    }
-
-                    for (uint8_t j = 0; j < 16; j++) {
-                        mfd.push_back(blockData[j]);
-                        blockStr += blockData[j] < 0x10 ? "0" : "";
-                        blockStr += String(blockData[j], HEX);
+                        memcpy(blockData + (useKeyA ? 0 : 10), pn532_ble.mifareDefaultKey, 6);
                     }
-                    area.addLine(blockStr);
-                    area.scrollDown();
-                    area.draw();
+                    dumpLine(area, dumpBlockLine(blockIndex, blockData));
                 }
             }
-            area.addLine("------------");
-            area.scrollDown();
-            area.draw();
         }
+        dumpLine(area, "------------");
+        dumpLine(area, "Read in " + String(millis() - start) + "ms");
+        dumpFrame(area, true);
         pn532_ble.wakeup();
 
         while (check(SelPress)) {
@@ -568,12 +549,8 @@ void Pn532ble::hf14aMfuReadDumpMode() {
 
     if (tagInfo.sak == 0x00) {
         mfud.clear();
-        area.addLine("TYPE: " + tagInfo.type);
-        area.scrollDown();
-        area.draw();
-        area.addLine("UID:  " + tagInfo.uid_hex);
-        area.scrollDown();
-        area.draw();
+        dumpLine(area, "TYPE: " + tagInfo.type);
+        dumpLine(area, "UID:  " + tagInfo.uid_hex);
 
         int max_block = 4;
         int block = 0;
@@ -583,9 +560,7 @@ void Pn532ble::hf14aMfuReadDumpMode() {
             if (block == 0 && res.size() == 16) {
                 max_block = res[14] * 2 + 9;
                 area.addLine("PAGE: " + String(max_block));
-                area.addLine("------------");
-                area.scrollDown();
-                area.draw();
+                dumpLine(area, "------------");
             }
             if (res.size() == 16) {
                 for (int i = 0; i < 4; i++) {
@@ -615,18 +590,15 @@ void Pn532ble::hf14aMfuReadDumpMode() {
                         }
                     }
 
-                    area.addLine(blockStr);
-                    area.scrollDown();
-                    area.draw();
+                    dumpLine(area, blockStr);
                 }
             } else {
                 padprintln("Block " + String(block) + " Failed to read");
             }
             block += 4;
         }
-        area.addLine("------------");
-        area.scrollDown();
-        area.draw();
+        dumpLine(area, "------------");
+        dumpFrame(area, true);
         pn532_ble.wakeup();
 
         while (check(SelPress)) {
@@ -6,6 +6,8 @@
 #include <set>
 #include <vector>
 
+#define PN532BLE_FRAME_MS 100 // dump screens are redrawn at most this often, not after every block
+
 class Pn532ble {
 public:
     Pn532ble();
@@ -45,6 +47,9 @@ private:
     void hf14aScan();
     void hf15Scan();
     void lfScan();
+    unsigned long _lastFrame = 0;
+    void dumpLine(ScrollableTextArea &area, const String &line);
+    void dumpFrame(ScrollableTextArea &area, bool force = false);
     void hf14aMfReadDumpMode();
     void hf14aMfuReadDumpMode();
     void hf14aMfuWriteDumpMode();
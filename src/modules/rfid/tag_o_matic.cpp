@@ -113,7 +113,7 @@ void TagOMatic::set_state(RFID_State state) {
         _scanned_tags.clear();
     }
     _sourceUID = "";
-    _sourcePages = "";
+    _sourcePages = 0;
 
     switch (state) {
         case READ_MODE:
@@ -124,7 +124,7 @@ void TagOMatic::set_state(RFID_State state) {
             break;
         case CHECK_MODE:
             _sourceUID = _rfid->printableUID.uid;
-            _sourcePages = _rfid->strAllPages;
+            _sourcePages = _rfid->image.checksum();
             padprintln("Source UID: " + _sourceUID);
             padprintln("");
             break;
@@ -176,6 +176,7 @@ void TagOMatic::dump_card_details() {
         padprintln("UID: " + _rfid->printableUID.uid);
         padprintln("ATQA: " + _rfid->printableUID.atqa);
         padprintln("SAK: " + _rfid->printableUID.sak);
+        if (_rfid->dumpTime) padprintln("Dump time: " + String(_rfid->dumpTime) + "ms");
     } else {
         padprintln("IDm: " + _rfid->printableUID.uid);
         padprintln("PMm: " + _rfid->printableUID.sak);
@@ -190,7 +191,7 @@ void TagOMatic::dump_check_details() {
     padprintln("");
 
     padprintln("UID: " + String(_sourceUID == _rfid->printableUID.uid ? "OK" : "NOT OK"));
-    padprintln("Data: " + String(_sourcePages == _rfid->strAllPages ? "OK" : "NOT OK"));
+    padprintln("Data: " + String(_sourcePages == _rfid->image.checksum() ? "OK" : "NOT OK"));
     padprintln("");
 
     if (_rfid->pageReadStatus != RFIDInterface::SUCCESS)
@@ -0,0 +1,211 @@
+#ifndef __MAC_SET_H__
+#define __MAC_SET_H__
+
+#include <Arduino.h>
+
+// Packs a 6 bytes MAC address into the lower 48 bits of an uint64_t
+inline uint64_t macToKey(const uint8_t *mac) {
+    return ((uint64_t)mac[0] << 40) | ((uint64_t)mac[1] << 32) | ((uint64_t)mac[2] << 24) |
+           ((uint64_t)mac[3] << 16) | ((uint64_t)mac[4] << 8) | (uint64_t)mac[5];
+}
+
+inline void keyToMac(uint64_t key, uint8_t *mac) {
+    for (int i = 5; i >= 0; i--) {
+        mac[i] = key & 0xFF;
+        key >>= 8;
+    }
+}
+
+/**
+ * @brief Fixed capacity open-addressing hash set of 64 bits keys (packed MACs)
+ *
+ * Lives in a flat array, so inserting never touches the heap. CAP must be a power of 2,
+ * the set refuses new keys once it is 3/4 full to keep the probe sequences short.
+ */
+template <size_t CAP> class MacSet {
+    static_assert((CAP & (CAP - 1)) == 0, "MacSet capacity must be a power of 2");
+    static const uint64_t EMPTY = UINT64_MAX;
+
+public:
+    MacSet() { clear(); }
+
+    void clear() {
+        for (size_t i = 0; i < CAP; i++) _slots[i] = EMPTY;
+        _count = 0;
+    }
+
+    size_t size() const { return _count; }
+    bool full() const { return _count >= CAP * 3 / 4; }
+
+    bool contains(uint64_t key) const { return _slots[probe(key)] == key; }
+
+    // Returns false if the key already exists or there is no room for it
+    bool insert(uint64_t key) {
+        size_t i = probe(key);
+        if (_slots[i] == key || full()) return false;
+        _slots[i] = key;
+        _count++;
+        return true;
+    }
+
+    class iterator {
+    public:
+        iterator(const uint64_t *slots, size_t i) : _s(slots), _i(i) { skip(); }
+        uint64_t operator*() const { return _s[_i]; }
+        iterator &operator++() {
+            _i++;
+            skip();
+            return *this;
+        }
+        bool operator!=(const iterator &o) const { return _i != o._i; }
+
+    private:
+        void skip() {
+            while (_i < CAP && _s[_i] == EMPTY) _i++;
+        }
+        const uint64_t *_s;
+        size_t _i;
+    };
+    iterator begin() const { return iterator(_slots, 0); }
+    iterator end() const { return iterator(_slots, CAP); }
+
+private:
+    // Index of the slot holding `key`, or of the empty slot where it would be inserted
+    size_t probe(uint64_t key) const {
+        size_t i = (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & (CAP - 1);
+        while (_slots[i] != EMPTY && _slots[i] != key) i = (i + 1) & (CAP - 1);
+        return i;
+    }
+
+    uint64_t _slots[CAP];
+    size_t _count;
+};
+
+/**
+ * @brief Fixed capacity open-addressing hash map from 64 bits keys (packed MACs) to values
+ *
+ * Probes like MacSet and refuses new keys once 3/4 full. Removing a key shifts back the entries
+ * that follow it, so there are no tombstones to pile up. Walk it by slot: [0, capacity()).
+ */
+template <size_t CAP, typename V> class MacMap {
+    static_assert((CAP & (CAP - 1)) == 0, "MacMap capacity must be a power of 2");
+    static const uint64_t EMPTY = UINT64_MAX;
+
+public:
+    MacMap() { clear(); }
+
+    void clear() {
+        for (size_t i = 0; i < CAP; i++) _keys[i] = EMPTY;
+        _count = 0;
+    }
+
+    size_t size() const { return _count; }
+    bool full() const { return _count >= CAP * 3 / 4; }
+
+    // Value of `key`, added default constructed (`fresh`) if missing. nullptr if there is no room for it
+    V *insert(uint64_t key, bool &fresh) {
+        size_t i = probe(key);
+        fresh = _keys[i] != key;
+        if (fresh) {
+            if (full()) return nullptr;
+            _keys[i] = key;
+            _values[i] = V();
+            _count++;
+        }
+        return &_values[i];
+    }
+
+    size_t capacity() const { return CAP; }
+    bool used(size_t slot) const { return _keys[slot] != EMPTY; }
+    V &value(size_t slot) { return _values[slot]; }
+
+    // An entry after the slot may be moved into it, check the slot again when walking the map
+    void eraseSlot(size_t slot) {
+        size_t hole = slot;
+        for (size_t j = (slot + 1) & (CAP - 1); _keys[j] != EMPTY; j = (j + 1) & (CAP - 1)) {
+            size_t home = homeOf(_keys[j]);
+            // the entry can fill the hole if the hole lies between its home slot and j
+            if (((j - home) & (CAP - 1)) >= ((j - hole) & (CAP - 1))) {
+                _keys[hole] = _keys[j];
+                _values[hole] = _values[j];
+                hole = j;
+            }
+        }
+        _keys[hole] = EMPTY;
+        _count--;
+    }
+
+private:
+    static size_t homeOf(uint64_t key) { return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & (CAP - 1); }
+    size_t probe(uint64_t key) const {
+        size_t i = homeOf(key);
+        while (_keys[i] != EMPTY && _keys[i] != key) i = (i + 1) & (CAP - 1);
+        return i;
+    }
+
+    uint64_t _keys[CAP];
+    V _values[CAP];
+    size_t _count;
+};
+
+/**
+ * @brief Bloom filter of 64 bits keys, to keep deduplicating once a MacSet is full
+ *
+ * Takes BITS / 8 bytes whatever the number of keys. It never forgets a key, but may claim to
+ * know one it never saw (about 3% with 8 bits per key). BITS must be a power of 2.
+ */
+template <size_t BITS> class MacBloom {
+    static_assert((BITS & (BITS - 1)) == 0, "MacBloom size must be a power of 2");
+    static const int HASHES = 3;
+
+public:
+    MacBloom() { clear(); }
+
+    void clear() {
+        memset(_bits, 0, sizeof(_bits));
+        _count = 0;
+    }
+
+    size_t size() const { return _count; }
+
+    bool contains(uint64_t key) const {
+        uint64_t h = mix(key);
+        for (int k = 0; k < HASHES; k++) {
+            size_t bit = bitFor(h, k);
+            if (!(_bits[bit >> 3] & (1 << (bit & 7)))) return false;
+        }
+        return true;
+    }
+
+    // Returns false if the key (or a false positive) was already there
+    bool insert(uint64_t key) {
+        if (contains(key)) return false;
+        uint64_t h = mix(key);
+        for (int k = 0; k < HASHES; k++) {
+            size_t bit = bitFor(h, k);
+            _bits[bit >> 3] |= 1 << (bit & 7);
+        }
+        _count++;
+        return true;
+    }
+
+private:
+    // MAC keys are far from random (shared OUIs), spread them before slicing
+    static uint64_t mix(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xFF51AFD7ED558CCDULL;
+        key ^= key >> 33;
+        key *= 0xC4CEB9FE1A85EC53ULL;
+        return key ^ (key >> 33);
+    }
+    // double hashing: the k-th bit is h1 + k * h2
+    static size_t bitFor(uint64_t h, int k) {
+        uint32_t h1 = h >> 32, h2 = (uint32_t)h | 1;
+        return (h1 + k * h2) & (BITS - 1);
+    }
+
+    uint8_t _bits[BITS / 8];
+    size_t _count;
+};
+
+#endif
@@ -0,0 +1,140 @@
+#include "pcap_ring.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+PcapRing pcapRing;
+
+bool PcapRing::begin() {
+    if (_buf) return true;
+    if (psramFound()) {
+        _size = PCAP_RING_SIZE_PSRAM;
+        _buf = (uint8_t *)ps_malloc(_size);
+    } else {
+        _size = PCAP_RING_SIZE_RAM;
+        _buf = (uint8_t *)malloc(_size);
+    }
+    if (!_buf) {
+        _size = 0;
+        Serial.println("PcapRing: not enough memory");
+        return false;
+    }
+    _head.store(0);
+    _tail.store(0);
+    resetStats();
+    return true;
+}
+
+void PcapRing::end() {
+    stopWriter();
+    uint8_t *buf = _buf;
+    _buf = nullptr;
+    _size = 0;
+    free(buf);
+}
+
+void PcapRing::resetStats() {
+    _highWater = 0;
+    _drops = 0;
+    _written = 0;
+    _lost = 0;
+}
+
+void PcapRing::copyIn(uint32_t pos, const void *src, size_t len) {
+    size_t idx = pos & (_size - 1);
+    size_t first = _size - idx;
+    if (first > len) first = len;
+    memcpy(_buf + idx, src, first);
+    if (len > first) memcpy(_buf, (const uint8_t *)src + first, len - first);
+}
+
+bool PcapRing::push(uint32_t ts_sec, uint32_t ts_usec, const uint8_t *buf, uint32_t len) {
+    if (!_buf) return false;
+    const uint32_t hdr[4] = {ts_sec, ts_usec, len, len}; // pcaprec_hdr_t
+    const uint32_t need = sizeof(hdr) + len;
+
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    uint32_t inUse = head - _tail.load(std::memory_order_acquire);
+    if (need > _size - inUse) {
+        _drops++;
+        return false;
+    }
+    copyIn(head, hdr, sizeof(hdr));
+    copyIn(head + sizeof(hdr), buf, len);
+    _head.store(head + need, std::memory_order_release);
+
+    inUse += need;
+    if (inUse > _highWater) _highWater = inUse;
+    TaskHandle_t task = _task;
+    if (task && inUse >= PCAP_RING_WRITE_BLOCK) xTaskNotifyGive(task);
+    return true;
+}
+
+// Writes the contiguous spans available to the file. Unless forced, only whole
+// blocks are written, leaving the tail of a burst for the next round
+size_t PcapRing::drain(bool force) {
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    uint32_t avail = _head.load(std::memory_order_acquire) - tail;
+    if (!force) {
+        if (avail < PCAP_RING_WRITE_BLOCK) return 0;
+        avail &= ~(uint32_t)(PCAP_RING_SECTOR - 1);
+    }
+    size_t total = 0;
+    while (avail > 0) {
+        size_t idx = tail & (_size - 1);
+        size_t chunk = _size - idx;
+        if (chunk > avail) chunk = avail;
+        size_t done = _file && *_file ? _file->write(_buf + idx, chunk) : 0;
+        if (done < chunk) {
+            // the rest is dropped anyway, keeping it would stall the producer behind a dead file
+            if (_lost == 0) Serial.printf("PcapRing: short write, %u of %u bytes\n", done, chunk);
+            _lost += chunk - done;
+        }
+        tail += chunk;
+        avail -= chunk;
+        total += done;
+        _tail.store(tail, std::memory_order_release);
+    }
+    _written += total;
+    return total;
+}
+
+void PcapRing::writerTask(void *param) {
+    PcapRing *ring = (PcapRing *)param;
+    unsigned long lastFlush = millis();
+    bool dirty = false;
+    while (ring->_running) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+        if (ring->drain(false)) dirty = true;
+        if (millis() - lastFlush > PCAP_RING_FLUSH_MS) {
+            if (ring->drain(true)) dirty = true;
+            if (dirty && ring->_file && *ring->_file) ring->_file->flush();
+            dirty = false;
+            lastFlush = millis();
+        }
+    }
+    ring->drain(true);
+    if (ring->_file && *ring->_file) ring->_file->flush();
+    ring->_task = NULL;
+    vTaskDelete(NULL);
+}
+
+bool PcapRing::startWriter(File *file) {
+    if (!_buf || _task) return false;
+    _file = file;
+    _running = true;
+    TaskHandle_t task = NULL;
+    if (xTaskCreate(writerTask, "PcapWriter", 4096, this, 2, &task) != pdPASS) {
+        _running = false;
+        return false;
+    }
+    _task = task;
+    return true;
+}
+
+void PcapRing::stopWriter() {
+    if (!_task) return;
+    _running = false;
+    xTaskNotifyGive(_task);
+    while (_task) vTaskDelay(pdMS_TO_TICKS(5));
+    _file = nullptr;
+}
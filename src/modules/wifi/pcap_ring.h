@@ -0,0 +1,67 @@
+#ifndef __PCAP_RING_H__
+#define __PCAP_RING_H__
+
+#include <Arduino.h>
+#include <FS.h>
+#include <atomic>
+
+#define PCAP_RING_SIZE_PSRAM (128 * 1024) // must be a power of 2
+#define PCAP_RING_SIZE_RAM (16 * 1024)    // must be a power of 2
+#define PCAP_RING_WRITE_BLOCK 4096        // writer waits for this amount before writing
+#define PCAP_RING_SECTOR 512              // partial writes are rounded down to this size
+#define PCAP_RING_FLUSH_MS 1000           // max time data stays in RAM before being flushed
+
+/**
+ * @brief Single-producer/single-consumer byte ring for pcap records
+ *
+ * The promiscuous RX callback (producer) only copies the pcap record header and the frame
+ * into the ring. A FreeRTOS writer task (consumer) drains it into the pcap file in large
+ * writes, so the Wi-Fi driver task never blocks on the filesystem.
+ */
+class PcapRing {
+public:
+    // Allocates the buffer (PSRAM when present). Returns false if there's no memory
+    bool begin();
+    // Stops the writer (if running) and releases the buffer
+    void end();
+
+    // Producer side: copies a pcap record (header + frame). Returns false and counts a drop if full
+    bool push(uint32_t ts_sec, uint32_t ts_usec, const uint8_t *buf, uint32_t len);
+
+    // Starts the writer task, that owns `file` until stopWriter() is called
+    bool startWriter(File *file);
+    // Drains everything that is left into the file, flushes it and stops the writer task
+    void stopWriter();
+
+    void resetStats();
+    size_t size() const { return _size; }
+    uint32_t used() const { return _head.load(std::memory_order_acquire) - _tail.load(); }
+    uint32_t highWater() const { return _highWater; }
+    uint8_t highWaterPercent() const { return _size ? (uint64_t)_highWater * 100 / _size : 0; }
+    uint32_t drops() const { return _drops; }
+    uint32_t written() const { return _written; }
+    // Bytes the filesystem didn't take (card full or removed), they are dropped from the ring
+    uint32_t lost() const { return _lost; }
+
+private:
+    static void writerTask(void *param);
+    size_t drain(bool force);
+    void copyIn(uint32_t pos, const void *src, size_t len);
+
+    uint8_t *_buf = nullptr;
+    size_t _size = 0;
+    std::atomic<uint32_t> _head{0}; // written only by the producer
+    std::atomic<uint32_t> _tail{0}; // written only by the consumer
+    volatile uint32_t _highWater = 0;
+    volatile uint32_t _drops = 0;
+    volatile uint32_t _written = 0;
+    volatile uint32_t _lost = 0;
+
+    File *_file = nullptr;
+    TaskHandle_t volatile _task = NULL;
+    volatile bool _running = false;
+};
+
+extern PcapRing pcapRing;
+
+#endif
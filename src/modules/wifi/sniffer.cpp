@@ -14,8 +14,8 @@
 #include "lwip/err.h"
 // #include "esp_event_loop.h"
 #include "driver/gpio.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
-#include <set>
 
 #include "FS.h"
 #include "core/display.h"
@@ -32,6 +32,7 @@
 #include <SPI.h>
 #include <SdFat.h>
 #endif
+#include "modules/wifi/pcap_ring.h"
 #include "modules/wifi/wifi_atks.h" // to use deauth frames and cmds
 
 //===== SETTINGS =====//
@@ -41,12 +42,21 @@
 #define CHANNEL_HOPPING true // if true it will scan on all channels
 #define MAX_CHANNEL 11       //(only necessary if channelHopping is true)
 #define HOP_INTERVAL 214     // in ms (only necessary if channelHopping is true)
+#define HS_FILE_CACHE 4      // handshake pcap files kept open at the same time
+#define HS_FLUSH_MS 1000     // max time handshake frames stay unflushed
+#define HS_QUEUE_LEN 8       // frames waiting for the handshake writer
+#define HS_FRAME_MAX 512     // bytes of a frame kept for the handshake files, longer frames are cut
+#define HOP_EAPOL_FACTOR 4   // dwell multiplier for channels with EAPOL frames seen in the last HOP_EAPOL_MS
+#define HOP_EAPOL_MS 30000   // in ms
+#define HOP_BEACON_FACTOR 2  // dwell multiplier for channels where beacons were seen on the last visit
+#define MAX_WIFI_CHANNEL 14
 
 //===== Run-Time variables =====//
 unsigned long lastTime = 0;
 unsigned long lastChannelChange = 0;
 uint8_t ch = CHANNEL;
 bool fileOpen = false;
+bool ringWriting = false; // packets go through pcapRing, else straight to the file
 bool isLittleFS = true;
 bool _only_HS = false; // option to only save handshakes and EAPOL pcaps
 int num_EAPOL = 0;
@@ -54,10 +64,63 @@ int num_HS = 0;
 uint32_t packet_counter = 0;
 
 File _pcap_file;
-std::set<BeaconList> registeredBeacons;
-std::set<String> SavedHS; // Saves the MAC of beacon HS detected in the session
+MacSet<64> registeredBeacons;
+MacSet<256> SavedHS; // Saves the MAC of beacon HS detected in the session
+
+// LRU of open handshake files, so a 4-way handshake burst doesn't open/close a file per frame
+struct HsFile {
+    uint64_t bssid;
+    File file;
+    uint32_t lastUse;
+    bool dirty;
+};
+HsFile hsFiles[HS_FILE_CACHE];
+uint32_t hsUseCounter = 0;
+unsigned long hsLastFlush = 0;
+
+// EAPOL frames, and beacons of the APs with a handshake file, copied by sniffer() for the handshake writer
+// task. The task owns the files and inserts in SavedHS, that the callback reads under hsMux
+struct HsFrame {
+    uint32_t timestamp; // rx_ctrl.timestamp, in us
+    uint16_t len;       // bytes in data
+    uint16_t origLen;   // length of the frame
+    uint8_t channel;
+    bool beacon;
+    uint8_t data[HS_FRAME_MAX];
+};
+QueueHandle_t hsQueue = NULL;
+TaskHandle_t volatile hsWriterTask = NULL;
+volatile bool hsWriterRunning = false;
+volatile uint32_t hsDropped = 0;
+portMUX_TYPE hsMux = portMUX_INITIALIZER_UNLOCKED;
+
 String filename = "/BrucePCAP/" + (String)FILENAME + ".pcap";
 
+// Channel hopping: an esp_timer paces it, so the UI loop doesn't affect the dwell time, and only posts a
+// request to the hopper task. The hopper task is the one that changes `ch` and closes the visits
+#define HOP_REQ_TIMER 0x01 // dwell time over
+#define HOP_REQ_NEXT 0x02  // manual channel change
+#define HOP_REQ_PREV 0x04
+#define HOP_REQ_ARM 0x08 // hopping was turned on
+#define HOP_REQ_QUIT 0x10
+
+struct ChannelStats {
+    volatile uint32_t frames;    // frames received on this channel, only counted by sniffer()
+    volatile uint32_t beacons;   // beacons received on this channel, only counted by sniffer()
+    volatile uint32_t lastEapol; // millis() of the last EAPOL frame seen on this channel
+    uint32_t visitFrames;        // frames when the current visit started
+    uint32_t visitBeacons;       // beacons when the current visit started
+    uint32_t lastBeacons;        // beacons received on the last visit
+    uint16_t fps;                // frames per second measured on the last visit
+};
+ChannelStats chStats[MAX_WIFI_CHANNEL + 1];
+esp_timer_handle_t hopTimer = NULL;
+TaskHandle_t volatile hopTask = NULL;
+volatile bool hopping = false;
+uint16_t hopDwell = HOP_INTERVAL; // base dwell per channel, in ms
+uint8_t hopMaxChannel = MAX_CHANNEL;
+unsigned long visitStart = 0;
+
 //===== FUNCTIONS =====//
 
 // Thank you 7h30th3r0n3 for helping me solve this issue! and for sharing your EAPOL/Handshake sniffer
@@ -100,18 +163,20 @@ typedef struct pcaprec_hdr_s {
     uint32_t orig_len; /* longueur réelle du paquet */
 } pcaprec_hdr_t;
 
-void saveHandshake(const wifi_promiscuous_pkt_t *packet, bool beacon, FS &Fs) {
-    // Construire le nom du fichier en utilisant les adresses MAC de l'AP et du client
-    const uint8_t *addr1 = packet->payload + 4;  // Adresse du destinataire (Adresse 1)
-    const uint8_t *addr2 = packet->payload + 10; // Adresse de l'expéditeur (Adresse 2)
-    const uint8_t *bssid = packet->payload + 16; // Adresse BSSID (Adresse 3)
-    const uint8_t *apAddr;
-
-    if (memcmp(addr1, bssid, 6) == 0) {
-        apAddr = addr1;
-    } else {
-        apAddr = addr2;
+// Returns the cached handle of the AP handshake file, opening it (and evicting the least
+// recently used one) if needed. `create` truncates the file, since it is new in this session
+HsFile *getHandshakeFile(FS &Fs, const uint8_t *apAddr, bool create) {
+    uint64_t bssid = macToKey(apAddr);
+    HsFile *slot = &hsFiles[0];
+    for (auto &f : hsFiles) {
+        if (f.file && f.bssid == bssid && !create) {
+            f.lastUse = ++hsUseCounter;
+            return &f;
+        }
+        if (!slot->file) continue; // already found an empty slot
+        if (!f.file || f.lastUse < slot->lastUse) slot = &f;
     }
+    if (slot->file) slot->file.close(); // flushes it
 
     char nomFichier[50];
     sprintf(
@@ -124,58 +189,154 @@ void saveHandshake(const wifi_promiscuous_pkt_t *packet, bool beacon, FS &Fs) {
         apAddr[4],
         apAddr[5]
     );
+    slot->file = Fs.open(nomFichier, create ? FILE_WRITE : FILE_APPEND);
+    if (!slot->file) return nullptr;
+    slot->bssid = bssid;
+    slot->lastUse = ++hsUseCounter;
+    slot->dirty = false;
+    return slot;
+}
+
+void closeHandshakeFiles() {
+    for (auto &f : hsFiles) {
+        if (f.file) f.file.close();
+        f.dirty = false;
+    }
+}
 
-    // Vérifier si le fichier existe déjà
-    bool fichierExiste = false;
+void printAddress(const uint8_t *addr) {
+    for (int i = 0; i < 6; i++) {
+        Serial.printf("%02X", addr[i]);
+        if (i < 5) Serial.print(":");
+    }
+    Serial.println();
+}
+
+void saveHandshake(const HsFrame &frame, FS &Fs) {
+    // Construire le nom du fichier en utilisant les adresses MAC de l'AP et du client
+    const uint8_t *addr1 = frame.data + 4;  // Adresse du destinataire (Adresse 1)
+    const uint8_t *addr2 = frame.data + 10; // Adresse de l'expéditeur (Adresse 2)
+    const uint8_t *bssid = frame.data + 16; // Adresse BSSID (Adresse 3)
+    const uint8_t *apAddr;
+
+    if (memcmp(addr1, bssid, 6) == 0) {
+        apAddr = addr1;
+    } else {
+        apAddr = addr2;
+    }
 
     // Check if the MAC Address was registered in the list
-    if (SavedHS.find(String((char *)apAddr, 6)) != SavedHS.end()) { fichierExiste = true; }
+    uint64_t apKey = macToKey(apAddr);
+    bool fichierExiste = SavedHS.contains(apKey); // only this task inserts, no need for the lock
 
     // Si probe est true et que le fichier n'existe pas, ignorer l'enregistrement
-    if (beacon && !fichierExiste) { return; }
+    if (frame.beacon && !fichierExiste) { return; }
+
+    if (frame.beacon) {
+        BeaconList ThisBeacon;
+        memcpy(ThisBeacon.MAC, (char *)apAddr, 6);
+        ThisBeacon.channel = frame.channel;
+        // Already saved for this BSSID, or no room left to remember it: skip rather than writing a beacon
+        // for every frame heard
+        if (!registeredBeacons.insert(ThisBeacon.key())) return;
+    } else {
+        Serial.println("EAPOL detected.");
+        Serial.print("Address MAC destination: ");
+        printAddress(addr1);
+        Serial.print("Address MAC expedition: ");
+        printAddress(addr2);
+        if (!fichierExiste && SavedHS.full()) {
+            Serial.println("Too many EAPOL/Handshake PCAP files in this session");
+            return;
+        }
+    }
 
     // Ouvrir le fichier en mode ajout si existant sinon en mode écriture
-    File fichierPcap = Fs.open(
-        nomFichier, fichierExiste ? FILE_APPEND : FILE_WRITE
-    ); // if the file already exists in the new session, will overwrite it
+    // if the file already exists in the new session, will overwrite it
+    HsFile *fichierPcap = getHandshakeFile(Fs, apAddr, !fichierExiste);
     if (!fichierPcap) {
         Serial.println("Fail creating the EAPOL/Handshake PCAP file");
         return;
     }
 
-    if (!beacon && !fichierExiste) {
+    if (!fichierExiste) {
         Serial.println("New EAPOL/Handshake PCAP file, writing header");
-        SavedHS.insert(String((char *)apAddr, 6));
+        portENTER_CRITICAL(&hsMux);
+        SavedHS.insert(apKey);
+        portEXIT_CRITICAL(&hsMux);
         num_HS++;
-        writeHeader(fichierPcap);
-    }
-    if (beacon && fichierExiste) {
-        BeaconList ThisBeacon;
-        memcpy(ThisBeacon.MAC, (char *)apAddr, 6);
-        ThisBeacon.channel = ch;
-        if (registeredBeacons.find(ThisBeacon) != registeredBeacons.end()) {
-            return; // Beacon déjà enregistré pour ce BSSID
-        }
-        registeredBeacons.insert(ThisBeacon); // Ajouter le BSSID à l'ensemble
+        writeHeader(fichierPcap->file);
     }
 
     // Écrire l'en-tête du paquet et le paquet lui-même dans le fichier
     pcaprec_hdr_t pcap_packet_header;
-    pcap_packet_header.ts_sec = packet->rx_ctrl.timestamp / 1000000;
-    pcap_packet_header.ts_usec = packet->rx_ctrl.timestamp % 1000000;
-    pcap_packet_header.incl_len = packet->rx_ctrl.sig_len;
-    pcap_packet_header.orig_len = packet->rx_ctrl.sig_len;
-    fichierPcap.write((const byte *)&pcap_packet_header, sizeof(pcaprec_hdr_t));
-    fichierPcap.write(packet->payload, packet->rx_ctrl.sig_len);
-    fichierPcap.close();
+    pcap_packet_header.ts_sec = frame.timestamp / 1000000;
+    pcap_packet_header.ts_usec = frame.timestamp % 1000000;
+    pcap_packet_header.incl_len = frame.len;
+    pcap_packet_header.orig_len = frame.origLen;
+    fichierPcap->file.write((const byte *)&pcap_packet_header, sizeof(pcaprec_hdr_t));
+    fichierPcap->file.write(frame.data, frame.len);
+    fichierPcap->dirty = true;
 }
 
-void printAddress(const uint8_t *addr) {
-    for (int i = 0; i < 6; i++) {
-        Serial.printf("%02X", addr[i]);
-        if (i < 5) Serial.print(":");
+// Files stay open, so they are flushed from time to time instead of closed after every frame
+void flushHandshakeFiles() {
+    for (auto &f : hsFiles) {
+        if (f.file && f.dirty) f.file.flush();
+        f.dirty = false;
     }
-    Serial.println();
+    hsLastFlush = millis();
+}
+
+void handshakeWriterTask(void *param) {
+    static HsFrame frame; // only touched by this task
+    while (hsWriterRunning || uxQueueMessagesWaiting(hsQueue)) {
+        if (xQueueReceive(hsQueue, &frame, pdMS_TO_TICKS(100)) == pdTRUE) {
+            if (isLittleFS) saveHandshake(frame, LittleFS);
+            else saveHandshake(frame, SD);
+        }
+        if (millis() - hsLastFlush > HS_FLUSH_MS) flushHandshakeFiles();
+    }
+    closeHandshakeFiles();
+    hsWriterTask = NULL;
+    vTaskDelete(NULL);
+}
+
+bool startHandshakeWriter() {
+    if (hsWriterTask) return true;
+    if (!hsQueue) hsQueue = xQueueCreate(HS_QUEUE_LEN, sizeof(HsFrame)); // kept, the callback may use it
+    if (!hsQueue) return false;
+    xQueueReset(hsQueue);
+    hsDropped = 0;
+    hsWriterRunning = true;
+    TaskHandle_t task = NULL;
+    if (xTaskCreate(handshakeWriterTask, "HsWriter", 4096, NULL, 2, &task) != pdPASS) {
+        hsWriterRunning = false;
+        Serial.println("Fail creating the handshake writer task");
+        return false;
+    }
+    hsWriterTask = task;
+    return true;
+}
+
+void stopHandshakeWriter() {
+    if (!hsWriterTask) return;
+    hsWriterRunning = false;
+    while (hsWriterTask) vTaskDelay(pdMS_TO_TICKS(5));
+    if (hsDropped) Serial.printf("Handshake writer: %u frames dropped\n", hsDropped);
+}
+
+// Copies a frame for the handshake writer, never blocks the Wi-Fi task
+void queueHandshakeFrame(const wifi_promiscuous_pkt_t *packet, uint32_t len, bool beacon) {
+    if (!hsWriterTask) return;
+    static HsFrame frame; // only touched by the Wi-Fi task
+    frame.timestamp = packet->rx_ctrl.timestamp;
+    frame.origLen = len;
+    frame.len = min(len, (uint32_t)HS_FRAME_MAX);
+    frame.channel = ch;
+    frame.beacon = beacon;
+    memcpy(frame.data, packet->payload, frame.len);
+    if (xQueueSend(hsQueue, &frame, 0) != pdTRUE) hsDropped++;
 }
 
 /* write packet to file */
@@ -240,9 +401,10 @@ void sniffer(void *buf, wifi_promiscuous_pkt_type_t type) {
             len -= 4; // Need to remove last 4 bytes (for checksum) or packet gets malformed #
                       // https://github.com/espressif/esp-idf/issues/886
         }
-        newPacketSD(
-            timestamp, microseconds, len, pkt->payload, _pcap_file
-        ); // If it is to save everything, saves every packet
+        // If it is to save everything, saves every packet. Only copies it to the ring here,
+        // the writer task is the one that touches the filesystem
+        if (ringWriting) pcapRing.push(timestamp, microseconds, pkt->payload, len);
+        else newPacketSD(timestamp, microseconds, len, pkt->payload, _pcap_file);
     }
     packet_counter++;
 
@@ -251,40 +413,26 @@ void sniffer(void *buf, wifi_promiscuous_pkt_type_t type) {
     const uint8_t frameType = (frameControl & 0x0C) >> 2;
     const uint8_t frameSubType = (frameControl & 0xF0) >> 4;
 
+    ChannelStats *chStat = ch <= MAX_WIFI_CHANNEL ? &chStats[ch] : NULL;
+    if (chStat) chStat->frames++;
+
+    // Handshake files are written by the handshake writer task, frames are only copied here
     if (isItEAPOL(pkt)) {
         // if(_only_HS) newPacketSD(timestamp, microseconds, len, pkt->payload, _pcap_file);
         num_EAPOL++;
-        Serial.println("EAPOL detected.");
-        const uint8_t *receiverAddr = frame + 4;
-        const uint8_t *senderAddr = frame + 10;
-        Serial.print("Address MAC destination: ");
-        printAddress(receiverAddr);
-        Serial.print("Address MAC expedition: ");
-        printAddress(senderAddr);
-        if (isLittleFS) saveHandshake(pkt, false, LittleFS);
-        else saveHandshake(pkt, false, SD);
+        if (chStat) chStat->lastEapol = millis();
+        queueHandshakeFrame(pkt, ctrl.sig_len, false);
     }
-    if (frameType == 0x00 && frameSubType == 0x08) {
-        const uint8_t *senderAddr = frame + 10; // Adresse source dans la trame beacon
-
-        // Convertir l'adresse MAC en chaîne de caractères pour la comparaison
-        char macStr[18];
-        snprintf(
-            macStr,
-            sizeof(macStr),
-            "%02X:%02X:%02X:%02X:%02X:%02X",
-            senderAddr[0],
-            senderAddr[1],
-            senderAddr[2],
-            senderAddr[3],
-            senderAddr[4],
-            senderAddr[5]
-        );
-
-        pkt->rx_ctrl.sig_len -= 4; // Réduire la longueur du signal de 4 bytes
-        // Enregistrer le paquet
-        if (isLittleFS) saveHandshake(pkt, true, LittleFS);
-        else saveHandshake(pkt, true, SD);
+    if (frameType == 0x00 && frameSubType == 0x08 && ctrl.sig_len >= 24 + 4) {
+        if (chStat) chStat->beacons++;
+        // beacons are only saved in the files of the APs with a handshake
+        const uint8_t *addr1 = frame + 4;
+        const uint8_t *bssid = frame + 16;
+        uint64_t apKey = macToKey(memcmp(addr1, bssid, 6) == 0 ? addr1 : frame + 10);
+        portENTER_CRITICAL(&hsMux);
+        bool saved = SavedHS.contains(apKey);
+        portEXIT_CRITICAL(&hsMux);
+        if (saved) queueHandshakeFrame(pkt, ctrl.sig_len - 4, true); // without the FCS
     }
 }
 
@@ -329,6 +477,143 @@ void openFile(FS &Fs) {
     }
 }
 
+// Changes the channel without touching the promiscuous callback, closing the stats of the last visit.
+// Only called by the hopper task once it runs
+void setSnifferChannel(uint8_t newCh) {
+    unsigned long elapsed = millis() - visitStart;
+    if (ch <= MAX_WIFI_CHANNEL) {
+        ChannelStats &s = chStats[ch];
+        if (elapsed > 0) s.fps = (uint64_t)(s.frames - s.visitFrames) * 1000 / elapsed;
+        s.lastBeacons = s.beacons - s.visitBeacons;
+    }
+    ch = newCh;
+    esp_wifi_set_channel(ch, WIFI_SECOND_CHAN_NONE);
+    if (ch <= MAX_WIFI_CHANNEL) {
+        chStats[ch].visitFrames = chStats[ch].frames;
+        chStats[ch].visitBeacons = chStats[ch].beacons;
+    }
+    visitStart = millis();
+}
+
+// Adaptive dwell: stays longer where APs were seen, and keeps extending it while a handshake is going on
+uint32_t hopDwellFor(uint8_t channel) {
+    const ChannelStats &s = chStats[channel];
+    if (s.lastEapol != 0 && millis() - s.lastEapol < HOP_EAPOL_MS) return hopDwell * HOP_EAPOL_FACTOR;
+    return s.lastBeacons ? hopDwell * HOP_BEACON_FACTOR : hopDwell;
+}
+
+void hopTimerCallback(void *arg) {
+    TaskHandle_t task = hopTask;
+    if (task) xTaskNotify(task, HOP_REQ_TIMER, eSetBits);
+}
+
+void hopperTask(void *param) {
+    uint32_t req = 0;
+    while (!(req & HOP_REQ_QUIT)) {
+        xTaskNotifyWait(0, UINT32_MAX, &req, portMAX_DELAY);
+        if (req & HOP_REQ_NEXT) setSnifferChannel(ch >= hopMaxChannel ? 1 : ch + 1);
+        if (req & HOP_REQ_PREV) setSnifferChannel(ch <= 1 ? hopMaxChannel : ch - 1);
+        if (req & (HOP_REQ_NEXT | HOP_REQ_PREV)) Serial.println(ch);
+        if (!hopping) continue; // a timer that fired while hopping was being turned off
+
+        uint32_t dwell = 0;
+        if (req & HOP_REQ_TIMER) {
+            uint32_t stay = millis() - visitStart;
+            const ChannelStats &s = chStats[ch];
+            bool eapolNow = s.lastEapol != 0 && millis() - s.lastEapol < hopDwell;
+            if (eapolNow && stay < (uint32_t)hopDwell * HOP_EAPOL_FACTOR * 2) {
+                dwell = hopDwell;
+            } else {
+                setSnifferChannel(ch >= hopMaxChannel ? 1 : ch + 1);
+                dwell = hopDwellFor(ch);
+            }
+        } else if (req & HOP_REQ_ARM) {
+            dwell = hopDwellFor(ch);
+        }
+        if (dwell) {
+            esp_timer_stop(hopTimer);
+            esp_timer_start_once(hopTimer, (uint64_t)dwell * 1000);
+        }
+    }
+    hopTask = NULL;
+    vTaskDelete(NULL);
+}
+
+// Creates the hop timer and the hopper task, that owns the channel from now on
+bool startChannelHopper() {
+    if (!hopTimer) {
+        esp_timer_create_args_t args = {};
+        args.callback = &hopTimerCallback;
+        args.name = "ch_hop";
+        if (esp_timer_create(&args, &hopTimer) != ESP_OK) {
+            Serial.println("Fail creating the channel hopping timer");
+            return false;
+        }
+    }
+    TaskHandle_t task = NULL;
+    if (!hopTask && xTaskCreate(hopperTask, "ChHopper", 4096, NULL, 3, &task) != pdPASS) {
+        Serial.println("Fail creating the channel hopper task");
+        return false;
+    }
+    if (task) hopTask = task;
+    return true;
+}
+
+void stopChannelHopper() {
+    hopping = false;
+    if (hopTimer) {
+        esp_timer_stop(hopTimer);
+        esp_timer_delete(hopTimer);
+        hopTimer = NULL;
+    }
+    TaskHandle_t task = hopTask;
+    if (!task) return;
+    xTaskNotify(task, HOP_REQ_QUIT, eSetBits);
+    while (hopTask) vTaskDelay(pdMS_TO_TICKS(5));
+}
+
+void startChannelHopping() {
+    if (!hopTask) return;
+    hopping = true;
+    xTaskNotify(hopTask, HOP_REQ_ARM, eSetBits);
+}
+
+void stopChannelHopping() {
+    hopping = false;
+    if (hopTimer) esp_timer_stop(hopTimer);
+}
+
+// Manual channel change, done by the hopper task
+void stepSnifferChannel(bool next) {
+    if (hopTask) xTaskNotify(hopTask, next ? HOP_REQ_NEXT : HOP_REQ_PREV, eSetBits);
+}
+
+void printChannelStats() {
+    Serial.print("Frames/s per channel:");
+    for (uint8_t i = 1; i <= hopMaxChannel; i++) Serial.printf(" %d:%d", i, chStats[i].fps);
+    Serial.println();
+}
+
+// Bar graph with the frame rate of each channel, current channel highlighted
+void drawChannelStats(int y, int h) {
+    if (h < 8) return;
+    int w = (tftWidth - 20) / hopMaxChannel;
+    uint16_t maxFps = 1;
+    for (uint8_t i = 1; i <= hopMaxChannel; i++)
+        if (chStats[i].fps > maxFps) maxFps = chStats[i].fps;
+    tft.fillRect(10, y, w * hopMaxChannel, h, bruceConfig.bgColor);
+    for (uint8_t i = 1; i <= hopMaxChannel; i++) {
+        int barH = chStats[i].fps * (h - 1) / maxFps + 1;
+        tft.fillRect(
+            10 + (i - 1) * w,
+            y + h - barH,
+            w - 1,
+            barH,
+            i == ch ? getColorVariation(bruceConfig.priColor) : bruceConfig.priColor
+        );
+    }
+}
+
 //===== SETUP =====//
 void sniffer_setup() {
     FS *Fs;
@@ -336,6 +621,9 @@ void sniffer_setup() {
     String FileSys = "LittleFS";
     bool deauth = true;
     long deauth_tmp = 0;
+    int statsY = 0;
+    uint8_t statsPrint = 0;
+    const uint16_t dwellOptions[] = {100, HOP_INTERVAL, 500, 1000};
     drawMainBorderWithTitle("RAW SNIFFER");
 
     // closeSdCard();
@@ -349,12 +637,16 @@ void sniffer_setup() {
     } else Fs = &LittleFS; // if not, use the internal memory.
 
     openFile(*Fs);
+    ringWriting = pcapRing.begin() && pcapRing.startWriter(&_pcap_file);
+    if (!ringWriting) Serial.println("PCAP ring unavailable, writing packets directly");
     displayTextLine("Sniffing Started");
     tft.setTextSize(FP);
     tft.setCursor(80, 100);
 
+    stopHandshakeWriter();
     SavedHS.clear(); // Need to clear to restart HS count
     registeredBeacons.clear();
+    startHandshakeWriter();
     /* setup wifi */
     nvs_flash_init();
     ESP_ERROR_CHECK(esp_netif_init()); // novo
@@ -378,8 +670,12 @@ void sniffer_setup() {
     ESP_ERROR_CHECK(esp_wifi_start());
     esp_wifi_set_promiscuous(true);
     esp_wifi_set_promiscuous_rx_cb(sniffer);
-    wifi_second_chan_t secondCh = (wifi_second_chan_t)NULL;
-    esp_wifi_set_channel(ch, secondCh);
+    wifi_country_t country;
+    if (esp_wifi_get_country(&country) == ESP_OK && country.nchan > 0)
+        hopMaxChannel = min(country.schan + country.nchan - 1, 13);
+    memset(chStats, 0, sizeof(chStats));
+    setSnifferChannel(ch);
+    if (startChannelHopper() && CHANNEL_HOPPING) startChannelHopping();
 
     Serial.println("Sniffer started!");
     delay(1000);
@@ -400,19 +696,11 @@ void sniffer_setup() {
         }
         unsigned long currentTime = millis();
 
-        /* Channel Hopping */
+        /* Manual channel change, locks the channel until hopping is enabled again */
         if (check(NextPress)) {
-            esp_wifi_set_promiscuous(false);
-            esp_wifi_set_promiscuous_rx_cb(nullptr);
-            ch++; // increase channel
-            if (ch > MAX_CHANNEL) ch = 1;
-            Serial.println(ch);
-            wifi_second_chan_t secondCh = (wifi_second_chan_t)NULL;
-            esp_wifi_set_channel(ch, secondCh);
+            stopChannelHopping();
+            stepSnifferChannel(true); // increase channel
             redraw = true;
-            delay(50);
-            esp_wifi_set_promiscuous(true);
-            esp_wifi_set_promiscuous_rx_cb(sniffer);
         }
 
         if (check(PrevPress)) {
@@ -432,21 +720,12 @@ void sniffer_setup() {
                 );
             if (millis() - _tmp > 700) { // longpress detected to exit
                 returnToMenu = true;
-                _pcap_file.close();
                 break;
             }
 #endif
-            esp_wifi_set_promiscuous(false);
-            esp_wifi_set_promiscuous_rx_cb(nullptr);
-            ch--; // increase channel
-            if (ch < 1) ch = 11;
-            Serial.println(ch);
-            wifi_second_chan_t secondCh = (wifi_second_chan_t)NULL;
-            esp_wifi_set_channel(ch, secondCh);
+            stopChannelHopping();
+            stepSnifferChannel(false); // decrease channel
             redraw = true;
-            delay(50);
-            esp_wifi_set_promiscuous(true);
-            esp_wifi_set_promiscuous_rx_cb(sniffer);
         }
 
 #if defined(HAS_KEYBOARD) ||                                                                                 \
@@ -455,7 +734,6 @@ void sniffer_setup() {
     ) // T-Embed has a different btn for Escape, different from StickCs that uses Previous btn
         if (check(EscPress)) { // Apertar o botão power ou Esc
             returnToMenu = true;
-            _pcap_file.close();
             break;
         }
 #endif
@@ -468,23 +746,36 @@ void sniffer_setup() {
                      [=]() {
                          if (_pcap_file) { // for the first run, only draws the screen, after that, changes
                                            // files
-                             _pcap_file.flush(); // save file
+                             fileOpen = false;                       // update flag
+                             if (ringWriting) pcapRing.stopWriter(); // drains the ring and saves file
                              Serial.println("==================");
                              Serial.println(filename + " saved!");
                              Serial.println("==================");
-                             fileOpen = false; // update flag
                              _pcap_file.close();
                              c++;           // add to filename
                              openFile(*Fs); // open new file
+                             if (ringWriting) ringWriting = pcapRing.startWriter(&_pcap_file);
                          }
                      }                                                                          },
                     {deauth ? "Deauth->OFF" : "Deauth->ON",      [&]() { deauth = !deauth; }    },
+                    {hopping ? "Hopping->OFF" : "Hopping->ON",
+                     [=]() {
+                         if (hopping) stopChannelHopping();
+                         else startChannelHopping();
+                     }                                                                          },
+                    {"Dwell: " + String(hopDwell) + "ms",
+                     [&]() {
+                         uint8_t i = 0;
+                         while (i < 4 && dwellOptions[i] != hopDwell) i++;
+                         hopDwell = dwellOptions[(i + 1) % 4];
+                     }                                                                          },
                     {_only_HS ? "All packets" : "EAPOL/HS only", [=]() { _only_HS = !_only_HS; }},
                     {"Reset Counter",
                      [=]() {
                          packet_counter = 0;
                          num_EAPOL = 0;
                          num_HS = 0;
+                         pcapRing.resetStats();
                      }                                                                          },
                     {"Exit Sniffer",                             [=]() { returnToMenu = true; } },
                 };
@@ -501,25 +792,44 @@ void sniffer_setup() {
             padprintln("Sniffer Mode: " + String(_only_HS ? "Only EAPOL/HS" : "All packets Sniff"));
             padprintln(deauth ? "Deauth: ON" : "Deauth: OFF");
             padprintln(String(BTN_ALIAS) + ": Options Menu");
-            tft.drawRightString(
-                "Ch." + String(ch < 10 ? "0" : "") + String(ch) + "(Next)", tftWidth - 10, tftHeight - 18, 1
-            );
+            statsY = tft.getCursorY() + 4;
         }
 
         if (currentTime - lastTime > 100) tft.drawPixel(0, 0, 0);
 
         if (fileOpen && currentTime - lastTime > 1000) {
-            _pcap_file.flush();     // save file
-            lastTime = currentTime; // update time
+            lastTime = currentTime; // update time, file is flushed by the pcap writer task
             tft.drawString("EAPOL: " + String(num_EAPOL) + " HS: " + String(num_HS), 10, tftHeight - 18);
             tft.drawCentreString("Packets " + String(packet_counter), tftWidth / 2, tftHeight - 26, 1);
+            if (!_only_HS) {
+                String ringStats = "Direct writes";
+                if (pcapRing.lost()) ringStats = "Write errors, " + String(pcapRing.lost()) + "B lost";
+                else if (ringWriting)
+                    ringStats =
+                        "Ring " + String(pcapRing.highWaterPercent()) + "% Drops " + String(pcapRing.drops());
+                tft.drawCentreString(ringStats + "  ", tftWidth / 2, tftHeight - 34, 1);
+            }
+            tft.drawRightString(
+                " Ch." + String(ch < 10 ? "0" : "") + String(ch) + (hopping ? "(Hop)" : "(Next)"),
+                tftWidth - 10,
+                tftHeight - 18,
+                1
+            );
+            drawChannelStats(statsY, tftHeight - 38 - statsY);
+            if (++statsPrint >= 5) { // every 5 seconds
+                printChannelStats();
+                statsPrint = 0;
+            }
         }
 
         if (deauth && (millis() - deauth_tmp) > 60000) { // deauths once every 60 seconds
             if (registeredBeacons.size() > 40)
                 registeredBeacons.clear(); // Clear registered beacons to restart search and avoid restarts
             Serial.println("<<---- Starting Deauthentication Process ---->>");
-            for (auto registeredBeacon : registeredBeacons) {
+            bool wasHopping = hopping; // holds the channel while deauthing it
+            stopChannelHopping();
+            for (uint64_t beaconKey : registeredBeacons) {
+                BeaconList registeredBeacon = BeaconList::fromKey(beaconKey);
                 if (registeredBeacon.channel == ch) {
                     memcpy(&ap_record.bssid, registeredBeacon.MAC, 6);
                     wsl_bypasser_send_raw_frame(
@@ -529,13 +839,28 @@ void sniffer_setup() {
                     delay(2);
                 }
             }
+            if (wasHopping) startChannelHopping();
             deauth_tmp = millis();
         }
 
         vTaskDelay(100 / portTICK_PERIOD_MS);
     }
 Exit:
+    stopChannelHopper();
     esp_wifi_set_promiscuous(false);
+    fileOpen = false;
+    pcapRing.stopWriter(); // drains what is left on the ring before closing the file
+    Serial.printf(
+        "PCAP ring: %u bytes written, high-water %u/%u bytes, %u drops, %u bytes lost\n",
+        pcapRing.written(),
+        pcapRing.highWater(),
+        pcapRing.size(),
+        pcapRing.drops(),
+        pcapRing.lost()
+    );
+    pcapRing.end();
+    if (_pcap_file) _pcap_file.close();
+    stopHandshakeWriter(); // writes the frames still queued and closes the files
     esp_wifi_stop();
     esp_wifi_set_promiscuous_rx_cb(NULL);
     esp_wifi_deinit();
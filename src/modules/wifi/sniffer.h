@@ -3,19 +3,18 @@
 #include <FS.h>
 #include <SD.h>
 #include <WiFi.h>
-#include <set>
+#include "mac_set.h"
 
 struct BeaconList {
     char MAC[6];
     uint8_t channel;
-    // Define comparison operator to use <set>
-    bool operator<(const BeaconList &other) const {
-        // Compare MACs (using memcmp)
-        int cmp = memcmp(MAC, other.MAC, sizeof(MAC));
-        if (cmp != 0) {
-            return cmp < 0; // if MACs are diferent, compares lexicografically
-        }
-        return channel < other.channel; // If MACs are equal, compare by channel
+    // Key used in registeredBeacons: MAC on the lower 48 bits and the channel above it
+    uint64_t key() const { return macToKey((const uint8_t *)MAC) | ((uint64_t)channel << 48); }
+    static BeaconList fromKey(uint64_t key) {
+        BeaconList b;
+        keyToMac(key, (uint8_t *)b.MAC);
+        b.channel = (key >> 48) & 0xFF;
+        return b;
     }
 };
 
@@ -27,8 +26,13 @@ extern uint8_t ch;
 
 void setHandshakeSniffer();
 
-extern std::set<BeaconList> registeredBeacons;
-extern std::set<String> SavedHS;
+extern MacSet<64> registeredBeacons; // BeaconList::key() of the APs found, used to deauth them
+extern MacSet<256> SavedHS;          // Packed BSSIDs of the handshakes saved in the session
+
+// Task that writes the handshake frames found by sniffer() to their pcap files, the callback only
+// queues them. Stopping it writes what is still queued and closes the files, once the capture ends
+bool startHandshakeWriter();
+void stopHandshakeWriter();
 
 void newPacketSD(uint32_t ts_sec, uint32_t ts_usec, uint32_t len, uint8_t *buf, File pcap_file);
 
@@ -0,0 +1,201 @@
+// Host stand-in of the Arduino core for the native tests: only what the tested modules use
+#ifndef __STUB_ARDUINO_H__
+#define __STUB_ARDUINO_H__
+
+#include <algorithm>
+#include <chrono>
+#include <ctype.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+
+using std::max;
+using std::min;
+
+typedef uint8_t byte;
+
+#define HEX 16
+#define DEC 10
+#define PROGMEM
+
+inline unsigned long millis() {
+    using namespace std::chrono;
+    static const steady_clock::time_point start = steady_clock::now();
+    return duration_cast<milliseconds>(steady_clock::now() - start).count();
+}
+inline unsigned long micros() {
+    using namespace std::chrono;
+    static const steady_clock::time_point start = steady_clock::now();
+    return duration_cast<microseconds>(steady_clock::now() - start).count();
+}
+inline void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline void delayMicroseconds(unsigned int us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+inline void yield() {}
+
+inline bool psramFound() { return false; }
+inline void *ps_malloc(size_t size) { return malloc(size); }
+inline void *ps_calloc(size_t n, size_t size) { return calloc(n, size); }
+inline void *ps_realloc(void *ptr, size_t size) { return realloc(ptr, size); }
+
+class String {
+public:
+    String() {}
+    String(const char *s) : _s(s ? s : "") {}
+    String(const std::string &s) : _s(s) {}
+    String(char c) : _s(1, c) {}
+    String(int v, unsigned char base = DEC) : _s(fromLong(v, base)) {}
+    String(unsigned int v, unsigned char base = DEC) : _s(fromLong(v, base)) {}
+    String(long v, unsigned char base = DEC) : _s(fromLong(v, base)) {}
+    String(unsigned long v, unsigned char base = DEC) : _s(fromLong(v, base)) {}
+
+    const char *c_str() const { return _s.c_str(); }
+    unsigned int length() const { return _s.size(); }
+    bool isEmpty() const { return _s.empty(); }
+    bool reserve(unsigned int size) {
+        _s.reserve(size);
+        return true;
+    }
+    char charAt(unsigned int i) const { return i < _s.size() ? _s[i] : 0; }
+    char operator[](unsigned int i) const { return charAt(i); }
+    char &operator[](unsigned int i) { return _s[i]; }
+
+    bool concat(const String &s) {
+        _s += s._s;
+        return true;
+    }
+    bool concat(const char *s) {
+        _s += s;
+        return true;
+    }
+    bool concat(char c) {
+        _s += c;
+        return true;
+    }
+    bool concat(const char *s, unsigned int len) {
+        _s.append(s, len);
+        return true;
+    }
+    String &operator+=(const String &s) {
+        _s += s._s;
+        return *this;
+    }
+    String &operator+=(const char *s) {
+        _s += s;
+        return *this;
+    }
+    String &operator+=(char c) {
+        _s += c;
+        return *this;
+    }
+    friend String operator+(const String &a, const String &b) { return String(a._s + b._s); }
+    friend String operator+(const String &a, const char *b) { return String(a._s + b); }
+    friend String operator+(const char *a, const String &b) { return String(a + b._s); }
+    friend String operator+(const String &a, char b) { return String(a._s + b); }
+
+    bool operator==(const String &s) const { return _s == s._s; }
+    bool operator==(const char *s) const { return _s == s; }
+    bool operator!=(const String &s) const { return _s != s._s; }
+    bool operator!=(const char *s) const { return _s != s; }
+    bool operator<(const String &s) const { return _s < s._s; }
+    bool equals(const String &s) const { return _s == s._s; }
+    bool equalsIgnoreCase(const String &s) const {
+        if (_s.size() != s._s.size()) return false;
+        for (size_t i = 0; i < _s.size(); i++) {
+            if (tolower((unsigned char)_s[i]) != tolower((unsigned char)s._s[i])) return false;
+        }
+        return true;
+    }
+    bool startsWith(const String &s) const { return _s.compare(0, s._s.size(), s._s) == 0; }
+    bool endsWith(const String &s) const {
+        return _s.size() >= s._s.size() && _s.compare(_s.size() - s._s.size(), s._s.size(), s._s) == 0;
+    }
+
+    int indexOf(char c, unsigned int from = 0) const { return found(_s.find(c, from)); }
+    int indexOf(const String &s, unsigned int from = 0) const { return found(_s.find(s._s, from)); }
+    int lastIndexOf(char c) const { return found(_s.rfind(c)); }
+    int lastIndexOf(const String &s) const { return found(_s.rfind(s._s)); }
+    String substring(unsigned int from) const { return substring(from, _s.size()); }
+    String substring(unsigned int from, unsigned int to) const {
+        if (from > to) std::swap(from, to);
+        if (from >= _s.size()) return String();
+        return String(_s.substr(from, min((size_t)to, _s.size()) - from));
+    }
+
+    void trim() {
+        size_t b = 0, e = _s.size();
+        while (b < e && isspace((unsigned char)_s[b])) b++;
+        while (e > b && isspace((unsigned char)_s[e - 1])) e--;
+        _s = _s.substr(b, e - b);
+    }
+    void toLowerCase() {
+        for (char &c : _s) c = tolower((unsigned char)c);
+    }
+    void toUpperCase() {
+        for (char &c : _s) c = toupper((unsigned char)c);
+    }
+    void replace(const String &from, const String &to) {
+        if (from._s.empty()) return;
+        for (size_t i = _s.find(from._s); i != std::string::npos; i = _s.find(from._s, i + to._s.size())) {
+            _s.replace(i, from._s.size(), to._s);
+        }
+    }
+    void remove(unsigned int index, unsigned int count = (unsigned int)-1) {
+        if (index < _s.size()) _s.erase(index, count);
+    }
+    long toInt() const { return strtol(_s.c_str(), nullptr, 10); }
+    float toFloat() const { return strtof(_s.c_str(), nullptr); }
+
+private:
+    static int found(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+    static std::string fromLong(long long v, unsigned char base) {
+        char txt[24];
+        if (base == HEX) snprintf(txt, sizeof(txt), "%llx", (unsigned long long)v);
+        else snprintf(txt, sizeof(txt), "%lld", v);
+        return txt;
+    }
+
+    std::string _s;
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buf, size_t len) {
+        size_t n = 0;
+        while (len-- && write(*buf++)) n++;
+        return n;
+    }
+    size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+    size_t print(const String &s) { return write((const uint8_t *)s.c_str(), s.length()); }
+    size_t println() { return print("\r\n"); }
+    size_t println(const String &s) { return print(s) + println(); }
+};
+
+class Stream : public Print {};
+
+// Serial output goes to stdout, so the tests show the modules' logs
+class HardwareSerial {
+public:
+    int printf(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, format);
+        int n = vprintf(format, args);
+        va_end(args);
+        return n;
+    }
+    size_t print(const String &s) { return fputs(s.c_str(), stdout) < 0 ? 0 : s.length(); }
+    size_t println(const String &s = String()) { return print(s) + print("\n"); }
+    size_t write(const uint8_t *buf, size_t len) { return fwrite(buf, 1, len, stdout); }
+    int availableForWrite() { return 256; }
+};
+
+static HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,163 @@
+// Host stand-in of the Arduino FS: files live in memory. A file can be told to take only so many
+// bytes, for the tests of a full or removed card. Folders are listed in name order
+#ifndef __STUB_FS_H__
+#define __STUB_FS_H__
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+struct FileData {
+    std::string path;
+    std::string data;
+    size_t writeLimit = (size_t)-1; // size the file can't grow past
+    bool directory = false;
+    std::vector<std::shared_ptr<FileData>> entries; // of a folder, when it was opened
+};
+
+class File {
+public:
+    File() {}
+    File(std::shared_ptr<FileData> data, bool append = false) : _data(data) {
+        if (append) _pos = data->data.size();
+    }
+
+    operator bool() const { return _data != nullptr; }
+    bool isDirectory() const { return _data && _data->directory; }
+    File openNextFile() {
+        if (!isDirectory() || _pos >= _data->entries.size()) return File();
+        return File(_data->entries[_pos++]);
+    }
+
+    size_t write(const uint8_t *buf, size_t len) {
+        if (!_data) return 0;
+        std::string &d = _data->data;
+        size_t room = _pos < _data->writeLimit ? _data->writeLimit - _pos : 0;
+        if (len > room) len = room;
+        if (_pos > d.size()) d.resize(_pos);
+        d.replace(_pos, min(len, d.size() - _pos), (const char *)buf, len);
+        _pos += len;
+        return len;
+    }
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t print(const String &s) { return write((const uint8_t *)s.c_str(), s.length()); }
+    size_t println(const String &s = String()) { return print(s) + print("\n"); }
+
+    int available() { return _data && _pos < _data->data.size() ? _data->data.size() - _pos : 0; }
+    int peek() { return available() ? (uint8_t)_data->data[_pos] : -1; }
+    int read() { return available() ? (uint8_t)_data->data[_pos++] : -1; }
+    size_t read(uint8_t *buf, size_t len) {
+        len = min(len, (size_t)available());
+        if (len) memcpy(buf, _data->data.data() + _pos, len);
+        _pos += len;
+        return len;
+    }
+    String readStringUntil(char terminator) {
+        String s;
+        int c;
+        while ((c = read()) >= 0 && c != terminator) s += (char)c;
+        return s;
+    }
+    bool seek(uint32_t pos) {
+        if (!_data || pos > _data->data.size()) return false;
+        _pos = pos;
+        return true;
+    }
+    size_t position() const { return _pos; }
+    size_t size() const { return _data ? _data->data.size() : 0; }
+    void flush() {}
+    void close() { _data = nullptr; }
+    const char *path() const { return _data ? _data->path.c_str() : ""; }
+    const char *name() const {
+        if (!_data) return "";
+        size_t slash = _data->path.rfind('/');
+        return _data->path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+    }
+
+private:
+    std::shared_ptr<FileData> _data;
+    size_t _pos = 0;
+};
+
+class FS {
+public:
+    // Writing a file creates its folders
+    File open(const String &path, const char *mode = FILE_READ) {
+        auto it = _files.find(path.c_str());
+        if (*mode == 'r') {
+            if (it != _files.end()) return File(it->second);
+            return isDir(path.c_str()) ? File(listing(path.c_str())) : File();
+        }
+        if (it == _files.end() || *mode == 'w') {
+            auto data = std::make_shared<FileData>();
+            data->path = path.c_str();
+            it = _files.insert_or_assign(path.c_str(), data).first;
+            mkdir(parent(path.c_str()));
+        }
+        return File(it->second, *mode == 'a');
+    }
+    bool exists(const String &path) { return _files.count(path.c_str()) > 0 || isDir(path.c_str()); }
+    bool remove(const String &path) { return _files.erase(path.c_str()) > 0; }
+    bool rename(const String &from, const String &to) {
+        auto it = _files.find(from.c_str());
+        if (it == _files.end()) return false;
+        auto data = it->second;
+        _files.erase(it);
+        data->path = to.c_str();
+        _files[to.c_str()] = data;
+        return true;
+    }
+    bool mkdir(const String &path) {
+        for (std::string dir = path.c_str(); dir.size() > 1; dir = parent(dir)) _dirs.insert(dir);
+        return true;
+    }
+
+    // Test access to the contents
+    FileData *data(const String &path) {
+        auto it = _files.find(path.c_str());
+        return it == _files.end() ? nullptr : it->second.get();
+    }
+
+private:
+    static std::string parent(const std::string &path) {
+        size_t slash = path.rfind('/');
+        return slash == 0 || slash == std::string::npos ? "/" : path.substr(0, slash);
+    }
+    bool isDir(const std::string &path) { return path == "/" || _dirs.count(path) > 0; }
+    std::shared_ptr<FileData> listing(const std::string &path) {
+        auto dir = std::make_shared<FileData>();
+        dir->path = path;
+        dir->directory = true;
+        std::map<std::string, std::shared_ptr<FileData>> entries;
+        for (auto &file : _files) {
+            if (parent(file.first) == path) entries[file.first] = file.second;
+        }
+        for (const std::string &sub : _dirs) {
+            if (parent(sub) != path) continue;
+            auto entry = std::make_shared<FileData>();
+            entry->path = sub;
+            entry->directory = true;
+            entries[sub] = entry;
+        }
+        for (auto &entry : entries) dir->entries.push_back(entry.second);
+        return dir;
+    }
+
+    std::map<std::string, std::shared_ptr<FileData>> _files;
+    std::set<std::string> _dirs;
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+
+#endif
@@ -0,0 +1,9 @@
+// Host stand-in of LittleFS.h: an in-memory FS, defined by the tests that use it
+#ifndef __STUB_LITTLEFS_H__
+#define __STUB_LITTLEFS_H__
+
+#include <FS.h>
+
+extern FS LittleFS;
+
+#endif
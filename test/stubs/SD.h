@@ -0,0 +1,9 @@
+// Host stand-in of SD.h: the card is an in-memory FS, defined by the tests that use it
+#ifndef __STUB_SD_H__
+#define __STUB_SD_H__
+
+#include <FS.h>
+
+extern FS SD;
+
+#endif
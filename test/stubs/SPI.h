@@ -0,0 +1,7 @@
+// Host stand-in of SPI.h: the tested modules only include it through sd_functions.h
+#ifndef __STUB_SPI_H__
+#define __STUB_SPI_H__
+
+class SPIClass {};
+
+#endif
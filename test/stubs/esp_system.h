@@ -0,0 +1,13 @@
+// Host stand-in of esp_system.h: the random numbers of the tests are repeatable
+#ifndef __STUB_ESP_SYSTEM_H__
+#define __STUB_ESP_SYSTEM_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+
+inline uint32_t esp_random() { return (uint32_t)rand(); }
+inline void esp_fill_random(void *buf, size_t len) {
+    for (size_t i = 0; i < len; i++) ((uint8_t *)buf)[i] = rand();
+}
+
+#endif
@@ -0,0 +1,59 @@
+// Host stand-in of the FreeRTOS tasks: a thread each, with the notification value of xTaskNotifyGive()
+#ifndef __STUB_FREERTOS_TASK_H__
+#define __STUB_FREERTOS_TASK_H__
+
+#include "FreeRTOS.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+typedef void (*TaskFunction_t)(void *);
+
+struct StubTask {
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint32_t notified = 0;
+};
+typedef StubTask *TaskHandle_t;
+
+inline TaskHandle_t &stubCurrentTask() {
+    static thread_local TaskHandle_t task = nullptr;
+    return task;
+}
+
+// The task objects are never freed, a handle may still be notified while its task ends
+inline BaseType_t xTaskCreate(
+    TaskFunction_t fn, const char *, uint32_t, void *param, UBaseType_t, TaskHandle_t *handle
+) {
+    TaskHandle_t task = new StubTask;
+    if (handle) *handle = task;
+    std::thread([=]() {
+        stubCurrentTask() = task;
+        fn(param);
+    }).detach();
+    return pdPASS;
+}
+
+// Task functions end right after it, returning ends the thread
+inline void vTaskDelete(TaskHandle_t) {}
+
+inline void vTaskDelay(TickType_t ticks) { std::this_thread::sleep_for(std::chrono::milliseconds(ticks)); }
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    std::lock_guard<std::mutex> lock(task->mutex);
+    task->notified++;
+    task->cv.notify_one();
+    return pdPASS;
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+    TaskHandle_t task = stubCurrentTask();
+    std::unique_lock<std::mutex> lock(task->mutex);
+    task->cv.wait_for(lock, std::chrono::milliseconds(ticks), [&]() { return task->notified > 0; });
+    uint32_t value = task->notified;
+    if (value) task->notified = clear ? 0 : value - 1;
+    return value;
+}
+
+#endif
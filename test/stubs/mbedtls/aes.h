@@ -0,0 +1,45 @@
+// Host stand-in of the mbedtls AES used by the tested modules, over OpenSSL (-lcrypto)
+#ifndef __STUB_MBEDTLS_AES_H__
+#define __STUB_MBEDTLS_AES_H__
+
+#include <openssl/evp.h>
+#include <stddef.h>
+#include <string.h>
+
+struct mbedtls_aes_context {
+    EVP_CIPHER_CTX *ctx;
+};
+
+inline void mbedtls_aes_init(mbedtls_aes_context *aes) { aes->ctx = EVP_CIPHER_CTX_new(); }
+inline void mbedtls_aes_free(mbedtls_aes_context *aes) {
+    EVP_CIPHER_CTX_free(aes->ctx);
+    aes->ctx = nullptr;
+}
+
+inline int mbedtls_aes_setkey_enc(mbedtls_aes_context *aes, const unsigned char *key, unsigned int bits) {
+    const EVP_CIPHER *cipher = bits == 256 ? EVP_aes_256_ecb() : bits == 128 ? EVP_aes_128_ecb() : nullptr;
+    if (!cipher || EVP_EncryptInit_ex(aes->ctx, cipher, nullptr, key, nullptr) != 1) return -1;
+    EVP_CIPHER_CTX_set_padding(aes->ctx, 0);
+    return 0;
+}
+
+// Same stream state as mbedtls: the offset in `stream_block`, the key stream of `nonce_counter` - 1
+inline int mbedtls_aes_crypt_ctr(
+    mbedtls_aes_context *aes, size_t length, size_t *nc_off, unsigned char nonce_counter[16],
+    unsigned char stream_block[16], const unsigned char *input, unsigned char *output
+) {
+    size_t n = *nc_off;
+    for (size_t i = 0; i < length; i++) {
+        if (n == 0) {
+            int len = 0;
+            EVP_EncryptUpdate(aes->ctx, stream_block, &len, nonce_counter, 16);
+            for (int j = 15; j >= 0 && ++nonce_counter[j] == 0; j--);
+        }
+        output[i] = input[i] ^ stream_block[n];
+        n = (n + 1) & 15;
+    }
+    *nc_off = n;
+    return 0;
+}
+
+#endif
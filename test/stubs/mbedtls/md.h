@@ -0,0 +1,55 @@
+// Host stand-in of the mbedtls HMAC-SHA256 used by the tested modules, over OpenSSL (-lcrypto)
+#ifndef __STUB_MBEDTLS_MD_H__
+#define __STUB_MBEDTLS_MD_H__
+
+#include <openssl/core_names.h>
+#include <openssl/evp.h>
+#include <stddef.h>
+
+typedef enum { MBEDTLS_MD_NONE = 0, MBEDTLS_MD_SHA256 = 6 } mbedtls_md_type_t;
+
+struct mbedtls_md_info_t {
+    mbedtls_md_type_t type;
+};
+
+struct mbedtls_md_context_t {
+    EVP_MAC_CTX *hmac;
+};
+
+inline const mbedtls_md_info_t *mbedtls_md_info_from_type(mbedtls_md_type_t type) {
+    static const mbedtls_md_info_t sha256 = {MBEDTLS_MD_SHA256};
+    return type == MBEDTLS_MD_SHA256 ? &sha256 : nullptr;
+}
+
+inline void mbedtls_md_init(mbedtls_md_context_t *ctx) { ctx->hmac = nullptr; }
+inline void mbedtls_md_free(mbedtls_md_context_t *ctx) {
+    EVP_MAC_CTX_free(ctx->hmac);
+    ctx->hmac = nullptr;
+}
+
+inline int mbedtls_md_setup(mbedtls_md_context_t *ctx, const mbedtls_md_info_t *info, int hmac) {
+    if (!info || !hmac) return -1;
+    EVP_MAC *mac = EVP_MAC_fetch(nullptr, "HMAC", nullptr);
+    ctx->hmac = mac ? EVP_MAC_CTX_new(mac) : nullptr;
+    EVP_MAC_free(mac);
+    return ctx->hmac ? 0 : -1;
+}
+
+inline int mbedtls_md_hmac_starts(mbedtls_md_context_t *ctx, const unsigned char *key, size_t keylen) {
+    char digest[] = "SHA256";
+    OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest, 0), OSSL_PARAM_construct_end()
+    };
+    return EVP_MAC_init(ctx->hmac, key, keylen, params) == 1 ? 0 : -1;
+}
+
+inline int mbedtls_md_hmac_update(mbedtls_md_context_t *ctx, const unsigned char *input, size_t len) {
+    return EVP_MAC_update(ctx->hmac, input, len) == 1 ? 0 : -1;
+}
+
+inline int mbedtls_md_hmac_finish(mbedtls_md_context_t *ctx, unsigned char *output) {
+    size_t len = 0;
+    return EVP_MAC_final(ctx->hmac, output, &len, 32) == 1 ? 0 : -1;
+}
+
+#endif
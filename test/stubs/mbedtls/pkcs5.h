@@ -0,0 +1,19 @@
+// Host stand-in of the mbedtls PBKDF2 used by the tested modules, over OpenSSL (-lcrypto)
+#ifndef __STUB_MBEDTLS_PKCS5_H__
+#define __STUB_MBEDTLS_PKCS5_H__
+
+#include "md.h"
+#include <openssl/evp.h>
+
+// Always HMAC-SHA256, the only one set up in `ctx` by the tested modules
+inline int mbedtls_pkcs5_pbkdf2_hmac(
+    mbedtls_md_context_t *, const unsigned char *password, size_t plen, const unsigned char *salt,
+    size_t slen, unsigned int iterations, uint32_t key_length, unsigned char *output
+) {
+    int ok = PKCS5_PBKDF2_HMAC(
+        (const char *)password, plen, salt, slen, iterations, EVP_sha256(), key_length, output
+    );
+    return ok == 1 ? 0 : -1;
+}
+
+#endif
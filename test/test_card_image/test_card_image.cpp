@@ -0,0 +1,106 @@
+// Host tests of CardImage, the text of .rfid files to binary and back: pio test -e native
+#include "../../src/modules/rfid/card_image.cpp"
+#include <string>
+#include <unity.h>
+#include <vector>
+
+static std::vector<std::string> textOf(const CardImage &image) {
+    std::vector<std::string> lines;
+    image.toText([&](const char *line) { lines.push_back(line); });
+    return lines;
+}
+
+static void parseAll(CardImage &image, const std::vector<std::string> &lines) {
+    for (const std::string &line : lines) TEST_ASSERT_TRUE_MESSAGE(image.parseLine(line.c_str()), line.c_str());
+}
+
+// Mifare Classic 1K with gaps: sectors that couldn't be opened leave their blocks unread
+static void test_classic_round_trip(void) {
+    CardImage image;
+    TEST_ASSERT_TRUE(image.begin(16, 64));
+    uint8_t block[16];
+    for (uint16_t b = 0; b < 64; b++) {
+        if (b / 4 == 5) continue;
+        for (int i = 0; i < 16; i++) block[i] = b * 16 + i;
+        TEST_ASSERT_TRUE(image.setPage(b, block));
+    }
+    const uint8_t keyA[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    const uint8_t keyB[6] = {0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5};
+    image.setKey(0, false, keyA);
+    image.setKey(15, true, keyB);
+
+    std::vector<std::string> lines = textOf(image);
+    TEST_ASSERT_EQUAL(60 + 2, lines.size());
+    TEST_ASSERT_EQUAL_STRING("Page 0: 00 01 02 03 04 05 06 07 08 09 0A 0B 0C 0D 0E 0F", lines[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("Key B 15: A0 A1 A2 A3 A4 A5", lines.back().c_str());
+
+    CardImage parsed;
+    parseAll(parsed, lines);
+    TEST_ASSERT_EQUAL(16, parsed.pageSize());
+    TEST_ASSERT_EQUAL(60, parsed.pagesRead());
+    TEST_ASSERT_FALSE(parsed.isRead(20));
+    for (uint16_t b = 0; b < 64; b++) {
+        if (!image.isRead(b)) continue;
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(image.page(b), parsed.page(b), 16);
+    }
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(keyA, parsed.key(0, false), 6);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(keyB, parsed.key(15, true), 6);
+    TEST_ASSERT_NULL(parsed.key(0, true));
+    TEST_ASSERT_EQUAL_UINT32(image.checksum(), parsed.checksum());
+    TEST_ASSERT_TRUE(textOf(parsed) == lines);
+}
+
+// NTAG215 pages, written by hand: lower case and no spaces are read too
+static void test_ultralight_text_round_trip(void) {
+    CardImage parsed;
+    TEST_ASSERT_TRUE(parsed.parseLine("Page 0: 04 A1 B2 97"));
+    TEST_ASSERT_TRUE(parsed.parseLine("Page 1: deadbeef"));
+    TEST_ASSERT_TRUE(parsed.parseLine("Page 134: 00 00 00 BD"));
+    TEST_ASSERT_EQUAL(4, parsed.pageSize());
+    TEST_ASSERT_EQUAL(135, parsed.pages());
+    TEST_ASSERT_EQUAL(3, parsed.pagesRead());
+
+    std::vector<std::string> lines = textOf(parsed);
+    TEST_ASSERT_EQUAL(3, lines.size());
+    TEST_ASSERT_EQUAL_STRING("Page 0: 04 A1 B2 97", lines[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("Page 1: DE AD BE EF", lines[1].c_str());
+    TEST_ASSERT_EQUAL_STRING("Page 134: 00 00 00 BD", lines[2].c_str());
+}
+
+static void test_felica_keeps_block_label(void) {
+    CardImage image;
+    TEST_ASSERT_TRUE(image.begin(16, 4, "Block"));
+    const uint8_t block[16] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+    image.setPage(3, block);
+
+    std::vector<std::string> lines = textOf(image);
+    TEST_ASSERT_EQUAL_STRING("Block 3: 01 02 03 04 05 06 07 08 09 0A 0B 0C 0D 0E 0F 10", lines[0].c_str());
+    CardImage parsed;
+    parseAll(parsed, lines);
+    TEST_ASSERT_TRUE(textOf(parsed) == lines);
+}
+
+// The other lines of a .rfid file are left to the caller
+static void test_rejects_other_lines(void) {
+    CardImage parsed;
+    TEST_ASSERT_FALSE(parsed.parseLine("Filetype: Bruce RFID File"));
+    TEST_ASSERT_FALSE(parsed.parseLine("Pages total: 135"));
+    TEST_ASSERT_FALSE(parsed.parseLine("Pages read: 135"));
+    TEST_ASSERT_FALSE(parsed.parseLine("Key A 0: FF FF FF FF FF FF")); // before any page
+    TEST_ASSERT_FALSE(parsed.parseLine("Page 0: 04 A1 B2"));
+    TEST_ASSERT_FALSE(parsed.parseLine("Page 0: 04 A1 B2 9"));
+    TEST_ASSERT_TRUE(parsed.parseLine("Page 0: 04 A1 B2 97"));
+    TEST_ASSERT_FALSE(parsed.parseLine("Page 1: 00 01 02 03 04 05 06 07 08 09 0A 0B 0C 0D 0E 0F")); // size
+    TEST_ASSERT_FALSE(parsed.parseLine("Page 1024: 00 00 00 00"));                                  // too far
+    TEST_ASSERT_FALSE(parsed.parseLine("Key A 40: FF FF FF FF FF FF"));
+    TEST_ASSERT_EQUAL(1, parsed.pagesRead());
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_classic_round_trip);
+    RUN_TEST(test_ultralight_text_round_trip);
+    RUN_TEST(test_felica_keeps_block_label);
+    RUN_TEST(test_rejects_other_lines);
+    return UNITY_END();
+}
@@ -0,0 +1,136 @@
+// Host tests of CryptoStream, the Bruce Encrypted Files version 2: pio test -e native
+#include "../../src/core/crypto_stream.cpp"
+#include <string>
+#include <unity.h>
+#include <vector>
+
+static const char *PASSWORD = "hunter2";
+
+static std::string plaintextOf(size_t len) {
+    std::string data(len, 0);
+    for (size_t i = 0; i < len; i++) data[i] = (char)(i * 31 + i / 251);
+    return data;
+}
+
+// Encrypts in chunks of varying size, so the key stream is cut at any offset of an AES block
+static void encryptTo(FS &fs, const char *path, const std::string &plain) {
+    File file = fs.open(path, FILE_WRITE);
+    CryptoStream cs;
+    uint8_t header[ENC_HEADER_SIZE];
+    TEST_ASSERT_TRUE(cs.beginEncrypt(PASSWORD, header));
+    file.write(header, sizeof(header));
+    std::vector<uint8_t> buf(plain.begin(), plain.end());
+    const size_t steps[] = {1, 7, 16, 250, 513, 4099};
+    size_t pos = 0;
+    for (int i = 0; pos < buf.size(); i++) {
+        size_t n = min(steps[i % 6], buf.size() - pos);
+        cs.update(buf.data() + pos, buf.data() + pos, n);
+        pos += n;
+    }
+    file.write(buf.data(), buf.size());
+    uint8_t tag[ENC_TAG_SIZE];
+    cs.finish(tag);
+    file.write(tag, sizeof(tag));
+}
+
+// Checks the file, then decrypts it by `chunk` bytes, as readDecryptedFile() does
+static bool decryptFrom(FS &fs, const char *path, std::string &plain, size_t chunk, const char *password) {
+    File file = fs.open(path, FILE_READ);
+    CryptoStream cs;
+    size_t dataLen = 0;
+    if (!openEncryptedFile(file, password, cs, dataLen)) return false;
+    plain.clear();
+    std::vector<uint8_t> buf(chunk);
+    while (dataLen > 0) {
+        size_t n = file.read(buf.data(), min(dataLen, chunk));
+        if (n == 0) return false;
+        cs.update(buf.data(), buf.data(), n);
+        plain.append((const char *)buf.data(), n);
+        dataLen -= n;
+    }
+    return true;
+}
+
+static void roundTrip(size_t len) {
+    char label[32];
+    snprintf(label, sizeof(label), "%zu bytes", len);
+    FS fs;
+    std::string plain = plaintextOf(len);
+    encryptTo(fs, "/data.enc", plain);
+    TEST_ASSERT_EQUAL_MESSAGE(ENC_HEADER_SIZE + len + ENC_TAG_SIZE, fs.data("/data.enc")->data.size(), label);
+    File file = fs.open("/data.enc");
+    TEST_ASSERT_TRUE_MESSAGE(isStreamEncrypted(file), label);
+    TEST_ASSERT_EQUAL_MESSAGE(0, file.position(), label);
+
+    for (size_t chunk : {256, 512, 4096, 1000}) {
+        std::string decrypted;
+        TEST_ASSERT_TRUE_MESSAGE(decryptFrom(fs, "/data.enc", decrypted, chunk, PASSWORD), label);
+        TEST_ASSERT_TRUE_MESSAGE(decrypted == plain, label);
+    }
+}
+
+// Just below, on and just above the AES block, the read buffers of openEncryptedFile() and of
+// readDecryptedFile(), and the file buffers
+static void test_round_trip_boundaries(void) {
+    roundTrip(0);
+    for (size_t boundary : {16, 256, 512, 4096, 65536}) {
+        roundTrip(boundary - 1);
+        roundTrip(boundary);
+        roundTrip(boundary + 1);
+    }
+}
+
+static void test_round_trip_large(void) { roundTrip(3 * 1024 * 1024 + 7); }
+
+static void test_rejects_tampering(void) {
+    FS fs;
+    std::string plain = plaintextOf(1000);
+    std::string decrypted;
+    encryptTo(fs, "/data.enc", plain);
+    std::string &data = fs.data("/data.enc")->data;
+    const std::string original = data;
+    TEST_ASSERT_TRUE(decryptFrom(fs, "/data.enc", decrypted, 256, PASSWORD));
+
+    TEST_ASSERT_FALSE(decryptFrom(fs, "/data.enc", decrypted, 256, "hunter3"));
+
+    data[data.size() - 1] ^= 0x01; // tag
+    TEST_ASSERT_FALSE(decryptFrom(fs, "/data.enc", decrypted, 256, PASSWORD));
+    data = original;
+    data[ENC_HEADER_SIZE + 500] ^= 0x80; // ciphertext
+    TEST_ASSERT_FALSE(decryptFrom(fs, "/data.enc", decrypted, 256, PASSWORD));
+    data = original;
+    data[13] ^= 0x01; // salt, authenticated with the header
+    TEST_ASSERT_FALSE(decryptFrom(fs, "/data.enc", decrypted, 256, PASSWORD));
+    data = original;
+    data.resize(data.size() - 1); // truncated
+    TEST_ASSERT_FALSE(decryptFrom(fs, "/data.enc", decrypted, 256, PASSWORD));
+    data = original.substr(0, ENC_HEADER_SIZE + ENC_TAG_SIZE - 1);
+    TEST_ASSERT_FALSE(decryptFrom(fs, "/data.enc", decrypted, 256, PASSWORD));
+
+    data = original;
+    TEST_ASSERT_TRUE(decryptFrom(fs, "/data.enc", decrypted, 256, PASSWORD));
+    TEST_ASSERT_TRUE(decrypted == plain);
+}
+
+// Too many iterations would block the device, the header is refused before deriving anything
+static void test_rejects_bad_header(void) {
+    FS fs;
+    std::string decrypted;
+    encryptTo(fs, "/data.enc", plaintextOf(100));
+    std::string &data = fs.data("/data.enc")->data;
+    uint32_t iterations = ENC_KDF_MAX_ITERATIONS + 1;
+    memcpy(&data[9], &iterations, 4);
+    TEST_ASSERT_FALSE(decryptFrom(fs, "/data.enc", decrypted, 256, PASSWORD));
+    data[8] = 1; // version
+    File file = fs.open("/data.enc");
+    TEST_ASSERT_FALSE(isStreamEncrypted(file));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip_boundaries);
+    RUN_TEST(test_round_trip_large);
+    RUN_TEST(test_rejects_tampering);
+    RUN_TEST(test_rejects_bad_header);
+    return UNITY_END();
+}
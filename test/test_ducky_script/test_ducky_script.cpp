@@ -0,0 +1,240 @@
+// Golden HID reports of DuckyScript, run as ducky_typer.cpp runs it: pio test -e native
+#include "../../lib/Bad_Usb_Lib/KeyboardLayout_en_US.cpp"
+#include "../../src/modules/badusb_ble/ducky_script.cpp"
+#include "../../src/modules/badusb_ble/string_injector.cpp"
+#include <Bad_Usb_Lib.h>
+#include <string>
+#include <unity.h>
+#include <vector>
+
+extern const uint8_t KeyboardLayout_en_US[128];
+
+// USB keyboard that logs its reports as "modifiers 00 keys", with the key handling of USBHIDKeyboard
+class ReportKeyboard : public HIDInterface {
+public:
+    std::vector<std::string> log;
+
+    const uint8_t *getLayout() override { return KeyboardLayout_en_US; }
+    bool sendKeys(uint8_t modifiers, const uint8_t *keys) override {
+        _mods = modifiers;
+        memcpy(_keys, keys, sizeof(_keys));
+        report();
+        return true;
+    }
+
+    size_t press(uint8_t k) override {
+        if (k >= 0x88) k -= 0x88;
+        else if (k >= 0x80) {
+            _mods |= 1 << (k - 0x80);
+            k = 0;
+        } else if (!(k = ascii(k))) return 0;
+        return pressRaw(k);
+    }
+    size_t pressRaw(uint8_t k) override {
+        if (!k) return 0; // a modifier goes out with the next key
+        if (!memchr(_keys, k, sizeof(_keys))) {
+            uint8_t *slot = (uint8_t *)memchr(_keys, 0, sizeof(_keys));
+            if (!slot) return 0;
+            *slot = k;
+        }
+        report();
+        return 1;
+    }
+    size_t release(uint8_t k) override {
+        if (k >= 0x88) k -= 0x88;
+        else if (k >= 0x80) {
+            _mods &= ~(1 << (k - 0x80));
+            k = 0;
+        } else if (!(k = ascii(k, true))) return 0;
+        for (uint8_t &key : _keys) {
+            if (k && key == k) key = 0;
+        }
+        report();
+        return 1;
+    }
+    void releaseAll() override {
+        _mods = 0;
+        memset(_keys, 0, sizeof(_keys));
+        report();
+    }
+    size_t write(uint8_t c) override {
+        size_t n = press(c);
+        release(c);
+        return n;
+    }
+    size_t write(const uint8_t *buf, size_t len) override {
+        size_t n = 0;
+        for (; len--; buf++) {
+            if (*buf != '\r' && write(*buf)) n++;
+        }
+        return n;
+    }
+
+private:
+    // Key of an ASCII char, its modifier added to (or taken from) the report
+    uint8_t ascii(uint8_t c, bool up = false) {
+        uint8_t k = c < 128 ? KeyboardLayout_en_US[c] : 0;
+        uint8_t mod = 0;
+        if ((k & ALT_GR) == ALT_GR) {
+            mod = 0x40;
+            k &= 0x3F;
+        } else if ((k & SHIFT) == SHIFT) {
+            mod = 0x02;
+            k &= 0x7F;
+        }
+        if (up) _mods &= ~mod;
+        else _mods |= mod;
+        return k == ISO_REPLACEMENT ? ISO_KEY : k;
+    }
+    void report() {
+        char txt[32];
+        snprintf(
+            txt,
+            sizeof(txt),
+            "%02X 00 %02X %02X %02X %02X %02X %02X",
+            _mods,
+            _keys[0],
+            _keys[1],
+            _keys[2],
+            _keys[3],
+            _keys[4],
+            _keys[5]
+        );
+        log.push_back(txt);
+    }
+
+    uint8_t _mods = 0;
+    uint8_t _keys[6] = {0};
+};
+
+// duckyRun() of ducky_typer.cpp without the screen: delays are logged instead of waited
+static void run(
+    const DuckyScript &script, size_t first, size_t last, ReportKeyboard &kb, StringInjector &inj
+) {
+    const std::vector<DuckyOp> &ops = script.ops();
+    for (size_t i = first; i < last; i++) {
+        const DuckyOp &op = ops[i];
+        switch (op.code) {
+            case DuckyOp_Line:
+            case DuckyOp_Warn: break;
+            case DuckyOp_Press: kb.press(op.key); break;
+            case DuckyOp_ReleaseAll: kb.releaseAll(); break;
+            case DuckyOp_Print: inj.type(&kb, script.text(op), op.len); break;
+            case DuckyOp_PrintLn: kb.println(); break;
+            case DuckyOp_Delay: kb.log.push_back("DELAY " + std::to_string(op.arg)); break;
+            case DuckyOp_Repeat:
+                for (uint32_t n = 0; n < op.arg; n++) run(script, i + 1, i + 1 + op.len, kb, inj);
+                i += op.len;
+                break;
+        }
+    }
+}
+
+static std::vector<std::string> reportsOf(const char *text, bool pack = false) {
+    FS fs;
+    File file = fs.open("/payload.txt", FILE_WRITE);
+    file.print(text);
+    file = fs.open("/payload.txt");
+    ReportKeyboard kb;
+    StringInjector inj;
+    inj.setPacking(pack);
+    DuckyScript script;
+    while (script.compileChunk(file)) run(script, 0, script.ops().size(), kb, inj);
+    return kb.log;
+}
+
+static void assertReports(const std::vector<std::string> &expected, const std::vector<std::string> &actual) {
+    for (size_t i = 0; i < expected.size() && i < actual.size(); i++) {
+        TEST_ASSERT_EQUAL_STRING_MESSAGE(expected[i].c_str(), actual[i].c_str(), std::to_string(i).c_str());
+    }
+    TEST_ASSERT_EQUAL(expected.size(), actual.size());
+}
+
+#define RELEASED "00 00 00 00 00 00 00 00"
+
+// STRING, modifier combos, DELAY and REPEAT: one key a report, as write() types
+static void test_golden_reports(void) {
+    const std::vector<std::string> expected = {
+        "DELAY 500",
+        "08 00 15 00 00 00 00 00", // GUI r
+        RELEASED,
+        "DELAY 100",
+        "02 00 0B 00 00 00 00 00", // H
+        RELEASED,
+        "00 00 0C 00 00 00 00 00", // i
+        RELEASED,
+        "02 00 1E 00 00 00 00 00", // !
+        RELEASED,
+        "00 00 28 00 00 00 00 00", // ENTER
+        RELEASED,
+        "05 00 4C 00 00 00 00 00", // CTRL-ALT DELETE
+        RELEASED,
+        "03 00 29 00 00 00 00 00", // CTRL-SHIFT ESCAPE
+        RELEASED,
+    };
+    std::vector<std::string> aa = {
+        "00 00 04 00 00 00 00 00",
+        RELEASED,
+        "00 00 04 00 00 00 00 00",
+        RELEASED,
+        "00 00 28 00 00 00 00 00", // STRINGLN
+        RELEASED,
+    };
+    std::vector<std::string> all = expected;
+    for (int i = 0; i < 3; i++) all.insert(all.end(), aa.begin(), aa.end()); // the line and 2 repeats
+    all.push_back("00 00 50 00 00 00 00 00");                                // LEFTARROW
+    all.push_back(RELEASED);
+
+    assertReports(
+        all,
+        reportsOf(
+            "REM opens a terminal\r\n"
+            "DELAY 500\r\n"
+            "GUI r\r\n"
+            "DELAY\r\n"
+            "STRING Hi!\r\n"
+            "ENTER\r\n"
+            "CTRL-ALT DELETE\r\n"
+            "CTRL-SHIFT ESCAPE\r\n"
+            "STRINGLN aa\r\n"
+            "REPEAT 2\r\n"
+            "LEFTARROW\r\n"
+        )
+    );
+}
+
+// Packed keys: a group ends on a key already in it or other modifiers
+static void test_golden_packed_reports(void) {
+    assertReports(
+        {
+            "00 00 04 05 06 00 00 00", // abc
+            RELEASED,
+            "00 00 04 00 00 00 00 00", // a again
+            RELEASED,
+            "02 00 04 05 00 00 00 00", // AB
+            RELEASED,
+        },
+        reportsOf("STRING abcaAB\n", true)
+    );
+}
+
+// A REPEAT at the start of a chunk runs the last line of the previous one
+static void test_repeat_across_chunks(void) {
+    std::string text;
+    for (int i = 0; i < DUCKY_CHUNK_LINES - 1; i++) text += "REM filler\n";
+    text += "STRING x\nREPEAT 2\n";
+    std::vector<std::string> expected;
+    for (int i = 0; i < 3; i++) {
+        expected.push_back("00 00 1B 00 00 00 00 00");
+        expected.push_back(RELEASED);
+    }
+    assertReports(expected, reportsOf(text.c_str()));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_golden_reports);
+    RUN_TEST(test_golden_packed_reports);
+    RUN_TEST(test_repeat_across_chunks);
+    return UNITY_END();
+}
@@ -0,0 +1,160 @@
+// Host tests of FileIndex, the sorted and cached listings of the file browser: pio test -e native
+#include "../../src/core/file_index.cpp"
+#include <algorithm>
+#include <string>
+#include <unity.h>
+#include <vector>
+
+// checkExt() of sd_functions.cpp, that needs the display
+bool checkExt(String ext, String pattern) {
+    ext.toUpperCase();
+    pattern.toUpperCase();
+    for (int start = 0, end; start <= (int)pattern.length(); start = end + 1) {
+        end = pattern.indexOf('|', start);
+        if (end < 0) end = pattern.length();
+        if (ext == pattern.substring(start, end)) return true;
+    }
+    return false;
+}
+
+struct Entry {
+    std::string name;
+    bool folder;
+};
+
+// Folders first, then by name, case insensitive
+static std::vector<Entry> sorted(std::vector<Entry> entries) {
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        if (a.folder != b.folder) return a.folder;
+        std::string ua = a.name, ub = b.name;
+        for (char &c : ua) c = toupper((uint8_t)c);
+        for (char &c : ub) c = toupper((uint8_t)c);
+        return ua < ub;
+    });
+    return entries;
+}
+
+static std::vector<Entry> makeFolder(FS &fs, const std::string &path, int files, int folders) {
+    std::vector<Entry> entries;
+    const char *exts[] = {"sub", "ir", "txt"};
+    for (int i = 0; i < files; i++) {
+        // names sharing their first 8 chars, and mixed case, so the sort key alone isn't enough
+        char name[40];
+        const char *prefix = i % 2 ? "Capture" : "capture_long";
+        snprintf(name, sizeof(name), "%s_%03d.%s", prefix, i * 37 % 1000, exts[i % 3]);
+        fs.open((path + "/" + name).c_str(), FILE_WRITE).print("x");
+        entries.push_back({name, false});
+    }
+    for (int i = 0; i < folders; i++) {
+        std::string name = "Dir" + std::to_string(i);
+        fs.mkdir((path + "/" + name).c_str());
+        entries.push_back({name, true});
+    }
+    return sorted(entries);
+}
+
+static void assertListing(FileIndex &index, const std::vector<Entry> &expected) {
+    TEST_ASSERT_EQUAL(expected.size(), index.size());
+    // backwards too, so pages are read out of order
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t k = 0; k < expected.size(); k++) {
+            size_t i = pass ? expected.size() - 1 - k : k;
+            FileList item = index.get(i);
+            TEST_ASSERT_EQUAL_STRING(expected[i].name.c_str(), item.filename.c_str());
+            TEST_ASSERT_EQUAL(expected[i].folder, item.folder);
+        }
+    }
+}
+
+static size_t indexFiles(FS &fs) {
+    File dir = fs.open(FILE_INDEX_DIR);
+    size_t n = 0;
+    for (File f = dir.openNextFile(); f; f = dir.openNextFile()) n++;
+    return n;
+}
+
+// Small folders are listed in RAM and leave no index behind
+static void test_small_folder(void) {
+    FS fs;
+    std::vector<Entry> expected = makeFolder(fs, "/ir", 20, 3);
+    FileIndex index;
+    TEST_ASSERT_TRUE(index.open(fs, "/ir/"));
+    assertListing(index, expected);
+    TEST_ASSERT_FALSE(fs.exists(FILE_INDEX_DIR));
+    TEST_ASSERT_EQUAL(0, index.get(9999).filename.length());
+}
+
+// Big folders are saved, the next open reads the same listing from the index a page at a time
+static void test_big_folder_index(void) {
+    FS fs;
+    std::vector<Entry> expected = makeFolder(fs, "/BruceRF", 300, 5);
+    {
+        FileIndex index;
+        TEST_ASSERT_TRUE(index.open(fs, "/BruceRF"));
+        assertListing(index, expected);
+    }
+    TEST_ASSERT_EQUAL(1, indexFiles(fs));
+
+    // a new file isn't seen until the folder is checked or the index dropped
+    fs.open("/BruceRF/aaa.sub", FILE_WRITE).print("x");
+    FileIndex cached;
+    TEST_ASSERT_TRUE(cached.open(fs, "/BruceRF"));
+    assertListing(cached, expected);
+
+    FileIndex::invalidate(fs, "/BruceRF/");
+    expected.push_back({"aaa.sub", false});
+    expected = sorted(expected);
+    FileIndex listed;
+    TEST_ASSERT_TRUE(listed.open(fs, "/BruceRF"));
+    assertListing(listed, expected);
+}
+
+// verify() walks the folder while it is shown and lists it again when it changed
+static void test_verify_catches_changes(void) {
+    FS fs;
+    std::vector<Entry> expected = makeFolder(fs, "/data", 100, 0);
+    FileIndex index;
+    TEST_ASSERT_TRUE(index.open(fs, "/data")); // writes the index, only a cached listing is verified
+    TEST_ASSERT_TRUE(index.open(fs, "/data"));
+    for (int calls = 0; calls < 100; calls++) TEST_ASSERT_FALSE(index.verify()); // nothing changed
+
+    TEST_ASSERT_TRUE(index.open(fs, "/data"));
+    fs.remove(("/data/" + expected[0].name).c_str());
+    expected.erase(expected.begin());
+    bool changed = false;
+    int calls;
+    for (calls = 0; calls < 100 && !changed; calls++) changed = index.verify();
+    TEST_ASSERT_TRUE(changed);
+    TEST_ASSERT_EQUAL((100 + FILE_INDEX_VERIFY_STEP - 1) / FILE_INDEX_VERIFY_STEP, calls);
+    assertListing(index, expected);
+    TEST_ASSERT_FALSE(index.verify());
+}
+
+static void test_filter_and_find(void) {
+    FS fs;
+    std::vector<Entry> all = makeFolder(fs, "/mixed", 90, 2);
+    std::vector<Entry> expected;
+    for (const Entry &e : all) {
+        if (e.folder || e.name.find(".sub") != std::string::npos || e.name.find(".ir") != std::string::npos) {
+            expected.push_back(e);
+        }
+    }
+    FileIndex index;
+    TEST_ASSERT_TRUE(index.open(fs, "/mixed", "sub|IR"));
+    assertListing(index, expected);
+
+    // first "c" entry after the folders, wrapping around from the end
+    TEST_ASSERT_EQUAL(2, index.find('c', 0));
+    TEST_ASSERT_EQUAL(expected.size() - 1, index.find('C', expected.size() - 1));
+    TEST_ASSERT_EQUAL(0, index.find('d', 5));
+    TEST_ASSERT_EQUAL(-1, index.find('z', 0));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_small_folder);
+    RUN_TEST(test_big_folder_index);
+    RUN_TEST(test_verify_catches_changes);
+    RUN_TEST(test_filter_and_find);
+    return UNITY_END();
+}
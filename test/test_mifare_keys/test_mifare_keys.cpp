@@ -0,0 +1,151 @@
+// Host tests of MifareDictionary, the keys tried on Mifare Classic sectors: pio test -e native
+#define __GLOBALS__ // globals.h needs the whole firmware, the config and file systems are defined here
+#include <Arduino.h>
+#include <set>
+struct {
+    std::set<String> mifareKeys;
+} bruceConfig;
+bool sdcardMounted = false;
+
+#include "../../src/modules/rfid/mifare_keys.cpp"
+#include <algorithm>
+#include <string>
+#include <unity.h>
+#include <vector>
+
+FS SD;
+FS LittleFS;
+
+static std::string hex(const uint8_t *key) {
+    char txt[13];
+    snprintf(txt, sizeof(txt), "%02X%02X%02X%02X%02X%02X", key[0], key[1], key[2], key[3], key[4], key[5]);
+    return txt;
+}
+
+// Keys tried on a sector until `accepted` is found, all of them when it isn't there
+static std::vector<std::string>
+tried(MifareDictionary &dict, uint8_t sector, const std::string &accepted = "") {
+    std::vector<std::string> keys;
+    dict.findKey(sector, false, [&](const uint8_t *key) {
+        keys.push_back(hex(key));
+        return keys.back() == accepted ? 1 : 0;
+    });
+    return keys;
+}
+
+static const uint8_t uidA[4] = {0x04, 0x11, 0x22, 0x01};
+static const uint8_t uidB[4] = {0x04, 0x11, 0x22, 0x02}; // same system as A
+static const uint8_t uidC[7] = {0x04, 0x99, 0x88, 0x77, 0x66, 0x55, 0x44};
+
+static void reset() {
+    bruceConfig.mifareKeys.clear();
+    SD = FS();
+    LittleFS = FS();
+    sdcardMounted = false;
+}
+
+// Built in keys, then the config, then the file, each key once where it first appears
+static void test_order_and_dedup(void) {
+    reset();
+    bruceConfig.mifareKeys = {"11:22:33:44:55:66", "ffffffffffff", "bad key"};
+    File file = LittleFS.open(MIFARE_KEY_FILE, FILE_WRITE);
+    file.print("# comment line\r\n");
+    file.print("A0A1A2A3A4A5\r\n");                        // built in
+    file.print("aa bb cc 00 11 22 # inline comment\n");
+    file.print("112233445566\n");                          // config
+    file.print("AABBCC001122\n");                          // file
+    file.print("0123456789ABCDEF0123456789ABCDEF01234\n"); // too long
+    file.print("12345\n\n");
+    file.print("C0FFEE000001"); // no new line at the end
+    MifareDictionary dict;
+    dict.beginCard(uidA, 4);
+    std::vector<std::string> keys = tried(dict, 0);
+    TEST_ASSERT_EQUAL(DEFAULT_KEYS + 3, dict.size());
+    TEST_ASSERT_EQUAL(dict.size(), keys.size());
+    TEST_ASSERT_EQUAL_STRING("FFFFFFFFFFFF", keys[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("A0A1A2A3A4A5", keys[1].c_str());
+    TEST_ASSERT_EQUAL_STRING("00000FFE2488", keys[DEFAULT_KEYS - 1].c_str());
+    TEST_ASSERT_EQUAL_STRING("112233445566", keys[DEFAULT_KEYS].c_str());
+    TEST_ASSERT_EQUAL_STRING("AABBCC001122", keys[DEFAULT_KEYS + 1].c_str());
+    TEST_ASSERT_EQUAL_STRING("C0FFEE000001", keys[DEFAULT_KEYS + 2].c_str());
+    MifareDumpStats stats = dict.endCard();
+    TEST_ASSERT_EQUAL(dict.size(), stats.auths);
+    TEST_ASSERT_EQUAL(0, stats.cacheHits);
+}
+
+// A big file, mostly duplicates: the dictionary keeps one of each, in the order of the file
+static void test_large_file_dedup(void) {
+    reset();
+    sdcardMounted = true;
+    File file = SD.open(MIFARE_KEY_FILE, FILE_WRITE);
+    for (int i = 0; i < 20000; i++) {
+        char line[16];
+        snprintf(line, sizeof(line), "%012X\n", (i * 7) % 3000);
+        file.print(line);
+    }
+    MifareDictionary dict;
+    dict.beginCard(uidA, 4);
+    TEST_ASSERT_EQUAL(DEFAULT_KEYS + 3000, dict.size());
+    std::vector<std::string> keys = tried(dict, 0);
+    std::set<std::string> unique(keys.begin(), keys.end());
+    TEST_ASSERT_EQUAL(keys.size(), unique.size());
+    TEST_ASSERT_EQUAL_STRING("000000000000", keys[DEFAULT_KEYS].c_str());
+    TEST_ASSERT_EQUAL_STRING("000000000007", keys[DEFAULT_KEYS + 1].c_str());
+    dict.endCard();
+
+    // the file is read again only when it changed
+    SD.open(MIFARE_KEY_FILE, FILE_APPEND).print("D00D00D00D00\n");
+    dict.beginCard(uidA, 4);
+    TEST_ASSERT_EQUAL(DEFAULT_KEYS + 3001, dict.size());
+    dict.endCard();
+}
+
+// Keys found are tried first: the same sector of a card of the same system, then the keys of this card
+static void test_found_keys_first(void) {
+    reset();
+    bruceConfig.mifareKeys = {"010203040506", "0A0B0C0D0E0F"};
+    MifareDictionary dict;
+    dict.beginCard(uidA, 4);
+    TEST_ASSERT_EQUAL(DEFAULT_KEYS + 2, tried(dict, 1, "0A0B0C0D0E0F").size());
+    std::vector<std::string> keys = tried(dict, 2, "0A0B0C0D0E0F");
+    TEST_ASSERT_EQUAL(1, keys.size()); // found on this card
+    keys = tried(dict, 3, "010203040506");
+    TEST_ASSERT_EQUAL(DEFAULT_KEYS + 2, keys.size()); // the hot key, then the dictionary without it
+    TEST_ASSERT_EQUAL_STRING("0A0B0C0D0E0F", keys[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("010203040506", keys.back().c_str());
+    TEST_ASSERT_EQUAL(1, std::count(keys.begin(), keys.end(), "0A0B0C0D0E0F"));
+    MifareDumpStats stats = dict.endCard();
+    TEST_ASSERT_EQUAL(1, stats.cacheHits);
+
+    dict.beginCard(uidB, 4);
+    keys = tried(dict, 3, "010203040506");
+    TEST_ASSERT_EQUAL(1, keys.size()); // sector 3 of the same system
+    keys = tried(dict, 1, "0A0B0C0D0E0F");
+    TEST_ASSERT_EQUAL(1, keys.size());
+    TEST_ASSERT_EQUAL(2, dict.endCard().cacheHits);
+
+    // another system starts from the dictionary
+    dict.beginCard(uidC, 7);
+    TEST_ASSERT_EQUAL(DEFAULT_KEYS + 1, tried(dict, 3, "010203040506").size());
+    dict.endCard();
+}
+
+static void test_tag_gone(void) {
+    reset();
+    MifareDictionary dict;
+    dict.beginCard(uidA, 4);
+    int calls = 0;
+    int result = dict.findKey(0, true, [&](const uint8_t *) { return ++calls == 3 ? -1 : 0; });
+    TEST_ASSERT_EQUAL(-1, result);
+    TEST_ASSERT_EQUAL(3, calls);
+    dict.endCard();
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_order_and_dedup);
+    RUN_TEST(test_large_file_dedup);
+    RUN_TEST(test_found_keys_first);
+    RUN_TEST(test_tag_gone);
+    return UNITY_END();
+}
@@ -0,0 +1,118 @@
+// Host tests of PcapRing, the pcap records between the sniffer callback and the card: pio test -e native
+#include "../../src/modules/wifi/pcap_ring.cpp"
+#include <string>
+#include <unity.h>
+
+// Frames are filled with `seed`, so a record written twice or out of order shows in the file
+static std::string record(uint32_t seed, uint32_t len) {
+    const uint32_t hdr[4] = {seed, seed * 2, len, len};
+    std::string r((const char *)hdr, sizeof(hdr));
+    r.append(len, (char)seed);
+    return r;
+}
+
+static bool push(PcapRing &ring, uint32_t seed, uint32_t len) {
+    std::string frame(len, (char)seed);
+    return ring.push(seed, seed * 2, (const uint8_t *)frame.data(), len);
+}
+
+// Runs a writer until the ring is empty: stopWriter() drains everything left
+static void drainTo(PcapRing &ring, File &file) {
+    TEST_ASSERT_TRUE(ring.startWriter(&file));
+    ring.stopWriter();
+    TEST_ASSERT_EQUAL(0, ring.used());
+}
+
+// Records, and a record header, split at the end of the ring go to the file in order
+static void test_wrap_around(void) {
+    FS fs;
+    File file = fs.open("/wrap.pcap", FILE_WRITE);
+    PcapRing ring;
+    TEST_ASSERT_TRUE(ring.begin());
+    TEST_ASSERT_EQUAL(PCAP_RING_SIZE_RAM, ring.size());
+    std::string expected;
+
+    // the next header starts 8 bytes before the end of the ring
+    uint32_t first = PCAP_RING_SIZE_RAM - 8 - 16;
+    TEST_ASSERT_TRUE(push(ring, 1, first));
+    expected += record(1, first);
+    drainTo(ring, file);
+
+    for (uint32_t seed = 2; seed < 40; seed++) {
+        uint32_t len = 100 + seed * 37;
+        TEST_ASSERT_TRUE(push(ring, seed, len));
+        expected += record(seed, len);
+        if (seed % 8 == 0) drainTo(ring, file);
+    }
+    drainTo(ring, file);
+
+    TEST_ASSERT_EQUAL(0, ring.drops());
+    TEST_ASSERT_EQUAL(0, ring.lost());
+    TEST_ASSERT_EQUAL(expected.size(), ring.written());
+    TEST_ASSERT_TRUE(fs.data("/wrap.pcap")->data == expected);
+    ring.end();
+}
+
+// A record that doesn't fit is dropped whole, the ones already in the ring are kept
+static void test_drops_when_full(void) {
+    FS fs;
+    File file = fs.open("/full.pcap", FILE_WRITE);
+    PcapRing ring;
+    TEST_ASSERT_TRUE(ring.begin());
+    uint32_t fit = PCAP_RING_SIZE_RAM / (16 + 1000);
+    for (uint32_t seed = 0; seed < fit; seed++) TEST_ASSERT_TRUE(push(ring, seed, 1000));
+    TEST_ASSERT_FALSE(push(ring, 99, 1000));
+    TEST_ASSERT_FALSE(push(ring, 99, 1000));
+    TEST_ASSERT_EQUAL(2, ring.drops());
+    TEST_ASSERT_EQUAL(fit * 1016, ring.used());
+    TEST_ASSERT_EQUAL(fit * 1016, ring.highWater());
+
+    // a smaller one still fits in what is left
+    uint32_t left = PCAP_RING_SIZE_RAM - fit * 1016 - 16;
+    TEST_ASSERT_TRUE(push(ring, 98, left));
+    TEST_ASSERT_EQUAL(100, ring.highWaterPercent());
+    TEST_ASSERT_FALSE(push(ring, 97, 0));
+    TEST_ASSERT_EQUAL(3, ring.drops());
+
+    drainTo(ring, file);
+    TEST_ASSERT_EQUAL(PCAP_RING_SIZE_RAM, fs.data("/full.pcap")->data.size());
+    TEST_ASSERT_TRUE(push(ring, 1, 1000));
+    ring.resetStats();
+    TEST_ASSERT_EQUAL(0, ring.drops());
+    TEST_ASSERT_EQUAL(0, ring.highWater());
+    ring.end();
+}
+
+// A card that stops taking data: what it didn't take is counted and dropped, the ring doesn't stall
+static void test_lost_on_short_writes(void) {
+    FS fs;
+    File file = fs.open("/short.pcap", FILE_WRITE);
+    fs.data("/short.pcap")->writeLimit = 3000;
+    PcapRing ring;
+    TEST_ASSERT_TRUE(ring.begin());
+    for (uint32_t seed = 0; seed < 5; seed++) TEST_ASSERT_TRUE(push(ring, seed, 1000));
+    drainTo(ring, file);
+    TEST_ASSERT_EQUAL(3000, ring.written());
+    TEST_ASSERT_EQUAL(5 * 1016 - 3000, ring.lost());
+    TEST_ASSERT_EQUAL(3000, fs.data("/short.pcap")->data.size());
+
+    for (uint32_t seed = 0; seed < 2; seed++) TEST_ASSERT_TRUE(push(ring, seed, 1000));
+    drainTo(ring, file);
+    TEST_ASSERT_EQUAL(3000, ring.written());
+    TEST_ASSERT_EQUAL(7 * 1016 - 3000, ring.lost());
+
+    // without a file everything is lost
+    File none;
+    TEST_ASSERT_TRUE(push(ring, 1, 500));
+    drainTo(ring, none);
+    TEST_ASSERT_EQUAL(7 * 1016 - 3000 + 516, ring.lost());
+    ring.end();
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_wrap_around);
+    RUN_TEST(test_drops_when_full);
+    RUN_TEST(test_lost_on_short_writes);
+    return UNITY_END();
+}
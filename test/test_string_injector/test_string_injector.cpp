@@ -0,0 +1,150 @@
+// Host tests of StringInjector, the pacing and retries of raw keyboard reports: pio test -e native
+#include "../../lib/Bad_Usb_Lib/KeyboardLayout_en_US.cpp"
+#include "../../src/modules/badusb_ble/string_injector.cpp"
+#include <Bad_Usb_Lib.h>
+#include <functional>
+#include <string>
+#include <unity.h>
+#include <vector>
+
+extern const uint8_t KeyboardLayout_en_US[128];
+
+// BLE keyboard whose host takes a report when `accept(n)` says so, n counting the reports sent
+class HostKeyboard : public HIDInterface {
+public:
+    std::vector<std::string> log; // reports taken, as "modifiers keys"
+    std::vector<unsigned long> sentUs;
+    std::function<bool(size_t n)> accept = [](size_t) { return true; };
+    const uint8_t *layout = KeyboardLayout_en_US;
+    uint32_t intervalUs = 0;
+    std::string written;
+
+    const uint8_t *getLayout() override { return layout; }
+    uint32_t reportIntervalUs() override { return intervalUs; }
+    bool sendKeys(uint8_t modifiers, const uint8_t *keys) override {
+        sentUs.push_back(micros());
+        if (!accept(sentUs.size() - 1)) return false;
+        char txt[24];
+        snprintf(txt, sizeof(txt), "%02X %02X %02X %02X", modifiers, keys[0], keys[1], keys[2]);
+        log.push_back(txt);
+        return true;
+    }
+    size_t write(const uint8_t *buf, size_t len) override {
+        written.append((const char *)buf, len);
+        return len;
+    }
+};
+
+#define RELEASED "00 00 00 00"
+
+static void assertReports(const std::vector<std::string> &expected, const std::vector<std::string> &actual) {
+    for (size_t i = 0; i < expected.size() && i < actual.size(); i++) {
+        TEST_ASSERT_EQUAL_STRING_MESSAGE(expected[i].c_str(), actual[i].c_str(), std::to_string(i).c_str());
+    }
+    TEST_ASSERT_EQUAL(expected.size(), actual.size());
+}
+
+// One key a report, each released before the next one; '\r' and chars out of the layout are skipped
+static void test_one_key_a_report(void) {
+    HostKeyboard kb;
+    StringInjector inj;
+    TEST_ASSERT_EQUAL(3, inj.type(&kb, "a\rB\xE9\n", 5));
+    assertReports({"00 04 00 00", RELEASED, "02 05 00 00", RELEASED, "00 28 00 00", RELEASED}, kb.log);
+    TEST_ASSERT_EQUAL(3, inj.stats().chars);
+    TEST_ASSERT_EQUAL(6, inj.stats().reports);
+    TEST_ASSERT_EQUAL(0, inj.stats().retries);
+}
+
+// Packed: a key held goes up before it is pressed again, modifiers change with no key down
+static void test_packed_release(void) {
+    HostKeyboard kb;
+    StringInjector inj;
+    inj.setPacking(true);
+    TEST_ASSERT_EQUAL(9, inj.type(&kb, "abcdefgba", 9));
+    assertReports(
+        {
+            "00 04 05 06", // abcdef
+            RELEASED,      // b is still down
+            "00 0A 05 04", // gba
+            RELEASED,
+        },
+        kb.log
+    );
+    kb.log.clear();
+    TEST_ASSERT_EQUAL(3, inj.type(&kb, "aA1", 3));
+    assertReports({"00 04 00 00", RELEASED, "02 04 00 00", RELEASED, "00 1E 00 00", RELEASED}, kb.log);
+}
+
+// A refused report is sent again after a gap that doubles on each refusal
+static void test_refused_reports_are_retried(void) {
+    HostKeyboard kb;
+    kb.accept = [](size_t n) { return n != 1 && n != 2 && n != 3; };
+    StringInjector inj;
+    TEST_ASSERT_EQUAL(2, inj.type(&kb, "ab", 2));
+    assertReports({"00 04 00 00", RELEASED, "00 05 00 00", RELEASED}, kb.log);
+    TEST_ASSERT_EQUAL(7, inj.stats().reports);
+    TEST_ASSERT_EQUAL(3, inj.stats().retries);
+    TEST_ASSERT_GREATER_OR_EQUAL(INJECT_MIN_BACKOFF_US, kb.sentUs[2] - kb.sentUs[1]);
+    TEST_ASSERT_GREATER_OR_EQUAL(2 * INJECT_MIN_BACKOFF_US, kb.sentUs[3] - kb.sentUs[2]);
+    TEST_ASSERT_GREATER_OR_EQUAL(4 * INJECT_MIN_BACKOFF_US, kb.sentUs[4] - kb.sentUs[3]);
+    // the pace is kept for the next reports, until the host takes enough of them
+    TEST_ASSERT_GREATER_OR_EQUAL(4 * INJECT_MIN_BACKOFF_US, kb.sentUs[5] - kb.sentUs[4]);
+}
+
+// The host stopped taking reports: the chars typed before are returned, the keys are released once
+static void test_host_gone(void) {
+    HostKeyboard kb;
+    kb.accept = [](size_t n) { return n < 2; };
+    StringInjector inj;
+    TEST_ASSERT_EQUAL(1, inj.type(&kb, "abc", 3));
+    TEST_ASSERT_EQUAL(1, inj.stats().chars);
+    TEST_ASSERT_EQUAL(2 + INJECT_RETRIES + 1, inj.stats().reports);
+    TEST_ASSERT_EQUAL(INJECT_RETRIES + 1, inj.stats().retries);
+    TEST_ASSERT_EQUAL(2 + INJECT_RETRIES + 1 + 1, kb.sentUs.size()); // and the last release
+    for (size_t i = 3; i < kb.sentUs.size() - 1; i++) {
+        TEST_ASSERT_LESS_OR_EQUAL(INJECT_MAX_GAP_US * 2, kb.sentUs[i] - kb.sentUs[i - 1]);
+    }
+}
+
+// The gap starts at the interval of the host and shrinks while every report is taken, down to a quarter
+static void test_gap_shrinks(void) {
+    HostKeyboard kb;
+    kb.intervalUs = 800;
+    StringInjector inj;
+    std::string text(100, 'a');
+    TEST_ASSERT_EQUAL(100, inj.type(&kb, text.c_str(), text.size()));
+    TEST_ASSERT_EQUAL(200, kb.log.size());
+    unsigned long last = 0xFFFFFFFF;
+    for (size_t i = 1; i < kb.sentUs.size(); i++) {
+        unsigned long gap = kb.sentUs[i] - kb.sentUs[i - 1];
+        TEST_ASSERT_GREATER_OR_EQUAL(kb.intervalUs / INJECT_REPORTS_PER_INTERVAL, gap);
+        if (i < INJECT_SPEEDUP_AFTER) TEST_ASSERT_GREATER_OR_EQUAL(kb.intervalUs, gap);
+        if (i >= kb.sentUs.size() - INJECT_SPEEDUP_AFTER) last = min(last, gap);
+    }
+    TEST_ASSERT_LESS_THAN(kb.intervalUs * 3 / 4, last);
+    TEST_ASSERT_GREATER_THAN(0, inj.charsPerSecond());
+}
+
+// A keyboard that can't send raw reports types with write()
+static void test_write_fallback(void) {
+    HostKeyboard kb;
+    kb.layout = nullptr;
+    StringInjector inj;
+    TEST_ASSERT_EQUAL(5, inj.type(&kb, "hello", 5));
+    TEST_ASSERT_EQUAL_STRING("hello", kb.written.c_str());
+    TEST_ASSERT_TRUE(kb.sentUs.empty());
+    TEST_ASSERT_EQUAL(5, inj.stats().chars);
+    inj.resetStats();
+    TEST_ASSERT_EQUAL(0, inj.stats().chars);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_one_key_a_report);
+    RUN_TEST(test_packed_release);
+    RUN_TEST(test_refused_reports_are_retried);
+    RUN_TEST(test_host_gone);
+    RUN_TEST(test_gap_shrinks);
+    RUN_TEST(test_write_fallback);
+    return UNITY_END();
+}
@@ -0,0 +1,175 @@
+// Host tests of SubReader, the streaming .sub parser of the RF replay: pio test -e native
+#include "../../src/modules/rf/sub_reader.cpp"
+#include <new>
+#include <string>
+#include <unity.h>
+#include <vector>
+
+#define SUB_TEST_CHUNK 1024        // SUB_RAW_CHUNK of rf_send.h
+#define SUB_TEST_LINES 2000        // RAW_Data lines of the large file
+#define SUB_TEST_LINE_TIMINGS 512  // Flipper writes 512 timings a line
+#define SUB_TEST_MAX_MS 3000       // parse time budget of the large file, the device is much slower
+
+// Heap in use, counted by the operators below, so the parser's allocations can be measured
+static size_t heapUsed = 0;
+static size_t heapPeak = 0;
+
+void *operator new(size_t size) {
+    size_t *p = (size_t *)malloc(sizeof(size_t) + size);
+    if (!p) throw std::bad_alloc();
+    *p = size;
+    heapUsed += size;
+    if (heapUsed > heapPeak) heapPeak = heapUsed;
+    return p + 1;
+}
+
+void operator delete(void *ptr) noexcept {
+    if (!ptr) return;
+    size_t *p = (size_t *)ptr - 1;
+    heapUsed -= *p;
+    free(p);
+}
+
+void operator delete(void *ptr, size_t) noexcept { operator delete(ptr); }
+
+static int timingAt(size_t line, size_t i) {
+    int value = 50 + (line * 7919 + i * 104729) % 30000;
+    return i % 2 ? -value : value;
+}
+
+// Flipper layout: a header, then RAW_Data lines of alternating HIGH and LOW timings
+static std::string subFile(size_t lines, size_t perLine, const char *eol = "\n") {
+    std::string text = "Filetype: Flipper SubGhz RAW File";
+    text += eol;
+    text += "Version: 1";
+    text += eol;
+    text += "Frequency: 433920000";
+    text += eol;
+    text += "Preset: FuriHalSubGhzPresetOok650Async";
+    text += eol;
+    text += "Protocol: RAW";
+    text += eol;
+    for (size_t line = 0; line < lines; line++) {
+        text += "RAW_Data:";
+        for (size_t i = 0; i < perLine; i++) text += " " + std::to_string(timingAt(line, i));
+        text += eol;
+    }
+    return text;
+}
+
+struct ParseResult {
+    size_t lines = 0;
+    size_t timings = 0;
+    size_t chunks = 0;
+    bool ordered = true; // every timing is the one written at its place
+    std::string protocol;
+};
+
+// The loop of txSubFile(): RAW_Data goes chunk by chunk, the other values are read whole
+static ParseResult parse(File &file) {
+    ParseResult r;
+    static int timings[SUB_TEST_CHUNK + 1];
+    char key[24];
+    char value[64];
+    SubReader reader(file);
+    while (reader.nextKey(key, sizeof(key))) {
+        if (strcmp(key, "RAW_Data")) {
+            reader.readValue(value, sizeof(value));
+            if (!strcmp(key, "Protocol")) r.protocol = value;
+            continue;
+        }
+        bool lineDone = false;
+        size_t i = 0;
+        while (!lineDone) {
+            size_t n = reader.readTimings(timings, SUB_TEST_CHUNK, lineDone);
+            for (size_t j = 0; j < n; j++, i++) {
+                if (timings[j] != timingAt(r.lines, i)) r.ordered = false;
+            }
+            r.timings += n;
+            r.chunks++;
+        }
+        r.lines++;
+    }
+    return r;
+}
+
+// A file of about 6 MB, parsed without any allocation and in a bounded time
+static void test_large_raw_file(void) {
+    FS fs;
+    File file = fs.open("/large.sub", FILE_WRITE);
+    std::string text = subFile(SUB_TEST_LINES, SUB_TEST_LINE_TIMINGS);
+    file.write((const uint8_t *)text.data(), text.size());
+    text = std::string();
+    file = fs.open("/large.sub");
+
+    size_t heapBefore = heapUsed;
+    heapPeak = heapUsed;
+    unsigned long start = millis();
+    ParseResult r = parse(file);
+    unsigned long ms = millis() - start;
+    size_t peak = heapPeak - heapBefore;
+    printf(
+        "SubReader: %zu bytes, %zu timings in %lu ms, peak allocation %zu bytes\n",
+        file.size(),
+        r.timings,
+        ms,
+        peak
+    );
+
+    TEST_ASSERT_EQUAL_STRING("RAW", r.protocol.c_str());
+    TEST_ASSERT_EQUAL(SUB_TEST_LINES, r.lines);
+    TEST_ASSERT_EQUAL(SUB_TEST_LINES * SUB_TEST_LINE_TIMINGS, r.timings);
+    TEST_ASSERT_TRUE(r.ordered);
+    TEST_ASSERT_EQUAL(0, peak);
+    TEST_ASSERT_LESS_THAN(SUB_TEST_MAX_MS, ms);
+}
+
+// Lines longer than a chunk go out in several, CRLF and odd spacing are taken
+static void test_long_lines_and_crlf(void) {
+    for (size_t perLine : {SUB_TEST_CHUNK - 1, SUB_TEST_CHUNK, SUB_TEST_CHUNK + 1, 3 * SUB_TEST_CHUNK + 5}) {
+        FS fs;
+        File file = fs.open("/long.sub", FILE_WRITE);
+        file.print(subFile(3, perLine, "\r\n").c_str());
+        file = fs.open("/long.sub");
+        ParseResult r = parse(file);
+        TEST_ASSERT_EQUAL(3, r.lines);
+        TEST_ASSERT_EQUAL(3 * perLine, r.timings);
+        TEST_ASSERT_EQUAL(3 * ((perLine + SUB_TEST_CHUNK - 1) / SUB_TEST_CHUNK), r.chunks);
+        TEST_ASSERT_TRUE(r.ordered);
+    }
+}
+
+// Seeking back, as the replay of a capture does, drops what was buffered
+static void test_seek(void) {
+    FS fs;
+    File file = fs.open("/seek.sub", FILE_WRITE);
+    file.print("Protocol: RAW\nRAW_Data: 100 -200  +300\t-400 x 0 500\n");
+    file = fs.open("/seek.sub");
+    SubReader reader(file);
+    char key[24];
+    char value[64];
+    TEST_ASSERT_TRUE(reader.nextKey(key, sizeof(key)));
+    reader.readValue(value, sizeof(value));
+    size_t dataPos = reader.position();
+    TEST_ASSERT_EQUAL(14, dataPos);
+    for (int round = 0; round < 2; round++) {
+        TEST_ASSERT_TRUE(reader.nextKey(key, sizeof(key)));
+        TEST_ASSERT_EQUAL_STRING("RAW_Data", key);
+        int timings[8];
+        bool lineDone = false;
+        TEST_ASSERT_EQUAL(5, reader.readTimings(timings, 8, lineDone));
+        TEST_ASSERT_TRUE(lineDone);
+        const int expected[] = {100, -200, 300, -400, 500};
+        TEST_ASSERT_TRUE(memcmp(expected, timings, sizeof(expected)) == 0);
+        TEST_ASSERT_FALSE(reader.nextKey(key, sizeof(key)));
+        TEST_ASSERT_TRUE(reader.seek(dataPos));
+    }
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_large_raw_file);
+    RUN_TEST(test_long_lines_and_crlf);
+    RUN_TEST(test_seek);
+    return UNITY_END();
+}